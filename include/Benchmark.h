@@ -0,0 +1,81 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <Arduino.h>
+
+// Generated workload for one benchmark run; the same seed gives the same events
+struct BenchConfig {
+  uint8_t tracks = 4;              // Tracks recorded and played (from track 0)
+  uint32_t eventsPerTrack = 1000;  // Note events per track (NoteOn + NoteOff)
+  uint32_t loopBars = 4;
+  uint16_t ccEveryTicks = 4;       // Dense CC on track 0: one every this many ticks (0 = none)
+  uint16_t undoLevels = 32;        // Undo chain built on track 0, then undone level by level
+  uint8_t playPasses = 2;          // Loop passes timed per tick
+  uint16_t displayFrames = 20;
+  uint16_t editTurns = 200;        // Encoder detents of a note move (alternating direction)
+  uint8_t storageRuns = 2;         // saveState() / loadState() pairs
+  uint32_t seed = 1;
+};
+
+// Cycle statistics of one timed code path
+struct BenchCase {
+  const char* name = "";
+  uint32_t samples = 0;
+  uint32_t minCycles = UINT32_MAX;
+  uint32_t maxCycles = 0;
+  uint64_t totalCycles = 0;
+  bool ok = true;                  // The path produced the expected result
+
+  void add(uint32_t cycles) {
+    samples++;
+    totalCycles += cycles;
+    if (cycles < minCycles) minCycles = cycles;
+    if (cycles > maxCycles) maxCycles = cycles;
+  }
+};
+
+struct BenchReport {
+  static constexpr uint8_t MAX_CASES = 10;
+
+  BenchConfig config;
+  BenchCase cases[MAX_CASES];
+  uint8_t count = 0;
+  uint32_t elapsedMs = 0;
+
+  bool passed() const {
+    for (uint8_t i = 0; i < count; ++i) {
+      if (!cases[i].ok || cases[i].samples == 0) return false;
+    }
+    return count > 0;
+  }
+};
+
+/**
+ * @class Benchmark
+ * @brief Benchmark firmware: times the real hot paths on a reproducible workload.
+ *
+ * run() builds the workload from BenchConfig (N tracks of M note events, a track of dense CC,
+ * a long undo chain) with a fixed PRNG and times, on the DWT cycle counter, each call of the
+ * paths the looper runs: recording an event, one tick of playback over all tracks, a display
+ * frame, a note-move detent, one undo level, saveState() and loadState(). print() writes the
+ * report as one "BENCH key=value ..." line per case, so runs of two firmware versions can be
+ * diffed or parsed.
+ *
+ * Nothing is compiled in unless LOOPER_BENCH is defined (see the teensy41_bench environment in
+ * platformio.ini). That firmware boots into setup() instead of the looper: no clock, buttons or
+ * restore, DIN output off (its 31250 baud would pace the playback case), session files under
+ * LOOPER_STORAGE_DIR so the looper's own session is left alone. The default run starts at
+ * boot; send 'b' over USB serial to repeat it and 'B' for a heavy run on every track.
+ */
+#ifdef LOOPER_BENCH
+
+class Benchmark {
+public:
+  static void setup();                                        // Boot into the benchmark (from setup())
+  static BenchReport run(const BenchConfig& config);
+  static void print(const BenchReport& report, Print& out);
+  static void pollSerial();                                   // Handle 'b' / 'B' requests (from loop())
+};
+
+#endif
@@ -5,7 +5,7 @@
 #define BUTTONMANAGER_H
 
 #include <Arduino.h>
-#include <Bounce2.h>
+#include <cstdint>
 #include <vector>
 
 enum ButtonAction {
@@ -21,18 +21,32 @@ enum ButtonId {
     BUTTON_ENCODER = 2
 };
 
+// One input change, stamped at interrupt level
+struct InputEvent {
+    uint32_t micros;
+    uint8_t source;     // Button index, or ButtonManager::INPUT_SOURCE_ENCODER
+    int8_t value;       // Button: 1 pressed, 0 released. Encoder: +1 / -1 per detent
+};
+
 /**
  * @class ButtonManager
- * @brief Manages hardware button/debounce logic and detects press actions and encoder turns.
+ * @brief Captures button and encoder changes in pin-change interrupts and turns them into press
+ *        actions and encoder turns.
  *
- * Uses Bounce2 to debounce a configurable set of input pins. The update() method must
- * be called regularly (e.g., in loop()) to poll button states. It classifies button events
- * into ButtonAction types: none, short press, double press, or long press, and routes them
- * to handleButton() for application-specific handling. The encoder push is treated like a
- * button (ButtonId::BUTTON_ENCODER). Encoder rotation is tracked via internal position counters.
+ * Every button pin and both encoder pins raise a CHANGE interrupt. The ISR stamps the new level
+ * with micros() and queues it (an SpscRingBuffer; Teensy 4 serves all GPIO interrupts from one
+ * vector, so there is a single producer). The encoder is decoded in the ISR and queued once per
+ * detent. update() drains the queue, so nothing is polled and nothing is lost to a slow frame.
+ *
+ * Debouncing works on the capture stamps: the first edge that changes a button's level is
+ * accepted at once, and further edges within DEFAULT_DEBOUNCE_INTERVAL of it are ignored. If the
+ * contact settles on the other level inside that window, the change is accepted when the window
+ * ends. Press durations, double-tap windows and the encoder hold use the accepted stamps, and
+ * encoder acceleration uses the time between detents, so all of them are exact regardless of how
+ * late update() runs. The encoder push is treated like a button (ButtonId::BUTTON_ENCODER).
  *
  * Configuration:
- *   - setup(pins): initialize pins for debouncing.
+ *   - setup(pins): attach the button pins (and the encoder) to their interrupts.
  *   - DEFAULT_DEBOUNCE_INTERVAL: debounce time in ms.
  *
  * Timing constants:
@@ -41,30 +55,69 @@ enum ButtonId {
  */
 class ButtonManager {
 public:
+    static constexpr uint8_t MAX_BUTTONS = 4;
+    static constexpr uint8_t INPUT_SOURCE_ENCODER = 0xFF;
+
     ButtonManager();
 
     void setup(const std::vector<uint8_t>& pins);
-    void update();
+    void update() { update(micros()); }
+    void update(uint32_t nowMicros);
     void handleButton(ButtonId button, ButtonAction action);
 
+    // Interrupt level: called by the pin-change ISRs (and by host tests with their own stamps)
+    void captureButton(uint8_t index, bool pressed, uint32_t timeMicros);
+    void captureEncoder(bool pinA, bool pinB, uint32_t timeMicros);
+
+    bool isPressed(uint8_t index) const { return index < buttonCount && buttons[index].stable; }
+    uint32_t getDroppedInputCount() const;           // Edges lost to a full queue
+    // Steps per detent for a turn interval; coarse when moving note starts
+    static int encoderAcceleration(uint32_t intervalMicros, bool coarse);
+
     // Debounce interval in milliseconds accessable for all functions
     static const uint16_t DEFAULT_DEBOUNCE_INTERVAL = 10;
 
 private:
-    std::vector<Bounce> buttons;
-    // Helpers for long and double tap logic
-    std::vector<uint32_t> lastTapTime;
-    // Helpers for double tap logic
-    std::vector<uint32_t> pressTimes;
-    std::vector<bool> pendingShortPress;
-    std::vector<uint32_t> shortPressExpireTime;
+    struct Button {
+        uint8_t pin;
+        // Written by the ISR: last captured level, to skip repeats and resync after an overflow
+        volatile bool capturedPressed;
+        volatile uint32_t capturedMicros;
+        // Debouncer (update() only)
+        bool raw;                     // Level of the latest edge
+        uint32_t rawMicros;
+        bool stable;                  // Debounced level
+        uint32_t acceptedMicros;      // Stamp of the last accepted change
+        // Tap / long-press detection
+        bool pressSeen;               // Press accepted after the boot window
+        uint32_t pressMicros;
+        bool pendingShortPress;       // Waiting for a possible second tap
+        uint32_t shortPressExpireMicros;
+    };
+    Button buttons[MAX_BUTTONS];
+    uint8_t buttonCount = 0;
+    uint32_t setupMicros = 0;
+    uint32_t seenOverflows = 0;
+
+    // Encoder: quadrature state in the ISR, detents in update()
+    volatile uint8_t encoderPins = 0;
+    volatile int8_t encoderCount = 0;
+    uint32_t lastDetentMicros = 0;
+    int pendingEncoderDelta = 0;
 
     static constexpr uint16_t DOUBLE_TAP_WINDOW = 300;  // ms
     static const uint16_t LONG_PRESS_TIME = 600; // ms
+    static constexpr uint32_t BOOT_IGNORE_TIME = 1000;  // ms: pullups settle, no actions
 
-    int encoderPosition = 0;
-    int lastEncoderPosition = 0;
+    void onEdge(uint8_t index, bool pressed, uint32_t timeMicros);
+    void settle(uint8_t index, uint32_t nowMicros);
+    void accept(uint8_t index, bool pressed, uint32_t timeMicros);
+    void expireShortPress(uint8_t index, uint32_t nowMicros);
+    void dispatch(uint8_t index, ButtonAction action);
+    void onDetent(int8_t direction, uint32_t timeMicros);
+    void flushEncoder();
+    void updateEncoderHold(uint32_t nowMicros);
 };
 extern ButtonManager buttonManager;
 
-#endif // BUTTONMANAGER_H
\ No newline at end of file
+#endif // BUTTONMANAGER_H
@@ -5,12 +5,19 @@
 #define CLOCKMANAGER_H
 
 #include <Arduino.h>
+#include "RingBuffer.h"
 
 enum ClockSource {
   CLOCK_INTERNAL,
   CLOCK_EXTERNAL
 };
 
+// Record handed from the clock ISR to the main loop: "tick N elapsed at micros T"
+struct ClockTickEvent {
+  uint32_t tick;    // Tick number that just elapsed
+  uint32_t micros;  // micros() timestamp taken in the ISR
+};
+
 /**
  * @class ClockManager
  * @brief Provides and manages the global timing (tick) source for the MIDI looper.
@@ -19,6 +26,18 @@ enum ClockSource {
  * and/or processes external MIDI clock pulses. Handles MIDI Start/Stop commands, tracks the
  * current playback tick, and detects external clock presence with a timeout. Other modules call
  * getCurrentTick() to synchronize playback, recording, and UI updates.
+ *
+ * The tick timer ISR advances currentTick and hands each tick to loop() through an SPSC queue;
+ * processPendingTicks() plays them in order, and logging and track bookkeeping stay in loop().
+ * The ISR does write MIDI: as clock master (setClockMaster()) it sends every
+ * Config::TICKS_PER_CLOCK-th tick's Clock, and the armed Start or Song Position, through
+ * MidiHandler::queueClockOutput(). The other interrupt-level port writers are the input capture
+ * ISR (soft thru) and the OutputScheduler ISR (sub-tick events); MidiHandler serializes all of
+ * them with loop()'s writes.
+ *
+ * Ticks come from a Q16.16 phase accumulator; external 24 PPQN clock drives a phase-locked loop
+ * (Config::CLOCK_*), with getMeasuredBpm(), getSyncDriftTicks() and isSyncLocked() reporting it.
+ * Song Position Pointer and locate() re-seat the tracks through TrackManager::locateAll().
  */
 class ClockManager {
 public:
@@ -30,31 +49,100 @@ public:
   // --- Public methods ---
   void setup();
   void updateInternalClock();
-  void onMidiClockPulse();
+  void onMidiClockPulse() { onMidiClockPulse(micros()); }
+  void onMidiClockPulse(uint32_t pulseMicros);  // Pulse with its arrival timestamp
   void onMidiStart();
   void onMidiStop();
-  void checkClockSource();  // TODO: Implement clock source detection and switching
+  void onMidiContinue();                   // Resume from the current (or last located) position
+  void onSongPosition(uint16_t sixteenths);  // Song Position Pointer: move to this 16th
+  void locate(uint32_t tick);              // Jump the clock and re-seat every playing track
+  void checkClockSource();  // Fall back to the internal tempo when external pulses stop (call from loop())
   void setBpm(uint16_t newBpm);
   void setTicksPerQuarterNote(uint16_t newTicks);
-  void handleMidiClock();  // Handle incoming MIDI clock messages
+  void processPendingTicks();  // Drain ISR tick queue and update tracks (call from loop())
 
   // --- Accessors ---
   uint32_t getCurrentTick() const;
+  void getTickPosition(uint32_t& tick, uint16_t& fracQ16) const;  // Tick and fraction now (ISR-safe)
+  uint32_t microsAtTickFraction(uint16_t fracQ16) const;  // micros() of the tick being played + fracQ16
   bool isExternalClockPresent() const;
   void setExternalClockPresent(bool present);
   bool isClockRunning() const; // Returns true if either the internal or external clock is running
   uint32_t setLastMidiClockTime(uint32_t lastMidiClockTime);
 
+  // --- External sync status ---
+  float getMeasuredBpm() const;       // Tempo of the incoming clock (0 until two pulses were seen)
+  float getSyncDriftTicks() const;    // Phase error at the last pulse; positive = internal clock behind
+  bool isSyncLocked() const { return syncLocked; }
+
+  // --- Clock master output ---
+  void setClockMaster(bool enable);
+  bool isClockMaster() const { return clockMaster; }
+  bool isSendingClock() const { return masterOutput; }  // Master and on the internal tempo
+  void onClockOutput(uint32_t sentMicros);  // A Clock was written (MidiHandler, any context)
+  uint32_t getClockJitterMax() const { return clockJitterMax; }    // Microseconds
+  uint32_t getClockJitterMean() const;                             // Microseconds
+  uint32_t getClockOutputCount() const { return clockOutCount; }   // Clocks sent since the last reset
+  void resetClockJitter();
+
+  // --- Tick queue diagnostics ---
+  uint32_t getTickQueueHighWater() const { return tickQueue.getHighWaterMark(); }
+  uint32_t getDroppedTickEvents() const { return tickQueue.getOverflowCount(); }
+
+  static constexpr size_t TICK_QUEUE_SIZE = 64;  // ~160 ms of ticks at 120 BPM / 192 PPQN
+
 private:
   // --- Timing data ---
-  uint32_t microsPerTick;
+  uint32_t microsPerTick;             // Whole-microsecond timer period currently programmed
+  volatile uint32_t tickPeriodQ16;    // Exact tick period, Q16.16 microseconds
+  uint32_t periodFracQ16;             // Dither accumulator for the fractional part (ISR only)
   volatile uint32_t currentTick;
+  volatile uint8_t clockPhase;        // currentTick's tick within its MIDI clock, counted by the ISR
+  volatile uint8_t sixteenthPhase;    // ...and within its 16th
   volatile uint32_t lastMidiClockTime;
   volatile uint32_t lastInternalTickTime;
+  uint32_t playTickMicros;            // When the tick being played elapsed
+
+  // --- ISR -> loop() hand-off ---
+  SpscRingBuffer<ClockTickEvent, TICK_QUEUE_SIZE> tickQueue;
 
   // --- Clock detection ---
   bool externalClockPresent;
   const uint32_t midiClockTimeout = 500000; // 500ms: timeout for external clock
+
+  // --- External clock PLL ---
+  volatile bool syncActive;           // Following pulses: the ISR may not pass tickLimit
+  volatile uint32_t tickLimit;        // Last tick allowed before the next pulse arrives
+  uint32_t pulseBaseTick;             // Tick the first followed pulse was aligned to
+  uint32_t pulseCount;                // Pulses followed since pulseBaseTick
+  uint32_t lastPulseMicros;
+  uint64_t pulseIntervalQ16;          // Smoothed pulse interval, Q16.16 microseconds (0 = unknown)
+  int32_t syncDriftQ16;               // Phase error at the last pulse, Q16.16 ticks
+  uint8_t lockedPulses;
+  bool syncLocked;
+  bool syncAcquired;                  // A pulse has set pulseBaseTick since Start / clock loss
+  bool positionPending;               // Located while stopped: Continue plays from the new tick
+
+  // --- Clock master output ---
+  bool clockMaster;
+  volatile bool masterOutput;         // The ISR sends clock
+  volatile bool masterArmed;          // Send Start / Song Position + Continue at the next 16th
+  volatile bool clockOutRestart;      // Next Clock starts a new interval (not measured)
+  uint32_t lastClockOutMicros;
+  volatile uint32_t clockOutIntervals;  // Intervals measured since the last reset
+  volatile uint32_t clockOutCount;
+  volatile uint32_t clockJitterMax;
+  volatile uint64_t clockJitterTotal;
+
+  uint32_t internalTickPeriodQ16() const;
+  void setTickPeriod(uint32_t periodQ16);
+  void restartTimerPhase();           // Start a fresh tick period now (aligns ticks to a pulse)
+  void resetSync();
+  void playTick(uint32_t tick, uint32_t tickMicros);
+  void seatTick(uint32_t tick);       // Set currentTick and its phases (interrupts off or ISR stopped)
+  void updateMasterOutput();          // Start or stop sending clock as the clock source changes
+  void sendMasterClock(uint32_t tick, bool onSixteenth);  // ISR: the Clock of tick, after armed transport
+  void sendMasterPosition(uint32_t tick);  // loop(): transport for tick now, or arm it for the next 16th
 };
 
 extern ClockManager clockManager;
@@ -0,0 +1,59 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <MIDI.h>
+
+/**
+ * @class ControllerThinner
+ * @brief Thins continuous controller input (pitch bend, aftertouch, CC) before it is recorded.
+ *
+ * A wheel or pressure-sensitive key sends a value every few milliseconds while it moves. Each
+ * lane (message type, channel, and CC number or note) remembers the value it last let through.
+ * A new value passes when it moved at least the value deadband and at least the minimum interval
+ * has passed. Values that fail either test are held as the lane's pending value. The pending
+ * value is recorded at its own tick once the lane has been quiet for the minimum interval, so
+ * the value a gesture ends on is always kept. Repeats of the last value are dropped. The end
+ * points (0, the maximum, pitch bend centre) always pass, so a wheel returning to centre lands
+ * exactly. Switch-type CCs (bank select, 64-69, channel mode) are never thinned.
+ *
+ * This limits a lane to about one event per Config::CONTROLLER_MIN_INTERVAL_TICKS, whatever the
+ * sender's rate. Lanes live in a small fixed table; a new lane reuses the least recently active
+ * one after flushing its pending value.
+ */
+class ControllerThinner {
+public:
+    static constexpr uint8_t MAX_LANES = 16;
+
+    // Records one message (selected track); called for held values the thinner lets through later
+    using RecordFn = void (*)(midi::MidiType type, uint8_t channel, uint8_t data1, uint8_t data2, uint32_t tick);
+
+    // True when the message should be recorded now
+    bool accept(midi::MidiType type, uint8_t channel, uint8_t data1, uint8_t data2, uint32_t tick, RecordFn record);
+    // Record the pending values of lanes that went quiet (call regularly while recording)
+    void flushIdle(uint32_t tick, RecordFn record);
+    // Forget all lanes without recording (a new take starts from scratch)
+    void reset() { laneCount = 0; pendingCount = 0; }
+
+    static bool isThinned(midi::MidiType type, uint8_t data1);
+
+private:
+    struct Lane {
+        uint8_t type;
+        uint8_t channel;
+        uint8_t number;          // CC number or poly aftertouch note; 0 otherwise
+        bool pending;
+        uint16_t value;          // Last value let through
+        uint32_t tick;           // ...and its tick
+        uint32_t lastSeen;       // Tick of the newest message
+        uint8_t pendingData1, pendingData2;
+        uint32_t pendingTick;
+    };
+    Lane lanes[MAX_LANES];
+    uint8_t laneCount = 0;
+    uint8_t pendingCount = 0;    // Lanes holding a pending value (flushIdle() fast path)
+
+    Lane& laneFor(midi::MidiType type, uint8_t channel, uint8_t number, uint32_t tick, RecordFn record);
+    void flushLane(Lane& lane, RecordFn record);
+};
@@ -31,13 +31,37 @@ using DisplayNote = NoteUtils::DisplayNote;
  *
  * It consumes MIDI event data, clock ticks, and state from EditManager and TrackManager,
  * and must have its update() method called regularly (e.g., at ~30 FPS) to refresh the display.
+ *
+ * Rendering is incremental. The screen is split into four regions: status column, piano roll,
+ * info line and note line. Each frame, every region hashes the inputs that decide its pixels
+ * (letters and pulse level, playhead column, formatted strings, ...). Only regions whose hash
+ * changed are cleared and redrawn, and the frame is sent only if at least one region changed.
+ *
+ * The piano roll's grid and note bars are pre-rasterized into an off-screen layer per track.
+ * A layer is rebuilt only when the track's events generation or loop length changes (the pitch
+ * range follows from the events). Each redraw copies the layer rows into the frame and then draws
+ * the selection highlight, bracket and playhead on top, so frame cost does not grow with note count.
+ *
+ * The overview (setOverview(), encoder double press) replaces the piano roll with one activity
+ * strip per track, drawn from each track's TrackSummary: a column's brightness follows its note
+ * count, controller-only columns are dim, and each strip has its own playhead. The summaries are
+ * kept current per recorded or edited event, so drawing the overview costs NUM_TRACKS x
+ * Config::OVERVIEW_COLUMNS whatever the event counts, and switching tracks rebuilds nothing.
+ *
+ * updateSlice() draws a frame in resumable steps (one region per step, then the transfer) until
+ * its time budget is used, so the main-loop scheduler can poll MIDI input between them.
+ * update() draws a whole frame at once.
  */
 class DisplayManager {
 public:
     DisplayManager();
     void setup();
-    void update();
+    void update();                            // Whole frame
+    bool updateSlice(uint32_t budgetMicros);  // Next regions of the frame; true when the frame is done
     void clearDisplayBuffer();
+    void setOverview(bool enable);            // All tracks as activity strips instead of the piano roll
+    void toggleOverview() { setOverview(!_overview); }
+    bool isOverview() const { return _overview; }
 
     // Margin for piano roll, info area and note info
     static constexpr int TRACK_MARGIN = 22; 
@@ -55,7 +79,8 @@ public:
     // Helper functions for piano roll rendering
     void drawGridLines(uint32_t lengthLoop, int pianoRollY0, int pianoRollY1);
     void drawNoteBar(const DisplayNote& e, int y, uint32_t s, uint32_t eTick, uint32_t lengthLoop, int noteBrightness);
-    void drawAllNotes(const std::vector<MidiEvent>& midiEvents, uint32_t startLoop, uint32_t lengthLoop, int minPitch, int maxPitch);
+    void drawAllNotes(const std::vector<DisplayNote>& notes, uint32_t startLoop, uint32_t lengthLoop, int minPitch, int maxPitch);
+    int noteToPianoRollY(uint8_t note, int minPitch, int maxPitch) const;
     void drawBracket(uint32_t bracketTick, uint32_t lengthLoop, int pianoRollY1);
 
 private:
@@ -75,6 +100,38 @@ private:
     float _pulsePhase = 0.0f; // 0..1
     unsigned long _lastPulseUpdate = 0;
 
+    // Dirty-region tracking
+    enum Region : uint8_t { REGION_STATUS, REGION_PIANO_ROLL, REGION_INFO, REGION_NOTE, NUM_REGIONS };
+    uint32_t _regionKey[NUM_REGIONS] = {};
+    bool _regionValid[NUM_REGIONS] = {};
+    bool _frameDirty = false;
+    // Frame in progress (updateSlice)
+    enum FrameStage : uint8_t { FRAME_IDLE, FRAME_STATUS, FRAME_PIANO_ROLL, FRAME_INFO, FRAME_NOTE, FRAME_SEND, FRAME_DONE };
+    FrameStage _frameStage = FRAME_IDLE;
+    uint32_t _frameTick = 0;
+    uint32_t _frameMillis = 0;
+    uint8_t _frameTrack = 0;
+    // Returns false when `key` matches what the region shows; otherwise clears the region for redraw
+    bool beginRegion(Region region, uint32_t key);
+    void invalidateRegions();
+
+    // Pre-rasterized grid and notes of one track (rows 0..PIANO_ROLL_ROWS-1 at full display width)
+    static constexpr int PIANO_ROLL_ROWS = 32;
+    struct PianoRollLayer {
+        uint8_t* pixels = nullptr;  // Same 4bpp packing as the frame buffer; allocated on first use
+        uint32_t generation = 0;    // Track events generation it was built from, 0 = not built
+        uint32_t loopLength = 0;
+        Timing::Meter meter;        // Meter of its grid lines
+        int minPitch = 60;
+        int maxPitch = 72;
+    };
+    PianoRollLayer _layers[Config::NUM_TRACKS];
+    uint8_t* _drawTarget = nullptr;  // Buffer the piano-roll helpers draw into; nullptr = frame buffer
+    uint8_t* drawTarget() { return _drawTarget ? _drawTarget : _display.api.getFrameBuffer(); }
+    // Returns the up-to-date layer for a track, or nullptr if no memory is available for it
+    PianoRollLayer* getPianoRollLayer(uint8_t trackIdx, Track& track);
+    bool _overview = false;
+
 
     // Edit Note bracket and highlight
     int tickToScreenX(uint32_t tick);
@@ -85,6 +142,8 @@ private:
     void drawTrackStatus(uint8_t selectedTrack, uint32_t currentMillis);
     // Piano roll rendering
     void drawPianoRoll(uint32_t currentTick, Track& selectedTrack);
+    // All-tracks overview rendering
+    void drawOverview(uint32_t currentTick, uint8_t selectedTrack);
     // Info area rendering
     void drawInfoArea(uint32_t currentTick, Track& selectedTrack);
     // Note info rendering
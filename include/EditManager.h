@@ -8,6 +8,7 @@
 #include "EditStartNoteState.h"
 #include "EditPitchNoteState.h"
 #include "MidiEvent.h"
+#include "TrackArena.h"
 #include <vector>
 #include <map>
 
@@ -72,7 +73,7 @@ public:
         uint8_t velocity;
         uint32_t startTick;
         uint32_t endTick;
-        std::vector<MidiEvent> events; // The original events for restoration
+        EventList events; // The original events for restoration
     };
     // Map: Track* -> note -> list of removed notes
     std::map<const Track*, std::map<uint8_t, std::vector<RemovedNote>>> temporarilyRemovedNotes;
@@ -86,12 +87,13 @@ public:
         int wrapCount = 0; // how many times the note has wrapped
         bool active = false;
         int movementDirection = 0; // -1 = left, 0 = none, 1 = right
-        std::vector<MidiEvent> deletedEvents; // Events that were deleted due to overlap
+        EventList deletedEvents; // Events that were deleted due to overlap
         std::vector<uint32_t> deletedEventIndices; // Original indices for restoration
         
         // Simple note storage for restoration
         struct DeletedNote {
             uint8_t note, velocity;
+            uint8_t channel = 1;     // Of the deleted events, used when the note is recreated
             uint32_t startTick, endTick;
             uint32_t originalLength; // Store original note length for consistent restoration
         };
@@ -4,13 +4,16 @@
 #pragma once
 #include "EditState.h"
 #include "NoteUtils.h"
+#include "NoteLanes.h"
 #include <vector>
 #include <utility>
 #include <cstdint>
 #include "MidiEvent.h"
+#include "TrackArena.h"
 // Forward declarations
 class EditManager;
 class Track;
+class EventEdit;
 
 class EditStartNoteState : public EditState {
 public:
@@ -29,7 +32,7 @@ private:
     using DisplayNote = NoteUtils::DisplayNote;
     /**
      * @brief Identify overlapping notes and decide which to shorten or delete.
-     * @param currentNotes Reconstructed display notes list
+     * @param candidates Notes of the moving pitch that overlap the new position (from the lanes)
      * @param movingPitch Pitch of the moving note
      * @param currentStart Original start tick of the moving note
      * @param newStart New start tick after movement
@@ -39,7 +42,7 @@ private:
      * @param notesToShorten Out list of notes to shorten (with new end tick)
      * @param notesToDelete Out list of notes to delete entirely
      */
-    static void findOverlaps(const std::vector<DisplayNote>& currentNotes,
+    static void findOverlaps(const std::vector<DisplayNote>& candidates,
                               uint8_t movingPitch,
                               uint32_t currentStart,
                               uint32_t newStart,
@@ -50,22 +53,21 @@ private:
                               std::vector<DisplayNote>& notesToDelete);
 
     /**
-     * @brief Apply shortening or deletion to MIDI events based on overlap decisions, reusing event index
-     * @param midiEvents List of MIDI events to modify.
+     * @brief Apply shortening or deletion to MIDI events based on overlap decisions
+     * @param edit Batch on the track's events that the changes are staged into.
      * @param notesToShorten Notes to shorten (pair of DisplayNote, new end tick).
      * @param notesToDelete Notes to delete entirely.
      * @param manager EditManager for recording deleted originals in undo list.
      * @param loopLength Loop length in ticks.
-     * @param onIndex Event index map for on events
-     * @param offIndex Event index map for off events
+     * @param lanes Per-pitch note lanes, updated to match
      */
-    static void applyShortenOrDelete(std::vector<MidiEvent>& midiEvents,
+    static void applyShortenOrDelete(EventEdit& edit,
                                      const std::vector<std::pair<DisplayNote, uint32_t>>& notesToShorten,
                                      const std::vector<DisplayNote>& notesToDelete,
                                      EditManager& manager,
                                      uint32_t loopLength,
-                                     NoteUtils::EventIndexMap& onIndex,
-                                     NoteUtils::EventIndexMap& offIndex);
+                                     NoteLanes& lanes);
 
     uint32_t initialHash = 0; // hash of midiEvents at onEnter for undo commit-on-exit
+    NoteLanes lanes;          // Per-pitch notes of the edited track, kept across the edit session
 }; 
\ No newline at end of file
@@ -9,8 +9,8 @@
  *  - Debug levels (DEBUG_* flags) and global debugLevel variable.
  *  - LCD, button, and encoder hardware pin assignments in LCD and Buttons namespaces.
  *  - Default MIDI channel and PPQN in MidiConfig namespace.
- *  - Track count, internal PPQN, time signature, and loop timing constants in Config namespace.
- *  - Runtime settings: bpm, ticksPerQuarterNote, quartersPerBar, ticksPerBar, and display timing.
+ *  - Track count, timing profile (internal PPQN, default meter), and loop timing constants in Config namespace.
+ *  - Runtime settings: bpm, ticksPerQuarterNote, and display timing (the running meter is timeSignature).
  *  - System helper functions: setupGlobals(), isBarBoundary(), loadConfig(), saveConfig().
  */
 #ifndef GLOBALS_H
@@ -18,6 +18,7 @@
 
 #pragma once
 #include <Arduino.h>
+#include "TimingProfile.h"
 
 // --------------------
 // Debug Configuration
@@ -65,20 +66,98 @@ namespace MidiConfig {
   const int CHANNEL = 1;      // Default MIDI channel
   const int PPQN = 24;        // MIDI clock pulses per quarter note
   const int CHANNEL_OMNI = 0; // Channel for listening to all MIDI channels
+  const bool SERIAL_RUNNING_STATUS = true;       // Omit repeated status bytes on the DIN output
+  const uint16_t RUNNING_STATUS_REFRESH_MS = 250; // Resend status after this long without DIN output
+  const uint32_t INPUT_CAPTURE_INTERVAL_US = 250;  // Input ISR period; under one DIN byte time (320 us)
+  const uint8_t INPUT_USB_BUDGET = 16;            // Messages a capture pass takes from the USB device port
+  const uint8_t INPUT_DIN_BUDGET = 8;             // ...from the DIN input (a pass sees one byte or so)
+  const uint8_t INPUT_HOST_BUDGET = 16;           // ...from the USB host port
+  const uint16_t INPUT_QUEUE_MESSAGES = 256;      // Merged input queue, all sources in arrival order
+  const uint16_t INPUT_SOURCE_SHARE = 128;        // Most one source may hold, so a flood leaves room for the others
+  const uint16_t THRU_QUEUE_EVENTS = 64;          // Thru output held while another writer has the ports
+  const bool USB_HOST_INPUT = true;               // Read controllers on the Teensy 4.1 USB host port
 }
 
 // --------------------
 // Track and Timing Configuration
 // --------------------
+#ifndef LOOPER_NUM_TRACKS
+#define LOOPER_NUM_TRACKS 16  // Build-time track count (-D LOOPER_NUM_TRACKS=n), 1-32
+#endif
+#ifndef LOOPER_PPQN
+#define LOOPER_PPQN 192       // Build-time internal resolution (-D LOOPER_PPQN=n), a multiple of 24 up to 960
+#endif
+#ifndef LOOPER_STORAGE_DIR
+#define LOOPER_STORAGE_DIR "" // Build-time card folder of the session files ('-D LOOPER_STORAGE_DIR="/dir"'), "" = root
+#endif
+
 namespace Config {
-  constexpr uint8_t  NUM_TRACKS = 4;                                   // Number of looper tracks
-  constexpr uint8_t  INTERNAL_PPQN = 192;                              // Internal resolution for timing
-  constexpr uint8_t  QUARTERS_PER_BAR = 4;                             // Time signature numerator (4/4 time) 
-  constexpr uint8_t  TICKS_PER_QUARTER_NOTE = INTERNAL_PPQN;           // For Musical Time naming consistency
-  constexpr uint8_t  TICKS_PER_CLOCK = (INTERNAL_PPQN / 24);           // 8 ticks per MIDI clock pulse (24 PPQN)
-  constexpr uint32_t TICKS_PER_BAR = INTERNAL_PPQN * QUARTERS_PER_BAR; // 768 or your default value (ticksPerQuarterNote * quartersPerBar)
-  constexpr uint32_t TICKS_PER_16TH_STEP = INTERNAL_PPQN / 4;          // 192 / 4 = 48 Ticks
+  constexpr uint8_t  NUM_TRACKS = LOOPER_NUM_TRACKS;                   // Number of looper tracks (one per MIDI channel at 16)
+  static_assert(NUM_TRACKS >= 1 && NUM_TRACKS <= 32, "TrackManager keeps per-track flags in 32-bit masks");
+  constexpr Timing::Profile TIMING = {LOOPER_PPQN, {4, 4}};           // Internal resolution and boot meter (4/4)
+  static_assert(TIMING.valid(), "PPQN must give whole MIDI clocks and 16ths; meter n/1..n/16, n 1-32");
+  static_assert(TIMING.ticksPerClock() * MidiConfig::PPQN == TIMING.ppqn, "MIDI clock is 24 PPQN");
+  constexpr uint16_t INTERNAL_PPQN = TIMING.ppqn;                      // Internal resolution for timing
+  constexpr uint8_t  QUARTERS_PER_BAR = TIMING.meter.numerator;        // Boot time signature numerator (4/4 time)
+  constexpr uint16_t TICKS_PER_QUARTER_NOTE = INTERNAL_PPQN;           // For Musical Time naming consistency
+  constexpr uint8_t  TICKS_PER_CLOCK = TIMING.ticksPerClock();         // 8 ticks per MIDI clock pulse (24 PPQN)
+  constexpr uint32_t TICKS_PER_BAR = TIMING.ticksPerBar(TIMING.meter); // 768: a bar of the boot meter (timeSignature has the current one)
+  constexpr uint32_t TICKS_PER_16TH_STEP = TIMING.ticksPer16th();      // 192 / 4 = 48 Ticks
+  constexpr uint8_t  METER_CHANGES = 8;                                // Meter changes kept for bar / beat lookup (older ones are dropped)
   constexpr uint8_t  MAX_UNDO_HISTORY = 99;
+  constexpr bool     CHASE_NOTES_ON_LOCATE = true;                     // Start/locate mid-note sounds the held notes
+  constexpr bool     CHASE_CONTROLLERS_ON_LOCATE = true;               // ...and resends the last CC / program values
+  constexpr bool     CONTROLLER_THINNING = true;                       // Thin pitch bend / aftertouch / CC input before recording
+  constexpr uint8_t  CONTROLLER_MIN_INTERVAL_TICKS = 4;                // At most one value per lane this often (end points excepted)
+  constexpr uint8_t  CONTROLLER_VALUE_DEADBAND = 2;                    // 7-bit steps a CC / aftertouch value must move
+  constexpr uint16_t PITCH_BEND_VALUE_DEADBAND = 64;                   // 14-bit steps a pitch bend value must move
+  constexpr bool     SUBTICK_OUTPUT = true;                            // Send swing / quantize fractions of a tick at their exact microsecond
+  constexpr uint16_t OUTPUT_QUEUE_EVENTS = 128;                        // Events waiting for their sub-tick deadline (more are sent at once)
+  constexpr uint32_t OUTPUT_RETRY_US = 20;                             // Scheduled output waits this long while another writer has the ports
+  constexpr uint16_t PLAYBACK_CATCHUP_BURST = 32;                      // Missed events a late tick sends per track; past that only NoteOffs
+  constexpr uint32_t PLAYBACK_CATCHUP_TICKS = TICKS_PER_16TH_STEP;     // Missed events later than this are dropped (NoteOffs still sent)
+  constexpr uint32_t SYSEX_STORE_BYTES = 16 * 1024;                    // SysEx bytes per track (events address them with 16-bit offsets)
+  constexpr uint16_t SYSEX_MAX_MESSAGE_BYTES = 512;                    // Longest SysEx message taken from USB or DIN input
+  constexpr uint32_t RECORD_RESERVE_EVENTS = 1024;                     // Event headroom reserved at the start of each take (at most an eighth of the arena)
+  constexpr uint8_t  OVERDUB_MAX_LAYERS = 8;                           // Overdub takes kept as layers; opening one more merges the oldest in
+  constexpr uint8_t  OVERDUB_FLATTEN_LAYERS = 4;                       // Sealed layers beyond this are merged in the background
+  constexpr uint32_t OVERDUB_LAYER_RESERVE_EVENTS = 128;               // Growth step of an overdub layer
+  constexpr uint32_t TRACK_ARENA_POOL_BYTES = 256 * 1024;              // Events + undo of all tracks in RAM2 (no PSRAM)
+  constexpr uint32_t TRACK_ARENA_BYTES = TRACK_ARENA_POOL_BYTES / NUM_TRACKS; // Per track in RAM2
+  constexpr uint8_t  TRACK_ARENA_EXTMEM_PERCENT = 75;                  // Share of the fitted PSRAM split between the tracks
+  constexpr uint32_t RECORD_MIN_FREE_EVENTS = 256;                    // Arena room a take needs to start (old undo evicted first)
+  constexpr uint32_t HEAP_MIN_FREE_BYTES = 16 * 1024;                  // RAM2 heap a take needs to start
+  constexpr uint8_t  MEMORY_WARN_PERCENT = 90;                         // Arena fill that highlights the display's memory field
+  constexpr uint16_t OVERVIEW_COLUMNS = 234;                           // Columns per track in the all-tracks overview (display width minus the status column)
+
+  // External clock PLL (24 PPQN in, INTERNAL_PPQN out)
+  constexpr uint8_t  CLOCK_TEMPO_SMOOTHING_SHIFT = 3;                  // Pulse-interval average weight 1/8
+  constexpr uint8_t  CLOCK_PHASE_CORRECTION_PULSES = 12;               // Phase error is pulled in over ~half a beat
+  constexpr uint32_t CLOCK_SLEW_PPM = 20000;                           // Max tick-period change per pulse (2%)
+  constexpr uint32_t CLOCK_LOCK_TOLERANCE_Q16 = 65536 / 2;             // |drift| under half a tick counts as in sync
+  constexpr uint8_t  CLOCK_LOCK_PULSES = 24;                           // In-tolerance pulses before reporting lock (1 beat)
+  constexpr uint8_t  CLOCK_RESYNC_TICKS = 2 * TICKS_PER_CLOCK;         // Falling further behind than this jumps ahead
+
+  // Clock master output (24 PPQN out while on the internal tempo)
+  constexpr bool     CLOCK_MASTER = true;                              // Send clock, Start/Stop and Song Position when no external clock is followed
+  constexpr uint8_t  CLOCK_OUTPUT_QUEUE = 16;                          // Clock / transport messages held while another writer has the ports
+
+  // Boot
+  constexpr uint32_t BOOT_SERIAL_WAIT_MS = 0;                          // Wait for a USB serial monitor at boot (2000 to see boot logs)
+
+  // SD card I/O (checkpoints are written and read in whole multi-sector blocks)
+  constexpr uint32_t SD_SECTOR_BYTES = 512;                            // Card sector; block writes start on a sector boundary
+  constexpr uint32_t STORAGE_BLOCK_BYTES = 8 * SD_SECTOR_BYTES;        // Staging buffer per open file: one card transfer
+
+  // Main-loop scheduler: slice budgets; pending ticks and MIDI input run between slices
+  constexpr uint32_t STORAGE_SLICE_BUDGET_US = 400;                    // SD journal / compaction / restore work per slice
+  constexpr uint32_t DISPLAY_SLICE_BUDGET_US = 400;                    // Display regions drawn per slice (at least one)
+  constexpr uint32_t CONTROL_SLICE_BUDGET_US = 100;                    // Buttons / looper state and serial command polls
+  constexpr uint32_t LAYER_FLATTEN_INTERVAL_MS = 50;                   // How often the background merge looks for surplus overdub layers
+
+  // Deferred logging
+  constexpr size_t   LOG_RING_RECORDS = 128;                           // Queued log messages before new ones are dropped
+  constexpr uint32_t LOG_DRAIN_BUDGET_US = 300;                        // Serial time per slice spent printing log messages
 }
  
 // --------------------
@@ -86,10 +165,7 @@ namespace Config {
 // --------------------
 extern float bpm;                          // Current tempo
 extern uint32_t ticksPerQuarterNote;       // MIDI resolution
-extern uint32_t quartersPerBar;            // Time signature numerator
-extern const uint32_t ticksPerBar;         // Computed as ticksPerQuarterNote * quartersPerBar
 extern uint32_t now;                       // Current time
-extern uint32_t lastDisplayUpdate;    
 
 // --------------------
 // System Functions
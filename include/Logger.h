@@ -4,6 +4,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include <type_traits>
 #include "MidiEvent.h"
 
 // Log levels
@@ -27,6 +28,36 @@ enum LogCategory {
   CAT_MOVE_NOTES = 7
 };
 
+// Messages above this level are removed at compile time, arguments included
+// (e.g. -D LOGGER_COMPILE_LEVEL=LOG_INFO for a release build)
+#ifndef LOGGER_COMPILE_LEVEL
+#define LOGGER_COMPILE_LEVEL LOG_DEBUG
+#endif
+
+/**
+ * @struct LogRecord
+ * @brief One deferred log message in binary form.
+ *
+ * The format string pointer serves as the message ID, so formats (and any %s arguments) must be
+ * string literals or other storage that outlives the record. Arguments are stored raw, with a
+ * 2-bit type tag per argument, and are only formatted when the record is drained.
+ */
+struct LogRecord {
+  static constexpr uint8_t MAX_ARG_WORDS = 8;
+  enum ArgType : uint8_t { ARG_INT = 0, ARG_INT64 = 1, ARG_DOUBLE = 2, ARG_STRING = 3 };
+
+  uint32_t timestampMs;
+  const char* format;
+  const char* event;        // logTrackEvent(): event name printed before the message
+  uint32_t tick;            // logTrackEvent(): tick printed after the event name
+  uint8_t level;
+  uint8_t category;
+  uint8_t argCount;
+  uint8_t argWords;
+  uint16_t argTypes;        // ArgType of argument i in bits 2i..2i+1
+  uint32_t args[MAX_ARG_WORDS];
+};
+
 /**
  * @class Logger
  * @brief Central logging utility with leveled and categorized message output.
@@ -38,31 +69,76 @@ enum LogCategory {
  *  - State transition logging
  *  - MIDI and track event logging with structured information
  *
- * The log level can be configured at runtime using setup(), and output is
- * prefixed with timestamps, levels, and categories.
+ * By default messages are deferred. A call stores a LogRecord (timestamp, format pointer, raw
+ * arguments) in a lock-free ring and returns, which is safe from the clock and input ISRs.
+ * drain(), called from loop(), formats the records and writes them to Serial within a time
+ * budget. It gives up early when the USB serial buffer is full rather than block. Records that
+ * do not fit in the ring are dropped and reported as a count. setDeferred(false) prints each
+ * message immediately instead, for bring-up or when chasing a crash.
+ *
+ * Levels above LOGGER_COMPILE_LEVEL compile to nothing. The runtime level set with setup() filters
+ * further, and output is prefixed with timestamps, levels, and categories.
  */
 class Logger {
 public:
   static void setup(LogLevel level = LOG_INFO);
-  
+  static void setDeferred(bool enabled) { deferred = enabled; }
+
+  // Write queued records to Serial for up to budgetMicros (call from loop())
+  static void drain(uint32_t budgetMicros);
+  static uint32_t getDroppedCount();
+
   // Log methods for different levels
-  static void error(const char* format, ...);
-  static void warning(const char* format, ...);
-  static void info(const char* format, ...);
-  static void debug(const char* format, ...);
-  static void trace(const char* format, ...);
+  template <typename... Args> static void error(const char* format, Args... args) {
+    log(CAT_GENERAL, LOG_ERROR, format, args...);
+  }
+  template <typename... Args> static void warning(const char* format, Args... args) {
+    log(CAT_GENERAL, LOG_WARNING, format, args...);
+  }
+  template <typename... Args> static void info(const char* format, Args... args) {
+    log(CAT_GENERAL, LOG_INFO, format, args...);
+  }
+  template <typename... Args> static void debug(const char* format, Args... args) {
+    log(CAT_GENERAL, LOG_DEBUG, format, args...);
+  }
+  template <typename... Args> static void trace(const char* format, Args... args) {
+    log(CAT_GENERAL, LOG_TRACE, format, args...);
+  }
 
   // Category-specific logging
-  static void log(LogCategory category, LogLevel level, const char* format, ...);
-  
+  template <typename... Args>
+  static void log(LogCategory category, LogLevel level, const char* format, Args... args) {
+    if (level > LOGGER_COMPILE_LEVEL) return;
+    if (currentLevel < level || !categoryEnabled[category]) return;
+    LogRecord rec;
+    begin(rec, level, category, format);
+    (pack(rec, args), ...);
+    submit(rec);
+  }
+
   // State transition logging
-  static void logStateTransition(const char* component, const char* fromState, const char* toState);
-  
+  static void logStateTransition(const char* component, const char* fromState, const char* toState) {
+    log(CAT_STATE, LOG_DEBUG, "%s state transition: %s -> %s", component, fromState, toState);
+  }
+
   // MIDI event logging
-  static void logMidiEvent(const MidiEvent& evt);
-  
+  static void logMidiEvent(const MidiEvent& evt) {
+    if (LOG_DEBUG > LOGGER_COMPILE_LEVEL) return;
+    logMidiEventRecord(evt);
+  }
+
   // Track event logging
-  static void logTrackEvent(const char* event, uint32_t tick, const char* format = nullptr, ...);
+  template <typename... Args>
+  static void logTrackEvent(const char* event, uint32_t tick, const char* format = nullptr, Args... args) {
+    if (LOG_DEBUG > LOGGER_COMPILE_LEVEL) return;
+    if (currentLevel < LOG_DEBUG || !categoryEnabled[CAT_TRACK]) return;
+    LogRecord rec;
+    begin(rec, LOG_DEBUG, CAT_TRACK, format);
+    rec.event = event;
+    rec.tick = tick;
+    (pack(rec, args), ...);
+    submit(rec);
+  }
 
   // Enable or disable logging for a given category
   static void setCategoryEnabled(LogCategory category, bool enabled);
@@ -71,12 +147,50 @@ private:
   static LogLevel currentLevel;
   static bool isInitialized;
   static bool categoryEnabled[];
-  
-  static void printPrefix(LogLevel level, LogCategory category = CAT_GENERAL);
-  static void printTimestamp();
-  static void printCategory(LogCategory category);
-  static void printLevel(LogLevel level);
+  static bool deferred;
+
+  static void begin(LogRecord& rec, LogLevel level, LogCategory category, const char* format);
+  static void submit(const LogRecord& rec);
+  static void logMidiEventRecord(const MidiEvent& evt);
+  static size_t formatRecord(const LogRecord& rec, char* out, size_t size);
+
+  // Append one argument and its type tag; arguments past MAX_ARG_WORDS are printed as '?'
+  template <typename T>
+  static void pack(LogRecord& rec, T value) {
+    using U = std::decay_t<T>;
+    uint8_t type;
+    uint32_t words[2] = {0, 0};
+    uint8_t count = 1;
+    if constexpr (std::is_floating_point_v<U>) {
+      double d = value;
+      memcpy(words, &d, sizeof(d));
+      type = LogRecord::ARG_DOUBLE;
+      count = 2;
+    } else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) {
+      words[0] = (uint32_t)(uintptr_t)value;
+      if constexpr (sizeof(uintptr_t) > 4) words[1] = (uint32_t)((uint64_t)(uintptr_t)value >> 32);
+      type = LogRecord::ARG_STRING;
+      count = sizeof(uintptr_t) > 4 ? 2 : 1;
+    } else if constexpr (std::is_pointer_v<U>) {
+      uint64_t v = (uint64_t)(uintptr_t)value;
+      memcpy(words, &v, sizeof(v));
+      type = LogRecord::ARG_INT64;
+      count = 2;
+    } else if constexpr (sizeof(U) > 4) {
+      uint64_t v = (uint64_t)value;
+      memcpy(words, &v, sizeof(v));
+      type = LogRecord::ARG_INT64;
+      count = 2;
+    } else {
+      words[0] = (uint32_t)(int32_t)value;
+      type = LogRecord::ARG_INT;
+    }
+    if (rec.argCount >= 8 || rec.argWords + count > LogRecord::MAX_ARG_WORDS) return;
+    rec.argTypes |= (uint16_t)type << (2 * rec.argCount);
+    for (uint8_t i = 0; i < count; ++i) rec.args[rec.argWords++] = words[i];
+    rec.argCount++;
+  }
 };
 
 // Global logger instance
-extern Logger logger; 
\ No newline at end of file
+extern Logger logger;
@@ -17,7 +17,8 @@
  * startPlayback, startOverdub, etc.) that queue state transitions (with optional
  * quantization) via the internal requestStateTransition().
  *
- * The setup() method initializes all subsystems, and update() should be called
+ * The setup() method mounts the SD card and starts the background restore of the saved state
+ * (StorageManager::beginRestore()), and update() should be called
  * regularly in the main loop to advance the looper state machine and propagate
  * clock ticks and user inputs to the appropriate modules.
  */
@@ -42,6 +43,7 @@ private:
   void requestStateTransition(LooperState targetState, bool quantize);
 
   LooperState state;
+  bool restoring = false;  // Boot restore running; the LED is lit until it completes
 };
 
 extern Looper looper;  // Global instance
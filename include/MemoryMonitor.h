@@ -0,0 +1,66 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <Arduino.h>
+#include <cstddef>
+#include <cstdint>
+
+class Track;
+
+// Bytes one track holds, by owner
+struct TrackMemoryUsage {
+  size_t eventBytes;          // midiEvents and overdub layers (capacity, the take's reserve included)
+  size_t undoBytes;           // midiHistory: resident overdub/edit levels
+  size_t clearUndoBytes;      // clearMidiHistory: full copies kept by "clear"
+  size_t editBytes;           // EditManager's deleted / removed notes while this track is edited
+  size_t playbackBytes;       // Both playback buffers, the published one and the next (arena)
+  size_t sysexBytes;          // SysEx store (capacity)
+  uint16_t undoLevels;        // Resident levels
+  uint16_t pagedUndoLevels;   // Levels still on the SD card (no RAM)
+  size_t arenaUsed;           // The track's TrackArena, block headers included
+  size_t arenaCapacity;
+  size_t arenaLargestFree;
+  uint32_t arenaOverflows;    // Allocations that fell back to the heap
+};
+
+// Whole-board figures; all zero with measured == false on a host build
+struct SystemMemoryUsage {
+  bool measured;
+  size_t ram1Free;            // RAM1 (DTCM): stack headroom above .bss
+  size_t ram1FreeLowWater;    // ...least seen by sample() since boot
+  size_t ram2Free;            // RAM2 (DMAMEM): heap above the break plus freed blocks
+  size_t heapUsed;            // Heap handed out now (track arenas without PSRAM included)
+  size_t heapHighWater;       // Highest heap break seen by sample() since boot
+};
+
+/**
+ * @class MemoryMonitor
+ * @brief Memory accounting per track and for the board, plus the limits that act on it.
+ *
+ * trackUsage() splits a track's RAM into events, undo levels, clear-undo copies, edit-state
+ * buffers and SysEx bytes, next to the fill of its TrackArena. systemUsage() reads free RAM1 and RAM2 and the
+ * heap from the Teensy linker symbols and newlib's mallinfo(). sample() keeps the heap high-water
+ * mark and the RAM1 low-water mark; call it from loop(). Send 'm' over USB serial for dump().
+ * The display shows the selected track's arena use on the info line.
+ *
+ * The limits act before an allocation fails. admitRecording() refuses a new take or overdub
+ * when RAM2 is under Config::HEAP_MIN_FREE_BYTES, or when the arena cannot give the take
+ * Config::RECORD_MIN_FREE_EVENTS of room even after old undo levels are evicted
+ * (TrackUndo::makeArenaRoom). Track growth during a take evicts undo levels the same way before
+ * it declares the track full.
+ */
+class MemoryMonitor {
+public:
+  static TrackMemoryUsage trackUsage(const Track& track);
+  static SystemMemoryUsage systemUsage();
+  static void sample();                          // Update the high/low-water marks
+  static void dump(Print& out);
+  static void pollSerial();                      // Handle 'm' requests (call from loop())
+
+  // True when the track may start a take (overdub keeps the current events)
+  static bool admitRecording(Track& track, bool overdub);
+  // Arena fill of a track in percent, for the display
+  static uint8_t arenaPercent(const Track& track);
+  static bool nearLimit(const Track& track);     // At Config::MEMORY_WARN_PERCENT or RAM2 low
+};
@@ -15,6 +15,10 @@
  * aftertouch, program change, SysEx, clock/transport messages, etc.).
  * Provides static factory methods (NoteOn, NoteOff, ControlChange, etc.) and
  * clamping utility functions to enforce valid MIDI ranges.
+ *
+ * The struct is packed to 8 bytes (32-bit tick, type, channel, two data bytes) because it
+ * is the storage format of Track::midiEvents, undo history and the SD files. It holds
+ * no pointers: SysEx events carry a 16-bit offset into their track's SysEx store.
  * @note This struct is tightly coupled to the external MIDI library (<MIDI.h>) and
  *       uses the midi::MidiType enumeration defined there; changes to that enum
  *       may require corresponding updates here.
@@ -33,10 +37,7 @@ struct MidiEvent {
         int16_t pitchBend;                              // Pitch Bend (-8192 to +8191)
 
         // System Common Messages
-        struct {                                        // System Exclusive
-            const uint8_t* data;                        // Pointer to SysEx data
-            uint16_t length;                            // Length of SysEx data
-        } sysexData;
+        uint16_t sysexOffset;                           // System Exclusive: offset into the track's SysEx store
         uint8_t timeCode;                               // MIDI Time Code Quarter Frame
         uint16_t songPosition;                          // Song Position Pointer (14-bit)
         uint8_t songNumber;                             // Song Select (0-127)
@@ -51,8 +52,8 @@ struct MidiEvent {
         // - SystemReset
     } data;
 
-    // Default constructor
-    MidiEvent() : tick(0), type(midi::InvalidType), channel(0) {}
+    // Default constructor (data zeroed so events compare bytewise)
+    MidiEvent() : tick(0), type(midi::InvalidType), channel(0), data{} {}
 
     // Helper for clamping values to MIDI range with runtime error reporting
     static uint8_t clampChannel(uint8_t channel) {
@@ -161,12 +162,12 @@ struct MidiEvent {
     }
 
     // System Common Message Constructors
-    static MidiEvent SysEx(uint32_t tick, const uint8_t* data, uint16_t length) {
+    static MidiEvent SysEx(uint32_t tick, uint16_t storeOffset) {
         MidiEvent evt;
         evt.tick = tick;
         evt.type = midi::SystemExclusive;
         evt.channel = 0;  // System messages don't use channel
-        evt.data.sysexData = {data, length};
+        evt.data.sysexOffset = storeOffset;
         return evt;
     }
 
@@ -247,3 +248,5 @@ struct MidiEvent {
     }
 };
 
+static_assert(sizeof(midi::MidiType) == 1, "MidiEvent packing relies on a one-byte MidiType");
+static_assert(sizeof(MidiEvent) == 8, "MidiEvent is the packed storage format of tracks and SD files");
@@ -0,0 +1,38 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @class MidiFile
+ * @brief Standard MIDI File (type 1) export and import of all tracks on the SD card.
+ *
+ * exportSession() writes a conductor track (tempo, time signature) and one MTrk per Track, in
+ * track order, empty tracks included so track numbers survive a round trip. Ticks are written at
+ * Config::INTERNAL_PPQN with delta-time varints and running status; NoteOffs without a release
+ * velocity are written as NoteOn velocity 0 so a track of notes is one status byte. Each MTrk
+ * carries its loop length as a sequencer-specific meta event and ends at the loop end. The file
+ * is written to a temporary name and renamed into place once complete. SysEx events are not
+ * exported (their payload lives in the track's SysEx store, not in the event).
+ *
+ * importSession() reads type 0 and type 1 files with a PPQN division. Each MTrk holding channel
+ * messages or a loop length goes into the next track (the first MTrk of a type 1 file is
+ * usually the conductor and holds neither), rescaled to Config::INTERNAL_PPQN. Meta and SysEx events are skipped except
+ * the first tempo, the first time signature (the running meter from the next bar line) and the
+ * loop length. Without a loop length the loop ends at the end-of-track or last event, rounded up
+ * to a whole bar of that meter. Tracks receiving events are cleared first with a
+ * clear-undo snapshot, and end up stopped.
+ *
+ * Both directions stream through a fixed BUFFER_BYTES buffer; the file is never held in RAM,
+ * and imported events go straight into each track's arena through Track::insertEvent().
+ */
+class MidiFile {
+public:
+    static constexpr size_t BUFFER_BYTES = 512;
+    static constexpr const char* DEFAULT_PATH = "/midilooper.mid";
+
+    static bool exportSession(const char* path = DEFAULT_PATH);
+    static bool importSession(const char* path = DEFAULT_PATH);
+};
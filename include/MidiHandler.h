@@ -5,11 +5,73 @@
 #define MIDIHANDLER_H
 
 #include <Arduino.h>
+#include "Globals.h"
 #include "MidiEvent.h"
+#include "ControllerThinner.h"
 
-enum InputSource {
-  SOURCE_USB,
-  SOURCE_SERIAL
+enum InputSource : uint8_t {
+  SOURCE_USB,       // USB device port (the computer)
+  SOURCE_SERIAL,    // 5-pin DIN on Serial8
+  SOURCE_USB_HOST,  // Controllers on the Teensy 4.1 USB host port
+  NUM_INPUT_SOURCES
+};
+
+// When an incoming message arrived, captured at interrupt level
+struct MidiInputStamp {
+  uint32_t micros;       // micros() at arrival
+  uint32_t tick;         // Clock tick at arrival
+  uint16_t tickFracQ16;  // How far towards the next tick it arrived
+  uint32_t nearestTick() const { return tick + (tickFracQ16 >= 0x8000 ? 1 : 0); }
+};
+
+// A message taken from the input queue
+struct InputMessage {
+  uint8_t type, channel, data1, data2;  // channel 1-16 (0 for system messages)
+  InputSource source;
+  MidiInputStamp stamp;
+  const uint8_t* sysex;                 // SysEx: F0 ... F7, valid until the next takeInput()
+  uint16_t sysexLength;
+};
+
+// Input stage counters of one source
+struct InputSourceStats {
+  uint32_t messages = 0;   // Queued since boot
+  uint32_t overflows = 0;  // Dropped: SysEx too long, cut short or without queue room
+  uint32_t stalls = 0;     // Capture passes that left input in the port while the queue was full
+  uint16_t depth = 0;      // Messages waiting in the input queue now
+  uint16_t highWater = 0;  // Deepest it has been
+};
+
+// Output ports a route can send to
+enum RoutePort : uint8_t {
+  ROUTE_USB = 0x01,
+  ROUTE_DIN = 0x02
+};
+
+// Soft thru of one input source, forwarded from the input ISR
+struct ThruConfig {
+  bool enabled = false;
+  uint8_t ports = ROUTE_DIN;         // RoutePort bits the input goes out on
+  bool followSelectedTrack = false;  // Instead: through the selected track's route (ports, cable, channel, filter)
+  bool realTime = false;             // Also clock, Start / Stop / Continue and Song Position
+};
+
+// Kinds of channel message a route can leave out
+enum RouteFilter : uint8_t {
+  FILTER_NOTES       = 0x01,  // NoteOn and NoteOff
+  FILTER_POLY_AT     = 0x02,
+  FILTER_CC          = 0x04,
+  FILTER_PROGRAM     = 0x08,
+  FILTER_CHANNEL_AT  = 0x10,
+  FILTER_PITCH_BEND  = 0x20
+};
+
+// Where one track's playback goes
+struct TrackRoute {
+  uint8_t ports = ROUTE_USB | ROUTE_DIN;
+  uint8_t usbCable = 0;  // Virtual cable (0-15) on multi-port USB types
+  uint8_t channel = 0;   // 1-16 sends every channel message there; 0 keeps the recorded channel
+  uint8_t filter = 0;    // RouteFilter bits not sent
 };
 
 /**
@@ -22,6 +84,38 @@ enum InputSource {
  * provide a unified API (sendMidiEvent/sendNoteOn/sendClock/etc.) with
  * configurable routing to USB and/or Serial ports via setOutputUSB()
  * and setOutputSerial().
+ *
+ * Output is batched. Between beginOutputBatch() and endOutputBatch(), events are gathered, then
+ * sent together. TrackManager wraps each tick in a batch. On USB, channel messages go out as
+ * packed USB-MIDI packets followed by one usbMIDI.send_now(). On the DIN port (Serial8), the
+ * batch is written in one call using running status, which drops repeated status bytes. Running
+ * status restarts after a pause of MidiConfig::RUNNING_STATUS_REFRESH_MS, so a receiver plugged
+ * in mid-stream picks it up. Outside a batch, sendMidiEvent() sends at once.
+ *
+ * Each track has a TrackRoute (ports, USB cable, channel override, filter). setTrackRoute() and
+ * the global setOutputUSB()/setOutputSerial() switches recompile all routes into a small table.
+ * Each entry holds the ports left after the global switches, the cable, the channel and a
+ * pass mask by message kind. sendTrackEvent() then costs one table lookup per event.
+ * Everything sent without a track (clock, transport, sendNoteOn() and friends) uses the
+ * system entry, which only applies the global switches.
+ *
+ * One writer holds the ports at a time. loop() nests beginPortWrite(); the clock, OutputScheduler
+ * and input ISRs use claimPort() and queue or retry when it fails. Clock and thru output queued
+ * meanwhile goes out, ahead of the holder's data, before the ports are released.
+ *
+ * Input is captured by an IntervalTimer ISR (captureInput()) from the USB device, DIN and USB
+ * host ports, a budget per source in rotating order, into one queue stamped with the arrival tick.
+ * USB is read only while the pass holds the ports. handleMidiInput() dispatches it from loop().
+ *
+ * Soft thru: each capture pass forwards its messages per source's ThruConfig (setThru()), on
+ * fixed ports or through the selected track's route. SysEx is never forwarded.
+ *
+ * SysEx up to Config::SYSEX_MAX_MESSAGE_BYTES is recorded on the selected track (handleSysEx());
+ * sendTrackSysEx() plays it from the track's SysExStore.
+ *
+ * Pitch bend, channel and poly aftertouch and continuous CCs pass a ControllerThinner before they
+ * reach the selected track (switch with setControllerThinning(), Config::CONTROLLER_THINNING by
+ * default), so a wheel gesture records as a few dozen events instead of hundreds.
  */
 class MidiHandler {
 public:
@@ -32,11 +126,31 @@ public:
 
   // --- Input Handling ---
   void handleMidiInput();
-  void handleMidiMessage(byte type, byte channel, byte data1, byte data2, InputSource source);
+  void handleMidiMessage(byte type, byte channel, byte data1, byte data2, const MidiInputStamp& stamp);
+  void handleSysEx(const uint8_t* data, uint16_t length, const MidiInputStamp& stamp);  // F0 ... F7
+  void captureInput();  // Input timer ISR: take each source's budget of messages and stamp them
+  bool takeInput(InputMessage& msg);       // Next message of the input queue (loop()); false when empty
+  uint32_t getInputOverflowCount() const;  // Every source
+  uint32_t getInputHighWaterMark() const;  // Deepest input queue fill (messages)
+  InputSourceStats getInputStats(InputSource source) const;
 
   // --- MIDI Output ---
   // Use the new MidiEvent constructors for all MIDI output
-  void sendMidiEvent(const MidiEvent& event); // Unified event-based output
+  void sendMidiEvent(const MidiEvent& event); // Unified event-based output (system route)
+  void sendTrackEvent(uint8_t trackIndex, const MidiEvent& event);  // Through the track's route
+  // A complete SysEx message, written from the caller's bytes (no copy) after the pending batch
+  void sendTrackSysEx(uint8_t trackIndex, const uint8_t* data, uint16_t length);
+  void beginOutputBatch();                    // Gather output until the matching endOutputBatch()
+  void endOutputBatch();
+
+  // --- Scheduled output (OutputScheduler) ---
+  // Route a track event now, send it later: false when the route filters it out
+  bool routeTrackEvent(uint8_t trackIndex, const MidiEvent& event, MidiEvent& routed, uint8_t& dest);
+  void sendRouted(const MidiEvent& routed, uint8_t dest);  // A routed event into the batch
+  // Write routed events at once. Interrupt level only between claimPort() and releasePort()
+  void writeRouted(const MidiEvent* events, const uint8_t* dest, uint8_t count);
+  bool claimPort();                          // Interrupt level: take the ports if free, held output first
+  void releasePort() { endPortWrite(); }     // After claimPort(): send what was held meanwhile
 
   void sendNoteOn(uint8_t channel, uint8_t note, uint8_t velocity);
   void sendNoteOff(uint8_t channel, uint8_t note, uint8_t velocity);
@@ -50,14 +164,79 @@ public:
   void sendStart();
   void sendStop();
   void sendContinueMIDI();
+  void sendSongPosition(uint16_t sixteenths);
+  // Clock timer ISR: a real-time message (or Song Position), written now unless a port is busy
+  void queueClockOutput(midi::MidiType type, uint16_t songPosition = 0);
+  void flushClockOutput();  // Write clock output held by a busy port (loop())
+  uint32_t getClockOutputOverflowCount() const;
 
   // --- Output Routing ---
   void setOutputUSB(bool enable);
   void setOutputSerial(bool enable);
+  void setTrackRoute(uint8_t trackIndex, const TrackRoute& route);
+  const TrackRoute& getTrackRoute(uint8_t trackIndex) const;
+
+  // --- Thru ---
+  void setThru(InputSource source, const ThruConfig& config);
+  const ThruConfig& getThru(InputSource source) const;
+  uint32_t getThruForwardedCount() const { return thruForwarded; }
+  uint32_t getThruOverflowCount() const;  // Held while another writer had the ports and the queue was full
+
+  // --- Recording ---
+  void setControllerThinning(bool enable);
+  bool getControllerThinning() const { return thinControllers; }
 
 private:
   bool outputUSB = true;
   bool outputSerial = true;
+  bool thinControllers = Config::CONTROLLER_THINNING;
+  ControllerThinner controllerThinner;
+
+  // --- Routing ---
+  static constexpr uint8_t SYSTEM_ROUTE = Config::NUM_TRACKS;  // Last table entry
+  struct RouteEntry {
+    uint8_t dest;       // RoutePort bits left after the global switches, USB cable in the high nibble
+    uint8_t channel;    // 0 = keep
+    uint8_t passKinds;  // Bit (status >> 4) & 7 per channel-message kind; bit 7 = system messages
+  };
+  // Everything the send paths read, compiled from the routes, thru configs and global switches
+  struct RouteTables {
+    RouteEntry tracks[Config::NUM_TRACKS + 1];
+    RouteEntry thru[NUM_INPUT_SOURCES];  // passKinds 0 = off
+    uint8_t thruFollows;                 // Bit per source: through the selected track's route
+  };
+  TrackRoute routes[Config::NUM_TRACKS];
+  RouteTables routeTables[2];            // compileRoutes() fills the other one, then swaps the index
+  volatile uint8_t activeRoutes = 0;
+  const RouteTables& routing() const { return routeTables[activeRoutes]; }
+  void compileRoutes();
+  bool route(const RouteEntry& entry, const MidiEvent& event, MidiEvent& routed, uint8_t& dest) const;
+  bool applyRoute(const RouteEntry& entry, const MidiEvent& event, MidiEvent& routed, uint8_t& dest) const;  // No stress tap
+
+  // --- Thru ---
+  ThruConfig thru[NUM_INPUT_SOURCES];
+  volatile uint32_t thruForwarded = 0;
+  void forwardThru();                               // Input ISR, end of a capture pass
+  void enqueue(const RouteEntry& route, const MidiEvent& event);
+
+  // --- Output batch ---
+  static constexpr uint8_t OUTPUT_BATCH_SIZE = 64;  // Flushed early if a tick produces more
+  MidiEvent outBatch[OUTPUT_BATCH_SIZE];
+  uint8_t outDest[OUTPUT_BATCH_SIZE];               // RouteEntry::dest of each batched event
+  uint8_t outBatchCount = 0;
+  uint8_t batchDepth = 0;
+  uint8_t serialRunningStatus = 0;                  // 0 = next channel message sends its status
+  uint32_t lastSerialOutputMs = 0;
+  volatile uint8_t outputBusy = 0;                  // Nesting count of the writer holding the ports
+  void beginPortWrite();                            // Raise outputBusy; the outermost writer sends held clock and thru first
+  void endPortWrite();
+  void writeClockOutput();                          // Drain the clock output queue (port held)
+  void writeSystemRealTime(uint8_t type, uint16_t songPosition);
+  void flushOutput();
+  void writeThruOutput();                           // Drain the thru output queue (port held)
+  void sendUsb(const MidiEvent& event, uint8_t cable);
+  void sendSerialNonChannel(const MidiEvent& event);
+  size_t encodeSerialChannelMessage(const MidiEvent& event, uint8_t* out);
 
   // --- Message Handlers ---
   void handleNoteOn(byte channel, byte note, byte velocity, uint32_t tickNow);
@@ -65,6 +244,8 @@ private:
   void handleControlChange(byte channel, byte control, byte value, uint32_t tickNow);
   void handlePitchBend(byte channel, int pitchValue, uint32_t tickNow);
   void handleAfterTouch(byte channel, byte pressure, uint32_t tickNow);
+  void handlePolyAfterTouch(byte channel, byte note, byte pressure, uint32_t tickNow);
+  void recordController(midi::MidiType type, byte channel, byte data1, byte data2, uint32_t tickNow);
   void handleProgramChange(byte channel, byte program, uint32_t tickNow);
   void handleMidiStart();
   void handleMidiStop();
@@ -0,0 +1,47 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include "Globals.h"
+
+/**
+ * @class MidiParser
+ * @brief Byte-at-a-time MIDI 1.0 stream parser for the DIN input, safe at interrupt level.
+ *
+ * feed() takes one byte and returns true when it completes a message. Channel messages keep
+ * running status; real-time bytes (F8-FF) are reported at once, also between the bytes of
+ * another message or inside a SysEx, without disturbing it. System common messages cancel
+ * running status. SysEx (F0 ... F7) is collected in a fixed buffer of up to
+ * Config::SYSEX_MAX_MESSAGE_BYTES and reported whole; a longer one, or one cut short by another
+ * status byte, is dropped and counted. Data bytes without a status are ignored. Nothing is
+ * allocated and no byte costs more than a few comparisons.
+ */
+class MidiParser {
+public:
+  struct Message {
+    uint8_t type;     // midi::MidiType: status with the channel masked off for channel messages
+    uint8_t channel;  // 1-16; 0 for system messages
+    uint8_t data1;
+    uint8_t data2;
+  };
+
+  bool feed(uint8_t byte, Message& msg);
+  void reset();
+
+  // The SysEx feed() just reported (F0 ... F7), valid until the next feed()
+  const uint8_t* sysExData() const { return sysex; }
+  uint16_t sysExLength() const { return sysexLength; }
+  uint32_t getDroppedSysEx() const { return droppedSysEx; }
+
+private:
+  uint8_t status = 0;        // Running status, or the system common message being read (0 = none)
+  uint8_t needed = 0;        // Data bytes the message takes
+  uint8_t have = 0;
+  uint8_t data[2] = {};
+  bool inSysEx = false;
+  bool sysexOverflow = false;
+  uint16_t sysexLength = 0;
+  volatile uint32_t droppedSysEx = 0;
+  uint8_t sysex[Config::SYSEX_MAX_MESSAGE_BYTES];
+};
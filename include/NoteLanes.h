@@ -0,0 +1,73 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "NoteUtils.h"
+
+/**
+ * @class NoteLanes
+ * @brief Per-pitch interval lanes of one track for overlap queries while a note is moved.
+ *
+ * Each lane holds the notes of one pitch, ordered by start tick, as intervals
+ * [start, start + length) with start inside the loop. A note whose end runs past the loop
+ * end (raw end tick >= loop length, or an end before its start) wraps to the loop start.
+ *
+ * After the start-note editor resolves each move, the notes of one pitch do not overlap, so
+ * their ends are ordered as well. overlapping() then finds its first candidate by binary
+ * search and runs in O(log n + k). Recorded material can break that ordering (overlapping
+ * notes on one pitch). Each lane counts its out-of-order neighbours, and a query on a lane
+ * with any falls back to a scan of that lane only.
+ *
+ * NoteLanes is built once from the track's display notes and then updated in place through
+ * insert(), remove() and setEnd(). It records the track's events generation after each
+ * update, so isCurrent() tells when other code has changed the events and a rebuild is due.
+ */
+class NoteLanes {
+public:
+    using DisplayNote = NoteUtils::DisplayNote;
+
+    void rebuild(const std::vector<DisplayNote>& notes, uint32_t loopLength, uint32_t generation);
+    void clear();
+    bool isCurrent(uint32_t generation, uint32_t loopLength) const {
+        return built && generation == eventsGeneration && loopLength == loopLengthTicks;
+    }
+    void setGeneration(uint32_t generation) { eventsGeneration = generation; }
+
+    void insert(const DisplayNote& note);
+    bool remove(uint8_t pitch, uint32_t startTick);
+    bool setEnd(uint8_t pitch, uint32_t startTick, uint32_t endTick);
+    // The note of this pitch starting at startTick, or nullptr
+    const DisplayNote* find(uint8_t pitch, uint32_t startTick) const;
+
+    // Append the notes of `pitch` that overlap [startTick, endTick) on the loop circle
+    void overlapping(uint8_t pitch, uint32_t startTick, uint32_t endTick, std::vector<DisplayNote>& out) const;
+
+    // Circular overlap of two notes given as DisplayNote-style start/end ticks
+    static bool overlaps(uint32_t start1, uint32_t end1, uint32_t start2, uint32_t end2, uint32_t loopLength);
+    // Length of a note, also when its end wraps before its start
+    static uint32_t lengthOf(uint32_t startTick, uint32_t endTick, uint32_t loopLength);
+
+private:
+    struct Entry {
+        uint32_t start;  // In [0, loopLength)
+        uint32_t end;    // start + length; may exceed loopLength
+        DisplayNote note;
+    };
+    struct Lane {
+        std::vector<Entry> entries;
+        uint32_t unordered = 0;  // Neighbour pairs whose ends are out of start order
+    };
+
+    Entry entryFor(const DisplayNote& note) const;
+    size_t lowerBound(const Lane& lane, uint32_t start) const;
+    int indexOf(const Lane& lane, uint32_t startTick) const;
+    static bool brokenPair(const Lane& lane, size_t second);
+    static void countPairs(Lane& lane, size_t index, int sign);
+
+    Lane lanes[128];
+    uint32_t loopLengthTicks = 0;
+    uint32_t eventsGeneration = 0;
+    bool built = false;
+};
@@ -0,0 +1,103 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @class NoteSet
+ * @brief Fixed 16 x 128 bitmap of (channel, note) pairs.
+ *
+ * Channels are 1-16 as stored in MidiEvent. set(), clear() and test() are constant time and never
+ * allocate. forEach() visits the active pairs in channel/note order by scanning the 64 bitmap
+ * words, so the cost is O(active + 64). The callback may clear the pair it is given (each word is
+ * read once before its bits are visited).
+ */
+class NoteSet {
+public:
+    static constexpr uint8_t CHANNELS = 16;
+    static constexpr uint8_t NOTES = 128;
+
+    // Returns true when the pair was not set before
+    bool set(uint8_t channel, uint8_t note) {
+        uint32_t& w = word(channel, note);
+        uint32_t bit = bitOf(note);
+        if (w & bit) return false;
+        w |= bit;
+        count_++;
+        return true;
+    }
+    // Returns true when the pair was set
+    bool clear(uint8_t channel, uint8_t note) {
+        uint32_t& w = word(channel, note);
+        uint32_t bit = bitOf(note);
+        if (!(w & bit)) return false;
+        w &= ~bit;
+        count_--;
+        return true;
+    }
+    bool test(uint8_t channel, uint8_t note) const {
+        return (bits_[index(channel, note)] & bitOf(note)) != 0;
+    }
+    void reset() {
+        memset(bits_, 0, sizeof(bits_));
+        count_ = 0;
+    }
+    uint16_t count() const { return count_; }
+    bool empty() const { return count_ == 0; }
+
+    // fn(channel, note) for every active pair
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (uint8_t i = 0; i < WORDS; ++i) {
+            uint32_t w = bits_[i];
+            while (w) {
+                uint8_t bit = (uint8_t)__builtin_ctz(w);
+                w &= w - 1;
+                fn((uint8_t)(i / WORDS_PER_CHANNEL + 1), (uint8_t)((i % WORDS_PER_CHANNEL) * 32 + bit));
+            }
+        }
+    }
+
+private:
+    static constexpr uint8_t WORDS_PER_CHANNEL = NOTES / 32;
+    static constexpr uint8_t WORDS = CHANNELS * WORDS_PER_CHANNEL;
+
+    static uint8_t index(uint8_t channel, uint8_t note) {
+        return (uint8_t)((((channel - 1) & 0x0F) * WORDS_PER_CHANNEL) + ((note & 0x7F) >> 5));
+    }
+    static uint32_t bitOf(uint8_t note) { return 1u << (note & 31); }
+    uint32_t& word(uint8_t channel, uint8_t note) { return bits_[index(channel, note)]; }
+
+    uint32_t bits_[WORDS] = {};
+    uint16_t count_ = 0;
+};
+
+/**
+ * @class NoteTable
+ * @brief NoteSet with the note-on velocity kept per slot.
+ *
+ * Holds the notes whose NoteOff has not arrived yet while a track records. A slot's velocity is
+ * only meaningful while the pair is active.
+ */
+class NoteTable {
+public:
+    void set(uint8_t channel, uint8_t note, uint8_t velocity) {
+        active_.set(channel, note);
+        velocity_[(channel - 1) & 0x0F][note & 0x7F] = velocity;
+    }
+    bool clear(uint8_t channel, uint8_t note) { return active_.clear(channel, note); }
+    bool test(uint8_t channel, uint8_t note) const { return active_.test(channel, note); }
+    uint8_t velocity(uint8_t channel, uint8_t note) const { return velocity_[(channel - 1) & 0x0F][note & 0x7F]; }
+    void reset() { active_.reset(); }
+    uint16_t count() const { return active_.count(); }
+    bool empty() const { return active_.empty(); }
+
+    template <typename Fn>
+    void forEach(Fn fn) const { active_.forEach(fn); }
+
+private:
+    NoteSet active_;
+    uint8_t velocity_[NoteSet::CHANNELS][NoteSet::NOTES] = {};
+};
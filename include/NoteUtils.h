@@ -6,6 +6,7 @@
 #include <map>
 #include <cstdint>
 #include "MidiEvent.h"
+#include "TrackArena.h"
 #include <unordered_map>
 #include <utility> // for std::pair
 
@@ -33,7 +34,12 @@ namespace NoteUtils {
  * @param loopLength  The loop length in ticks.
  * @return Vector of paired DisplayNote entries.
  */
-std::vector<DisplayNote> reconstructNotes(const std::vector<MidiEvent>& midiEvents, uint32_t loopLength);
+std::vector<DisplayNote> reconstructNotes(const EventList& midiEvents, uint32_t loopLength);
+/// Same as reconstructNotes(), reusing the capacity of `notes` (used by the per-track cache).
+void reconstructNotesInto(const EventList& midiEvents, uint32_t loopLength, std::vector<DisplayNote>& notes);
+
+/// A tick position wrapped into [0, loopLength), also when it is negative.
+uint32_t wrapPosition(int32_t position, uint32_t loopLength);
 
 /**
  * @brief Fast lookup index for NoteOn/NoteOff events by (pitch<<32)|tick.
@@ -43,6 +49,8 @@ std::vector<DisplayNote> reconstructNotes(const std::vector<MidiEvent>& midiEven
 using Key = uint64_t;
 using EventIndexMap = std::unordered_map<Key, size_t>;
 using EventIndex = std::pair<EventIndexMap, EventIndexMap>;
-EventIndex buildEventIndex(const std::vector<MidiEvent>& midiEvents);
+EventIndex buildEventIndex(const EventList& midiEvents);
+/// Same as buildEventIndex(), reusing the buckets of `index` (used by the per-track cache).
+void buildEventIndexInto(const EventList& midiEvents, EventIndex& index);
 
 } // namespace NoteUtils 
\ No newline at end of file
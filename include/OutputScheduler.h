@@ -0,0 +1,67 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <Arduino.h>
+#include <cstdint>
+#include "Globals.h"
+#include "MidiEvent.h"
+
+/**
+ * @class OutputScheduler
+ * @brief Sends MIDI events at microsecond deadlines between clock ticks.
+ *
+ * schedule() routes a track event at once (MidiHandler::routeTrackEvent()) and keeps it in a
+ * fixed-capacity min-heap ordered by deadline. A one-shot IntervalTimer is armed for the earliest
+ * deadline; its ISR writes every event that is due through MidiHandler::writeRouted() and re-arms
+ * for the next one. While another writer holds the ports (MidiHandler::claimPort() fails) the ISR
+ * waits Config::OUTPUT_RETRY_US and tries again, so the ports see whole messages in deadline order.
+ *
+ * A deadline that has already passed, or a full heap, sends the event at once like
+ * Track::sendMidiEvent() does. cancelTrack() drops a track's pending NoteOns and sends its
+ * pending NoteOffs and other events at once; Track::sendSoundingNoteOffs() calls it before a
+ * stop, mute or locate so no note is left on and nothing sounds after the track went quiet.
+ *
+ * loop() changes the heap with interrupts off (O(log n) per event); the ISR is the only other
+ * user. Host builds have no timer: call service() with the time to fire what is due.
+ */
+class OutputScheduler {
+public:
+  void setup();
+
+  // Send `event` through the track's route at deadlineMicros (loop() context)
+  void schedule(uint8_t trackIndex, const MidiEvent& event, uint32_t deadlineMicros);
+  void cancelTrack(uint8_t trackIndex);
+
+  // Send everything due at nowMicros; returns microseconds to the next deadline (0 = none)
+  uint32_t service(uint32_t nowMicros);
+  void onTimer();                         // Timer ISR
+
+  uint16_t getPendingCount() const { return count; }
+  uint32_t getSentOnTime() const { return sentOnTime; }      // Written at their deadline by service()
+  uint32_t getSentImmediately() const { return sentAtOnce; } // Deadline passed or heap full
+  uint32_t getMaxLateMicros() const { return maxLateMicros; } // Worst deadline miss in service()
+  void resetStats();
+
+private:
+  struct Entry {
+    uint32_t deadline;
+    MidiEvent event;        // Routed: channel override applied
+    uint8_t dest;           // MidiHandler route destination bits
+    uint8_t track;
+  };
+  Entry heap[Config::OUTPUT_QUEUE_EVENTS];
+  volatile uint16_t count = 0;
+
+  volatile uint32_t sentOnTime = 0;
+  uint32_t sentAtOnce = 0;
+  volatile uint32_t maxLateMicros = 0;
+
+  static bool earlier(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+  void push(const Entry& entry);
+  void popTop();
+  void siftDown(uint16_t i);
+  void arm(uint32_t waitMicros);           // Interrupts off; 0 stops the timer
+};
+
+extern OutputScheduler outputScheduler;
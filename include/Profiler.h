@@ -0,0 +1,73 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <Arduino.h>
+
+// Instrumented hot paths; name new probes in Profiler.cpp
+enum ProfileProbe : uint8_t {
+  PROBE_UPDATE_ALL_TRACKS,
+  PROBE_DISPLAY_UPDATE,
+  PROBE_STORAGE_UPDATE,
+  PROBE_SAVE_STATE,
+  PROBE_RECONSTRUCT_NOTES,
+  PROBE_EDIT_ENCODER,
+  PROBE_EDIT_BUTTON,
+  NUM_PROFILE_PROBES
+};
+
+// Event counts reported with the probes; name new counters in Profiler.cpp
+enum ProfileCounter : uint8_t {
+  COUNTER_PLAYBACK_OVERRUNS,
+  COUNTER_PLAYBACK_DROPPED,
+  NUM_PROFILE_COUNTERS
+};
+
+/**
+ * @class Profiler
+ * @brief Cycle-accurate timing of hot paths using the Cortex-M7 DWT cycle counter.
+ *
+ * PROFILE_SCOPE(probe) times the rest of the enclosing block and adds the result to that probe.
+ * Each probe keeps count, min, max, mean and a log2 histogram of cycles; PROFILE_COUNT(counter, n)
+ * adds to an event counter (playback overruns, events they dropped). Nothing is compiled in
+ * unless LOOPER_PROFILE is defined (see the teensy41_profile environment in platformio.ini);
+ * otherwise all PROFILE_* macros expand to nothing. With profiling on, send 'p' over USB serial to
+ * dump the statistics (times in microseconds) and 'r' to reset them.
+ */
+#ifdef LOOPER_PROFILE
+
+class Profiler {
+public:
+  static void setup();                                       // Enable the DWT cycle counter
+  static void record(ProfileProbe probe, uint32_t cycles);
+  static void count(ProfileCounter counter, uint32_t n);
+  static void dump(Print& out);
+  static void reset();
+  static void pollSerial();                                  // Handle 'p' / 'r' requests (call from loop())
+};
+
+class ProfileScope {
+public:
+  explicit ProfileScope(ProfileProbe p) : probe(p), start(ARM_DWT_CYCCNT) {}
+  ~ProfileScope() { Profiler::record(probe, ARM_DWT_CYCCNT - start); }
+
+private:
+  ProfileProbe probe;
+  uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(probe) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(probe)
+#define PROFILE_COUNT(counter, n) Profiler::count(counter, n)
+#define PROFILE_SETUP() Profiler::setup()
+#define PROFILE_POLL() Profiler::pollSerial()
+
+#else
+
+#define PROFILE_SCOPE(probe) do {} while (0)
+#define PROFILE_COUNT(counter, n) do {} while (0)
+#define PROFILE_SETUP() do {} while (0)
+#define PROFILE_POLL() do {} while (0)
+
+#endif
@@ -0,0 +1,143 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+/**
+ * @class SpscRingBuffer
+ * @brief Fixed-capacity, allocation-free single-producer/single-consumer queue.
+ *
+ * Designed for handing records from an interrupt (producer) to the main loop
+ * (consumer) without locks: the producer only writes `head`, the consumer only
+ * writes `tail`, and acquire/release ordering publishes the slot contents.
+ * push() and pop() are O(1) and never block, so ISR time stays constant.
+ *
+ * Capacity must be a power of two. When the queue is full push() drops the
+ * record and counts it in getOverflowCount(); getHighWaterMark() reports the
+ * deepest fill level seen since the last resetStats().
+ */
+template <typename T, size_t Capacity>
+class SpscRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRingBuffer capacity must be a power of two");
+public:
+    // Producer side (e.g. ISR)
+    bool push(const T& item) {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        uint32_t used = head - tail;
+        if (used >= Capacity) {
+            overflowCount_++;
+            return false;
+        }
+        buffer_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        if (used + 1 > highWaterMark_) highWaterMark_ = used + 1;
+        return true;
+    }
+
+    // Consumer side (e.g. loop())
+    bool pop(T& out) {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+        uint32_t head = head_.load(std::memory_order_acquire);
+        if (tail == head) return false;
+        out = buffer_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+    size_t size() const {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Diagnostics
+    uint32_t getOverflowCount() const { return overflowCount_; }
+    uint32_t getHighWaterMark() const { return highWaterMark_; }
+    void resetStats() { overflowCount_ = 0; highWaterMark_ = 0; }
+
+private:
+    T buffer_[Capacity];
+    std::atomic<uint32_t> head_{0};
+    std::atomic<uint32_t> tail_{0};
+    volatile uint32_t overflowCount_ = 0;
+    volatile uint32_t highWaterMark_ = 0;
+};
+
+/**
+ * @class MpscRingBuffer
+ * @brief Fixed-capacity, allocation-free multi-producer/single-consumer queue.
+ *
+ * For records that both loop() code and interrupts produce, such as log messages. Each slot
+ * carries a sequence number. A producer claims a slot with a compare-and-swap on `head` and
+ * publishes it by advancing that slot's sequence. An interrupt that preempts a producer part way
+ * through claims the next slot instead of waiting, so push() never blocks or disables
+ * interrupts. The consumer stops at the first slot that has not been published yet.
+ *
+ * Capacity must be a power of two. A full queue drops the record and counts it.
+ */
+template <typename T, size_t Capacity>
+class MpscRingBuffer {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "MpscRingBuffer capacity must be a power of two");
+public:
+    MpscRingBuffer() {
+        for (uint32_t i = 0; i < Capacity; ++i) cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    // Producer side (loop() or ISR)
+    bool push(const T& item) {
+        uint32_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & (Capacity - 1)];
+            int32_t diff = (int32_t)(cell.seq.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                overflowCount_++;
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side (loop() only)
+    bool pop(T& out) {
+        Cell& cell = cells_[tail_ & (Capacity - 1)];
+        if (cell.seq.load(std::memory_order_acquire) != tail_ + 1) return false;
+        out = cell.item;
+        cell.seq.store(tail_ + Capacity, std::memory_order_release);
+        tail_++;
+        return true;
+    }
+
+    bool empty() const {
+        return cells_[tail_ & (Capacity - 1)].seq.load(std::memory_order_acquire) != tail_ + 1;
+    }
+    static constexpr size_t capacity() { return Capacity; }
+
+    // Diagnostics
+    uint32_t getOverflowCount() const { return overflowCount_; }
+    void resetStats() { overflowCount_ = 0; }
+
+private:
+    struct Cell {
+        std::atomic<uint32_t> seq;
+        T item;
+    };
+    Cell cells_[Capacity];
+    std::atomic<uint32_t> head_{0};
+    uint32_t tail_ = 0;
+    volatile uint32_t overflowCount_ = 0;
+};
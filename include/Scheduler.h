@@ -0,0 +1,77 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <Arduino.h>
+#include <cstdint>
+
+enum TaskPriority : uint8_t {
+  TASK_PRIORITY_HIGH,     // Controls: buttons, looper state
+  TASK_PRIORITY_NORMAL,   // Display frame, SD writes
+  TASK_PRIORITY_LOW,      // Log output, serial commands
+};
+
+/**
+ * @class Scheduler
+ * @brief Cooperative, time-budgeted scheduler for the work loop() does.
+ *
+ * Each task does one slice of work per call and is given a budget in microseconds. A task that
+ * returns true has unfinished work and is resumed on the next pass. Otherwise it waits until its
+ * interval has passed since its last run started (0 = every pass). runPass() visits the due
+ * tasks in priority order (registration order within a priority) and runs one slice of each.
+ *
+ * The service function (pending clock ticks, MIDI input) runs before the first slice and after
+ * every slice. Input latency is therefore bounded by the longest slice, not by a whole frame or
+ * save. Per-task statistics count slices, the longest slice and the slices that overran their
+ * budget. getMaxServiceGapMicros() is the longest time between two service calls. Send 't' over
+ * USB serial for dump().
+ */
+class Scheduler {
+public:
+  static constexpr uint8_t MAX_TASKS = 8;
+
+  // One slice of work within budgetMicros; true while the task has unfinished work
+  using TaskFn = bool (*)(uint32_t budgetMicros);
+  using ServiceFn = void (*)();
+
+  struct TaskStats {
+    uint32_t slices;
+    uint32_t maxMicros;     // Longest slice
+    uint32_t overruns;      // Slices longer than the budget
+  };
+
+  void setService(ServiceFn fn) { service = fn; }
+  bool addTask(const char* name, TaskFn fn, TaskPriority priority, uint32_t budgetMicros, uint32_t intervalMillis = 0);
+  void runPass();                                  // Call from loop()
+
+  uint8_t getTaskCount() const { return taskCount; }
+  const char* getTaskName(uint8_t i) const { return tasks[i].name; }
+  const TaskStats& getTaskStats(uint8_t i) const { return tasks[i].stats; }
+  uint32_t getMaxServiceGapMicros() const { return maxServiceGap; }
+  void resetStats();
+  void dump(Print& out);
+  void pollSerial();                               // Handle 't' requests (leaves other commands)
+
+private:
+  struct Task {
+    const char* name;
+    TaskFn fn;
+    TaskPriority priority;
+    uint32_t budgetMicros;
+    uint32_t intervalMillis;
+    uint32_t lastStartMillis;
+    bool started;           // Has run at least once (the first run is due at once)
+    bool resume;            // Returned true: continue on the next pass
+    TaskStats stats;
+  };
+  Task tasks[MAX_TASKS];
+  uint8_t taskCount = 0;
+  ServiceFn service = nullptr;
+  uint32_t lastServiceEnd = 0;
+  uint32_t maxServiceGap = 0;
+  bool serviceRan = false;
+
+  void runService();
+};
+
+extern Scheduler scheduler;
@@ -0,0 +1,84 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <SD.h>
+#include "Globals.h"
+
+namespace SectorFile {
+  // Create (or empty) a file for writing from its start. On the Teensy, reserveBytes of
+  // contiguous clusters are preallocated when the card has them; elsewhere it is a plain file.
+  File create(const char* path, uint64_t reserveBytes);
+}
+
+/**
+ * @class SectorWriter
+ * @brief Writes a new file on the SD card in whole multi-sector blocks.
+ *
+ * Records are serialized into a sector-aligned staging buffer of Config::STORAGE_BLOCK_BYTES.
+ * Each time it fills, the block goes to the card in one write at a block-aligned offset, which
+ * SdFat turns into a multi-sector transfer without a read-modify-write of a partly written
+ * sector. Only the tail is written short, by finish().
+ *
+ * open() can reserve the expected size up front: on the Teensy the clusters are preallocated
+ * contiguously (SdFat preAllocate()), so the block writes need no FAT updates. finish() cuts the
+ * file to what was written. A failed write sticks: later writes return 0 and finish() false.
+ */
+class SectorWriter {
+public:
+  bool open(const char* path, uint64_t reserveBytes = 0);  // New empty file; false if it cannot be created
+  size_t write(const uint8_t* data, size_t size);           // size, or 0 after a failed block write
+  bool finish();                                            // Write the tail, release the unused reservation, close
+  void close();                                             // Abandon: staged bytes are dropped
+
+  explicit operator bool() const { return opened; }
+  uint64_t position() const { return start + fill; }  // Bytes written so far, staged ones included
+  uint32_t getBlockWrites() const { return blockWrites; }
+
+private:
+  bool drain();
+
+  File file;
+  bool opened = false;
+  bool failed = false;
+  uint64_t start = 0;    // File offset of buffer[0]; always a multiple of the block size
+  uint32_t fill = 0;
+  uint32_t blockWrites = 0;
+  alignas(Config::SD_SECTOR_BYTES) uint8_t buffer[Config::STORAGE_BLOCK_BYTES];
+};
+
+/**
+ * @class SectorReader
+ * @brief Reads a file from the SD card in whole multi-sector blocks.
+ *
+ * The file size is read once at open(). Small reads (record headers, counts) are served from a
+ * block-aligned buffer refilled with one read of Config::STORAGE_BLOCK_BYTES; reads of a block
+ * or more from a sector boundary (event lists) go straight to the destination. seek() inside
+ * the buffered block costs nothing, so skipping a short record does not touch the card.
+ */
+class SectorReader {
+public:
+  bool open(const char* path);
+  void close();
+  int read(uint8_t* data, size_t size);  // Bytes read, short at the end of the file
+  bool seek(uint64_t pos);               // False past the end
+
+  explicit operator bool() const { return opened; }
+  uint64_t position() const { return pos; }
+  uint64_t size() const { return length; }
+  uint64_t available() const { return length - pos; }
+
+private:
+  bool refill();
+
+  File file;
+  bool opened = false;
+  uint64_t length = 0;
+  uint64_t pos = 0;       // Logical read position
+  uint64_t filePos = 0;   // Where the card file is, to skip redundant seeks
+  uint64_t bufStart = 0;  // File offset of buffer[0]; sector-aligned
+  uint32_t bufFill = 0;
+  alignas(Config::SD_SECTOR_BYTES) uint8_t buffer[Config::STORAGE_BLOCK_BYTES];
+};
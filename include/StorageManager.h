@@ -2,7 +2,12 @@
 //  Licensed under the PolyForm Noncommercial 1.0.0
 
 #pragma once
+#include "Globals.h"
 #include "LooperState.h"
+#include "MidiEvent.h"
+#include "UndoHistory.h"
+
+class Track;
 
 /**
  * @class StorageManager
@@ -11,9 +16,68 @@
  * Provides static methods to serialize the current LooperState to external memory (e.g., SD card
  * or flash) and to reload it on startup. saveState() writes the state and returns true on success;
  * loadState() restores a saved state and returns true on success.
+ *
+ * Storage format v2 is a checkpoint plus an append-only journal. Every record carries a CRC32.
+ * Track and undo code report each change through the journal*() hooks (event insert/delete,
+ * full event list, undo push/drop/restore, clear). update(), called from loop(), appends the
+ * buffered records to the journal in small time-budgeted slices, so a save costs O(changes).
+ * Track headers (state, mute, length) and the session header are diffed periodically and
+ * journaled when they change. Once the journal grows past a threshold it is compacted into a new
+ * checkpoint with a higher generation number. The checkpoint is renamed into place only when
+ * complete, so a power loss never corrupts the previous checkpoint. loadState() reads the
+ * checkpoint and replays the matching journal up to the first torn or corrupt record. A v1
+ * monolithic state file is migrated on first load, and files holding the older 16-byte event
+ * layout are decoded and rewritten with packed 8-byte events. A track's SysEx store is saved as
+ * raw bytes ahead of its events: whole in the checkpoint, one append per journal record.
+ *
+ * Card I/O goes in whole sectors (SectorFile.h): a checkpoint is staged and written in aligned
+ * multi-sector blocks to a file preallocated at its estimated size, every file is read in bulk
+ * blocks, and journal appends are cut at sector boundaries.
+ *
+ * Loading reads each track's current events straight into the track's arena and swaps them in;
+ * over a track that still holds events they are read onto the heap and copied in, since the arena
+ * has no room for both.
+ * Undo levels of a checkpoint in the current layout stay on the card: only their record offsets
+ * are kept, and TrackUndo pages the newest one in (CRC checked) when an undo needs it. Paged
+ * levels hold no RAM; compaction copies their records unchanged into the new checkpoint.
+ *
+ * At boot, beginRestore() does the same work from update() in time-budgeted steps: each track
+ * is installed as soon as its checkpoint records are read, and the journal is replayed after
+ * the last track. Journal hooks from the user's own changes meanwhile mark the track as theirs
+ * (its saved state is skipped) and end the restore in a fresh checkpoint. Files the incremental
+ * reader does not handle fall back to loadState().
+ *
+ * saveState() forces a synchronous compaction. requestSave() asks for buffered changes to be
+ * flushed soon; requests are coalesced so a burst of undos becomes one write.
  */
 class StorageManager {
 public:
     static bool saveState(const LooperState& state);
     static bool loadState(LooperState& state);
-}; 
\ No newline at end of file
+
+    // Boot restore: tracks are installed one by one from update() while clock and MIDI run
+    static bool beginRestore(LooperState& state);   // False only if a synchronous fallback load failed
+    static bool isRestoring();
+    static bool isTrackRestored(uint8_t track);     // True once the track's saved state (or the user's) is in place
+
+    // Background saving
+    static void requestSave();      // Ask update() to flush pending changes soon
+    // Append journal records / advance compaction within budgetMicros (call from loop())
+    static void update(uint32_t budgetMicros = Config::STORAGE_SLICE_BUDGET_US);
+    static bool isSavePending();    // True while changes have not reached the card
+
+    // Journal hooks: record a change to a track as it happens
+    static void journalEventInserted(const Track& track, const MidiEvent& evt);
+    static void journalSysExStored(const Track& track, uint16_t offset);  // SysEx store appended at offset
+    static void journalEventDeleted(const Track& track, const MidiEvent& evt);
+    static void journalTrackEvents(const Track& track);   // Whole event list replaced (bulk edits)
+    static void journalTrackCleared(const Track& track);
+    static void journalUndoPushed(const Track& track);    // Snapshot of the current events pushed
+    static void journalUndoDropped(const Track& track);   // Last snapshot discarded
+    static void journalUndoRestored(const Track& track);  // Last snapshot restored and removed
+
+    // Undo levels left on the card at load, older than every level in the track's history
+    static size_t pagedUndoLevels(const Track& track);
+    static bool pageInUndoLevel(const Track& track, UndoEntry& entry);  // Newest paged level, removed from the card list
+    static void dropPagedUndo(const Track& track, size_t count);        // Forget the oldest `count` paged levels
+};
@@ -0,0 +1,95 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <Arduino.h>
+#include "MidiEvent.h"
+
+// Stream and timing knobs for one stress run
+struct StressConfig {
+  uint8_t trackIndex = 0;          // Track that is cleared, recorded and played (left empty afterwards)
+  uint8_t channel = 16;            // Stream channel; output on other channels is not counted
+  uint32_t loopBars = 2;           // Length of the recorded loop
+  uint8_t notesPerBeat = 8;        // Note onsets per quarter note
+  uint8_t chordSize = 1;           // Notes starting together at each onset
+  uint32_t noteLengthTicks = 12;
+  uint8_t ccPerBeat = 0;           // Interleaved CC messages per quarter note
+  uint8_t playbackLoops = 2;       // Loop passes checked after recording
+  uint32_t stallEveryTicks = 0;    // Hold the main loop off for stallTicks every this many ticks (0 = never)
+  uint32_t stallTicks = 0;
+  bool simulatedClock = true;      // Step ticks directly; false follows the running clock ISR
+  uint32_t seed = 1;
+};
+
+// Results of one run, compared against the generated stream
+struct StressReport {
+  static constexpr uint8_t LATENESS_BUCKETS = 8;  // 0, 1, 2, 3-4, 5-8, 9-16, 17-32, >32 ticks
+
+  bool completed = false;
+  uint32_t sent = 0;               // Messages fed through MidiHandler::handleMidiMessage()
+  uint32_t recorded = 0;           // Events on the track after recording
+  uint32_t recordMissed = 0;       // Sent, but not recorded within a MIDI clock of the intended tick
+  uint32_t recordShifted = 0;      // Recorded, but not on the intended tick
+  uint32_t recordExtra = 0;
+  uint32_t recordMaxErrorTicks = 0;
+  uint32_t expectedPlayback = 0;   // recorded * playbackLoops
+  uint32_t played = 0;
+  uint32_t playMissed = 0;
+  uint32_t playExtra = 0;
+  uint32_t lateness[LATENESS_BUCKETS] = {};
+  uint32_t early = 0;              // Played before the tick it was due
+  uint32_t maxLatenessTicks = 0;
+  uint64_t totalLatenessTicks = 0;
+  uint32_t playbackJumps = 0;      // Track::playMidiEvents() re-seated its cursor (tick out of sequence)
+  uint32_t playbackOverruns = 0;   // Late ticks that caught up on stepped-over ones
+  uint32_t playbackDropped = 0;    // Missed events a catch-up did not send
+  uint32_t skippedTicks = 0;
+  uint32_t tickQueueHighWater = 0;
+  uint32_t droppedTicks = 0;
+  uint32_t inputHighWater = 0;
+  uint32_t inputOverflows = 0;
+  uint32_t logDropped = 0;
+
+  bool passed() const {
+    return completed && recordMissed == 0 && recordExtra == 0 && playMissed == 0 && playExtra == 0 &&
+           droppedTicks == 0 && inputOverflows == 0;
+  }
+};
+
+/**
+ * @class StressTest
+ * @brief Replays a generated MIDI stream through the input path and checks the result.
+ *
+ * run() clears the configured track and arms it. It then feeds a dense stream (notes, optional
+ * CC) through MidiHandler::handleMidiMessage(), stamped with the tick each message is due, while
+ * ticks advance. After the loop closes it plays playbackLoops passes. The recorded events are
+ * compared with the stream, and every event the track sends (seen through
+ * STRESS_TAP_OUTPUT in MidiHandler::route(), before routing) is matched against its due tick. The
+ * stallEveryTicks/stallTicks knobs hold off input handling and tick processing the way a slow
+ * loop() would, so lateness shows up in the report.
+ *
+ * With simulatedClock the run steps ticks itself and needs no timer, which is how the native test
+ * drives it. On the device it can also follow the running clock ISR (simulatedClock = false).
+ * Nothing is compiled in unless LOOPER_STRESS is defined (see the teensy41_stress environment in
+ * platformio.ini). With it, send 's' over USB serial for a default run and 'S' for a dense run
+ * against the running clock.
+ */
+#ifdef LOOPER_STRESS
+
+class StressTest {
+public:
+  static StressReport run(const StressConfig& config);
+  static void print(const StressReport& report, Print& out);
+  static void onOutput(const MidiEvent& event);  // Output tap (MidiHandler::sendMidiEvent)
+  static void pollSerial();                      // Handle 's' / 'S' requests (call from loop())
+};
+
+#define STRESS_TAP_OUTPUT(event) StressTest::onOutput(event)
+#define STRESS_POLL() StressTest::pollSerial()
+
+#else
+
+#define STRESS_TAP_OUTPUT(event) do {} while (0)
+#define STRESS_POLL() do {} while (0)
+
+#endif
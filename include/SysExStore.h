@@ -0,0 +1,53 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "TrackArena.h"
+
+/**
+ * @class SysExStore
+ * @brief One track's SysEx payloads, pooled in a byte buffer on the track's arena.
+ *
+ * A SysEx event holds no bytes: MidiEvent::data.sysexOffset points at an entry here, a 16-bit
+ * length followed by the complete message (F0 ... F7). message() returns a pointer straight into
+ * the pool, which MidiHandler::sendTrackSysEx() hands to the USB and DIN drivers without a copy.
+ *
+ * Entries are appended and never moved or rewritten, so events in the list, undo levels and
+ * clear copies can all refer to them. The pool is emptied when a track is cleared with no clear
+ * copy left to restore. It is limited to Config::SYSEX_STORE_BYTES (offsets are 16 bits).
+ * message() checks every offset, so an event whose entry is gone (a legacy file, a damaged
+ * journal) is skipped rather than sent as garbage.
+ *
+ * StorageManager saves the pool as raw bytes: the whole of it in a checkpoint, and each append
+ * with its offset in the journal; restore() rebuilds it from either.
+ */
+class SysExStore {
+public:
+  explicit SysExStore(TrackArena* arena) : bytes(ArenaAllocator<uint8_t>(arena)) {}
+
+  // Bytes the pool has to allocate before append() of a length-byte message (0 = fits)
+  size_t growthFor(uint16_t length) const;
+  // Append a complete message; false when it is not framed F0 ... F7 or the pool (or arena) is full
+  bool append(const uint8_t* data, uint16_t length, uint16_t& offset);
+  // The message at offset, or nullptr (length 0) when offset does not hold one
+  const uint8_t* message(uint16_t offset, uint16_t& length) const;
+
+  // Saved bytes from offset on (the pool is cut or zero-filled to offset first); skipped when they
+  // do not fit, which leaves the events that use them unsent (see message())
+  void restore(uint32_t offset, const uint8_t* data, uint32_t length);
+  void truncate(size_t size);
+  void reset();
+
+  const uint8_t* data() const { return bytes.data(); }
+  size_t size() const { return bytes.size(); }
+  size_t capacityBytes() const { return bytes.capacity(); }
+
+  static constexpr size_t HEADER = 2;  // Little-endian message length before each entry
+
+private:
+  bool fits(size_t capacity) const;
+  std::vector<uint8_t, ArenaAllocator<uint8_t>> bytes;
+};
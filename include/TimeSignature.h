@@ -0,0 +1,71 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include "Globals.h"
+#include "TimingProfile.h"
+
+/**
+ * @class TimeSignature
+ * @brief The running meter: where bars and beats fall on the tick line.
+ *
+ * Holds a short table of meter segments, each starting on a bar line with its bar and beat
+ * lengths and their TickDividers precomputed. setMeter() adds a segment at the next bar line,
+ * so bars already played keep their length and the change lands on the downbeat. Looking a tick
+ * up walks the table from the newest entry (one entry in the usual case) and divides by
+ * multiplying, so isBarStart() and position() are cheap enough for every tick and frame in any
+ * meter, 7/8 and 5/4 as well as 4/4.
+ *
+ * Loop-relative queries (loopPosition(), barsIn()) count in the newest meter: a loop is as many
+ * bars long as the meter it plays under.
+ */
+class TimeSignature {
+public:
+  struct Position {
+    uint32_t bar;       // From 1
+    uint8_t beat;       // From 1
+    uint8_t sixteenth;  // From 1, within the beat
+    uint16_t tick;      // Ticks into the 16th
+  };
+
+  TimeSignature();
+
+  bool setMeter(Timing::Meter meter, uint32_t tick);  // From the next bar line at or after tick; false if invalid
+  bool reset(Timing::Meter meter = Config::TIMING.meter);  // One meter from tick 0; false if invalid
+
+  Timing::Meter meterAt(uint32_t tick) const { return segmentAt(tick).meter; }
+  Timing::Meter getMeter() const { return newest().meter; }
+  uint32_t ticksPerBarAt(uint32_t tick) const { return segmentAt(tick).bar.divisor(); }
+  const Timing::TickDivider& barAt(uint32_t tick) const { return segmentAt(tick).bar; }
+  uint32_t ticksPerBar() const { return newest().bar.divisor(); }
+  uint32_t ticksPerBeat() const { return newest().beat.divisor(); }
+
+  bool isBarStart(uint32_t tick) const;
+  uint32_t barStartAtOrBefore(uint32_t tick) const;
+  Position position(uint32_t tick) const;          // Bar / beat / 16th of an absolute tick
+  Position loopPosition(uint32_t tickInLoop) const; // The same from the loop start
+  uint32_t barsIn(uint32_t ticks) const { return newest().bar.div(ticks); }
+
+  static const Timing::TickDivider SIXTEENTH;  // Config::TICKS_PER_16TH_STEP
+  static const Timing::TickDivider CLOCK;      // Config::TICKS_PER_CLOCK
+
+private:
+  struct Segment {
+    uint32_t startTick;  // On a bar line of the previous segment
+    uint32_t startBar;   // Bars before startTick, from 0
+    Timing::Meter meter;
+    Timing::TickDivider bar;
+    Timing::TickDivider beat;
+  };
+
+  Segment segments[Config::METER_CHANGES];
+  uint8_t count = 0;
+
+  static Segment makeSegment(Timing::Meter meter, uint32_t startTick, uint32_t startBar);
+  const Segment& segmentAt(uint32_t tick) const;
+  const Segment& newest() const { return segments[count - 1]; }
+  static Position positionIn(const Segment& seg, uint32_t ticks, uint32_t firstBar);
+};
+
+extern TimeSignature timeSignature;
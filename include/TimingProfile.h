@@ -0,0 +1,85 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+
+/**
+ * @file TimingProfile.h
+ * @brief Compile-time tick resolution and meter, and division-free tick arithmetic.
+ *
+ * A TimingProfile fixes the internal PPQN and the default meter at build time (Config::TIMING,
+ * -D LOOPER_PPQN=n); every step length derives from it as a constant. TickDivider turns a
+ * division by a step length into a multiply by a precomputed reciprocal, so code that finds
+ * the bar, beat or 16th of a tick on every tick or frame needs no hardware divide. Divisors only
+ * known at run time (the current meter's bar) get a TickDivider built once when they change.
+ */
+namespace Timing {
+
+  constexpr uint8_t MIDI_CLOCKS_PER_QUARTER = 24;
+
+  constexpr bool isPowerOfTwo(uint32_t v) { return v && !(v & (v - 1)); }
+
+  // Time signature: numerator beats of a 1/denominator note per bar
+  struct Meter {
+    uint8_t numerator = 4;    // Beats per bar, 1-32
+    uint8_t denominator = 4;  // Beat note value: 1, 2, 4, 8 or 16
+
+    constexpr bool valid() const {
+      return numerator >= 1 && numerator <= 32 && isPowerOfTwo(denominator) && denominator <= 16;
+    }
+    constexpr bool operator==(const Meter& o) const { return numerator == o.numerator && denominator == o.denominator; }
+    constexpr bool operator!=(const Meter& o) const { return !(*this == o); }
+  };
+
+  struct Profile {
+    uint16_t ppqn;  // Internal ticks per quarter note
+    Meter meter;    // Meter at boot and of Config::TICKS_PER_BAR
+
+    constexpr uint32_t ticksPerClock() const { return ppqn / MIDI_CLOCKS_PER_QUARTER; }
+    constexpr uint32_t ticksPer16th() const { return ppqn / 4; }
+    constexpr uint32_t ticksPerBeat(Meter m) const { return ppqn * 4u / m.denominator; }
+    constexpr uint32_t ticksPerBar(Meter m) const { return ticksPerBeat(m) * m.numerator; }
+
+    // Whole MIDI clocks and 16ths per beat for every meter (a 1/16 beat is one 16th)
+    constexpr bool valid() const { return ppqn >= 24 && ppqn % 24 == 0 && ppqn <= 960 && meter.valid(); }
+  };
+
+  /**
+   * Division by a divisor fixed ahead of time: q = (x * m) >> 32 with m = floor((2^32 - 1) / d),
+   * then at most two corrections; exact for every 32-bit x. Building one divides once; div(),
+   * mod() and divmod() are a UMULL, a multiply-subtract and compares.
+   */
+  class TickDivider {
+  public:
+    constexpr TickDivider() : d(1), m(0xFFFFFFFFu) {}
+    constexpr explicit TickDivider(uint32_t divisor)
+      : d(divisor ? divisor : 1), m(0xFFFFFFFFu / (divisor ? divisor : 1)) {}
+
+    constexpr uint32_t divisor() const { return d; }
+
+    void divmod(uint32_t x, uint32_t& q, uint32_t& r) const {
+      q = (uint32_t)(((uint64_t)x * m) >> 32);
+      r = x - q * d;
+      while (r >= d) {
+        ++q;
+        r -= d;
+      }
+    }
+    uint32_t div(uint32_t x) const {
+      uint32_t q, r;
+      divmod(x, q, r);
+      return q;
+    }
+    uint32_t mod(uint32_t x) const {
+      uint32_t q, r;
+      divmod(x, q, r);
+      return r;
+    }
+
+  private:
+    uint32_t d;
+    uint32_t m;
+  };
+
+}
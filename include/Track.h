@@ -8,12 +8,19 @@
 #include <cstdint>
 #include <Arduino.h>
 #include <vector>
-#include <unordered_map>  // For pendingNotes
 #include <deque>          // For undo
 #include "MidiEvent.h"
 #include "MidiHandler.h"
+#include "UndoHistory.h"
+#include "TrackArena.h"
+#include "NoteUtils.h"
+#include "NoteTable.h"
+#include "TrackTransform.h"
+#include "SysExStore.h"
+#include "TrackSummary.h"
 
 class TrackUndo; // Forward declaration
+class EventEdit;
 
 // Track states with clear transitions
 enum TrackState {
@@ -27,37 +34,39 @@ enum TrackState {
   NUM_TRACK_STATES          // Always helpful to validate range
 };
 
-// Pending note structure
-struct PendingNote {
-  uint8_t note;            // MIDI note number
-  uint8_t channel;         // MIDI channel
-  uint32_t startNoteTick;  // tick when note-on occurred
-  uint8_t velocity;        // note-on velocity
-};
-
-// Hash function for pair (used in unordered_map)
-struct PairHash {
-  template<class T1, class T2>
-  std::size_t operator()(const std::pair<T1, T2>& p) const {
-    auto h1 = std::hash<T1>{}(p.first);
-    auto h2 = std::hash<T2>{}(p.second);
-    return h1 ^ (h2 << 1);
-  }
-};
-
 /**
  * @class Track
  * @brief Manages the lifecycle, storage, playback, and undo history of a MIDI track.
  *
  * A Track maintains a sequence of MidiEvent objects for recording, playback, and overdubbing.
  * It uses a state machine (TrackState) to transition between empty, recording, stopped,
- * playing, and overdubbing modes. PendingNote structures buffer incoming NoteOn events
- * until their corresponding NoteOff, ensuring proper timing and ordering. Loop length
+ * playing, and overdubbing modes. A fixed NoteTable holds incoming NoteOn events until their
+ * corresponding NoteOff, so recording a note never allocates. Loop length
  * and quantization helpers define the track's playback boundaries.
  *
- * Undo history is maintained via friend class TrackUndo, which snapshots the midiEvents
- * vector to allow undoing overdubs or clears. Track also supports muting, clearing,
+ * Undo history is maintained via friend class TrackUndo, which stores it as deltas of the
+ * midiEvents vector to allow undoing overdubs or clears. Track also supports muting, clearing,
  * and sending all-notes-off commands.
+ *
+ * Events, undo data and the playback buffers live in the track's TrackArena and never spill to
+ * the heap. When it is full, old undo levels are evicted first; after that insertEvent() drops
+ * events, edits and playback builds are refused (playback keeps the buffer it has) and isFull()
+ * reports it.
+ *
+ * Every change to the events bumps an events generation; code that edits through
+ * editMidiEvents() calls markEventsChanged(). The note views, content hash and TrackSummary
+ * rebuild only after such a change; insertEvent(), eraseEvent() and commitEdit() update the
+ * hash and summary per event. Editors stage changes in an EventEdit and apply them with commitEdit().
+ *
+ * Playback reads a bucketed copy on the arena that preparePlayback() builds from loop() and the
+ * next tick publishes. Ticks stepped over by a late tick are caught up, within
+ * Config::PLAYBACK_CATCHUP_BURST and PLAYBACK_CATCHUP_TICKS.
+ *
+ * Each overdub take records into a layer of its own, merged at playback and dropped by undo.
+ * getMidiEvents() returns a merged view; editMidiEvents() and commitEdit() flatten the layers.
+ *
+ * A TrackTransform is rendered into the playback copy and takes effect at the next loop start;
+ * commitTransform() keeps the render. SysEx bytes live in the track's SysExStore.
  */
 class Track {
 public:
@@ -101,10 +110,29 @@ public:
 
   // MIDI events
   void recordMidiEvents(midi::MidiType type, byte channel, byte data1, byte data2, uint32_t currentTick);
+  void recordSysEx(const uint8_t* data, uint16_t length, uint32_t currentTick);  // Complete F0 ... F7 message
+  bool insertEvent(const MidiEvent& evt);  // Sorted insert (recording and journal replay); false when full
+  void reserveRecordingCapacity();          // Preallocate event storage before a take
+  size_t recordReserveEvents() const;       // Headroom of a take, within an eighth of the arena
   void playMidiEvents(uint32_t currentTick, bool isAudible);
+  void locate(uint32_t currentTick, bool chase);  // Re-seat playback at any tick (O(log n)), optionally chasing
+  bool preparePlayback();  // From loop(): build the next playback buffer if it is stale; true if it did
+
+  // Overdub layers (see the class comment)
+  size_t getLayerCount() const { return overdubLayers.size(); }
+  bool compactLayers();          // Merge the oldest layer in when more than OVERDUB_FLATTEN_LAYERS are sealed; true if it did
+  void flattenLayers();          // Merge every layer into midiEvents, oldest first
+  size_t getEventBytes() const;  // midiEvents and the layers (capacity)
+
+  // Playback transform (non-destructive until committed)
+  void setTransform(const TrackTransform& t);
+  const TrackTransform& getTransform() const { return transformPending ? pendingTransform : transform; }
+  bool commitTransform();  // Bake the transform into the events as one undo step; false when full or none set
   void printNoteEvents() const;
   /// Send an "All Notes Off" (CC 123) on every channel and clear any pending notes.
   void sendAllNotesOff();
+  /// Send a NoteOff for each note this track's playback started and has not ended yet.
+  void sendSoundingNoteOffs();
 
   // Note events
   void noteOn(uint8_t channel, uint8_t note, uint8_t velocity, uint32_t tick);
@@ -120,7 +148,7 @@ public:
   void setLoopLength(uint32_t ticks);
   
   // Tempo accessors
-  static uint32_t getTicksPerBar();
+  static uint32_t getTicksPerBar();  // Bar of the current meter (timeSignature)
 
   // Track state checks
   bool isEmpty() const;
@@ -131,44 +159,195 @@ public:
   bool isPlaying() const;
   bool isStopped() const;
   bool isMuted() const;
+  bool isFull() const { return full; }
+
+  // Playback diagnostics: discontinuities in the ticks passed to playMidiEvents()
+  uint32_t getPlaybackJumpCount() const { return playJumpCount; }     // Ticks that did not follow the last one (overruns aside)
+  uint32_t getOverrunCount() const { return playOverrunCount; }       // Late ticks that caught up on stepped-over ones
+  uint32_t getDroppedEventCount() const { return playDroppedEvents; } // Missed events not sent by a catch-up
+  uint32_t getSkippedTickCount() const { return playSkippedTicks; }   // Ticks stepped over by overruns and forward jumps
+  void resetPlaybackStats() { playJumpCount = 0; playOverrunCount = 0; playDroppedEvents = 0; playSkippedTicks = 0; }
+  uint32_t getPublishedGeneration() const { return playback().generation; }  // Events generation playback reads (layers aside)
+  size_t getPlaybackBytes() const;   // Both playback buffers (on the arena)
+
+  // Memory budget and slot in TrackManager's table
+  void attachArena(uint8_t trackIndex);
+  const TrackArena& getArena() const { return arena; }
+
+  // Every event, the overdub layers merged in order (a cached view; nothing is flattened)
+  const EventList& getMidiEvents() const { return eventsView(); }
+
+  // midiEvents to change in place: the layers are flattened into it first (an edit commit point).
+  // Call markEventsChanged() after modifying events through this reference.
+  EventList& editMidiEvents() { flattenLayers(); return midiEvents; }
+  bool assignEvents(const EventList& events);  // Replace midiEvents (a load, a journal record); false when full
+  ArenaAllocator<MidiEvent> eventAllocator() const { return midiEvents.get_allocator(); }  // For lists staged for this track
+
+  // Payloads of the track's SysEx events (see SysExStore.h)
+  SysExStore& getSysExStore() { return sysex; }
+  const SysExStore& getSysExStore() const { return sysex; }
 
-  // Add to public section of Track to be able to save the events
-  std::vector<MidiEvent>& getMidiEvents() { return midiEvents; }
+  // Hashed edits: each keeps the content hash current and bumps the events generation once
+  EventList::iterator eraseEvent(EventList::iterator pos);
+  bool commitEdit(EventEdit& edit);  // Apply a staged batch in one pass; false (nothing applied) when full
 
-  /// Immutable access to midiEvents (for const Track)
-  const std::vector<MidiEvent>& getMidiEvents() const { return midiEvents; }
+  // Order-independent hash of midiEvents (O(1) unless events were edited via getMidiEvents())
+  uint32_t getContentHash() const;
+  static uint32_t hashEvent(const MidiEvent& evt);
+
+  // Derived note views, cached per events generation
+  void markEventsChanged() { baseGeneration = ++eventsGeneration; }
+  uint32_t getEventsGeneration() const { return eventsGeneration; }
+  const std::vector<NoteUtils::DisplayNote>& getDisplayNotes() const;
+  const NoteUtils::EventIndex& getEventIndex() const;
+  const TrackSummary& getSummary() const;  // Overview density, current in O(1) after hashed edits
 
 private:
   friend class TrackUndo;
   bool isPlayingBack;  // Flag to ignore playback events during overdub
-  void sendMidiEvent(const MidiEvent& evt);
+  void sendMidiEvent(const MidiEvent& evt, uint16_t fracQ16 = 0);  // fracQ16: sub-tick deadline
 
   // Track data
   bool muted;
   TrackState trackState;
+  uint8_t index = 0xFF;   // Slot in TrackManager, set by attachArena()
+  void publishState();
   uint32_t startLoopTick;
   uint32_t loopLengthTicks;
   uint32_t lastTickInLoop;
-  uint16_t nextEventIndex;
-  static const uint32_t TICKS_PER_BAR;
 
-  // Event storage
-  std::unordered_map<std::pair<uint8_t, uint8_t>, PendingNote, PairHash> pendingNotes;
-  std::vector<MidiEvent> midiEvents;
+  // Transform: the published buffer holds the rendered events while one is set
+  TrackTransform transform;
+  TrackTransform pendingTransform;
+  bool transformPending = false;   // Waits for the loop start and a buffer rendered with it
+  void applyPendingTransform();
+  // Playback cursor
+  uint32_t nextEventIndex = 0;        // Next published event to fire
+  uint32_t lastPlayedTick = 0;
+  bool playCursorValid = false;       // False after a jump: re-seat before playing
+  uint32_t playJumpCount = 0;
+  uint32_t playOverrunCount = 0;
+  uint32_t playDroppedEvents = 0;
+  uint32_t playSkippedTicks = 0;
+  uint32_t firstEntryAtOrAfter(uint32_t tickInLoop) const;
+  void chaseAt(uint32_t tickInLoop);
+  // Overdub layers, oldest first; the newest takes the input while layerOpen
+  std::deque<EventList> overdubLayers;
+  bool layerOpen = false;
+  uint32_t layerCursors[Config::OVERDUB_MAX_LAYERS] = {};  // Next event to fire per layer
+  bool insertIntoLayer(const MidiEvent& evt);
+  void sealLayer();
+  void mergeBottomLayer();
+  void dropTopLayer();  // Undo of the newest take
+  void seatLayerCursors(uint32_t tickInLoop);
+  void catchUp(uint32_t fromTick, uint32_t count, uint32_t tickInLoop);  // Events of stepped-over ticks
+  template <typename Fn>
+  void mergeDue(const MidiEvent* base, uint32_t baseSize, uint32_t& baseCursor, uint32_t* cursors,
+                uint32_t lastTick, Fn&& fn) const;
+
+  // Event storage: the arena is declared first so it outlives the containers it backs
+  TrackArena arena;
+  bool full = false;
+  NoteTable pendingNotes;  // Recorded NoteOns still waiting for their NoteOff
+  NoteSet soundingNotes;   // Notes this track's playback has started and not yet ended
+  EventList midiEvents;
+  SysExStore sysex;
+
+  // Playback buffers, on the arena. Playback reads only playBuffers[publishedPlayback]: copies of
+  // the events (tick = tick in loop) ordered by loop tick, bucketed per 16th (generation 0 = never built)
+  struct PlaybackBuffer {
+    explicit PlaybackBuffer(TrackArena* a)
+      : events(ArenaAllocator<MidiEvent>(a)), buckets(ArenaAllocator<uint32_t>(a)), offsets(ArenaAllocator<uint16_t>(a)) {}
+    EventList events;
+    std::vector<uint32_t, ArenaAllocator<uint32_t>> buckets;  // buckets[b] = first event at or after tick b * 16th
+    OffsetList offsets;             // Sub-tick start per event (Q16 of a tick); empty = all on the tick
+    uint32_t generation = 0;
+    uint32_t loopLength = 0;
+    TrackTransform transform;       // Rendered with
+  };
+  PlaybackBuffer playBuffers[2];
+  volatile uint8_t publishedPlayback = 0;
+  const PlaybackBuffer& playback() const { return playBuffers[publishedPlayback]; }
+  bool playbackCurrent(const PlaybackBuffer& buffer, const TrackTransform& with) const;
+  bool buildPlayback(PlaybackBuffer& buffer, const TrackTransform& with);  // False (nothing built) when full
+  size_t playbackCopyBytes() const;  // Arena one playback buffer of the current events takes
+  bool publishPlayback();  // Tick path: publish a prepared buffer, never build; true when it did
+  void releasePlayback();
+  void releaseBuffer(PlaybackBuffer& buffer);
+  uint32_t eventsGeneration = 1;
+  uint32_t baseGeneration = 1;  // eventsGeneration of the last change to midiEvents itself (playback rebuilds on it)
+  bool recordingTick(uint32_t currentTick, uint32_t& tickRelative) const;
+  bool reserveForInsert(EventList& list, size_t step);
+  EventList::iterator sortedPosition(uint32_t tick);
+  static bool isNoteOffEvent(const MidiEvent& evt);
+  void hashedEdit(uint32_t removedHash, uint32_t addedHash, bool summarized, bool inBase = true);
+  bool summaryCurrent() const;
+  const EventList& eventsView() const;  // midiEvents, or merged with the layers
+
+  // Content hash, current while contentHashGeneration == eventsGeneration (the empty list hashes to 0)
+  mutable uint32_t contentHash = 0;
+  mutable uint32_t contentHashGeneration = 1;
+
+  // midiEvents and the layers in merged order, current while layerViewGeneration == eventsGeneration
+  mutable EventList layerView;
+  mutable uint32_t layerViewGeneration = 0;
+
+  // Note view cache (generation 0 = never built)
+  mutable std::vector<NoteUtils::DisplayNote> cachedNotes;
+  mutable uint32_t cachedNotesGeneration = 0;
+  mutable uint32_t cachedNotesLoopLength = 0;
+  mutable NoteUtils::EventIndex cachedIndex;
+  mutable uint32_t cachedIndexGeneration = 0;
+  // Overview summary, current while summaryGeneration == eventsGeneration at the same loop length
+  mutable TrackSummary summary;
+  mutable uint32_t summaryGeneration = 0;
   
   // State management
   bool transitionState(TrackState newState);  // Internal state transition method
   
   // Undo management
-  std::deque<std::vector<MidiEvent>> midiHistory;
+  std::deque<UndoEntry> midiHistory;
+  size_t midiHistoryBytes = 0;  // Sum of midiHistory[i].bytes(), kept under TrackUndo::undoBudgetBytes()
   size_t midiEventCountAtLastSnapshot = 0;
   // Undo clear track control
-  std::deque<std::vector<MidiEvent>> clearMidiHistory;
+  std::deque<EventList> clearMidiHistory;
   std::deque<TrackState> clearStateHistory;
   std::deque<uint32_t> clearLengthHistory;
 
 };
 
+/**
+ * @class EventEdit
+ * @brief A batch of event changes staged against one track and applied by Track::commitEdit().
+ *
+ * Indices refer to the track's events as they are when staging starts; nothing changes until
+ * the commit, so lookups made while staging still see the old list. Each index is staged at
+ * most once: a second remove/move/replace of it returns false and stages nothing. A move or
+ * replacement is a removal plus an addition. Additions go after the events already at their
+ * tick, except that NoteOffs go ahead of them: a note shortened or moved to end where another
+ * of its pitch starts still pairs with its own NoteOn when notes are reconstructed.
+ */
+class EventEdit {
+public:
+  explicit EventEdit(const Track& track) : events(track.getMidiEvents()) {}
+
+  void insert(const MidiEvent& evt) { additions.push_back(evt); }
+  bool remove(size_t index);
+  bool move(size_t index, uint32_t tick);
+  bool replace(size_t index, const MidiEvent& evt);
+
+  bool isStaged(size_t index) const;
+  const EventList& getEvents() const { return events; }  // The list indices refer to
+  bool empty() const { return removals.empty() && additions.empty(); }
+  void clear() { removals.clear(); additions.clear(); }
+
+private:
+  friend class Track;
+  const EventList& events;
+  std::vector<uint32_t> removals;   // Indices into events, sorted by the commit
+  std::vector<MidiEvent> additions;
+};
+
 #include "TrackUndo.h"
 
 #endif
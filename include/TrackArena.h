@@ -0,0 +1,117 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "MidiEvent.h"
+
+/**
+ * @class TrackArena
+ * @brief Fixed memory region that holds one track's events and undo data.
+ *
+ * Each Track gets its own region, carved once at boot: from EXTMEM (PSRAM) when it is fitted,
+ * otherwise from RAM2 (DMAMEM, where the Teensy 4 heap lives). Each track gets an even share:
+ * Config::TRACK_ARENA_EXTMEM_PERCENT of the fitted PSRAM, or Config::TRACK_ARENA_POOL_BYTES of
+ * RAM2, split over Config::NUM_TRACKS. Track data therefore never touches the general heap, and
+ * one busy track cannot starve the others.
+ *
+ * The region is managed with a first-fit free list kept in address order. Neighbouring free
+ * blocks are merged on release. All blocks are 8-byte aligned. Every growth of a track's lists
+ * checks canAllocate() first (several allocations at once: the sum of their blockBytes()) and
+ * refuses the work when it fails; that is "track full". allocate() returns nullptr and counts an
+ * overflow when no block fits, so a non-zero getOverflowCount() is a growth that skipped the
+ * check. An arena without a region (e.g. a Track outside TrackManager) has no budget, so
+ * canAllocate() is always true.
+ */
+class TrackArena {
+public:
+    // Bind the region for a track (PSRAM when available, DMAMEM otherwise)
+    void attachTrackRegion(uint8_t trackIndex);
+    static size_t extmemBytesPerTrack();
+    void attach(void* region, size_t bytes);
+
+    void* allocate(size_t bytes);
+    void deallocate(void* ptr);
+    bool owns(const void* ptr) const;
+    bool canAllocate(size_t bytes) const;
+    static size_t blockBytes(size_t bytes);  // Arena taken by an allocation of `bytes`, header included
+
+    // Budget reporting
+    size_t capacity() const { return capacityBytes; }
+    size_t used() const { return usedBytes; }
+    size_t largestFreeBlock() const;
+    bool inExtmem() const { return extmem; }
+    uint32_t getOverflowCount() const { return overflowCount; }
+
+    // Arena that owns `ptr`, or nullptr for heap memory
+    static TrackArena* ownerOf(const void* ptr);
+
+private:
+    struct Block {
+        size_t size;   // Bytes including this header
+        Block* next;   // Next free block (free list only)
+    };
+    static constexpr size_t ALIGN = 8;
+    static constexpr size_t HEADER = (sizeof(Block) + ALIGN - 1) & ~(ALIGN - 1);
+
+    uint8_t* base = nullptr;
+    size_t capacityBytes = 0;
+    size_t usedBytes = 0;
+    Block* freeList = nullptr;
+    bool extmem = false;
+    uint32_t overflowCount = 0;  // Allocations that found no block (and returned nullptr)
+};
+
+/**
+ * @brief STL allocator that places a container in a TrackArena.
+ *
+ * A default-constructed allocator (no arena), or one whose arena has no region, uses the heap.
+ * That covers temporaries such as edit buffers and load staging. Copies of a container are heap
+ * temporaries too (select_on_container_copy_construction). Assigning into an arena-backed
+ * container keeps that container's arena, because the allocator does not propagate on assignment
+ * or swap. With a region, allocate() never uses the heap: callers check TrackArena::canAllocate()
+ * before they grow (see TrackArena). deallocate() returns the memory to whichever arena owns the
+ * pointer, so a mismatched swap cannot corrupt the heap.
+ */
+template <typename T>
+struct ArenaAllocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::false_type;
+    using propagate_on_container_swap = std::false_type;
+
+    TrackArena* arena = nullptr;
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(TrackArena* a) : arena(a) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) {
+        if (arena && arena->capacity()) return static_cast<T*>(arena->allocate(n * sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) {
+        if (TrackArena* owner = TrackArena::ownerOf(p)) {
+            owner->deallocate(p);
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+// Event list type used for track data, undo snapshots and the buffers exchanged with them
+using EventList = std::vector<MidiEvent, ArenaAllocator<MidiEvent>>;
+using OffsetList = std::vector<uint16_t, ArenaAllocator<uint16_t>>;  // Sub-tick offsets next to an EventList
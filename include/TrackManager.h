@@ -21,11 +21,19 @@
  * states and lengths.
  *
  * Timing and clock interaction:
- *   - updateAllTracks(currentTick) is driven by the global clock (ClockManager);
+ *   - updateAllTracks(currentTick) is driven by the global clock (ClockManager) from
+ *     loop() context (ClockManager::processPendingTicks drains the ISR tick queue);
  *     it must be called regularly with the current tick to advance each Track's
  *     state machine (playback, overdub, pending NoteOffs, quantized events).
  *   - TrackManager consumes the global tick to schedule recording start/stop,
  *     playback loops, overdub timing, and note finalization in each Track.
+ *
+ * The track count is Config::NUM_TRACKS (build flag LOOPER_NUM_TRACKS, up to 32). The per-track
+ * flags read on the tick path are kept apart from the Track objects in a small table: one 32-bit
+ * mask per flag and a state array that each Track keeps current through onTrackStateChanged().
+ * The active mask holds the tracks that record or play (TrackStateMachine::runsOnTick()), so
+ * updateAllTracks() visits only those plus any with a pending record/stop, and stopped or empty
+ * tracks cost nothing per tick.
  */
 class TrackManager {
 public:
@@ -56,6 +64,13 @@ public:
   void stopPlayingTrack(uint8_t trackIndex);
   void startOverdubbingTrack(uint8_t trackIndex);
   void clearTrack(uint8_t trackIndex);
+  bool compactLayers();  // Merge one surplus overdub layer (from loop()); true if one was merged
+  bool preparePlayback();  // Build one stale playback buffer (from loop()); true if one was built
+
+  // --- Transport (MIDI Stop / Continue / Song Position Pointer) ---
+  void locateAll(uint32_t currentTick);         // Re-seat and chase every playing track at a new position
+  void pauseForTransport();                     // Stop all tracks; remember which were playing
+  void resumeFromTransport(uint32_t currentTick);  // Restart the tracks paused by the transport
 
   // --- Mute / Solo ---
   void muteTrack(uint8_t trackIndex);
@@ -74,7 +89,12 @@ public:
 
   // --- State Accessors ---
   TrackState getTrackState(uint8_t trackIndex) const;
+  uint32_t getActiveTrackMask() const { return table.active; }  // Bit i: track i records or plays
   uint32_t getTrackLength(uint8_t trackIndex) const;
+  uint8_t getTrackIndex(const Track& track) const;
+
+  // Called by Track on every state change
+  void onTrackStateChanged(uint8_t trackIndex, TrackState state);
 
 private:
   Track tracks[Config::NUM_TRACKS];
@@ -82,11 +102,20 @@ private:
   uint8_t selectedTrack = 0;
   bool autoAlignEnabled = false;
   uint32_t masterLoopLength = 0;
-
-  bool muted[Config::NUM_TRACKS] = {false};
-  bool soloed[Config::NUM_TRACKS] = {false};
-  bool pendingRecord[Config::NUM_TRACKS] = {false};
-  bool pendingStop[Config::NUM_TRACKS] = {false};
+  uint32_t transportPaused = 0;  // Tracks stopped by MIDI Stop, restarted by Continue
+  uint8_t nextCompactTrack = 0;  // Round-robin start of compactLayers()
+  uint8_t nextPrepareTrack = 0;  // Round-robin start of preparePlayback()
+
+  // Hot per-track state as structure of arrays: bit i / slot i belongs to track i
+  struct TrackTable {
+    uint32_t active = 0;         // Recording, playing or overdubbing
+    uint32_t pendingRecord = 0;  // Start recording at the next bar
+    uint32_t pendingStop = 0;    // Stop recording on the next tick
+    uint32_t muted = 0;
+    uint32_t soloed = 0;
+    TrackState state[Config::NUM_TRACKS] = {};
+  } table;
+  static uint32_t bit(uint8_t trackIndex) { return 1u << trackIndex; }
 
   //friend class UI; // Optional: if you have a UI or debug class needing internal access
 };
@@ -13,6 +13,7 @@
  * This namespace provides utility functions for the Track state machine:
  *  - isValidTransition(current, next): check if moving from 'current' to 'next' state is allowed.
  *  - toString(state): convert a TrackState enum to a human-readable string representation.
+ *  - runsOnTick(state): whether a track in this state plays or records on each clock tick.
  */
 namespace TrackStateMachine {
 
@@ -22,4 +23,7 @@ namespace TrackStateMachine {
     // Convert a TrackState enum to a human-readable string
     const char* toString(TrackState state);
 
+    // Recording, playing or overdubbing: TrackManager visits the track on every tick
+    bool runsOnTick(TrackState state);
+
 }
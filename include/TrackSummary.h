@@ -0,0 +1,42 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include "Globals.h"
+#include "MidiEvent.h"
+#include "TrackArena.h"
+
+/**
+ * @class TrackSummary
+ * @brief Event density of one track's loop per overview column, for the all-tracks view.
+ *
+ * The loop is split into Config::OVERVIEW_COLUMNS columns, one per pixel of the overview strip.
+ * Each column counts the note starts and the other events (controllers, program changes, SysEx)
+ * whose loop tick falls in it; NoteOffs are not counted. The counts saturate at 255.
+ *
+ * Track keeps the summary current the way it keeps its content hash: insertEvent(), eraseEvent()
+ * and commitEdit() add and remove single events in O(1). Any other change (load, undo, a new loop
+ * length) leaves it stale and Track::getSummary() rebuilds it once. So does removing an event
+ * from a saturated column, whose true count is no longer known (remove() returns false).
+ */
+class TrackSummary {
+public:
+  static constexpr uint16_t COLUMNS = Config::OVERVIEW_COLUMNS;
+
+  void rebuild(const EventList& events, uint32_t loopLength);
+  void add(const MidiEvent& evt);
+  bool remove(const MidiEvent& evt);  // False when the column was saturated: rebuild
+
+  uint8_t notes(uint16_t column) const { return noteCounts[column]; }
+  uint8_t others(uint16_t column) const { return otherCounts[column]; }
+  uint32_t getLoopLength() const { return loopLength; }
+  uint32_t getVersion() const { return version; }  // Moves with every change (display region key)
+
+private:
+  uint32_t loopLength = 0;
+  uint32_t version = 0;
+  uint8_t noteCounts[COLUMNS] = {};
+  uint8_t otherCounts[COLUMNS] = {};
+  uint8_t* countFor(const MidiEvent& evt);  // nullptr for events not counted
+};
@@ -0,0 +1,53 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MidiEvent.h"
+#include "TrackArena.h"
+
+/**
+ * @struct TrackTransform
+ * @brief Live performance transform of one track, applied when its events are played.
+ *
+ * Quantize pulls each note start towards the nearest grid step by quantizeStrength percent,
+ * with every second step placed at swing percent of the step pair (50 = straight). The note
+ * keeps its length, scaled by lengthScale percent (at least one tick). Transpose moves notes and
+ * poly aftertouch; notes moved out of 0-127 are dropped. Velocity is scaled by velocityScale
+ * percent and kept in 1-127. Controllers and other events keep their tick.
+ *
+ * render() writes the transformed copy of a track's events: sorted by tick with NoteOffs first
+ * at a tick, like Track::midiEvents, so the playback index can be built from it directly and
+ * Track::commitTransform() can store it in place of the originals. Swing and partial quantize
+ * rarely land on a whole tick: the fraction left over is reported per event in `offsets` (a
+ * note's NoteOff shares its NoteOn's), and the events are ordered by tick plus fraction.
+ * Playback sends those events at their exact microsecond. NoteOffs are paired with the
+ * NoteOn before them on the same channel and note, or, for notes wrapping the loop end, with the
+ * first unmatched NoteOff of the loop. Unpaired NoteOffs are only transposed.
+ */
+struct TrackTransform {
+  uint8_t  quantizeStrength = 0;    // % towards the grid (0 = off)
+  uint16_t quantizeGrid = 48;       // Grid step in ticks (48 = 16th at 192 PPQN)
+  uint8_t  swing = 50;              // % position of the odd grid steps within a step pair
+  int8_t   transpose = 0;           // Semitones
+  uint8_t  velocityScale = 100;     // %
+  uint8_t  lengthScale = 100;       // %
+
+  bool isIdentity() const {
+    // Swing only places the quantize targets
+    return (quantizeStrength == 0 || quantizeGrid == 0) && transpose == 0 && velocityScale == 100 &&
+           lengthScale == 100;
+  }
+  bool operator==(const TrackTransform& o) const {
+    return quantizeStrength == o.quantizeStrength && quantizeGrid == o.quantizeGrid && swing == o.swing &&
+           transpose == o.transpose && velocityScale == o.velocityScale && lengthScale == o.lengthScale;
+  }
+  bool operator!=(const TrackTransform& o) const { return !(*this == o); }
+
+  // New start tick of a note starting at tick; fracQ16 gets the fraction of a tick past it
+  uint32_t moveStart(uint32_t tick, uint16_t* fracQ16 = nullptr) const;
+  // Transformed copy of events (sorted by tick) for a loop of loopLength ticks. With offsets, the
+  // sub-tick start of each output event (Q16 of a tick); left empty when every event is on a tick
+  void render(const EventList& events, uint32_t loopLength, EventList& out, OffsetList* offsets = nullptr) const;
+};
@@ -23,29 +23,51 @@
  * For full-track clear operations, separate clear-track snapshots are managed via
  * pushClearTrackSnapshot and undoClearTrack.
  *
- * Internally, snapshots are stored in deques of std::vector<MidiEvent> for efficient
- * push/pop operations.
+ * Internally the overdub/edit history is a deque of UndoEntry: the newest level keeps a full
+ * copy, older levels are sealed into deltas (see UndoHistory.h). Each track's history is held
+ * under undoBudgetBytes() and Config::MAX_UNDO_HISTORY levels by evicting the oldest levels; the
+ * newest level is always kept. The budget is what the track's arena has left after the events,
+ * their two playback copies and a take's record reserve, so it shrinks as the track grows.
+ *
+ * After a load, older levels may still be on the SD card (StorageManager::pagedUndoLevels).
+ * They count as undo levels, are paged in one at a time when the resident history runs out,
+ * and are evicted before any resident level.
+ *
+ * makeArenaRoom() is the memory limit's lever: it evicts the oldest levels, then the oldest
+ * clear-track copies, until the track's arena can hold an allocation. The newest of each is kept.
+ * A level or clear copy that still does not fit is not taken (the change goes ahead without it);
+ * when the newest level cannot be sealed or rebuilt, the whole history is given up.
+ *
+ * Overdub takes still held as layers (see Track) are the newest undo levels: undoOverdub() drops
+ * the top layer, and a layer merged into the events leaves the events before it as a level here.
  */
 class TrackUndo {
 public:
     friend class Track;
     // Undo overdub
-    static void pushUndoSnapshot(Track& track);
+    static bool pushUndoSnapshot(Track& track);  // False (and no history left) when the copy does not fit
     static void undoOverdub(Track& track);
     static size_t getUndoCount(const Track& track);
     static bool canUndo(const Track& track);
     static void popLastUndo(Track& track);
-    static const std::vector<MidiEvent>& peekLastMidiSnapshot(const Track& track);
-    static std::deque<std::vector<MidiEvent>>& getMidiHistory(Track& track);
-    static const std::vector<MidiEvent>& getCurrentMidiSnapshot(const Track& track);
+    static const EventList& peekLastMidiSnapshot(const Track& track);  // Resident levels only
+    static const EventList& getCurrentMidiSnapshot(const Track& track);
+    static size_t getUndoBytes(const Track& track);
+    static size_t undoBudgetBytes(const Track& track);  // Resident undo the arena can spare now
+    // Resident history for persistence (oldest entry first), newer than any paged level
+    static const std::deque<UndoEntry>& getUndoEntries(const Track& track);
+    static void clearHistory(Track& track);
+    // Replace the history with loaded entries; open (full) entries below the newest are sealed
+    static void restoreHistory(Track& track, std::deque<UndoEntry>&& entries);
+    // Evict old levels until the arena can hold `bytes`; false when it still cannot
+    static bool makeArenaRoom(Track& track, size_t bytes);
     // Undo clear
     static void pushClearTrackSnapshot(Track& track);
     static void undoClearTrack(Track& track);
     static bool canUndoClearTrack(const Track& track);
-    /**
-     * @brief Compute a simple rolling hash (FNV-1a) over the track's current MIDI events
-     * @param track The track to hash
-     * @return 32-bit hash of current midiEvents
-     */
-    static uint32_t computeMidiHash(const Track& track);
+    static bool clearCopiesUseSysEx(const Track& track);  // A clear copy holds SysEx events
+    static size_t getClearUndoBytes(const Track& track);
+
+private:
+    static void pushUndoLevel(Track& track, EventList&& state);  // Events before a merged layer
 }; 
\ No newline at end of file
@@ -0,0 +1,47 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "MidiEvent.h"
+#include "TrackArena.h"
+
+/**
+ * @struct UndoChange
+ * @brief One event of an undo delta together with its position in the event list it belongs to.
+ */
+struct UndoChange {
+    uint32_t index;   // Position of the event in its (sorted) event list
+    MidiEvent event;
+};
+
+using ChangeList = std::vector<UndoChange, ArenaAllocator<UndoChange>>;
+
+/**
+ * @struct UndoEntry
+ * @brief One level of a track's undo history.
+ *
+ * Only the newest entry is "open" and keeps a full copy of the events it restores, so
+ * undo is a plain copy. When a newer snapshot is pushed, the entry is sealed into a delta
+ * against that newer state: `removed` holds events of this state that are missing from the
+ * next one, `inserted` holds events of the next state that are missing here. Older states
+ * are rebuilt from the newest one by applying deltas backwards, one level at a time.
+ * Entries of a track's history are constructed on that track's arena.
+ */
+struct UndoEntry {
+    explicit UndoEntry(TrackArena* arena = nullptr)
+        : base(ArenaAllocator<MidiEvent>(arena)), removed(ArenaAllocator<UndoChange>(arena)),
+          inserted(ArenaAllocator<UndoChange>(arena)) {}
+
+    bool open = false;
+    EventList base;        // open: full state to restore
+    ChangeList removed;    // sealed: index into this state
+    ChangeList inserted;   // sealed: index into the next state
+
+    size_t bytes() const {
+        return sizeof(UndoEntry) + base.size() * sizeof(MidiEvent) +
+               (removed.size() + inserted.size()) * sizeof(UndoChange);
+    }
+};
@@ -0,0 +1,269 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "Benchmark.h"
+
+#ifdef LOOPER_BENCH
+
+#include <algorithm>
+#include <vector>
+#include <SD.h>
+#include "Globals.h"
+#include "DisplayManager.h"
+#include "EditManager.h"
+#include "Logger.h"
+#include "LooperState.h"
+#include "MidiHandler.h"
+#include "OutputScheduler.h"
+#include "StorageManager.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+
+namespace {
+
+constexpr uint8_t BENCH_BASE_PITCH = 36;
+constexpr uint8_t BENCH_PITCH_SPAN = 48;
+constexpr uint8_t BENCH_CC = 74;
+
+// Cycle counter: DWT on the Teensy; the host has none, so microseconds scaled to 600 MHz
+inline uint32_t cycles() {
+#if defined(__IMXRT1062__)
+  return ARM_DWT_CYCCNT;
+#else
+  return micros() * (F_CPU_ACTUAL / 1000000);
+#endif
+}
+
+float cyclesToMicros(uint64_t c) {
+  return (float)c / (F_CPU_ACTUAL / 1000000.0f);
+}
+
+uint32_t nextRandom(uint32_t& state) {
+  state = state * 1664525u + 1013904223u;
+  return state >> 8;
+}
+
+uint32_t loopLengthOf(const BenchConfig& config) {
+  return config.loopBars * Config::TICKS_PER_BAR;
+}
+
+// Notes evenly spread over the loop, pitches rotating so a pitch never overlaps itself, random
+// velocities; track 0 also gets a CC sweep. Sorted by tick like a live take.
+std::vector<MidiEvent> makeTake(const BenchConfig& config, uint8_t t, uint32_t& seed) {
+  const uint32_t loopLength = loopLengthOf(config);
+  const uint32_t notes = config.eventsPerTrack / 2;
+  const uint32_t spacing = notes ? std::max<uint32_t>(1, loopLength / notes) : 1;
+  const uint32_t length = std::max<uint32_t>(1, spacing / 2);
+  const uint8_t channel = 1 + t % 16;
+  std::vector<MidiEvent> events;
+  events.reserve(config.eventsPerTrack + (t == 0 && config.ccEveryTicks ? loopLength / config.ccEveryTicks : 0));
+  for (uint32_t i = 0; i < notes; ++i) {
+    uint32_t tick = (uint32_t)((uint64_t)i * (loopLength - length - 1) / notes);
+    uint8_t pitch = BENCH_BASE_PITCH + (i + t * 5) % BENCH_PITCH_SPAN;
+    events.push_back(MidiEvent::NoteOn(tick, channel, pitch, 1 + nextRandom(seed) % 127));
+    events.push_back(MidiEvent::NoteOff(tick + length, channel, pitch));
+  }
+  if (t == 0 && config.ccEveryTicks) {
+    for (uint32_t tick = 0; tick + 1 < loopLength; tick += config.ccEveryTicks) {
+      events.push_back(MidiEvent::ControlChange(tick, channel, BENCH_CC, nextRandom(seed) % 128));
+    }
+  }
+  std::stable_sort(events.begin(), events.end(),
+                   [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; });
+  return events;
+}
+
+void emptyTrack(Track& track) {
+  track.forceSetState(TRACK_PLAYING);  // clear() ignores an empty track
+  track.clear();
+  TrackUndo::clearHistory(track);
+}
+
+BenchCase& addCase(BenchReport& report, const char* name) {
+  BenchCase& c = report.cases[report.count++];
+  c.name = name;
+  return c;
+}
+
+void benchRecord(BenchReport& report) {
+  const BenchConfig& config = report.config;
+  BenchCase& c = addCase(report, "record");
+  uint32_t seed = config.seed;
+  for (uint8_t t = 0; t < config.tracks; ++t) {
+    Track& track = trackManager.getTrack(t);
+    emptyTrack(track);
+    std::vector<MidiEvent> take = makeTake(config, t, seed);
+    track.setState(TRACK_ARMED);
+    track.startRecording(0);
+    for (const MidiEvent& e : take) {
+      uint32_t start = cycles();
+      // ccData shares the two data bytes with noteData
+      track.recordMidiEvents((midi::MidiType)e.type, e.channel, e.data.noteData.note, e.data.noteData.velocity,
+                             e.tick);
+      c.add(cycles() - start);
+    }
+    track.stopRecording(loopLengthOf(config));
+    // A take larger than the track arena stops at "track full"
+    c.ok = c.ok && (track.getMidiEventCount() == take.size() || track.isFull());
+  }
+}
+
+// One tick of every track, as ClockManager::processPendingTicks() runs it
+void benchPlay(BenchReport& report) {
+  const BenchConfig& config = report.config;
+  BenchCase& c = addCase(report, "play_tick");
+  uint32_t ticks = config.playPasses * loopLengthOf(config);
+  trackManager.updateAllTracks(0);
+  uint32_t jumps = 0;
+  for (uint8_t t = 0; t < config.tracks; ++t) jumps += trackManager.getTrack(t).getPlaybackJumpCount();
+  for (uint32_t tick = 1; tick <= ticks; ++tick) {
+    uint32_t start = cycles();
+    trackManager.updateAllTracks(tick);
+    c.add(cycles() - start);
+  }
+  uint32_t after = 0;
+  for (uint8_t t = 0; t < config.tracks; ++t) after += trackManager.getTrack(t).getPlaybackJumpCount();
+  c.ok = after == jumps;
+}
+
+void benchDisplay(BenchReport& report) {
+  BenchCase& c = addCase(report, "display_frame");
+  trackManager.setSelectedTrack(0);
+  for (uint16_t i = 0; i < report.config.displayFrames; ++i) {
+    uint32_t start = cycles();
+    displayManager.update();
+    c.add(cycles() - start);
+  }
+}
+
+// A note on the dense track moved back and forth one detent at a time
+void benchEditMove(BenchReport& report) {
+  BenchCase& c = addCase(report, "edit_move");
+  Track& track = trackManager.getTrack(0);
+  const auto& notes = track.getDisplayNotes();
+  if (notes.empty()) {
+    c.ok = false;
+    return;
+  }
+  uint32_t hash = track.getContentHash();
+  editManager.setSelectedNoteIdx(notes.size() / 2);
+  editManager.setState(editManager.getStartNoteState(), track, 0);
+  uint16_t turns = report.config.editTurns & ~1u;  // Even: the note ends where it started
+  for (uint16_t i = 0; i < turns; ++i) {
+    uint32_t start = cycles();
+    editManager.onEncoderTurn(track, (i & 1) ? -1 : 1);
+    c.add(cycles() - start);
+  }
+  editManager.exitEditMode(track);
+  c.ok = track.getContentHash() == hash;
+}
+
+// A chain of one-event levels on the dense track, undone level by level
+void benchUndo(BenchReport& report) {
+  BenchCase& push = addCase(report, "undo_push");
+  BenchCase& undo = addCase(report, "undo");
+  Track& track = trackManager.getTrack(0);
+  const uint32_t loopLength = loopLengthOf(report.config);
+  size_t before = TrackUndo::getUndoCount(track);
+  for (uint16_t i = 0; i < report.config.undoLevels; ++i) {
+    uint32_t start = cycles();
+    TrackUndo::pushUndoSnapshot(track);
+    push.add(cycles() - start);
+    track.insertEvent(MidiEvent::NoteOn((i * 37u) % loopLength, 16, 100, 1));
+  }
+  // Only the levels pushed here; the oldest may have been evicted by the undo budget
+  while (TrackUndo::getUndoCount(track) > before) {
+    size_t levels = TrackUndo::getUndoCount(track);
+    size_t events = track.getMidiEventCount();
+    uint32_t start = cycles();
+    TrackUndo::undoOverdub(track);
+    undo.add(cycles() - start);
+    undo.ok = undo.ok && TrackUndo::getUndoCount(track) + 1 == levels && track.getMidiEventCount() + 1 == events;
+  }
+}
+
+void benchStorage(BenchReport& report) {
+  BenchCase& save = addCase(report, "save");
+  BenchCase& load = addCase(report, "load");
+  LooperState& state = looperState.getLooperState();
+  uint32_t hash = 0;
+  for (uint8_t t = 0; t < report.config.tracks; ++t) hash ^= trackManager.getTrack(t).getContentHash() + t;
+  for (uint8_t r = 0; r < report.config.storageRuns; ++r) {
+    uint32_t start = cycles();
+    save.ok = StorageManager::saveState(state) && save.ok;
+    save.add(cycles() - start);
+    start = cycles();
+    load.ok = StorageManager::loadState(state) && load.ok;
+    load.add(cycles() - start);
+  }
+  uint32_t loaded = 0;
+  for (uint8_t t = 0; t < report.config.tracks; ++t) loaded ^= trackManager.getTrack(t).getContentHash() + t;
+  load.ok = load.ok && loaded == hash;
+}
+
+}  // namespace
+
+BenchReport Benchmark::run(const BenchConfig& config) {
+  BenchReport report;
+  report.config = config;
+  if (report.config.tracks > Config::NUM_TRACKS) report.config.tracks = Config::NUM_TRACKS;
+  uint32_t started = millis();
+  benchRecord(report);
+  benchPlay(report);
+  benchDisplay(report);
+  benchEditMove(report);
+  benchUndo(report);
+  benchStorage(report);
+  report.elapsedMs = millis() - started;
+  for (uint8_t t = 0; t < report.config.tracks; ++t) emptyTrack(trackManager.getTrack(t));
+  return report;
+}
+
+void Benchmark::print(const BenchReport& report, Print& out) {
+  const BenchConfig& config = report.config;
+  out.printf("BENCH begin build=\"%s %s\" cpu_mhz=%lu tracks=%u events=%lu bars=%lu cc_every=%u undo=%u seed=%lu\n",
+             __DATE__, __TIME__, (unsigned long)(F_CPU_ACTUAL / 1000000), config.tracks,
+             (unsigned long)config.eventsPerTrack, (unsigned long)config.loopBars, config.ccEveryTicks,
+             config.undoLevels, (unsigned long)config.seed);
+  for (uint8_t i = 0; i < report.count; ++i) {
+    const BenchCase& c = report.cases[i];
+    uint64_t mean = c.samples ? c.totalCycles / c.samples : 0;
+    out.printf("BENCH case=%s n=%lu min_cyc=%lu mean_cyc=%lu max_cyc=%lu mean_us=%.2f max_us=%.2f ok=%d\n", c.name,
+               (unsigned long)c.samples, (unsigned long)(c.samples ? c.minCycles : 0), (unsigned long)mean,
+               (unsigned long)c.maxCycles, cyclesToMicros(mean), cyclesToMicros(c.maxCycles), c.ok ? 1 : 0);
+  }
+  out.printf("BENCH end passed=%d ms=%lu\n", report.passed() ? 1 : 0, (unsigned long)report.elapsedMs);
+}
+
+void Benchmark::setup() {
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  trackManager.setup();
+  midiHandler.setup();
+  midiHandler.setOutputSerial(false);
+  outputScheduler.setup();
+  displayManager.setup();
+  SD.begin(BUILTIN_SDCARD);
+  if (LOOPER_STORAGE_DIR[0]) SD.mkdir(LOOPER_STORAGE_DIR);
+  StorageManager::loadState(looperState.getLooperState());  // Starts this firmware's own checkpoint
+  print(run(BenchConfig()), Serial);
+}
+
+void Benchmark::pollSerial() {
+  logger.drain(Config::LOG_DRAIN_BUDGET_US);
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c != 'b' && c != 'B') continue;
+    BenchConfig config;
+    if (c == 'B') {
+      config.tracks = Config::NUM_TRACKS;
+      config.eventsPerTrack = 4000;
+      config.loopBars = 8;
+      config.ccEveryTicks = 2;
+      config.undoLevels = Config::MAX_UNDO_HISTORY;
+    }
+    print(run(config), Serial);
+  }
+}
+
+#endif  // LOOPER_BENCH
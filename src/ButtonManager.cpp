@@ -9,124 +9,268 @@
 #include "LooperState.h"
 #include "Logger.h"
 #include "TrackUndo.h"
-#include "Globals.h"
-#include <Encoder.h>
+#include "RingBuffer.h"
 #include "EditManager.h"
-
-Encoder encoder(Buttons::ENCODER_PIN_A, Buttons::ENCODER_PIN_B);
+#include "DisplayManager.h"
 
 ButtonManager buttonManager;
 
+// --- Input capture (filled by the pin-change ISRs) ---
+static SpscRingBuffer<InputEvent, 128> inputQueue;  // A few bouncing presses plus a fast turn
+static uint8_t isrPins[ButtonManager::MAX_BUTTONS];
+
+template <uint8_t Index>
+static void buttonIsr() {
+    buttonManager.captureButton(Index, digitalRead(isrPins[Index]) == LOW, micros());
+}
+static void (*const BUTTON_ISRS[ButtonManager::MAX_BUTTONS])() = {
+    buttonIsr<0>, buttonIsr<1>, buttonIsr<2>, buttonIsr<3>
+};
+
+static void encoderIsr() {
+    buttonManager.captureEncoder(digitalRead(Buttons::ENCODER_PIN_A), digitalRead(Buttons::ENCODER_PIN_B), micros());
+}
+
+// Quadrature steps by (previous B A, new B A), in the direction the Encoder library counts
+static const int8_t QUADRATURE_STEP[16] = {0, 1, -1, 2, -1, 0, -2, 1, 1, -2, 0, -1, 2, -1, 1, 0};
+static constexpr int8_t STEPS_PER_DETENT = 4;
+
 ButtonManager::ButtonManager() {
-    buttons.clear();
-    pressTimes.clear();
-    lastTapTime.clear();
-    pendingShortPress.clear();
-    shortPressExpireTime.clear();
-    encoderPosition = 0;
-    lastEncoderPosition = 0;
+    buttonCount = 0;
+    pendingEncoderDelta = 0;
     if (DEBUG_BUTTONS) {
         Serial.println("ButtonManager constructor called.");
     }
 }
 
 void ButtonManager::setup(const std::vector<uint8_t>& pins) {
-    size_t countPins = pins.size();
-    buttons.resize(countPins);
-    pressTimes.resize(countPins);
-    lastTapTime.resize(countPins, 0);
-    pendingShortPress.resize(countPins, false);
-    shortPressExpireTime.resize(countPins, 0);
-
-    uint32_t t0 = millis();
-
-    // seed pressTimes so that initial rises are harmless
-    pressTimes.assign(countPins, t0);
-
-    for (size_t i = 0; i < countPins; ++i) {
-        buttons[i].attach(pins[i], INPUT_PULLUP);
-        buttons[i].interval(DEFAULT_DEBOUNCE_INTERVAL);
-        // prime the debouncer to clear any pending transitions
-        buttons[i].update();
-        buttons[i].update();
+    if (pins.size() > MAX_BUTTONS) {
+        Serial.print("[Buttons] ERROR: Only "); Serial.print(MAX_BUTTONS); Serial.println(" buttons supported");
     }
+    buttonCount = pins.size() < MAX_BUTTONS ? pins.size() : MAX_BUTTONS;
+    setupMicros = micros();
+    seenOverflows = inputQueue.getOverflowCount();
 
-    // encoder.write(0);
-    encoderPosition = 0;
-    lastEncoderPosition = 0;
+    for (uint8_t i = 0; i < buttonCount; ++i) {
+        Button& b = buttons[i];
+        b.pin = pins[i];
+        isrPins[i] = pins[i];
+        pinMode(b.pin, INPUT_PULLUP);
+        // Start from the current level so the pullup coming up is not an edge
+        bool pressed = digitalRead(b.pin) == LOW;
+        b.capturedPressed = pressed;
+        b.capturedMicros = setupMicros;
+        b.raw = b.stable = pressed;
+        b.rawMicros = setupMicros;
+        b.acceptedMicros = setupMicros - DEFAULT_DEBOUNCE_INTERVAL * 1000UL;
+        b.pressSeen = false;
+        b.pressMicros = setupMicros;
+        b.pendingShortPress = false;
+        b.shortPressExpireMicros = 0;
+        attachInterrupt(digitalPinToInterrupt(b.pin), BUTTON_ISRS[i], CHANGE);
+    }
+
+    pinMode(Buttons::ENCODER_PIN_A, INPUT_PULLUP);
+    pinMode(Buttons::ENCODER_PIN_B, INPUT_PULLUP);
+    encoderPins = (digitalRead(Buttons::ENCODER_PIN_A) ? 1 : 0) | (digitalRead(Buttons::ENCODER_PIN_B) ? 2 : 0);
+    encoderCount = 0;
+    lastDetentMicros = setupMicros - 1000000UL;
+    pendingEncoderDelta = 0;
+    attachInterrupt(digitalPinToInterrupt(Buttons::ENCODER_PIN_A), encoderIsr, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(Buttons::ENCODER_PIN_B), encoderIsr, CHANGE);
 
     if (DEBUG_BUTTONS) {
         Serial.print("ButtonManager setup complete with ");
-        Serial.print(countPins);
+        Serial.print(buttonCount);
         Serial.println(" buttons.");
     }
 }
 
-void ButtonManager::update() {
-    // Ignore states when booting up, pullup change is else detected as button press
-    static uint32_t bootTime = millis();
-    uint32_t now = millis();
+// Runs in the pin-change ISR
+void ButtonManager::captureButton(uint8_t index, bool pressed, uint32_t timeMicros) {
+    if (index >= buttonCount) return;
+    Button& b = buttons[index];
+    // A bounce too fast for the ISR can show the same level twice; only changes are queued
+    if (pressed == b.capturedPressed) return;
+    b.capturedPressed = pressed;
+    b.capturedMicros = timeMicros;
+    inputQueue.push(InputEvent{timeMicros, index, static_cast<int8_t>(pressed ? 1 : 0)});
+}
 
-    // still ignore the first second of boot-up
-    if (now - bootTime < 1000) {
-        // make sure Bounce keeps its state up-to-date
-        for (auto& b : buttons) b.update();
-        return;
+// Runs in the pin-change ISR
+void ButtonManager::captureEncoder(bool pinA, bool pinB, uint32_t timeMicros) {
+    uint8_t state = encoderPins | (pinA ? 4 : 0) | (pinB ? 8 : 0);
+    encoderPins = state >> 2;
+    int8_t count = encoderCount + QUADRATURE_STEP[state];
+    if (count >= STEPS_PER_DETENT) {
+        count -= STEPS_PER_DETENT;
+        inputQueue.push(InputEvent{timeMicros, INPUT_SOURCE_ENCODER, 1});
+    } else if (count <= -STEPS_PER_DETENT) {
+        count += STEPS_PER_DETENT;
+        inputQueue.push(InputEvent{timeMicros, INPUT_SOURCE_ENCODER, -1});
     }
+    encoderCount = count;
+}
 
-    for (size_t i = 0; i < buttons.size(); ++i) {
-        buttons[i].update();
+uint32_t ButtonManager::getDroppedInputCount() const {
+    return inputQueue.getOverflowCount();
+}
 
-        if (buttons[i].fell()) {
-            pressTimes[i] = now;
+void ButtonManager::update(uint32_t nowMicros) {
+    InputEvent e;
+    while (inputQueue.pop(e)) {
+        if (e.source == INPUT_SOURCE_ENCODER) {
+            onDetent(e.value, e.micros);
+        } else if (e.source < buttonCount) {
+            onEdge(e.source, e.value != 0, e.micros);
         }
+    }
 
-        if (buttons[i].rose()) {
-            // never fire on a rise if we never saw a fall
-            if (pressTimes[i] == 0) {
-                pressTimes[i] = now;
-                continue;
-            }
-            uint32_t duration = now - pressTimes[i];
-            if (duration >= LONG_PRESS_TIME ) {
-                handleButton(static_cast<ButtonId>(i), BUTTON_LONG_PRESS);
-            } else {
-                // Delay decision for short press vs. double tap
-                if (now - lastTapTime[i] <= DOUBLE_TAP_WINDOW) {
-                    // Detected second tap in window → double
-                    lastTapTime[i] = 0;
-                    pendingShortPress[i] = false;
-                    handleButton(static_cast<ButtonId>(i), BUTTON_DOUBLE_PRESS);
-                } else {
-                    // First tap
-                    lastTapTime[i] = now;
-                    pendingShortPress[i] = true;
-                    shortPressExpireTime[i] = now + DOUBLE_TAP_WINDOW;
-                }
-            }
+    // Edges lost to a full queue: continue from the level the ISR saw last
+    if (inputQueue.getOverflowCount() != seenOverflows) {
+        seenOverflows = inputQueue.getOverflowCount();
+        for (uint8_t i = 0; i < buttonCount; ++i) {
+            noInterrupts();
+            bool pressed = buttons[i].capturedPressed;
+            uint32_t at = buttons[i].capturedMicros;
+            interrupts();
+            if (pressed != buttons[i].raw) onEdge(i, pressed, at);
         }
+    }
+
+    for (uint8_t i = 0; i < buttonCount; ++i) {
+        settle(i, nowMicros);
+        expireShortPress(i, nowMicros);
+    }
+    flushEncoder();
+    updateEncoderHold(nowMicros);
+}
 
-        // Fire short press if timeout expired and no second tap arrived
-        if (pendingShortPress[i] && now >= shortPressExpireTime[i]) {
-            pendingShortPress[i] = false;
-            handleButton(static_cast<ButtonId>(i), BUTTON_SHORT_PRESS);
+// --- Debouncing on capture stamps ---
+
+void ButtonManager::onEdge(uint8_t index, bool pressed, uint32_t timeMicros) {
+    Button& b = buttons[index];
+    settle(index, timeMicros);
+    b.raw = pressed;
+    b.rawMicros = timeMicros;
+    if (pressed != b.stable && timeMicros - b.acceptedMicros >= DEFAULT_DEBOUNCE_INTERVAL * 1000UL) {
+        accept(index, pressed, timeMicros);
+    }
+}
+
+// A level that changed inside the debounce window and stayed: accept it when the window ends
+void ButtonManager::settle(uint8_t index, uint32_t nowMicros) {
+    Button& b = buttons[index];
+    const uint32_t windowEnd = b.acceptedMicros + DEFAULT_DEBOUNCE_INTERVAL * 1000UL;
+    if (b.raw == b.stable || (int32_t)(nowMicros - windowEnd) < 0) return;
+    accept(index, b.raw, (int32_t)(b.rawMicros - windowEnd) > 0 ? b.rawMicros : windowEnd);
+}
+
+void ButtonManager::accept(uint8_t index, bool pressed, uint32_t timeMicros) {
+    Button& b = buttons[index];
+    b.stable = pressed;
+    b.acceptedMicros = timeMicros;
+    // A first tap whose window closed before this change is a short press
+    expireShortPress(index, timeMicros);
+
+    // Ignore changes in the first second after boot, the pullups are still settling
+    if (timeMicros - setupMicros < BOOT_IGNORE_TIME * 1000UL) {
+        b.pressSeen = false;
+        return;
+    }
+
+    if (pressed) {
+        b.pressSeen = true;
+        b.pressMicros = timeMicros;
+        return;
+    }
+    // never fire on a release if we never saw the press
+    if (!b.pressSeen) return;
+    b.pressSeen = false;
+
+    uint32_t duration = timeMicros - b.pressMicros;
+    if (duration >= LONG_PRESS_TIME * 1000UL) {
+        dispatch(index, BUTTON_LONG_PRESS);
+    } else if (b.pendingShortPress) {
+        // Detected second tap in window → double
+        b.pendingShortPress = false;
+        dispatch(index, BUTTON_DOUBLE_PRESS);
+    } else {
+        // First tap: delay decision for short press vs. double tap
+        b.pendingShortPress = true;
+        b.shortPressExpireMicros = timeMicros + DOUBLE_TAP_WINDOW * 1000UL;
+    }
+}
+
+// Fire short press if timeout expired and no second tap arrived
+void ButtonManager::expireShortPress(uint8_t index, uint32_t nowMicros) {
+    Button& b = buttons[index];
+    if (b.pendingShortPress && (int32_t)(nowMicros - b.shortPressExpireMicros) >= 0) {
+        b.pendingShortPress = false;
+        dispatch(index, BUTTON_SHORT_PRESS);
+    }
+}
+
+void ButtonManager::dispatch(uint8_t index, ButtonAction action) {
+    // Turns made before the press act first, in the edit state they were made in
+    flushEncoder();
+    handleButton(static_cast<ButtonId>(index), action);
+}
+
+// --- Encoder ---
+
+int ButtonManager::encoderAcceleration(uint32_t intervalMicros, bool coarse) {
+    uint32_t interval = intervalMicros / 1000;
+    if (coarse) {
+        if (interval < 25) return 24;
+        if (interval < 50) return 8;
+        if (interval < 100) return 4;
+    } else {
+        // Edit mode: slow down encoder
+        if (interval < 50) return 4;
+        if (interval < 75) return 3;
+        if (interval < 100) return 2;
+    }
+    return 1;
+}
+
+void ButtonManager::onDetent(int8_t direction, uint32_t timeMicros) {
+    uint32_t interval = timeMicros - lastDetentMicros;
+    lastDetentMicros = timeMicros;
+    bool coarse = editManager.getCurrentState() == editManager.getStartNoteState();
+    pendingEncoderDelta += direction * encoderAcceleration(interval, coarse);
+}
+
+void ButtonManager::flushEncoder() {
+    if (pendingEncoderDelta == 0) return;
+    int delta = pendingEncoderDelta;
+    pendingEncoderDelta = 0;
+    if (editManager.getCurrentState() != nullptr) {
+        // In edit mode: encoder changes value
+        editManager.onEncoderTurn(trackManager.getSelectedTrack(), delta);
+        if (DEBUG_BUTTONS) {
+            Serial.print("[EDIT] Encoder value change: ");
+            Serial.println(delta);
         }
+    } else if (DEBUG_BUTTONS) {
+        Serial.print("Encoder delta: ");
+        Serial.println(delta);
     }
+}
 
-    // --- Encoder button hold/release logic ---
+// --- Encoder button hold/release logic ---
+void ButtonManager::updateEncoderHold(uint32_t nowMicros) {
     static bool wasEncoderButtonHeld = false;
-    static uint32_t encoderButtonHoldStart = 0;
     static bool pitchEditActive = false;
     const uint32_t ENCODER_HOLD_DELAY = 250; // ms
     bool encoderButtonHeld = false;
-    if (buttons.size() > BUTTON_ENCODER) {
-        encoderButtonHeld = buttons[BUTTON_ENCODER].read() == LOW; // LOW = pressed/held
+    uint32_t holdStart = 0;
+    if (buttonCount > BUTTON_ENCODER) {
+        const Button& b = buttons[BUTTON_ENCODER];
+        encoderButtonHeld = b.stable && b.pressSeen;
+        holdStart = b.pressMicros;
     }
-    if (encoderButtonHeld && !wasEncoderButtonHeld) {
-        // Just started holding
-        encoderButtonHoldStart = now;
-    }
-    if (encoderButtonHeld && (now - encoderButtonHoldStart >= ENCODER_HOLD_DELAY) &&
+    if (encoderButtonHeld && (nowMicros - holdStart >= ENCODER_HOLD_DELAY * 1000UL) &&
         (editManager.getCurrentState() == editManager.getNoteState() ||
          editManager.getCurrentState() == editManager.getStartNoteState())) {
         if (!pitchEditActive) {
@@ -139,50 +283,9 @@ void ButtonManager::update() {
         if (editManager.getCurrentState() == editManager.getPitchNoteState()) {
             editManager.exitPitchEditMode(trackManager.getSelectedTrack());
         }
-        encoderButtonHoldStart = 0;
         pitchEditActive = false;
     }
     wasEncoderButtonHeld = encoderButtonHeld;
-
-    // --- Encoder handling ---
-    static uint32_t lastEncoderTime = 0;
-    long newEncoderPos = encoder.read() / 4; // adjust divisor for your encoder
-    int rawDelta = newEncoderPos - encoderPosition;
-    if (rawDelta != 0) {
-        uint32_t now = millis();
-        uint32_t interval = now - lastEncoderTime;
-        lastEncoderTime = now;
-        int accel = 1;
-        if (editManager.getCurrentState() == editManager.getStartNoteState()) {
-            if (interval < 25) accel = 24;
-            else if (interval < 50) accel = 8;
-            else if (interval < 100) accel = 4;
-        } else {
-            // Edit mode: slow down encoder
-            if (interval < 50) accel = 4;
-            else if (interval < 75) accel = 3;
-            else if (interval < 100) accel = 2;
-        }
-        // else accel = 1;
-        int finalDelta = rawDelta * accel;
-        if (editManager.getCurrentState() != nullptr) {
-            // In edit mode: encoder changes value
-            editManager.onEncoderTurn(trackManager.getSelectedTrack(), finalDelta);
-            if (DEBUG_BUTTONS) {
-                Serial.print("[EDIT] Encoder value change: ");
-                Serial.println(finalDelta);
-            }
-        } else {
-            // Not in edit mode, print encoder position and delta for debug
-            if (DEBUG_BUTTONS) {
-                Serial.print("Encoder position: ");
-                Serial.println(newEncoderPos);
-                Serial.print("Encoder delta: ");
-                Serial.println(rawDelta);
-            }
-        }
-        encoderPosition = newEncoderPos; // Only update after using the delta
-    }
 }
 
 void ButtonManager::handleButton(ButtonId button, ButtonAction action) {
@@ -226,7 +329,7 @@ void ButtonManager::handleButton(ButtonId button, ButtonAction action) {
                     } else {
                         TrackUndo::pushClearTrackSnapshot(track);
                         track.clear();
-                        StorageManager::saveState(looperState.getLooperState());
+                        StorageManager::requestSave();
                         if (DEBUG_BUTTONS) Serial.println("Button A: Clear Track");
                     }
                     break;
@@ -241,7 +344,7 @@ void ButtonManager::handleButton(ButtonId button, ButtonAction action) {
                     if (TrackUndo::canUndoClearTrack(track)) {
                         if (DEBUG_BUTTONS) Serial.println("Button A: Undo Clear Track");
                         TrackUndo::undoClearTrack(track);
-                        StorageManager::saveState(looperState.getLooperState());
+                        StorageManager::requestSave();
                     } else {
                         if (DEBUG_BUTTONS) Serial.println("Nothing to undo for clear/mute.");
                     }                
@@ -287,6 +390,12 @@ void ButtonManager::handleButton(ButtonId button, ButtonAction action) {
                         }
                     }
                     break;
+                case BUTTON_DOUBLE_PRESS:
+                    if (editManager.getCurrentState() == nullptr) {
+                        displayManager.toggleOverview();
+                        if (DEBUG_BUTTONS) Serial.println("Encoder Button: Toggle track overview");
+                    }
+                    break;
                 case BUTTON_LONG_PRESS:
                     if (looperState.getEditContext() != EDIT_NONE) {
                         logger.debug("Exit edit mode");
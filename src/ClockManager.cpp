@@ -4,8 +4,10 @@
 #include "ClockManager.h"
 #include "Globals.h"
 #include <IntervalTimer.h>
+#include "MidiHandler.h"
 #include "TrackManager.h"
 #include "Logger.h"
+#include "TimeSignature.h"
 
 ClockManager clockManager;  // Global instance initiated
 IntervalTimer clockTimer;
@@ -15,11 +17,35 @@ bool sequencerRunning = true;
 ClockManager::ClockManager()
   : pendingStart(false),
     microsPerTick(0),
+    tickPeriodQ16(0),
+    periodFracQ16(0),
     currentTick(0),
+    clockPhase(0),
+    sixteenthPhase(0),
     lastMidiClockTime(0),
     lastInternalTickTime(0),
-    externalClockPresent(false)
-    
+    playTickMicros(0),
+    externalClockPresent(false),
+    syncActive(false),
+    tickLimit(0),
+    pulseBaseTick(0),
+    pulseCount(0),
+    lastPulseMicros(0),
+    pulseIntervalQ16(0),
+    syncDriftQ16(0),
+    lockedPulses(0),
+    syncLocked(false),
+    syncAcquired(false),
+    positionPending(false),
+    clockMaster(Config::CLOCK_MASTER),
+    masterOutput(false),
+    masterArmed(false),
+    clockOutRestart(true),
+    lastClockOutMicros(0),
+    clockOutIntervals(0),
+    clockOutCount(0),
+    clockJitterMax(0),
+    clockJitterTotal(0)
 {}
 
 
@@ -30,60 +56,216 @@ uint32_t ClockManager::getCurrentTick() const {
   return tick;
 }
 
+// Position between ticks, for timestamping input at interrupt level
+void ClockManager::getTickPosition(uint32_t& tick, uint16_t& fracQ16) const {
+  noInterrupts();
+  tick = currentTick;
+  uint32_t since = micros() - lastInternalTickTime;
+  uint32_t periodQ16 = tickPeriodQ16;
+  interrupts();
+  uint64_t frac = ((uint64_t)since << 32) / (periodQ16 ? periodQ16 : 1);
+  fracQ16 = frac > 0xFFFF ? 0xFFFF : (uint16_t)frac;
+}
+
 bool ClockManager::isExternalClockPresent() const {
   return externalClockPresent;
 }
 
 void ClockManager::setExternalClockPresent(bool present) {
   externalClockPresent = present;
+  updateMasterOutput();
 }
 
 void ClockManager::setup() {
-  microsPerTick = 60000000UL / (bpm * MidiConfig::PPQN);
+  tickPeriodQ16 = internalTickPeriodQ16();
+  microsPerTick = tickPeriodQ16 >> 16;
+  clockTimer.begin([] { clockManager.updateInternalClock(); }, microsPerTick);
+  updateMasterOutput();
+}
+
+// Tick period for the internal tempo, Q16.16 microseconds
+uint32_t ClockManager::internalTickPeriodQ16() const {
+  double ticksPerMinute = (double)bpm * ticksPerQuarterNote;
+  if (ticksPerMinute <= 0) return UINT32_MAX;
+  double periodQ16 = 60000000.0 * 65536.0 / ticksPerMinute;
+  return periodQ16 >= (double)UINT32_MAX ? UINT32_MAX : (uint32_t)periodQ16;
+}
+
+// Publish a new tick period; the ISR applies it from the next tick
+void ClockManager::setTickPeriod(uint32_t periodQ16) {
+  constexpr uint32_t minPeriodQ16 = 50u << 16;  // Keep the ISR rate sane (20 kHz)
+  tickPeriodQ16 = periodQ16 < minPeriodQ16 ? minPeriodQ16 : periodQ16;
+}
+
+void ClockManager::restartTimerPhase() {
+  clockTimer.end();
+  noInterrupts();
+  periodFracQ16 = 0;
+  microsPerTick = tickPeriodQ16 >> 16;
+  lastInternalTickTime = micros();
+  interrupts();
   clockTimer.begin([] { clockManager.updateInternalClock(); }, microsPerTick);
 }
 
 void ClockManager::setBpm(uint16_t newBpm) {
   bpm = newBpm;
-  microsPerTick = 60000000UL / (bpm * MidiConfig::PPQN);
-  clockTimer.update(microsPerTick);
+  if (!syncActive) setTickPeriod(internalTickPeriodQ16());
 }
 
 void ClockManager::setTicksPerQuarterNote(uint16_t newTicks) {
   ticksPerQuarterNote = newTicks;
-  microsPerTick = 60000000UL / (bpm * MidiConfig::PPQN);
-  clockTimer.update(microsPerTick);
+  if (!syncActive) setTickPeriod(internalTickPeriodQ16());
 }
 
 
+// Runs in the IntervalTimer ISR: advance the tick and hand it to loop(). As clock master it also
+// writes MIDI: the Clock, and an armed Start or Song Position, through queueClockOutput().
+// Constant-time regardless of how many tracks or events are due.
 void ClockManager::updateInternalClock() {
   if (!sequencerRunning) return;
+  if (syncActive && currentTick >= tickLimit) return;  // Wait for the next external pulse
+  uint32_t nowMicros = micros();
   currentTick++;
-  trackManager.updateAllTracks(currentTick);  // Let TrackManager handle it
-  lastInternalTickTime = micros();
+  tickQueue.push({currentTick, nowMicros});
+  lastInternalTickTime = nowMicros;
+  uint8_t clock = clockPhase + 1;
+  uint8_t sixteenth = sixteenthPhase + 1;
+  if (clock == Config::TICKS_PER_CLOCK) clock = 0;
+  if (sixteenth == Config::TICKS_PER_16TH_STEP) sixteenth = 0;
+  clockPhase = clock;
+  sixteenthPhase = sixteenth;
+  if (masterOutput && clock == 0) sendMasterClock(currentTick, sixteenth == 0);
+
+  // Dither the whole-microsecond timer period so it averages to the exact Q16 period.
+  // The new period applies from the next timer reload.
+  uint32_t periodQ16 = tickPeriodQ16;
+  uint32_t us = periodQ16 >> 16;
+  periodFracQ16 += periodQ16 & 0xFFFF;
+  if (periodFracQ16 >= 0x10000) {
+    periodFracQ16 -= 0x10000;
+    us++;
+  }
+  if (us != microsPerTick) {
+    microsPerTick = us;
+    clockTimer.update(us);
+  }
 }
 
-void ClockManager::onMidiClockPulse() {
+// Runs in loop(): drain the ticks elapsed since the last call, oldest first.
+void ClockManager::processPendingTicks() {
+  ClockTickEvent evt;
+  midiHandler.flushClockOutput();  // Clock held by a busy port goes before the tick's notes
+  while (tickQueue.pop(evt)) {
+    playTick(evt.tick, evt.micros);
+  }
+}
+
+// Play one tick; tickMicros is when it elapsed, the base of sub-tick deadlines
+void ClockManager::playTick(uint32_t tick, uint32_t tickMicros) {
+  playTickMicros = tickMicros;
+  trackManager.updateAllTracks(tick);
+}
+
+// When the tick being played plus fracQ16 of a tick falls
+uint32_t ClockManager::microsAtTickFraction(uint16_t fracQ16) const {
+  return playTickMicros + (uint32_t)(((uint64_t)fracQ16 * tickPeriodQ16) >> 32);
+}
+
+void ClockManager::onMidiClockPulse(uint32_t pulseMicros) {
+  lastMidiClockTime = pulseMicros;
   if (!sequencerRunning) return;
-  externalClockPresent = true;
-  //Avoid snapping if currentTick is 0.
-  if (currentTick != 0) {
-    uint32_t expectedTick = ((currentTick / 8) + 1) * 8;
-    if (currentTick != expectedTick) {
-        currentTick = expectedTick; // Resync to MIDI clock
+  if (!externalClockPresent) {
+    externalClockPresent = true;
+    updateMasterOutput();
+    logger.info("External MIDI clock detected");
+  }
+  // Play out ticks the ISR already produced, so order is preserved
+  processPendingTicks();
+
+  if (!syncAcquired) {
+    // Acquire: this pulse sits on the current tick; follow from here
+    noInterrupts();
+    pulseBaseTick = currentTick;
+    tickLimit = currentTick + Config::TICKS_PER_CLOCK;
+    syncActive = true;
+    interrupts();
+    syncAcquired = true;
+    pulseCount = 0;
+    pulseIntervalQ16 = 0;
+    syncDriftQ16 = 0;
+    lockedPulses = 0;
+    syncLocked = false;
+    lastPulseMicros = pulseMicros;
+    restartTimerPhase();
+    return;
+  }
+
+  // Frequency: smoothed pulse interval
+  uint32_t interval = pulseMicros - lastPulseMicros;
+  lastPulseMicros = pulseMicros;
+  bool firstInterval = (pulseIntervalQ16 == 0);
+  if (interval > 0 && interval < midiClockTimeout) {
+    int64_t sample = (int64_t)interval << 16;
+    if (firstInterval) {
+      pulseIntervalQ16 = sample;
+    } else {
+      pulseIntervalQ16 += (sample - (int64_t)pulseIntervalQ16) >> Config::CLOCK_TEMPO_SMOOTHING_SHIFT;
     }
   }
-  
-  // if (pendingStart) {
-  //   // const uint32_t ticksPerBar = MidiConfig::PPQN * 4;
-  //   // if (currentTick % ticksPerBar == 0) {
-  //     currentTick = 0;
-  //     pendingStart = false;
-  //   // }
-  // }
+  pulseCount++;
+  uint32_t expectedTick = pulseBaseTick + pulseCount * Config::TICKS_PER_CLOCK;
 
-  trackManager.updateAllTracks(currentTick);
-  lastMidiClockTime = setLastMidiClockTime(micros());
+  // Phase: where the internal clock stood at the pulse, in Q16 ticks
+  noInterrupts();
+  uint32_t tick = currentTick;
+  int32_t sinceTick = (int32_t)(pulseMicros - lastInternalTickTime);
+  uint32_t periodQ16 = tickPeriodQ16;
+  interrupts();
+  // Negative when the pulse was stamped before the latest tick (input drained late)
+  int64_t fracQ16 = ((int64_t)sinceTick << 32) / periodQ16;
+  if (fracQ16 > 0xFFFF) fracQ16 = 0xFFFF;
+  int64_t errQ16 = ((int64_t)(int32_t)(expectedTick - tick) << 16) - fracQ16;
+  syncDriftQ16 = errQ16 > INT32_MAX ? INT32_MAX : (errQ16 < INT32_MIN ? INT32_MIN : (int32_t)errQ16);
+
+  if (errQ16 > ((int64_t)Config::CLOCK_RESYNC_TICKS << 16)) {
+    // Too far behind to slew: freeze the ISR, then play the missed ticks in order
+    noInterrupts();
+    tickLimit = currentTick;
+    interrupts();
+    processPendingTicks();
+    for (uint32_t t = currentTick + 1; (int32_t)(expectedTick - t) >= 0; ++t) {
+      seatTick(t);
+      playTick(t, micros());
+    }
+    tickLimit = expectedTick + Config::TICKS_PER_CLOCK;
+    restartTimerPhase();
+    lockedPulses = 0;
+    syncLocked = false;
+    return;
+  }
+  tickLimit = expectedTick + Config::TICKS_PER_CLOCK;
+  if (pulseIntervalQ16 == 0) return;  // No tempo yet
+
+  // Tick period = measured frequency, corrected to close the phase error over a few pulses
+  int64_t basePeriod = (int64_t)(pulseIntervalQ16 / Config::TICKS_PER_CLOCK);
+  int64_t correction = basePeriod * errQ16 /
+      (((int64_t)Config::TICKS_PER_CLOCK * Config::CLOCK_PHASE_CORRECTION_PULSES) << 16);
+  int64_t target = basePeriod - correction;
+  if (!firstInterval) {
+    int64_t maxStep = (int64_t)periodQ16 * Config::CLOCK_SLEW_PPM / 1000000;
+    if (target > (int64_t)periodQ16 + maxStep) target = (int64_t)periodQ16 + maxStep;
+    if (target < (int64_t)periodQ16 - maxStep) target = (int64_t)periodQ16 - maxStep;
+  }
+  setTickPeriod(target > UINT32_MAX ? UINT32_MAX : (target < 0 ? 0 : (uint32_t)target));
+
+  // Lock: drift within tolerance for a full beat
+  int64_t absErr = errQ16 < 0 ? -errQ16 : errQ16;
+  if (absErr <= Config::CLOCK_LOCK_TOLERANCE_Q16) {
+    if (lockedPulses < Config::CLOCK_LOCK_PULSES) lockedPulses++;
+  } else {
+    lockedPulses = 0;
+  }
+  syncLocked = (lockedPulses >= Config::CLOCK_LOCK_PULSES);
 }
 
 uint32_t ClockManager::setLastMidiClockTime(uint32_t lastMidiClockTime){
@@ -91,30 +273,200 @@ uint32_t ClockManager::setLastMidiClockTime(uint32_t lastMidiClockTime){
 }
 
 void ClockManager::checkClockSource() {
-  // Future enhancement: detect clock loss
+  if (!externalClockPresent) return;
+  if (micros() - lastMidiClockTime < midiClockTimeout) return;
+  externalClockPresent = false;
+  resetSync();
+  setTickPeriod(internalTickPeriodQ16());
+  updateMasterOutput();
+  logger.info("External MIDI clock lost, using internal tempo");
+}
+
+// Stop following external pulses; the ISR runs freely again
+void ClockManager::resetSync() {
+  syncActive = false;
+  syncAcquired = false;
+  pulseIntervalQ16 = 0;
+  syncDriftQ16 = 0;
+  lockedPulses = 0;
+  syncLocked = false;
+}
+
+// --- Clock master output ---
+
+void ClockManager::setClockMaster(bool enable) {
+  bool wasSending = masterOutput;
+  clockMaster = enable;
+  updateMasterOutput();
+  if (wasSending && !masterOutput) midiHandler.sendStop();
+}
+
+// Send clock while master on the internal tempo. A clock source taking over gets no Stop from
+// here: downstream gear hears that source from then on.
+void ClockManager::updateMasterOutput() {
+  bool send = clockMaster && !externalClockPresent && sequencerRunning;
+  if (send == masterOutput) return;
+  if (send) {
+    masterArmed = true;  // Before the ISR sees masterOutput
+    clockOutRestart = true;
+    masterOutput = true;
+    logger.info("Clock master: sending 24 PPQN clock");
+    return;
+  }
+  masterOutput = false;
+  masterArmed = false;
+  logger.info("Clock master off: %lu clocks, jitter max %lu us, mean %lu us", (unsigned long)clockOutCount,
+              (unsigned long)clockJitterMax, (unsigned long)getClockJitterMean());
+}
+
+// Runs in the timer ISR
+void ClockManager::sendMasterClock(uint32_t tick, bool onSixteenth) {
+  if (masterArmed && onSixteenth) {
+    uint16_t position = (uint16_t)(TimeSignature::SIXTEENTH.div(tick) & 0x3FFF);
+    if (position == 0) {
+      midiHandler.queueClockOutput(midi::Start);
+    } else {
+      midiHandler.queueClockOutput(midi::SongPosition, position);
+      midiHandler.queueClockOutput(midi::Continue);
+    }
+    masterArmed = false;
+    clockOutRestart = true;
+  }
+  midiHandler.queueClockOutput(midi::Clock);
+}
+
+// Position pointers count 16ths, so a tick between them waits for the next one
+void ClockManager::sendMasterPosition(uint32_t tick) {
+  clockOutRestart = true;
+  uint32_t sixteenths, inSixteenth;
+  TimeSignature::SIXTEENTH.divmod(tick, sixteenths, inSixteenth);
+  if (inSixteenth != 0) {
+    masterArmed = true;
+    return;
+  }
+  masterArmed = false;
+  uint16_t position = (uint16_t)(sixteenths & 0x3FFF);
+  if (position == 0) {
+    midiHandler.sendStart();
+  } else {
+    midiHandler.sendSongPosition(position);
+    midiHandler.sendContinueMIDI();
+  }
+  if (TimeSignature::CLOCK.mod(tick) == 0) midiHandler.sendClock();
+}
+
+// Deviation of each clock interval from TICKS_PER_CLOCK tick periods. MidiHandler calls this with
+// the port held, so calls never overlap.
+void ClockManager::onClockOutput(uint32_t sentMicros) {
+  clockOutCount++;
+  if (!clockOutRestart) {
+    uint32_t expected = (uint32_t)(((uint64_t)tickPeriodQ16 * Config::TICKS_PER_CLOCK) >> 16);
+    uint32_t interval = sentMicros - lastClockOutMicros;
+    uint32_t jitter = interval > expected ? interval - expected : expected - interval;
+    if (jitter > clockJitterMax) clockJitterMax = jitter;
+    clockJitterTotal += jitter;
+    clockOutIntervals++;
+  }
+  clockOutRestart = false;
+  lastClockOutMicros = sentMicros;
+}
+
+uint32_t ClockManager::getClockJitterMean() const {
+  noInterrupts();
+  uint64_t total = clockJitterTotal;
+  uint32_t intervals = clockOutIntervals;
+  interrupts();
+  return intervals ? (uint32_t)(total / intervals) : 0;
+}
+
+void ClockManager::resetClockJitter() {
+  noInterrupts();
+  clockOutIntervals = 0;
+  clockOutCount = 0;
+  clockJitterMax = 0;
+  clockJitterTotal = 0;
+  clockOutRestart = true;
+  interrupts();
+}
+
+float ClockManager::getMeasuredBpm() const {
+  if (pulseIntervalQ16 == 0) return 0.0f;
+  return (float)(60000000.0 * 65536.0 / ((double)pulseIntervalQ16 * MidiConfig::PPQN));
+}
+
+float ClockManager::getSyncDriftTicks() const {
+  return syncDriftQ16 / 65536.0f;
 }
 
 void ClockManager::onMidiStart() {
   sequencerRunning = true;
   pendingStart = false;
   externalClockPresent = true;
+  updateMasterOutput();
   lastMidiClockTime = micros();
-  currentTick = 0;
-  trackManager.updateAllTracks(currentTick);
+  processPendingTicks();
+  // Hold at tick 0 until the first pulse, which acquires sync
+  noInterrupts();
+  seatTick(0);
+  tickLimit = 0;
+  syncActive = true;
+  interrupts();
+  syncAcquired = false;
+  positionPending = false;
+  playTick(0, micros());
 }
 
 void ClockManager::onMidiStop() {
   sequencerRunning = false;
+  updateMasterOutput();
 }
 
-void ClockManager::handleMidiClock() {
-  if (!externalClockPresent) {
-    externalClockPresent = true;
-    logger.info("External MIDI clock detected");
+void ClockManager::onMidiContinue() {
+  sequencerRunning = true;
+  pendingStart = false;
+  externalClockPresent = true;
+  updateMasterOutput();
+  lastMidiClockTime = micros();
+  processPendingTicks();
+  // Hold at the current tick until the next pulse, which acquires sync from there
+  noInterrupts();
+  uint32_t tick = currentTick;
+  tickLimit = tick;
+  syncActive = true;
+  interrupts();
+  syncAcquired = false;
+  trackManager.resumeFromTransport(tick);
+  if (positionPending) playTick(tick, micros());
+  positionPending = false;
+}
+
+void ClockManager::onSongPosition(uint16_t sixteenths) {
+  locate((uint32_t)sixteenths * Config::TICKS_PER_16TH_STEP);
+}
+
+void ClockManager::locate(uint32_t tick) {
+  processPendingTicks();
+  noInterrupts();
+  seatTick(tick);
+  if (syncActive) tickLimit = tick;
+  interrupts();
+  syncAcquired = false;  // The next pulse aligns to the new position
+  if (masterOutput) {
+    // Receivers take a position only while stopped
+    midiHandler.sendStop();
+    sendMasterPosition(tick);
   }
-  
-  // Update internal clock based on MIDI clock
-  currentTick += Config::TICKS_PER_CLOCK;
+  trackManager.locateAll(tick);
+  // Running: play the new tick now; stopped: Continue plays it
+  positionPending = !sequencerRunning;
+  if (sequencerRunning) playTick(tick, micros());
+  logger.info("Locate to tick %lu", tick);
+}
+
+void ClockManager::seatTick(uint32_t tick) {
+  currentTick = tick;
+  clockPhase = (uint8_t)TimeSignature::CLOCK.mod(tick);
+  sixteenthPhase = (uint8_t)TimeSignature::SIXTEENTH.mod(tick);
 }
 
 // Returns true if either the internal or external clock is running
@@ -0,0 +1,123 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "ControllerThinner.h"
+#include "Globals.h"
+
+namespace {
+
+// Value carried by a message: 14-bit pitch bend (8192 = centre), 7-bit otherwise
+uint16_t valueOf(midi::MidiType type, uint8_t data1, uint8_t data2) {
+    switch (type) {
+        case midi::PitchBend:         return (uint16_t)(data1 | (data2 << 7));
+        case midi::AfterTouchChannel: return data1;
+        default:                      return data2;  // CC value, poly pressure
+    }
+}
+
+uint8_t laneNumber(midi::MidiType type, uint8_t data1) {
+    return (type == midi::ControlChange || type == midi::AfterTouchPoly) ? data1 : 0;
+}
+
+bool isEndPoint(midi::MidiType type, uint16_t value) {
+    if (type == midi::PitchBend) return value == 0 || value == 8192 || value == 16383;
+    return value == 0 || value == 127;
+}
+
+uint16_t deadbandOf(midi::MidiType type) {
+    return type == midi::PitchBend ? Config::PITCH_BEND_VALUE_DEADBAND : Config::CONTROLLER_VALUE_DEADBAND;
+}
+
+}  // namespace
+
+bool ControllerThinner::isThinned(midi::MidiType type, uint8_t data1) {
+    switch (type) {
+        case midi::PitchBend:
+        case midi::AfterTouchChannel:
+        case midi::AfterTouchPoly:
+            return true;
+        case midi::ControlChange:
+            // Bank select, sustain/portamento/sostenuto/soft/legato/hold 2, channel mode
+            return data1 != 0 && data1 != 32 && (data1 < 64 || data1 > 69) && data1 < 120;
+        default:
+            return false;
+    }
+}
+
+void ControllerThinner::flushLane(Lane& lane, RecordFn record) {
+    if (!lane.pending) return;
+    lane.pending = false;
+    pendingCount--;
+    lane.value = valueOf((midi::MidiType)lane.type, lane.pendingData1, lane.pendingData2);
+    lane.tick = lane.pendingTick;
+    record((midi::MidiType)lane.type, lane.channel, lane.pendingData1, lane.pendingData2, lane.pendingTick);
+}
+
+ControllerThinner::Lane& ControllerThinner::laneFor(midi::MidiType type, uint8_t channel, uint8_t number,
+                                                    uint32_t tick, RecordFn record) {
+    Lane* oldest = nullptr;
+    for (uint8_t i = 0; i < laneCount; ++i) {
+        Lane& lane = lanes[i];
+        if (lane.type == type && lane.channel == channel && lane.number == number) return lane;
+        if (!oldest || tick - lane.lastSeen > tick - oldest->lastSeen) oldest = &lane;
+    }
+    Lane* lane = laneCount < MAX_LANES ? &lanes[laneCount++] : oldest;
+    if (lane == oldest) flushLane(*lane, record);
+    lane->type = type;
+    lane->channel = channel;
+    lane->number = number;
+    lane->pending = false;
+    lane->tick = tick;
+    lane->lastSeen = tick;
+    lane->value = UINT16_MAX;  // No value yet: the first one always passes
+    return *lane;
+}
+
+bool ControllerThinner::accept(midi::MidiType type, uint8_t channel, uint8_t data1, uint8_t data2,
+                               uint32_t tick, RecordFn record) {
+    if (!isThinned(type, data1)) return true;
+    Lane& lane = laneFor(type, channel, laneNumber(type, data1), tick, record);
+    // A pending value followed by a pause ended a gesture of its own
+    if (lane.pending && tick - lane.lastSeen >= Config::CONTROLLER_MIN_INTERVAL_TICKS) flushLane(lane, record);
+    lane.lastSeen = tick;
+
+    uint16_t value = valueOf(type, data1, data2);
+    if (lane.value == UINT16_MAX) {
+        lane.value = value;
+        lane.tick = tick;
+        return true;
+    }
+    if (value == lane.value) {
+        // Back where it was: anything held in between is noise
+        if (lane.pending) {
+            lane.pending = false;
+            pendingCount--;
+        }
+        return false;
+    }
+    uint16_t moved = value > lane.value ? value - lane.value : lane.value - value;
+    if (isEndPoint(type, value) ||
+        (moved >= deadbandOf(type) && tick - lane.tick >= Config::CONTROLLER_MIN_INTERVAL_TICKS)) {
+        if (lane.pending) {
+            lane.pending = false;
+            pendingCount--;
+        }
+        lane.value = value;
+        lane.tick = tick;
+        return true;
+    }
+    if (!lane.pending) pendingCount++;
+    lane.pending = true;
+    lane.pendingData1 = data1;
+    lane.pendingData2 = data2;
+    lane.pendingTick = tick;
+    return false;
+}
+
+void ControllerThinner::flushIdle(uint32_t tick, RecordFn record) {
+    if (pendingCount == 0) return;
+    for (uint8_t i = 0; i < laneCount; ++i) {
+        Lane& lane = lanes[i];
+        if (lane.pending && tick - lane.lastSeen >= Config::CONTROLLER_MIN_INTERVAL_TICKS) flushLane(lane, record);
+    }
+}
@@ -10,13 +10,68 @@
 #include <Font5x7Fixed.h>
 #include <Font5x7FixedMono.h>
 #include "TrackUndo.h"
+#include "StorageManager.h"
+#include "MemoryMonitor.h"
 #include "Logger.h"
 #include <map>
 #include <string>
 #include "NoteUtils.h"
+#include "Profiler.h"
+#include "TimeSignature.h"
 
 DisplayManager displayManager;
 
+// Screen rectangles of the dirty regions (inclusive), indexed by DisplayManager::Region
+struct RegionRect { int x0, y0, x1, y1; };
+static const RegionRect regionRects[] = {
+    {0, 0, DisplayManager::TRACK_MARGIN - 1, DISPLAY_HEIGHT - 1},                  // Status column
+    {DisplayManager::TRACK_MARGIN, 0, DISPLAY_WIDTH - 1, 32},                      // Piano roll + playhead
+    {DisplayManager::TRACK_MARGIN, DISPLAY_HEIGHT - 21, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 11},  // Info line
+    {DisplayManager::TRACK_MARGIN, DISPLAY_HEIGHT - 10, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1},   // Note line
+};
+
+// FNV-1a over the inputs that decide a region's pixels
+struct RegionKey {
+    uint32_t hash = 2166136261u;
+    RegionKey& add(uint32_t v) {
+        for (int i = 0; i < 4; ++i) { hash ^= (v >> (8 * i)) & 0xFF; hash *= 16777619u; }
+        return *this;
+    }
+    RegionKey& add(const char* s) {
+        while (*s) { hash ^= (uint8_t)*s++; hash *= 16777619u; }
+        return add(0u);
+    }
+};
+
+// Piano-roll layer size: full-width rows in the frame buffer's 4bpp packing (2 pixels per byte)
+static constexpr int FRAME_ROW_BYTES = DISPLAY_WIDTH / 2;
+static_assert(DisplayManager::TRACK_MARGIN % 2 == 0, "Piano roll must start on a frame buffer byte boundary");
+static_assert(TrackSummary::COLUMNS == DISPLAY_WIDTH - DisplayManager::TRACK_MARGIN, "One summary column per overview pixel");
+
+static void pitchRange(const std::vector<DisplayNote>& notes, int& minPitch, int& maxPitch) {
+    minPitch = 127;
+    maxPitch = 0;
+    for (const auto& n : notes) {
+        if (n.note < minPitch) minPitch = n.note;
+        if (n.note > maxPitch) maxPitch = n.note;
+    }
+    if (minPitch > maxPitch) { minPitch = 60; maxPitch = 72; } // fallback
+}
+
+bool DisplayManager::beginRegion(Region region, uint32_t key) {
+    if (_regionValid[region] && _regionKey[region] == key) return false;
+    _regionKey[region] = key;
+    _regionValid[region] = true;
+    const RegionRect& r = regionRects[region];
+    _display.gfx.draw_rect_filled(_display.api.getFrameBuffer(), r.x0, r.y0, r.x1, r.y1, 0);
+    _frameDirty = true;
+    return true;
+}
+
+void DisplayManager::invalidateRegions() {
+    for (auto& valid : _regionValid) valid = false;
+}
+
 // Generic helper to draw a label:value field at (x, y) with optional highlight brightness
 void DisplayManager::drawInfoField(const char* label, const char* value, int x, int y, bool highlight, uint8_t defaultBrightness = 5) {
     
@@ -40,6 +95,7 @@ DisplayManager::DisplayManager() : _display() {
 void DisplayManager::clearDisplayBuffer() {
     Serial.println("DisplayManager: Clearing display buffer");
     _display.gfx.fill_buffer(_display.api.getFrameBuffer(), 0);
+    invalidateRegions();
     Serial.println("DisplayManager: Display buffer cleared");
     Serial.println("DisplayManager: Displaying buffer");   
    _display.api.display();
@@ -61,15 +117,12 @@ static char trackStateToLetter(TrackState state, bool muted) {
     }
 }
 
-// Helper: Convert ticks to Bars:Beats:16th:Ticks string, with option to limit ticks to 2 decimals
-static void ticksToBarsBeats16thTicks2Dec(uint32_t ticks, char* out, size_t outSize, bool leadingZeros = false) {
-    uint32_t bar = ticks / Config::TICKS_PER_BAR + 1;
-    uint32_t ticksInBar = ticks % Config::TICKS_PER_BAR;
-    uint32_t beat = ticksInBar / Config::TICKS_PER_QUARTER_NOTE + 1;
-    uint32_t ticksInBeat = ticksInBar % Config::TICKS_PER_QUARTER_NOTE;
-    uint32_t sixteenthTicks = Config::TICKS_PER_QUARTER_NOTE / 4;
-    uint32_t sixteenth = ticksInBeat / sixteenthTicks + 1;
-    uint32_t ticksIn16th = ticksInBeat % sixteenthTicks;
+// Helper: Convert a position to a Bars:Beats:16th:Ticks string, with option to limit ticks to 2 decimals
+static void ticksToBarsBeats16thTicks2Dec(const TimeSignature::Position& pos, char* out, size_t outSize, bool leadingZeros = false) {
+    uint32_t bar = pos.bar;
+    uint32_t beat = pos.beat;
+    uint32_t sixteenth = pos.sixteenth;
+    uint32_t ticksIn16th = pos.tick;
     // Limit ticks to 2 decimals (max 99)
     uint32_t ticks2dec = (ticksIn16th > 99) ? 99 : ticksIn16th;
     if (leadingZeros) {
@@ -90,24 +143,34 @@ void DisplayManager::drawTrackStatus(uint8_t selectedTrack, uint32_t currentMill
     _display.gfx.select_font(&Font5x7FixedMono);
     constexpr int x = 0; // left margin
     constexpr int char_height = 7; // Font5x7FixedMono is 7px high
-    constexpr int trackCount = 8;
-    constexpr int step = (DISPLAY_HEIGHT - char_height) / (trackCount - 1);
-
-
-    for (uint8_t i = 0; i < trackCount; ++i) {
-        char label[2] = {0};
-        label[0] = trackStateToLetter(trackManager.getTrackState(i), !trackManager.isTrackAudible(i));
-        int y = i * step + char_height;
-        uint8_t brightness = 15;
-        if (i == selectedTrack) {
-            float phase = _pulsePhase;
-            brightness = minPulse + (maxPulse - minPulse) * (0.5f + 0.5f * sinf(phase * 2 * 3.1415926f));
-        } else {
-            brightness = 8;
-        }
+    // Up to 8 rows fit; with more tracks the column shows the page of 8 holding the selected one
+    constexpr int rows = Config::NUM_TRACKS < 8 ? Config::NUM_TRACKS : 8;
+    constexpr int step = rows > 1 ? (DISPLAY_HEIGHT - char_height) / (rows - 1) : 0;
+    const uint8_t first = (selectedTrack / rows) * rows;
+
+    // The pulse only changes the picture when it crosses a brightness step
+    uint8_t pulseBrightness = minPulse + (maxPulse - minPulse) * (0.5f + 0.5f * sinf(_pulsePhase * 2 * 3.1415926f));
+    char letters[rows];
+    RegionKey key;
+    key.add(selectedTrack).add(pulseBrightness);
+    for (uint8_t r = 0; r < rows; ++r) {
+        uint8_t i = first + r;
+        if (i >= Config::NUM_TRACKS) letters[r] = ' ';
+        else if (!StorageManager::isTrackRestored(i)) letters[r] = '.';  // Still loading from SD
+        else letters[r] = trackStateToLetter(trackManager.getTrackState(i), !trackManager.isTrackAudible(i));
+        key.add((uint32_t)letters[r]);
+    }
+    if (!beginRegion(REGION_STATUS, key.hash)) return;
+
+    for (uint8_t r = 0; r < rows; ++r) {
+        uint8_t i = first + r;
+        if (i >= Config::NUM_TRACKS) break;
+        char label[2] = {letters[r], 0};
+        int y = r * step + char_height;
+        uint8_t brightness = (i == selectedTrack) ? pulseBrightness : 8;
         _display.gfx.draw_text(_display.api.getFrameBuffer(), label, x, y, brightness);
         // Draw track number next to state letter at 25% brightness
-        char numStr[3];
+        char numStr[4];
         snprintf(numStr, sizeof(numStr), "%d", i + 1);
         uint8_t numBrightness = (i == selectedTrack) ? 15 : 4; // 100% if selected, else 25%
         _display.gfx.draw_text(_display.api.getFrameBuffer(), numStr, x + 10, y, numBrightness);
@@ -136,7 +199,7 @@ void DisplayManager::setup() {
     Serial.println("Text drawn.");
     _display.api.display();
     Serial.println("DisplayManager: Text sent to display");
-    delay(1000);
+    // The splash stays on screen until the first frame is drawn over it
     clearDisplayBuffer();
 }
 
@@ -158,66 +221,62 @@ void DisplayManager::drawGridLines(uint32_t lengthLoop, int pianoRollY0, int pia
     const int barBrightness = 3;      // 50%
     const int beatBrightness = 2;     // 25%
     const int sixteenthBrightness = 1;// 10%
-    const uint32_t ticksPerBar = Config::TICKS_PER_BAR;
-    const uint32_t ticksPerBeat = Config::TICKS_PER_QUARTER_NOTE;
-    const uint32_t ticksPerSixteenth = Config::TICKS_PER_QUARTER_NOTE / 4;
+    const uint32_t ticksPerBar = timeSignature.ticksPerBar();
+    const uint32_t ticksPerBeat = timeSignature.ticksPerBeat();
+    const uint32_t ticksPerSixteenth = Config::TICKS_PER_16TH_STEP;
+    const uint8_t beatsPerBar = timeSignature.getMeter().numerator;
+    const uint32_t sixteenthsPerBeat = TimeSignature::SIXTEENTH.div(ticksPerBeat);
+    if (lengthLoop == 0) return;
+    // Tick to x by one multiply per line instead of map()'s divide: the Q32 scale rounded up
+    const uint64_t xScale = (((uint64_t)(DISPLAY_WIDTH - 1 - TRACK_MARGIN) << 32) + lengthLoop - 1) / lengthLoop;
+    auto xAt = [&](uint32_t t) { return TRACK_MARGIN + (int)((t * xScale) >> 32); };
     // Bar lines
     for (uint32_t t = 0; t < lengthLoop; t += ticksPerBar) {
-        int x = TRACK_MARGIN + map(t, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
-        _display.gfx.draw_vline(_display.api.getFrameBuffer(), x, pianoRollY0, pianoRollY1, barBrightness);
+        _display.gfx.draw_vline(drawTarget(), xAt(t), pianoRollY0, pianoRollY1, barBrightness);
     }
-    // Beat lines
+    // Beat lines; the counter skips the bar lines in any meter
     bool showBeat = (lengthLoop <= 9 * ticksPerBar);
     if (showBeat) {
+        uint8_t beat = 0;
         for (uint32_t t = ticksPerBeat; t < lengthLoop; t += ticksPerBeat) {
-            if (t % ticksPerBar == 0) continue;
-            int x = TRACK_MARGIN + map(t, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
+            if (++beat == beatsPerBar) beat = 0;
+            if (beat == 0) continue;
+            int x = xAt(t);
             for (int y = pianoRollY0; y <= pianoRollY1; y += 2) {
-                _display.gfx.draw_pixel(_display.api.getFrameBuffer(), x, y, beatBrightness);
+                _display.gfx.draw_pixel(drawTarget(), x, y, beatBrightness);
             }
         }
     }
-    // Sixteenth lines
-    bool showSixteenth = (lengthLoop <= 5 * ticksPerBar);
+    // Sixteenth lines (none when the beat is a 16th)
+    bool showSixteenth = (lengthLoop <= 5 * ticksPerBar) && sixteenthsPerBeat > 1;
     if (showSixteenth) {
+        uint32_t sixteenth = 0;
         for (uint32_t t = ticksPerSixteenth; t < lengthLoop; t += ticksPerSixteenth) {
-            if (t % ticksPerBar == 0 || t % ticksPerBeat == 0) continue;
-            int x = TRACK_MARGIN + map(t, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
+            if (++sixteenth == sixteenthsPerBeat) sixteenth = 0;
+            if (sixteenth == 0) continue;
+            int x = xAt(t);
             for (int y = pianoRollY0; y <= pianoRollY1; y += 4) {
-                _display.gfx.draw_pixel(_display.api.getFrameBuffer(), x, y, sixteenthBrightness);
+                _display.gfx.draw_pixel(drawTarget(), x, y, sixteenthBrightness);
             }
         }
     }
 }
 
-// --- Helper: Draw all notes ---
-void DisplayManager::drawAllNotes(const std::vector<MidiEvent>& midiEvents, uint32_t startLoop, uint32_t lengthLoop, int minPitch, int maxPitch) {
-    auto notes = NoteUtils::reconstructNotes(midiEvents, lengthLoop);
-
-    // Highlight if in note, start-note, or pitch-note edit state
-    int highlight = (editManager.getCurrentState() == editManager.getNoteState() ||
-                     editManager.getCurrentState() == editManager.getStartNoteState() ||
-                     editManager.getCurrentState() == editManager.getPitchNoteState());
-    int selectedNoteIdx = highlight ? editManager.getSelectedNoteIdx() : -1;
-
-    for (int noteIdx = 0; noteIdx < (int)notes.size(); ++noteIdx) {
-        const auto& e = notes[noteIdx];
-        
-        uint32_t s = e.startTick;
-        uint32_t eTick = e.endTick;
-        
+// --- Helper: Draw all notes (the selected note is highlighted separately by drawPianoRoll) ---
+void DisplayManager::drawAllNotes(const std::vector<DisplayNote>& notes, uint32_t startLoop, uint32_t lengthLoop, int minPitch, int maxPitch) {
+    for (const auto& e : notes) {
         // Don't apply any modulo operations - preserve the original tick values
         // The drawNoteBar function will handle wrapped notes correctly
-        
-        int y = map(e.note, minPitch, maxPitch == minPitch ? minPitch + 1 : maxPitch, 31, 0);
-        // Use a different brightness for the selected note
-        int noteBrightness = (highlight && noteIdx == selectedNoteIdx) ? 15 : 8; // 15=max, 8=normal
-        drawNoteBar(e, y, s, eTick, lengthLoop, noteBrightness);
+        drawNoteBar(e, noteToPianoRollY(e.note, minPitch, maxPitch), e.startTick, e.endTick, lengthLoop, 8); // 8=normal
     }
 }
 
+int DisplayManager::noteToPianoRollY(uint8_t note, int minPitch, int maxPitch) const {
+    return map(note, minPitch, maxPitch == minPitch ? minPitch + 1 : maxPitch, 31, 0);
+}
+
 // --- Helper: Draw bracket ---
-void DisplayManager::drawBracket(unsigned long a, unsigned long b, int c) {
+void DisplayManager::drawBracket(uint32_t a, uint32_t b, int c) {
     // Draw bracket in note, start-note, or pitch-note edit states
     if (editManager.getCurrentState() == editManager.getNoteState() ||
         editManager.getCurrentState() == editManager.getStartNoteState() ||
@@ -247,7 +306,7 @@ void DisplayManager::drawNoteBar(const DisplayNote& e, int y, uint32_t s, uint32
         int x0 = TRACK_MARGIN + map(s, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
         int x1 = TRACK_MARGIN + map(eTick, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
         if (x1 < x0) x1 = x0;
-        _display.gfx.draw_rect_filled(_display.api.getFrameBuffer(), x0, y, x1, y, noteBrightness);
+        _display.gfx.draw_rect_filled(drawTarget(), x0, y, x1, y, noteBrightness);
     } else {
         // Wrapped note: draw two segments
         uint32_t wrappedEndTick = eTick % lengthLoop;
@@ -260,50 +319,158 @@ void DisplayManager::drawNoteBar(const DisplayNote& e, int y, uint32_t s, uint32
          
         // Draw from start to end of loop (segment 1)
         if (s % lengthLoop < lengthLoop) {
-            _display.gfx.draw_rect_filled(_display.api.getFrameBuffer(), x0, y, xEnd, y, noteBrightness);
+            _display.gfx.draw_rect_filled(drawTarget(), x0, y, xEnd, y, noteBrightness);
         }
         
         // Draw from 0 to wrapped endTick (segment 2)
         if (wrappedEndTick > 0) {
-            _display.gfx.draw_rect_filled(_display.api.getFrameBuffer(), x1, y, x2, y, noteBrightness);
+            _display.gfx.draw_rect_filled(drawTarget(), x1, y, x2, y, noteBrightness);
         }
     }
 }
 
-// --- Draw piano roll using midiEvents ---
+// --- Draw piano roll from the track's cached notes ---
 void DisplayManager::drawPianoRoll(uint32_t currentTick, Track& selectedTrack) {
     auto& track = selectedTrack;
     uint32_t startLoop = 0; // Always start at bar 1 visually
     uint32_t lengthLoop = track.getLoopLength();
-    const auto& midiEvents = track.getMidiEvents();
 
     //setLastPlayedNote(nullptr); // Reset at the start
     const int pianoRollY0 = 0;
     const int pianoRollY1 = 31;
+    uint32_t loopPos = 0;
+    int cx = -1;
     if (lengthLoop > 0) {
-        uint32_t loopPos = (currentTick >= startLoop)
+        loopPos = (currentTick >= startLoop)
             ? ((currentTick - startLoop) % lengthLoop)
             : 0;
+        cx = TRACK_MARGIN + map(loopPos, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
+    }
 
-        // Compute min/max pitch for scaling
-        int minPitch = 127;
-        int maxPitch = 0;
-        auto notes = NoteUtils::reconstructNotes(midiEvents, lengthLoop);
-        for (const auto& n : notes) {
-            if (n.note < minPitch) minPitch = n.note;
-            if (n.note > maxPitch) maxPitch = n.note;
+    // Notes change with the events generation; otherwise only the playhead column and edit cursor move
+    RegionKey key;
+    Timing::Meter meter = timeSignature.getMeter();
+    key.add((uint32_t)(uintptr_t)&track).add(track.getEventsGeneration()).add(lengthLoop)
+       .add((uint32_t)((meter.numerator << 8) | meter.denominator))
+       .add((uint32_t)(uintptr_t)editManager.getCurrentState())
+       .add((uint32_t)editManager.getSelectedNoteIdx()).add(editManager.getBracketTick())
+       .add((uint32_t)cx);
+    if (!beginRegion(REGION_PIANO_ROLL, key.hash)) return;
+
+    if (lengthLoop > 0) {
+        const auto& notes = track.getDisplayNotes();
+        int minPitch, maxPitch;
+        if (PianoRollLayer* layer = getPianoRollLayer(trackManager.getSelectedTrackIndex(), track)) {
+            // Static grid and notes: copy the piano-roll part of each layer row
+            uint8_t* fb = _display.api.getFrameBuffer();
+            constexpr int skip = TRACK_MARGIN / 2;
+            for (int y = 0; y < PIANO_ROLL_ROWS; ++y) {
+                memcpy(fb + y * FRAME_ROW_BYTES + skip, layer->pixels + y * FRAME_ROW_BYTES + skip, FRAME_ROW_BYTES - skip);
+            }
+            minPitch = layer->minPitch;
+            maxPitch = layer->maxPitch;
+        } else {
+            // No memory for a layer: draw straight into the frame
+            pitchRange(notes, minPitch, maxPitch);
+            drawGridLines(lengthLoop, pianoRollY0, pianoRollY1);
+            drawAllNotes(notes, startLoop, lengthLoop, minPitch, maxPitch);
         }
-        if (minPitch > maxPitch) { minPitch = 60; maxPitch = 72; } // fallback
 
-        drawGridLines(lengthLoop, pianoRollY0, pianoRollY1);
-        drawAllNotes(midiEvents, startLoop, lengthLoop, minPitch, maxPitch); // includes selected note
+        // Highlight the selected note in note, start-note, or pitch-note edit state
+        EditState* state = editManager.getCurrentState();
+        bool highlight = (state == editManager.getNoteState() ||
+                          state == editManager.getStartNoteState() ||
+                          state == editManager.getPitchNoteState());
+        int selectedNoteIdx = editManager.getSelectedNoteIdx();
+        if (highlight && selectedNoteIdx >= 0 && selectedNoteIdx < (int)notes.size()) {
+            const auto& e = notes[selectedNoteIdx];
+            drawNoteBar(e, noteToPianoRollY(e.note, minPitch, maxPitch), e.startTick, e.endTick, lengthLoop, 15); // 15=max
+        }
         drawBracket(editManager.getBracketTick(), lengthLoop, pianoRollY1);
-      
-        int cx = TRACK_MARGIN + map(loopPos, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
+
         _display.gfx.draw_vline(_display.api.getFrameBuffer(), cx, 0, 32, 3);
     }
 }
 
+void DisplayManager::setOverview(bool enable) {
+    _overview = enable;
+    _regionValid[REGION_PIANO_ROLL] = false;
+}
+
+// --- Draw every track as an activity strip from its summary (cost independent of event count) ---
+void DisplayManager::drawOverview(uint32_t currentTick, uint8_t selectedTrack) {
+    // Strips share the piano roll's rows; with more tracks than fit, the page holding the selected one
+    constexpr int stripRows = PIANO_ROLL_ROWS / Config::NUM_TRACKS > 0 ? PIANO_ROLL_ROWS / Config::NUM_TRACKS : 1;
+    constexpr int strips = PIANO_ROLL_ROWS / stripRows < Config::NUM_TRACKS ? PIANO_ROLL_ROWS / stripRows : Config::NUM_TRACKS;
+    const uint8_t first = (selectedTrack / strips) * strips;
+
+    const TrackSummary* summaries[strips] = {};
+    int cursors[strips];
+    bool audible[strips];
+    RegionKey key;
+    key.add(0x0F0Fu).add(selectedTrack);  // Never matches a piano-roll key
+    for (int s = 0; s < strips; ++s) {
+        uint8_t i = first + s;
+        cursors[s] = -1;
+        audible[s] = false;
+        if (i >= Config::NUM_TRACKS) continue;
+        Track& track = trackManager.getTrack(i);
+        uint32_t lengthLoop = track.getLoopLength();
+        if (lengthLoop == 0) continue;
+        summaries[s] = &track.getSummary();
+        audible[s] = trackManager.isTrackAudible(i);
+        cursors[s] = TRACK_MARGIN + map(currentTick % lengthLoop, 0, lengthLoop, 0, DISPLAY_WIDTH - 1 - TRACK_MARGIN);
+        key.add(summaries[s]->getVersion()).add(lengthLoop).add((uint32_t)cursors[s]).add(audible[s]);
+    }
+    if (!beginRegion(REGION_PIANO_ROLL, key.hash)) return;
+
+    uint8_t* fb = _display.api.getFrameBuffer();
+    for (int s = 0; s < strips; ++s) {
+        if (!summaries[s]) continue;
+        const int y0 = s * stripRows;
+        const int y1 = y0 + stripRows - 1;
+        for (uint16_t c = 0; c < TrackSummary::COLUMNS; ++c) {
+            uint8_t notes = summaries[s]->notes(c);
+            if (!notes && !summaries[s]->others(c)) continue;
+            int brightness = notes ? (notes >= 5 ? 15 : 5 + 2 * notes) : 2;
+            if (!audible[s]) brightness = (brightness + 1) / 3;  // Muted strips stay readable but dim
+            _display.gfx.draw_vline(fb, TRACK_MARGIN + c, y0, y1, brightness);
+        }
+        _display.gfx.draw_vline(fb, cursors[s], y0, y1, first + s == selectedTrack ? 15 : 3);
+    }
+}
+
+DisplayManager::PianoRollLayer* DisplayManager::getPianoRollLayer(uint8_t trackIdx, Track& track) {
+    if (trackIdx >= Config::NUM_TRACKS) return nullptr;
+    PianoRollLayer& layer = _layers[trackIdx];
+    if (!layer.pixels) {
+        layer.pixels = static_cast<uint8_t*>(malloc(FRAME_ROW_BYTES * PIANO_ROLL_ROWS));
+        if (!layer.pixels) return nullptr;
+        layer.generation = 0;
+    }
+    uint32_t lengthLoop = track.getLoopLength();
+    if (layer.generation == track.getEventsGeneration() && layer.loopLength == lengthLoop &&
+        layer.meter == timeSignature.getMeter()) {
+        return &layer;
+    }
+
+    // Rebuild: point the library's drawing routines at the layer while rasterizing
+    const auto& notes = track.getDisplayNotes();
+    pitchRange(notes, layer.minPitch, layer.maxPitch);
+    _display.gfx.set_buffer_size(DISPLAY_WIDTH, PIANO_ROLL_ROWS);
+    _drawTarget = layer.pixels;
+    _display.gfx.fill_buffer(layer.pixels, 0);
+    drawGridLines(lengthLoop, 0, PIANO_ROLL_ROWS - 1);
+    drawAllNotes(notes, 0, lengthLoop, layer.minPitch, layer.maxPitch);
+    _drawTarget = nullptr;
+    _display.gfx.set_buffer_size(DISPLAY_WIDTH, DISPLAY_HEIGHT);
+
+    layer.generation = track.getEventsGeneration();
+    layer.loopLength = lengthLoop;
+    layer.meter = timeSignature.getMeter();
+    return &layer;
+}
+
 // Draw info area
 void DisplayManager::drawInfoArea(uint32_t currentTick, Track& selectedTrack) {
     // 1. Current position (playhead) as musical time, with leading zeros and 2 decimals for ticks
@@ -312,13 +479,32 @@ void DisplayManager::drawInfoArea(uint32_t currentTick, Track& selectedTrack) {
     // Get length of loop
     uint32_t lengthLoop = selectedTrack.getLoopLength();
     
-    ticksToBarsBeats16thTicks2Dec(currentTick, posStr, sizeof(posStr), true); // true = leading zeros
-    if (lengthLoop > 0 && Config::TICKS_PER_BAR > 0) {
-        uint32_t bars = lengthLoop / Config::TICKS_PER_BAR;
+    ticksToBarsBeats16thTicks2Dec(timeSignature.position(currentTick), posStr, sizeof(posStr), true); // true = leading zeros
+    if (lengthLoop > 0) {
+        uint32_t bars = timeSignature.barsIn(lengthLoop);
         snprintf(loopLine, sizeof(loopLine), "%lu", bars);
     } else {
         snprintf(loopLine, sizeof(loopLine), "-");
     }
+    uint8_t undoCount = static_cast<uint8_t>(editManager.getDisplayUndoCount(selectedTrack));
+    char undoStr[4];
+    if (undoCount == 0) {
+        snprintf(undoStr, sizeof(undoStr), "--");
+    } else {
+        if (undoCount > 99) undoCount = 99;
+        snprintf(undoStr, sizeof(undoStr), "%02u", undoCount);
+    }
+
+    // Selected track's arena fill, highlighted near the memory limits
+    char memStr[4];
+    uint8_t memPercent = MemoryMonitor::arenaPercent(selectedTrack);
+    snprintf(memStr, sizeof(memStr), "%02u", memPercent > 99 ? 99 : memPercent);
+    bool memLow = MemoryMonitor::nearLimit(selectedTrack);
+
+    RegionKey key;
+    key.add(posStr).add(loopLine).add(undoStr).add(memStr).add(memLow);
+    if (!beginRegion(REGION_INFO, key.hash)) return;
+
     // Draw position string
     int x = DisplayManager::TRACK_MARGIN;
     int y = DISPLAY_HEIGHT - 12;
@@ -337,24 +523,17 @@ void DisplayManager::drawInfoArea(uint32_t currentTick, Track& selectedTrack) {
     int loopX = x + 12 * 6; // after posStr (11 chars + 1 space)
     drawInfoField("LOOP", loopLine, loopX, y, false, 5);
     // Draw undo count right-aligned, max 99
-    uint8_t undoCount = static_cast<uint8_t>(editManager.getDisplayUndoCount(selectedTrack));
-    char undoStr[4];
-    if (undoCount == 0) {
-        snprintf(undoStr, sizeof(undoStr), "--");
-    } else {
-        if (undoCount > 99) undoCount = 99;
-        snprintf(undoStr, sizeof(undoStr), "%02u", undoCount);
-    }
     int undoX = DISPLAY_WIDTH - 4 * 6; // right-aligned, enough space for "U:99"
     drawInfoField("U", undoStr, undoX, y, false, 5);
+    // Memory field left of it ("M:99")
+    drawInfoField("M", memStr, undoX - 5 * 6, y, memLow, 5);
 }
 
-// --- Draw note info using midiEvents ---
+// --- Draw note info from the track's cached notes ---
 void DisplayManager::drawNoteInfo(uint32_t currentTick, Track& selectedTrack) {
     char startStr[24] = {0};
-    const auto& midiEvents = selectedTrack.getMidiEvents();
     uint32_t lengthLoop = selectedTrack.getLoopLength();
-    auto notes = NoteUtils::reconstructNotes(midiEvents, lengthLoop);
+    const auto& notes = selectedTrack.getDisplayNotes();
 
     const DisplayNote* noteToShow = nullptr;
     uint32_t displayStartTick = 0;
@@ -406,7 +585,7 @@ void DisplayManager::drawNoteInfo(uint32_t currentTick, Track& selectedTrack) {
     char velStr[4] = "---";
     bool validNote = false;
     if (noteToShow) {
-        ticksToBarsBeats16thTicks2Dec(displayStartTick % lengthLoop, startStr, sizeof(startStr), true);
+        ticksToBarsBeats16thTicks2Dec(timeSignature.loopPosition(displayStartTick % lengthLoop), startStr, sizeof(startStr), true);
         uint8_t noteVal = noteToShow->note;
         // Calculate note length, handling wrap-around case
         uint32_t lenVal;
@@ -424,10 +603,16 @@ void DisplayManager::drawNoteInfo(uint32_t currentTick, Track& selectedTrack) {
             snprintf(velStr, sizeof(velStr), "%3u", velVal);
         }
     }
+    bool isStartNote = (editManager.getCurrentState() == editManager.getStartNoteState());
+    bool inPitchEdit = (editManager.getCurrentState() == editManager.getPitchNoteState());
+
+    RegionKey key;
+    key.add(startStr).add(noteStr).add(lenStr).add(velStr).add(isStartNote).add(inPitchEdit);
+    if (!beginRegion(REGION_NOTE, key.hash)) return;
+
     int x = DisplayManager::TRACK_MARGIN;
     int y = DISPLAY_HEIGHT;
     // Draw the time string (ticksToBarsBeats16thTicks2Dec)
-    bool isStartNote = (editManager.getCurrentState() == editManager.getStartNoteState());
     _display.gfx.select_font(&Font5x7FixedMono);
     int timeStrLen = strlen(startStr);
     for (int i = 0; i < timeStrLen; ++i) {
@@ -437,7 +622,6 @@ void DisplayManager::drawNoteInfo(uint32_t currentTick, Track& selectedTrack) {
     }
     // Draw NOTE, LEN, VEL fields using drawInfoField
     int infoX = x + timeStrLen * 6 + 6; // after time string
-    bool inPitchEdit = (editManager.getCurrentState() == editManager.getPitchNoteState());
     struct InfoField { const char* label; const char* value; bool highlight; };
     InfoField fields[] = {
         {"NOTE", noteStr, inPitchEdit},
@@ -451,25 +635,43 @@ void DisplayManager::drawNoteInfo(uint32_t currentTick, Track& selectedTrack) {
 }
 
 void DisplayManager::update() {
-    // Get current global tick count for display timing
-    uint32_t currentTick = clockManager.getCurrentTick();
-    uint32_t now = millis();
-
-    // Clear frame buffer
-    _display.gfx.fill_buffer(_display.api.getFrameBuffer(), 0);
-
-    // Draw vertical track status on the left
-    drawTrackStatus(trackManager.getSelectedTrackIndex(), now);
-    
-    // Draw piano roll
-    drawPianoRoll(currentTick, trackManager.getSelectedTrack());
-
-    // Draw info area
-    drawInfoArea(currentTick, trackManager.getSelectedTrack());
-
-    // Draw note info
-    drawNoteInfo(currentTick, trackManager.getSelectedTrack());
+    while (!updateSlice(UINT32_MAX)) {}
+}
 
-    // Send buffer to display
-   _display.api.display();
+// One region per step, in screen order, then the transfer. The tick and selection are taken
+// when the frame starts so every region of a frame shows the same moment.
+bool DisplayManager::updateSlice(uint32_t budgetMicros) {
+    PROFILE_SCOPE(PROBE_DISPLAY_UPDATE);
+    uint32_t sliceStart = micros();
+    if (_frameStage == FRAME_IDLE) {
+        _frameTick = clockManager.getCurrentTick();
+        _frameMillis = millis();
+        _frameTrack = trackManager.getSelectedTrackIndex();
+        // Each region clears and redraws itself only when its inputs changed
+        _frameDirty = false;
+        _frameStage = FRAME_STATUS;
+    }
+    Track& selectedTrack = trackManager.getTrack(_frameTrack);
+    do {
+        switch (_frameStage) {
+            case FRAME_STATUS:     drawTrackStatus(_frameTrack, _frameMillis); break;
+            case FRAME_PIANO_ROLL:
+                if (_overview) drawOverview(_frameTick, _frameTrack);
+                else drawPianoRoll(_frameTick, selectedTrack);
+                break;
+            case FRAME_INFO:       drawInfoArea(_frameTick, selectedTrack); break;
+            case FRAME_NOTE:       drawNoteInfo(_frameTick, selectedTrack); break;
+            case FRAME_SEND:
+                // Send buffer to display only if something changed
+                if (_frameDirty) _display.api.display();
+                break;
+            default: break;
+        }
+        _frameStage = (FrameStage)(_frameStage + 1);
+        if (_frameStage == FRAME_DONE) {
+            _frameStage = FRAME_IDLE;
+            return true;
+        }
+    } while (micros() - sliceStart < budgetMicros);
+    return false;
 }
@@ -15,6 +15,8 @@
 #include "TrackUndo.h"
 #include "Logger.h"
 #include "NoteUtils.h"
+#include "StorageManager.h"
+#include "Profiler.h"
 
 using DisplayNote = NoteUtils::DisplayNote;
 
@@ -30,17 +32,21 @@ void EditManager::setState(EditState* newState, Track& track, uint32_t startTick
         // Handle hash-based commit-on-exit for start-note edits
         if (currentState == &startNoteState) {
             auto* s = static_cast<EditStartNoteState*>(currentState);
-            if (TrackUndo::computeMidiHash(track) == s->getInitialHash()) {
+            if (track.getContentHash() == s->getInitialHash()) {
                 TrackUndo::popLastUndo(track);
                 logger.debug("No net change in start-note edit, popped undo snapshot");
+            } else {
+                StorageManager::journalTrackEvents(track);
             }
         }
         // Handle hash-based commit-on-exit for pitch-note edits
         else if (currentState == &pitchNoteState) {
             auto* p = static_cast<EditPitchNoteState*>(currentState);
-            if (TrackUndo::computeMidiHash(track) == p->getInitialHash()) {
+            if (track.getContentHash() == p->getInitialHash()) {
                 TrackUndo::popLastUndo(track);
                 logger.debug("No net change in pitch edit, popped undo snapshot");
+            } else {
+                StorageManager::journalTrackEvents(track);
             }
         }
         currentState->onExit(*this, track);
@@ -54,7 +60,11 @@ void EditManager::setState(EditState* newState, Track& track, uint32_t startTick
 }
 
 void EditManager::onEncoderTurn(Track& track, int delta) {
-    if (currentState) {
+    PROFILE_SCOPE(PROBE_EDIT_ENCODER);
+    if (currentState == &startNoteState) {
+        // Applied as one move, however many detents a fast spin produced
+        currentState->onEncoderTurn(*this, track, delta);
+    } else if (currentState) {
         int step = (delta > 0) ? 1 : -1;
         for (int i = 0; i < abs(delta); ++i) {
             currentState->onEncoderTurn(*this, track, step);
@@ -63,13 +73,12 @@ void EditManager::onEncoderTurn(Track& track, int delta) {
 }
 
 void EditManager::onButtonPress(Track& track) {
+    PROFILE_SCOPE(PROBE_EDIT_BUTTON);
     if (currentState) currentState->onButtonPress(*this, track);
 }
 
 void EditManager::selectClosestNote(Track& track, uint32_t startTick) {
-    const auto& midiEvents = track.getMidiEvents();
-    // Reconstruct note list using shared helper
-    auto notes = NoteUtils::reconstructNotes(midiEvents, track.getLoopLength());
+    const auto& notes = track.getDisplayNotes();
     
     // If no notes, just place bracket at exact tick
     if (notes.empty()) {
@@ -143,11 +152,9 @@ void EditManager::exitEditMode(Track& track) {
 }
 
 void EditManager::moveBracket(int delta, const Track& track, uint32_t ticksPerStep) {
-    const auto& midiEvents = track.getMidiEvents();
     uint32_t loopLength = track.getLoopLength();
     if (loopLength == 0) return;
-    // Reconstruct note list using shared helper
-    auto notes = NoteUtils::reconstructNotes(midiEvents, loopLength);
+    const auto& notes = track.getDisplayNotes();
     
     const uint32_t SNAP_WINDOW = 24;
     if (delta > 0) {
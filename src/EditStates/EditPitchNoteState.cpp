@@ -17,7 +17,7 @@ using DisplayNote = NoteUtils::DisplayNote;
 void EditPitchNoteState::onEnter(EditManager& manager, Track& track, uint32_t startTick) {
     logger.debug("Entered EditPitchNoteState");
     // Commit-on-enter: snapshot and hash initial MIDI events
-    initialHash = TrackUndo::computeMidiHash(track);
+    initialHash = track.getContentHash();
     TrackUndo::pushUndoSnapshot(track);
     logger.debug("Snapshot on enter (pitch), initial hash: %u", initialHash);
 }
@@ -29,14 +29,12 @@ void EditPitchNoteState::onExit(EditManager& manager, Track& track) {
 void EditPitchNoteState::onEncoderTurn(EditManager& manager, Track& track, int delta) {
     int noteIdx = manager.getSelectedNoteIdx();
     if (noteIdx < 0) return;
-    auto& midiEvents = track.getMidiEvents();
-    uint32_t loopLength = track.getLoopLength();
-    // Reconstruct notes using shared utility
-    auto notes = NoteUtils::reconstructNotes(midiEvents, loopLength);
+    auto& midiEvents = track.editMidiEvents();
+    const auto& notes = track.getDisplayNotes();
     
     if (noteIdx >= (int)notes.size()) return;
     // Find the corresponding MidiEvent indices for this note
-    const auto& dn = notes[noteIdx];
+    const DisplayNote dn = notes[noteIdx];  // Copy: the cache is rebuilt after the edit
     // Find the NoteOn and NoteOff events in midiEvents using non-const iterators
     auto onIt = std::find_if(midiEvents.begin(), midiEvents.end(), [&](MidiEvent& evt) {
         return evt.type == midi::NoteOn && evt.data.noteData.note == dn.note && evt.tick == dn.startTick;
@@ -47,10 +45,15 @@ void EditPitchNoteState::onEncoderTurn(EditManager& manager, Track& track, int d
     if (onIt == midiEvents.end() || offIt == midiEvents.end()) return;
     // Change pitch, wrap 0-127
     int newPitch = ((int)dn.note + delta + 128) % 128;
-    onIt->data.noteData.note = newPitch;
-    offIt->data.noteData.note = newPitch;
+    MidiEvent on = *onIt, off = *offIt;
+    on.data.noteData.note = newPitch;
+    off.data.noteData.note = newPitch;
+    EventEdit edit(track);
+    edit.replace(onIt - midiEvents.begin(), on);
+    edit.replace(offIt - midiEvents.begin(), off);
+    if (!track.commitEdit(edit)) return;
     // Update selection in manager
-    manager.selectClosestNote(track, onIt->tick);
+    manager.selectClosestNote(track, on.tick);
 }
 
 void EditPitchNoteState::onButtonPress(EditManager& manager, Track& track) {
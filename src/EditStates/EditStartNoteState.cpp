@@ -13,7 +13,6 @@
 #include "Globals.h"
 #include "TrackUndo.h"
 #include "NoteUtils.h"
-#include <unordered_map>
 
 using DisplayNote = NoteUtils::DisplayNote;
 
@@ -28,70 +27,38 @@ using DisplayNote = NoteUtils::DisplayNote;
  * Flow of onEncoderTurn():
  *   1. Read current moving-note identity (pitch, lastStart, lastEnd).
  *   2. Compute newStart = lastStart + δ (wrapping at loopLength), then compute raw newEnd = newStart + noteLen (no chopping at loop boundary); store raw newEnd in MIDI and defer wrapping to display/playback.
- *   3. Reconstruct all DisplayNotes from MIDI events into currentNotes.
+ *      A fast spin arrives as one δ of many steps and is applied as one move.
+ *   3. Bring the per-pitch note lanes up to date (rebuilt only when other code changed the events).
  *   4. From manager.movingNote.deletedNotes decide which notes to restore (no longer overlapping).
- *   5. Scan currentNotes for ones that overlap the moved note; for right-to-left motion try to shorten them, otherwise queue them for deletion.
- *   6. Move your NoteOn/NoteOff events to newStart/newEnd.
- *   7. Apply shortening, then deletion, and record all DeletedNote entries into manager.movingNote.deletedNotes.
- *   8. Re-insert any notes that no longer overlap.
- *   9. Sort the MIDI event list, update manager.movingNote.lastStart/lastEnd and bracket, and reselect the moved note index.
+ *   5. Query the moving pitch's lane for notes overlapping the new position; for right-to-left motion try to shorten them, otherwise queue them for deletion.
+ *   6. Stage the move of your NoteOn/NoteOff events to newStart/newEnd.
+ *   7. Stage shortening, then deletion, and record all DeletedNote entries into manager.movingNote.deletedNotes.
+ *   8. Stage re-inserting any notes that no longer overlap.
+ *   9. Commit the step, update manager.movingNote.lastStart/lastEnd and bracket, and reselect the moved note index.
+ *
+ * A step stages every event change in one EventEdit and commits it once (Track::commitEdit()), which
+ * keeps the event list sorted; each change is mirrored in the lanes, so a step never re-sorts or
+ * rescans the track. Events are looked up by binary search on their tick in the list as it was
+ * before the step, skipping events the step has already staged.
  */
 
-// Helper functions for wrap-around calculations and overlap detection
-static uint32_t wrapPosition(int32_t position, uint32_t loopLength) {
-    if (position < 0) {
-        position = (int32_t)loopLength + position;
-        while (position < 0) {
-            position += (int32_t)loopLength;
+// Index of the NoteOn (on) or NoteOff of `pitch` at `tick` not yet staged in `edit`, by binary
+// search on the tick-sorted events; -1 if there is none
+static int findNoteEvent(const EventList& events, const EventEdit& edit, uint8_t pitch, uint32_t tick, bool on) {
+    auto it = std::lower_bound(events.begin(), events.end(), tick,
+                               [](const MidiEvent& e, uint32_t t) { return e.tick < t; });
+    for (; it != events.end() && it->tick == tick; ++it) {
+        bool isOn = it->type == midi::NoteOn && it->data.noteData.velocity > 0;
+        bool isOff = it->type == midi::NoteOff || (it->type == midi::NoteOn && it->data.noteData.velocity == 0);
+        if (it->data.noteData.note == pitch && (on ? isOn : isOff) && !edit.isStaged(it - events.begin())) {
+            return (int)(it - events.begin());
         }
-    } else if (position >= (int32_t)loopLength) {
-        position = position % (int32_t)loopLength;
-    }
-    return (uint32_t)position;
-}
-
-static uint32_t calculateNoteLength(uint32_t start, uint32_t end, uint32_t loopLength) {
-    if (end >= start) {
-        return end - start;
-    } else {
-        return (loopLength - start) + end;
-    }
-}
-
-static bool notesOverlap(uint32_t start1, uint32_t end1, uint32_t start2, uint32_t end2, uint32_t loopLength) {
-    // Convert to unwrapped positions for comparison
-    uint32_t unwrappedEnd1 = end1;
-    uint32_t unwrappedEnd2 = end2;
-    
-    // Check if notes are wrapped (end < start means wrapped)
-    bool wrapped1 = (end1 < start1);
-    bool wrapped2 = (end2 < start2);
-    
-    if (wrapped1) {
-        unwrappedEnd1 = end1 + loopLength;
-    }
-    if (wrapped2) {
-        unwrappedEnd2 = end2 + loopLength;
-    }
-    
-    // Now check overlap using unwrapped positions
-    // Note1: [start1, unwrappedEnd1], Note2: [start2, unwrappedEnd2]
-    bool overlap = (start1 < unwrappedEnd2) && (start2 < unwrappedEnd1);
-    
-    // If both notes are unwrapped, also check for loop-wrapped overlaps
-    if (!wrapped1 && !wrapped2) {
-        // Check if note1 wraps around and overlaps with note2
-        bool note1WrapsAndOverlaps = (start1 + loopLength < unwrappedEnd2) && (start2 < end1 + loopLength);
-        // Check if note2 wraps around and overlaps with note1
-        bool note2WrapsAndOverlaps = (start2 + loopLength < unwrappedEnd1) && (start1 < end2 + loopLength);
-        overlap = overlap || note1WrapsAndOverlaps || note2WrapsAndOverlaps;
     }
-    
-    return overlap;
+    return -1;
 }
 
 // Helper to detect and categorize overlapping notes
-void EditStartNoteState::findOverlaps(const std::vector<DisplayNote>& currentNotes,
+void EditStartNoteState::findOverlaps(const std::vector<DisplayNote>& candidates,
                                       uint8_t movingNotePitch,
                                       uint32_t currentStart,
                                       uint32_t newStart,
@@ -100,14 +67,14 @@ void EditStartNoteState::findOverlaps(const std::vector<DisplayNote>& currentNot
                                       uint32_t loopLength,
                                       std::vector<std::pair<DisplayNote, uint32_t>>& notesToShorten,
                                       std::vector<DisplayNote>& notesToDelete) {
-    for (const auto& note : currentNotes) {
+    for (const auto& note : candidates) {
         if (note.note != movingNotePitch) continue;
         if (note.startTick == currentStart) continue;
-        bool overlaps = notesOverlap(newStart, newEnd, note.startTick, note.endTick, loopLength);
+        bool overlaps = NoteLanes::overlaps(newStart, newEnd, note.startTick, note.endTick, loopLength);
         if (!overlaps) continue;
         if (delta < 0 && note.startTick < newStart) {
             uint32_t newNoteEnd = newStart;
-            uint32_t shortenedLength = calculateNoteLength(note.startTick, newNoteEnd, loopLength);
+            uint32_t shortenedLength = NoteLanes::lengthOf(note.startTick, newNoteEnd, loopLength);
             if (shortenedLength >= Config::TICKS_PER_16TH_STEP) {
                 notesToShorten.push_back({note, newNoteEnd});
                 logger.debug("Will shorten note: pitch=%d, start=%lu, end=%lu->%lu, length=%lu", 
@@ -127,15 +94,15 @@ void EditStartNoteState::findOverlaps(const std::vector<DisplayNote>& currentNot
                  notesToShorten.size(), notesToDelete.size());
 }
 
-// Apply shorten/delete decisions on the raw MIDI event list, reusing prebuilt indexes
-void EditStartNoteState::applyShortenOrDelete(std::vector<MidiEvent>& midiEvents,
+// Stage shorten/delete decisions on the track's events and apply them to the lanes
+void EditStartNoteState::applyShortenOrDelete(EventEdit& edit,
                                               const std::vector<std::pair<DisplayNote, uint32_t>>& notesToShorten,
                                               const std::vector<DisplayNote>& notesToDelete,
                                               EditManager& manager,
                                               uint32_t loopLength,
-                                              NoteUtils::EventIndexMap& onIndex,
-                                              NoteUtils::EventIndexMap& offIndex) {
-    // Shorten overlapping notes using index
+                                              NoteLanes& lanes) {
+    const auto& midiEvents = edit.getEvents();
+    // Shorten overlapping notes
     for (const auto& [dn, newEnd] : notesToShorten) {
         // Record original for undo
         EditManager::MovingNoteIdentity::DeletedNote original;
@@ -143,38 +110,35 @@ void EditStartNoteState::applyShortenOrDelete(std::vector<MidiEvent>& midiEvents
         original.velocity = dn.velocity;
         original.startTick = dn.startTick;
         original.endTick = dn.endTick;
-        original.originalLength = calculateNoteLength(dn.startTick, dn.endTick, loopLength);
+        original.originalLength = NoteLanes::lengthOf(dn.startTick, dn.endTick, loopLength);
         manager.movingNote.deletedNotes.push_back(original);
         logger.debug("Stored original note before shortening: pitch=%d, start=%lu, end=%lu, length=%lu",
                      original.note, original.startTick, original.endTick, original.originalLength);
-        // Adjust its NoteOff event via index
-        auto offKey = (NoteUtils::Key(dn.note) << 32) | dn.endTick;
-        auto itOff = offIndex.find(offKey);
-        if (itOff != offIndex.end()) {
-            size_t idx = itOff->second;
-            midiEvents[idx].tick = newEnd;
-            // Update index for new tick
-            offIndex.erase(itOff);
-            auto newKey = (NoteUtils::Key(dn.note) << 32) | newEnd;
-            offIndex[newKey] = idx;
+        // Move its NoteOff event
+        int offIdx = findNoteEvent(midiEvents, edit, dn.note, dn.endTick, false);
+        if (offIdx >= 0) {
+            edit.move(offIdx, newEnd);
+            lanes.setEnd(dn.note, dn.startTick, newEnd);
         }
     }
-    // Delete overlapping notes entirely (could similarly use onIndex/offIndex)
+    // Delete overlapping notes entirely
     for (const auto& dn : notesToDelete) {
         int deletedCount = 0;
-        auto it = midiEvents.begin();
-        while (it != midiEvents.end()) {
-            bool matchOn  = (it->type == midi::NoteOn && it->data.noteData.velocity > 0 && it->data.noteData.note == dn.note && it->tick == dn.startTick);
-            bool matchOff = ((it->type == midi::NoteOff || (it->type == midi::NoteOn && it->data.noteData.velocity == 0)) && it->data.noteData.note == dn.note && it->tick == dn.endTick);
-            if (matchOn || matchOff) {
-                logger.debug("Deleting MIDI event: type=%s, pitch=%d, tick=%lu",
-                             (matchOn ? "NoteOn" : "NoteOff"), dn.note, (matchOn ? dn.startTick : dn.endTick));
-                it = midiEvents.erase(it);
-                deletedCount++;
-            } else {
-                ++it;
-            }
+        uint8_t channel = 1;
+        int onIdx = findNoteEvent(midiEvents, edit, dn.note, dn.startTick, true);
+        if (onIdx >= 0) {
+            channel = midiEvents[onIdx].channel;
+            logger.debug("Deleting MIDI event: type=NoteOn, pitch=%d, tick=%lu", dn.note, dn.startTick);
+            edit.remove(onIdx);
+            deletedCount++;
+        }
+        int offIdx = findNoteEvent(midiEvents, edit, dn.note, dn.endTick, false);
+        if (offIdx >= 0) {
+            logger.debug("Deleting MIDI event: type=NoteOff, pitch=%d, tick=%lu", dn.note, dn.endTick);
+            edit.remove(offIdx);
+            deletedCount++;
         }
+        lanes.remove(dn.note, dn.startTick);
         if (deletedCount != 2) {
             logger.debug("Warning: deleted %d events for pitch %d (expected 2)", deletedCount, dn.note);
         }
@@ -182,29 +146,30 @@ void EditStartNoteState::applyShortenOrDelete(std::vector<MidiEvent>& midiEvents
         EditManager::MovingNoteIdentity::DeletedNote deleted;
         deleted.note = dn.note;
         deleted.velocity = dn.velocity;
+        deleted.channel = channel;
         deleted.startTick = dn.startTick;
         deleted.endTick = dn.endTick;
-        deleted.originalLength = calculateNoteLength(dn.startTick, dn.endTick, loopLength);
+        deleted.originalLength = NoteLanes::lengthOf(dn.startTick, dn.endTick, loopLength);
         manager.movingNote.deletedNotes.push_back(deleted);
         logger.debug("Stored deleted note: pitch=%d, start=%lu, end=%lu, length=%lu",
                      deleted.note, deleted.startTick, deleted.endTick, deleted.originalLength);
     }
 }
 
-// Helper to restore deleted or shortened notes after movement, reusing prebuilt indexes
-static void restoreNotes(std::vector<MidiEvent>& midiEvents,
+// Helper to stage restoring deleted or shortened notes after movement
+static void restoreNotes(EventEdit& edit,
                          const std::vector<EditManager::MovingNoteIdentity::DeletedNote>& notesToRestore,
                          EditManager& manager,
                          uint32_t loopLength,
-                         NoteUtils::EventIndexMap& onIndex,
-                         NoteUtils::EventIndexMap& offIndex) {
+                         NoteLanes& lanes) {
+    const auto& midiEvents = edit.getEvents();
     // Debug existing notes before restoration
     logger.log(CAT_MOVE_NOTES, LOG_DEBUG, "=== EXISTING NOTES BEFORE RESTORATION ===");
     #ifdef DEBUG_MOVE_NOTES
     {
         auto existingNotes = NoteUtils::reconstructNotes(midiEvents, loopLength);
         for (const auto& dn : existingNotes) {
-            uint32_t length = calculateNoteLength(dn.startTick, dn.endTick, loopLength);
+            uint32_t length = NoteLanes::lengthOf(dn.startTick, dn.endTick, loopLength);
             logger.log(CAT_MOVE_NOTES, LOG_DEBUG,
                        "Existing note: pitch=%d, start=%lu, end=%lu, length=%lu",
                        dn.note, dn.startTick, dn.endTick, length);
@@ -221,16 +186,17 @@ static void restoreNotes(std::vector<MidiEvent>& midiEvents,
     for (const auto& nr : notesToRestore) {
         uint32_t targetEnd = nr.startTick + nr.originalLength;
         bool didRestore = false;
-        // Try to extend an existing shortened note via index
-        auto onKey = (NoteUtils::Key(nr.note) << 32) | nr.startTick;
-        auto itOn = onIndex.find(onKey);
-        if (itOn != onIndex.end()) {
-            // Find its NoteOff event by original endTick
-            auto offKey = (NoteUtils::Key(nr.note) << 32) | nr.endTick;
-            auto itOff = offIndex.find(offKey);
-            if (itOff != offIndex.end() && midiEvents[itOff->second].tick < targetEnd) {
-                midiEvents[itOff->second].tick = targetEnd;
-                logger.debug("Extended note: pitch=%d, start=%lu, new end=%lu", nr.note, nr.startTick, targetEnd);
+        if (const DisplayNote* current = lanes.find(nr.note, nr.startTick)) {
+            // Still there (it was shortened): extend its NoteOff back to the original length
+            uint32_t start = current->startTick;
+            uint32_t end = current->endTick;
+            if (NoteLanes::lengthOf(start, end, loopLength) < nr.originalLength) {
+                int offIdx = findNoteEvent(midiEvents, edit, nr.note, end, false);
+                if (offIdx >= 0) {
+                    edit.move(offIdx, targetEnd);
+                    lanes.setEnd(nr.note, start, targetEnd);
+                    logger.debug("Extended note: pitch=%d, start=%lu, new end=%lu", nr.note, nr.startTick, targetEnd);
+                }
             }
             didRestore = true;
         } else {
@@ -238,15 +204,18 @@ static void restoreNotes(std::vector<MidiEvent>& midiEvents,
             MidiEvent onEvt;
             onEvt.tick = nr.startTick;
             onEvt.type = midi::NoteOn;
+            onEvt.channel = nr.channel;
             onEvt.data.noteData.note = nr.note;
             onEvt.data.noteData.velocity = nr.velocity;
-            midiEvents.push_back(onEvt);
             MidiEvent offEvt;
             offEvt.tick = targetEnd;
             offEvt.type = midi::NoteOff;
+            offEvt.channel = nr.channel;
             offEvt.data.noteData.note = nr.note;
             offEvt.data.noteData.velocity = 0;
-            midiEvents.push_back(offEvt);
+            edit.insert(onEvt);
+            edit.insert(offEvt);
+            lanes.insert(DisplayNote{nr.note, nr.velocity, nr.startTick, targetEnd});
             logger.debug("Restored deleted note: pitch=%d, start=%lu, end=%lu", nr.note, nr.startTick, targetEnd);
             didRestore = true;
         }
@@ -271,19 +240,16 @@ static void restoreNotes(std::vector<MidiEvent>& midiEvents,
 
 // Helper to finalize reconstruction and selection after movement
 static void finalReconstructAndSelect(
-    std::vector<MidiEvent>& midiEvents,
+    Track& track,
     EditManager& manager,
     uint8_t movingNotePitch,
     uint32_t newStart,
-    uint32_t newEnd,
-    uint32_t loopLength) {
-    // Sort events by tick
-    std::sort(midiEvents.begin(), midiEvents.end(),
-              [](const MidiEvent &a, const MidiEvent &b){ return a.tick < b.tick; });
+    uint32_t newEnd) {
+    const auto& midiEvents = track.getMidiEvents();
     // Update bracket to moved note start
     manager.setBracketTick(newStart);
-    // Reconstruct final notes and select moved note
-    auto finalNotes = NoteUtils::reconstructNotes(midiEvents, loopLength);
+    // Final notes and select moved note (this rebuild is shared with the next display frame)
+    const auto& finalNotes = track.getDisplayNotes();
     int newSelectedIdx = -1;
     // Exact match on pitch/start/end
     for (int i = 0; i < (int)finalNotes.size(); ++i) {
@@ -326,7 +292,7 @@ void EditStartNoteState::onEnter(EditManager& manager, Track& track, uint32_t st
     logger.debug("Entered EditStartNoteState");
     
     // Commit-on-enter: snapshot and hash initial MIDIEVENTS
-    initialHash = TrackUndo::computeMidiHash(track);
+    initialHash = track.getContentHash();
     TrackUndo::pushUndoSnapshot(track);
     logger.debug("Snapshot on enter, initial hash: %u", initialHash);
     
@@ -334,11 +300,7 @@ void EditStartNoteState::onEnter(EditManager& manager, Track& track, uint32_t st
     if (idx >= 0) {
         // Don't rebuild notes here - just preserve the current selection
         // and set up the moving note identity for tracking
-        uint32_t loopLength = track.getLoopLength();
-        
-        // Reconstruct notes using shared utility
-        auto& midiEvents = track.getMidiEvents();
-        std::vector<DisplayNote> notes = NoteUtils::reconstructNotes(midiEvents, loopLength);
+        const auto& notes = track.getDisplayNotes();
         
         if (idx < (int)notes.size()) {
             // Record persistent identity for the currently selected note
@@ -379,13 +341,14 @@ void EditStartNoteState::onExit(EditManager& manager, Track& track) {
     manager.movingNote.active = false;
     // IDEA: if you want to restore the original length of the note when starting a new move, then remove this line
     manager.movingNote.deletedNotes.clear();
+    lanes.clear();
 }
 
 // 2. onEncoderTurn(): move a note's start/end based on encoder spinning.
 void EditStartNoteState::onEncoderTurn(EditManager& manager, Track& track, int delta) {
     logger.debug("EditStartNoteState::onEncoderTurn called with delta=%d", delta);
     
-    auto& midiEvents = track.getMidiEvents();
+    const auto& midiEvents = track.getMidiEvents();
     uint32_t loopLength = track.getLoopLength();
     
     logger.debug("=== LOOP INFO ===");
@@ -422,9 +385,9 @@ void EditStartNoteState::onEncoderTurn(EditManager& manager, Track& track, int d
     // Calculate note length and new positions with wrap-around
     // displayEnd accounts for currentEnd possibly > loopLength
     uint32_t displayCurrentEnd = (currentEnd >= loopLength) ? (currentEnd % loopLength) : currentEnd;
-    uint32_t noteLen = calculateNoteLength(currentStart, displayCurrentEnd, loopLength);
+    uint32_t noteLen = NoteLanes::lengthOf(currentStart, displayCurrentEnd, loopLength);
     int32_t rawNewStart = (int32_t)currentStart + delta;
-    uint32_t newStart = wrapPosition(rawNewStart, loopLength);
+    uint32_t newStart = NoteUtils::wrapPosition(rawNewStart, loopLength);
     // actual MIDI new end (no modulo) and display end for UI/overlap logic
     uint32_t newEnd = newStart + noteLen;
     uint32_t displayNewEnd = newEnd % loopLength; // only for UI/debug; storage uses raw newEnd
@@ -441,8 +404,16 @@ void EditStartNoteState::onEncoderTurn(EditManager& manager, Track& track, int d
         logger.debug("Note WILL WRAP - newEnd=%lu >= loopLength=%lu", newEnd, loopLength);
     }
     
-    // Reconstruct notes for overlap detection and selection
-    std::vector<DisplayNote> currentNotes = NoteUtils::reconstructNotes(midiEvents, loopLength);
+    // Lanes of the state before this step; rebuilt only if the events changed outside this state
+    if (!lanes.isCurrent(track.getEventsGeneration(), loopLength)) {
+        lanes.rebuild(track.getDisplayNotes(), loopLength, track.getEventsGeneration());
+    }
+    const DisplayNote* moving = lanes.find(movingNotePitch, currentStart);
+    if (!moving) {
+        logger.debug("Warning: moving note pitch=%u start=%lu not found", movingNotePitch, currentStart);
+        return;
+    }
+    const DisplayNote movingNote = *moving;
     
     // Store notes to delete and restore
     std::vector<DisplayNote> notesToDelete;
@@ -455,17 +426,18 @@ void EditStartNoteState::onEncoderTurn(EditManager& manager, Track& track, int d
             if (deletedNote.note == movingNotePitch) {
                 // Check if the deleted note overlaps with the new position
                 // Use display coordinates consistently for overlap detection
-                bool hasOverlap = notesOverlap(newStart, newEnd,
+                bool hasOverlap = NoteLanes::overlaps(newStart, newEnd,
                                              deletedNote.startTick, deletedNote.endTick, loopLength);
                 
-                // Additional check: only restore if we're moving away from the deleted note
+                // Additional check: only restore if we're moving away from the deleted note.
+                // Judged at the new position, so a multi-step move that passes a note restores it
                 bool movingAway = false;
                 if (manager.movingNote.movementDirection > 0) {
                     // Moving right (positive delta) - restore notes to the left
-                    movingAway = (deletedNote.endTick <= currentStart);
+                    movingAway = (deletedNote.endTick <= newStart);
                 } else if (manager.movingNote.movementDirection < 0) {
                     // Moving left (negative delta) - restore notes to the right  
-                    movingAway = (deletedNote.startTick >= currentStart + noteLen);
+                    movingAway = (deletedNote.startTick >= newStart + noteLen);
                 }
                 
                 if (!hasOverlap && movingAway) {
@@ -484,55 +456,62 @@ void EditStartNoteState::onEncoderTurn(EditManager& manager, Track& track, int d
     logger.debug("Found %zu notes to restore, %zu total deleted notes", 
                  notesToRestore.size(), manager.movingNote.deletedNotes.size());
     
-    // Build event index once and reuse
-    auto [onIndex, offIndex] = NoteUtils::buildEventIndex(midiEvents);
-    // Detect and categorize overlaps in one shared helper
+    // Detect and categorize overlaps among the moving pitch's lane (the moving note itself left out)
+    lanes.remove(movingNotePitch, currentStart);
+    std::vector<DisplayNote> candidates;
+    lanes.overlapping(movingNotePitch, newStart, newEnd, candidates);
     std::vector<std::pair<DisplayNote, uint32_t>> notesToShorten;
-    findOverlaps(currentNotes, movingNotePitch, currentStart, newStart, newEnd, delta, loopLength,
+    findOverlaps(candidates, movingNotePitch, currentStart, newStart, newEnd, delta, loopLength,
                  notesToShorten, notesToDelete);
     
-    // Move the selected note's NoteOn/NoteOff events before adjusting overlaps
-    {
-    auto onIt = std::find_if(midiEvents.begin(), midiEvents.end(), [&](MidiEvent& evt) {
-            return evt.type == midi::NoteOn &&
-                   evt.data.noteData.note == movingNotePitch &&
-                   evt.tick == currentStart;
-    });
-    auto offIt = std::find_if(midiEvents.begin(), midiEvents.end(), [&](MidiEvent& evt) {
-            bool isOff = (evt.type == midi::NoteOff) || (evt.type == midi::NoteOn && evt.data.noteData.velocity == 0);
-            return isOff && evt.data.noteData.note == movingNotePitch &&
-                   evt.tick == currentEnd;
-        });
-        if (onIt != midiEvents.end() && offIt != midiEvents.end()) {
-    onIt->tick = newStart;
-    offIt->tick = newEnd;
-            manager.movingNote.lastStart = newStart;
-            manager.movingNote.lastEnd = newEnd;
-            logger.debug("Moved note events: pitch=%u start->%lu end->%lu", movingNotePitch, newStart, newEnd);
-        } else {
-            logger.debug("Warning: could not find MIDI events for moving note pitch=%u", movingNotePitch);
-        }
+    // Stage the selected note's NoteOn/NoteOff move before adjusting overlaps
+    EventEdit edit(track);
+    const auto deletedBefore = manager.movingNote.deletedNotes;  // Put back if the commit fails
+    bool moved = false;
+    int onIdx = findNoteEvent(midiEvents, edit, movingNotePitch, currentStart, true);
+    int offIdx = findNoteEvent(midiEvents, edit, movingNotePitch, currentEnd, false);
+    if (onIdx >= 0 && offIdx >= 0) {
+        edit.move(onIdx, newStart);
+        edit.move(offIdx, newEnd);
+        lanes.insert(DisplayNote{movingNotePitch, movingNote.velocity, newStart, newEnd});
+        moved = true;
+    } else {
+        lanes.insert(movingNote);
+        logger.debug("Warning: could not find MIDI events for moving note pitch=%u", movingNotePitch);
     }
     
-    // Apply shorten/delete using shared index
-    applyShortenOrDelete(midiEvents,
+    // Stage shorten/delete
+    applyShortenOrDelete(edit,
                          notesToShorten,
                          notesToDelete,
                          manager,
                          loopLength,
-                         onIndex,
-                         offIndex);
+                         lanes);
     
-    // Restore notes that should be restored based on movement, reusing index
-    restoreNotes(midiEvents,
+    // Stage restoring notes that should be restored based on movement
+    restoreNotes(edit,
                  notesToRestore,
                  manager,
                  loopLength,
-                 onIndex,
-                 offIndex);
+                 lanes);
+    
+    // Apply the whole step in one pass
+    if (!track.commitEdit(edit)) {
+        // Track full (restoring needed room): nothing changed, rebuild the lanes next step
+        manager.movingNote.deletedNotes = deletedBefore;
+        lanes.clear();
+        logger.debug("Warning: move of pitch=%u not applied, track full", movingNotePitch);
+        return;
+    }
+    lanes.setGeneration(track.getEventsGeneration());
+    if (moved) {
+        manager.movingNote.lastStart = newStart;
+        manager.movingNote.lastEnd = newEnd;
+        logger.debug("Moved note events: pitch=%u start->%lu end->%lu", movingNotePitch, newStart, newEnd);
+    }
     
     // Helper to finalize reconstruction and selection after movement
-    finalReconstructAndSelect(midiEvents, manager, movingNotePitch, newStart, newEnd, loopLength);
+    finalReconstructAndSelect(track, manager, movingNotePitch, newStart, newEnd);
 }
 
 // 4. onButtonPress(): exit move mode and return to NoteState.
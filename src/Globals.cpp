@@ -3,12 +3,13 @@
 
 #include "Globals.h"
 #include "ClockManager.h"
+#include "TimeSignature.h"
 
 //uint8_t debugLevel = DEBUG_INFO;
 
 // Runtime settings
 float bpm = 120.0f;
-uint32_t lastDisplayUpdate = 0;
+uint32_t ticksPerQuarterNote = Config::TICKS_PER_QUARTER_NOTE;
 uint32_t now = millis();
 
 // --------------------
@@ -21,7 +22,7 @@ uint32_t now = millis();
 // Check if we're at the start of a new bar
 // --------------------
 bool isBarBoundary() {
-  return (clockManager.getCurrentTick() % ticksPerBar) == 0;
+  return timeSignature.isBarStart(clockManager.getCurrentTick());
 }
 
 // --------------------
@@ -2,16 +2,22 @@
 //  Licensed under the PolyForm Noncommercial 1.0.0
 
 #include "Logger.h"
-#include <stdarg.h>
 #include "MidiEvent.h"
+#include "RingBuffer.h"
+#include "Globals.h"
 
 LogLevel Logger::currentLevel = LOG_INFO;
 bool Logger::isInitialized = false;
 // By default, all categories enabled except MOVE_NOTES
 bool Logger::categoryEnabled[] = { true, true, true, true, true, true, true, false };
+bool Logger::deferred = true;
 Logger logger;
 
-static char logBuffer[128];  // Shared buffer for formatted log output
+static MpscRingBuffer<LogRecord, Config::LOG_RING_RECORDS> logRing;
+static uint32_t reportedDrops = 0;
+
+static const char* const levelNames[] = {"ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+static const char* const categoryNames[] = {"GEN", "STATE", "MIDI", "CLOCK", "TRACK", "BTN", "DISP", "MOVE"};
 
 void Logger::setup(LogLevel level) {
   currentLevel = level;
@@ -28,141 +34,158 @@ void Logger::setCategoryEnabled(LogCategory category, bool enabled) {
   }
 }
 
-void Logger::printTimestamp() {
-  unsigned long ms = millis();
-  Serial.printf("[%lu.%03lu] ", ms / 1000, ms % 1000);
-}
-
-void Logger::printLevel(LogLevel level) {
-  const char* levels[] = {"ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
-  Serial.printf("[%s] ", levels[level]);
+uint32_t Logger::getDroppedCount() {
+  return logRing.getOverflowCount();
 }
 
-void Logger::printCategory(LogCategory category) {
-  const char* categories[] = {"GEN", "STATE", "MIDI", "CLOCK", "TRACK", "BTN", "DISP", "MOVE"};
-  if (category < (int)(sizeof(categories)/sizeof(categories[0]))) {
-    Serial.printf("[%s] ", categories[category]);
-  }
+void Logger::begin(LogRecord& rec, LogLevel level, LogCategory category, const char* format) {
+  rec.timestampMs = millis();
+  rec.format = format;
+  rec.event = nullptr;
+  rec.tick = 0;
+  rec.level = level;
+  rec.category = category;
+  rec.argCount = 0;
+  rec.argWords = 0;
+  rec.argTypes = 0;
 }
 
-void Logger::printPrefix(LogLevel level, LogCategory category) {
-  if (!isInitialized) return;
-  printTimestamp();
-  printLevel(level);
-  if (category != CAT_GENERAL) {
-    printCategory(category);
+void Logger::submit(const LogRecord& rec) {
+  if (deferred) {
+    logRing.push(rec);
+    return;
   }
+  char line[160];
+  size_t len = formatRecord(rec, line, sizeof(line));
+  Serial.write((const uint8_t*)line, len);
 }
 
-void Logger::error(const char* format, ...) {
-  if (currentLevel < LOG_ERROR) return;
-  printPrefix(LOG_ERROR);
-  va_list args;
-  va_start(args, format);
-  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-  va_end(args);
-  Serial.println(logBuffer);
-}
-
-void Logger::warning(const char* format, ...) {
-  if (currentLevel < LOG_WARNING) return;
-  printPrefix(LOG_WARNING);
-  va_list args;
-  va_start(args, format);
-  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-  va_end(args);
-  Serial.println(logBuffer);
-}
-
-void Logger::info(const char* format, ...) {
-  if (currentLevel < LOG_INFO) return;
-  printPrefix(LOG_INFO);
-  va_list args;
-  va_start(args, format);
-  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-  va_end(args);
-  Serial.println(logBuffer);
-}
-
-void Logger::debug(const char* format, ...) {
-  if (currentLevel < LOG_DEBUG) return;
-  printPrefix(LOG_DEBUG);
-  va_list args;
-  va_start(args, format);
-  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-  va_end(args);
-  Serial.println(logBuffer);
-}
-
-void Logger::trace(const char* format, ...) {
-  if (currentLevel < LOG_TRACE) return;
-  printPrefix(LOG_TRACE);
-  va_list args;
-  va_start(args, format);
-  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-  va_end(args);
-  Serial.println(logBuffer);
-}
-
-void Logger::log(LogCategory category, LogLevel level, const char* format, ...) {
-  if (currentLevel < level) return;
-  if (!categoryEnabled[category]) return;
-  printPrefix(level, category);
-  va_list args;
-  va_start(args, format);
-  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-  va_end(args);
-  Serial.println(logBuffer);
-}
-
-void Logger::logStateTransition(const char* component, const char* fromState, const char* toState) {
-  if (currentLevel < LOG_DEBUG) return;
-  printPrefix(LOG_DEBUG, CAT_STATE);
-  Serial.printf("%s state transition: %s -> %s", component, fromState, toState);
-  Serial.println();
-}
-
-void Logger::logMidiEvent(const MidiEvent& evt) {
-  if (currentLevel < LOG_DEBUG) return;
-  printPrefix(LOG_DEBUG, CAT_MIDI);
+void Logger::logMidiEventRecord(const MidiEvent& evt) {
   switch (evt.type) {
     case midi::NoteOn:
-      Serial.printf("NoteOn: ch=%d, note=%d, vel=%d", evt.channel, evt.data.noteData.note, evt.data.noteData.velocity);
+      log(CAT_MIDI, LOG_DEBUG, "NoteOn: ch=%d, note=%d, vel=%d", evt.channel, evt.data.noteData.note, evt.data.noteData.velocity);
       break;
     case midi::NoteOff:
-      Serial.printf("NoteOff: ch=%d, note=%d, vel=%d", evt.channel, evt.data.noteData.note, evt.data.noteData.velocity);
+      log(CAT_MIDI, LOG_DEBUG, "NoteOff: ch=%d, note=%d, vel=%d", evt.channel, evt.data.noteData.note, evt.data.noteData.velocity);
       break;
     case midi::ControlChange:
-      Serial.printf("ControlChange: ch=%d, cc=%d, val=%d", evt.channel, evt.data.ccData.cc, evt.data.ccData.value);
+      log(CAT_MIDI, LOG_DEBUG, "ControlChange: ch=%d, cc=%d, val=%d", evt.channel, evt.data.ccData.cc, evt.data.ccData.value);
       break;
     case midi::ProgramChange:
-      Serial.printf("ProgramChange: ch=%d, program=%d", evt.channel, evt.data.program);
+      log(CAT_MIDI, LOG_DEBUG, "ProgramChange: ch=%d, program=%d", evt.channel, evt.data.program);
       break;
     case midi::PitchBend:
-      Serial.printf("PitchBend: ch=%d, value=%d", evt.channel, evt.data.pitchBend);
+      log(CAT_MIDI, LOG_DEBUG, "PitchBend: ch=%d, value=%d", evt.channel, evt.data.pitchBend);
       break;
     case midi::AfterTouchChannel:
-      Serial.printf("AfterTouch: ch=%d, pressure=%d", evt.channel, evt.data.channelPressure);
+      log(CAT_MIDI, LOG_DEBUG, "AfterTouch: ch=%d, pressure=%d", evt.channel, evt.data.channelPressure);
       break;
     default:
-      Serial.printf("MIDI type=%d, ch=%d", evt.type, evt.channel);
+      log(CAT_MIDI, LOG_DEBUG, "MIDI type=%d, ch=%d", evt.type, evt.channel);
       break;
   }
-  Serial.println();
 }
 
-void Logger::logTrackEvent(const char* event, uint32_t tick, const char* format, ...) {
-  if (currentLevel < LOG_DEBUG) return;
-  printPrefix(LOG_DEBUG, CAT_TRACK);
-  Serial.printf("%s @ tick %lu", event, tick);
-  if (format) {
-    Serial.print(" (");
-    va_list args;
-    va_start(args, format);
-    vsnprintf(logBuffer, sizeof(logBuffer), format, args);
-    va_end(args);
-    Serial.print(logBuffer);
-    Serial.print(")");
+// Expand the record's format with its stored arguments. Each conversion is re-issued to
+// snprintf with the length modifier that matches the stored type, so "%lu" and "%d" both
+// work whatever the argument width was at the call site. Returns the length, newline included.
+size_t Logger::formatRecord(const LogRecord& rec, char* out, size_t size) {
+  size_t len = 0;
+  auto append = [&](int n) {
+    if (n > 0) len += (size_t)n;
+    if (len > size - 2) len = size - 2;  // Keep room for the newline
+  };
+
+  if (isInitialized) {
+    uint32_t ms = rec.timestampMs;
+    append(snprintf(out + len, size - len, "[%lu.%03lu] [%s] ", (unsigned long)(ms / 1000),
+                    (unsigned long)(ms % 1000), levelNames[rec.level]));
+    if (rec.category != CAT_GENERAL) {
+      append(snprintf(out + len, size - len, "[%s] ", categoryNames[rec.category]));
+    }
+  }
+  if (rec.event) {
+    append(snprintf(out + len, size - len, "%s @ tick %lu", rec.event, (unsigned long)rec.tick));
+    if (rec.format) append(snprintf(out + len, size - len, " ("));
+  }
+
+  uint8_t argIndex = 0;
+  uint8_t word = 0;
+  for (const char* p = rec.format; p && *p && len < size - 2; ++p) {
+    if (*p != '%') { out[len++] = *p; continue; }
+    if (p[1] == '%') { out[len++] = '%'; ++p; continue; }
+
+    // Collect flags, width and precision; drop the caller's length modifiers
+    char spec[16];
+    size_t s = 0;
+    spec[s++] = '%';
+    ++p;
+    while (*p && strchr("-+ #0123456789.*", *p) && s < sizeof(spec) - 4) spec[s++] = *p++;
+    while (*p && strchr("hlLjzt", *p)) ++p;
+    char conv = *p;
+    if (!conv) break;
+
+    if (argIndex >= rec.argCount) { out[len++] = '?'; continue; }
+    uint8_t type = (rec.argTypes >> (2 * argIndex)) & 0x3;
+    uint32_t lo = rec.args[word];
+    uint32_t hi = (type == LogRecord::ARG_INT || word + 1 >= LogRecord::MAX_ARG_WORDS) ? 0 : rec.args[word + 1];
+    uint64_t wide = ((uint64_t)hi << 32) | lo;
+    bool twoWords = type == LogRecord::ARG_INT64 || type == LogRecord::ARG_DOUBLE ||
+                    (type == LogRecord::ARG_STRING && sizeof(uintptr_t) > 4);
+    word += twoWords ? 2 : 1;
+    argIndex++;
+
+    size_t remain = size - len;
+    if (type == LogRecord::ARG_DOUBLE) {
+      double d;
+      memcpy(&d, &wide, sizeof(d));
+      spec[s++] = strchr("eEfFgGaA", conv) ? conv : 'f';
+      spec[s] = '\0';
+      append(snprintf(out + len, remain, spec, d));
+    } else if (type == LogRecord::ARG_STRING) {
+      const char* str = (const char*)(uintptr_t)(sizeof(uintptr_t) > 4 ? wide : lo);
+      spec[s++] = 's';
+      spec[s] = '\0';
+      append(snprintf(out + len, remain, spec, str ? str : "(null)"));
+    } else if (conv == 'p') {
+      spec[s++] = 'p';
+      spec[s] = '\0';
+      append(snprintf(out + len, remain, spec, (void*)(uintptr_t)wide));
+    } else if (type == LogRecord::ARG_INT64) {
+      spec[s++] = 'l';
+      spec[s++] = 'l';
+      spec[s++] = strchr("diouxXc", conv) ? conv : 'd';
+      spec[s] = '\0';
+      append(snprintf(out + len, remain, spec, (long long)wide));
+    } else {
+      spec[s++] = strchr("diouxXc", conv) ? conv : 'd';
+      spec[s] = '\0';
+      append(snprintf(out + len, remain, spec, (int)lo));
+    }
+  }
+
+  if (rec.event && rec.format && len < size - 2) out[len++] = ')';
+  out[len++] = '\n';
+  out[len] = '\0';
+  return len;
+}
+
+void Logger::drain(uint32_t budgetMicros) {
+  uint32_t start = ::micros();
+  char line[160];
+
+  uint32_t dropped = logRing.getOverflowCount();
+  if (dropped != reportedDrops) {
+    Serial.printf("[LOG] %lu messages dropped\n", (unsigned long)(dropped - reportedDrops));
+    reportedDrops = dropped;
+  }
+
+  LogRecord rec;
+  while (::micros() - start < budgetMicros) {
+    // Leave records queued rather than block on a full USB serial buffer
+    if (Serial.availableForWrite() < (int)sizeof(line)) break;
+    if (!logRing.pop(rec)) break;
+    size_t len = formatRecord(rec, line, sizeof(line));
+    Serial.write((const uint8_t*)line, len);
   }
-  Serial.println();
 }
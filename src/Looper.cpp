@@ -6,6 +6,8 @@
 #include "LooperState.h"
 #include "Looper.h"
 #include "StorageManager.h"
+#include "TrackManager.h"
+#include "Logger.h"
 #include <SD.h>
 
 Looper looper;  // Global instance
@@ -18,16 +20,23 @@ void Looper::setup() {
   // ... any hardware or SD initialization ...
   SD.begin(BUILTIN_SDCARD); // or your SD chip select pin
 
-  // Try to load previous state
-  if (!StorageManager::loadState(looperState.getLooperState())) {
+  // Restore the previous state in the background; tracks become playable as they load
+  if (!StorageManager::beginRestore(looperState.getLooperState())) {
       // Optionally: print a message or handle first-time setup
       Serial.println("No previous looper state found or failed to load.");
-  } else {
-      Serial.println("Looper state loaded from SD card.");
   }
+  restoring = true;
 }
 
 void Looper::update() {
+  if (restoring && !StorageManager::isRestoring()) {
+    restoring = false;
+    digitalWrite(LED_BUILTIN, LOW);
+    for (uint8_t i = 0; i < trackManager.getTrackCount(); ++i) {
+      Track& track = trackManager.getTrack(i);
+      logger.debug("Track %d state: %s", i, track.getStateName(track.getState()));
+    }
+  }
   handleState();
 }
 
@@ -0,0 +1,157 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "MemoryMonitor.h"
+#include "Globals.h"
+#include "Track.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "EditManager.h"
+#include "StorageManager.h"
+#include "Logger.h"
+
+#if defined(__IMXRT1062__)
+#include <malloc.h>
+// Teensy 4 linker symbols: RAM1 statics end at _ebss, the heap spans RAM2
+extern unsigned long _ebss;
+extern unsigned long _heap_start;
+extern unsigned long _heap_end;
+extern char* __brkval;
+#endif
+
+namespace {
+
+#if defined(__IMXRT1062__)
+size_t heapHighWater = 0;
+size_t ram1LowWater = SIZE_MAX;
+#endif
+
+template <typename Vec>
+size_t vectorBytes(const Vec& v) {
+  return v.capacity() * sizeof(typename Vec::value_type);
+}
+
+size_t editBytesFor(const Track& track) {
+  size_t bytes = 0;
+  auto removed = editManager.temporarilyRemovedNotes.find(&track);
+  if (removed != editManager.temporarilyRemovedNotes.end()) {
+    for (const auto& note : removed->second) {
+      bytes += vectorBytes(note.second);
+      for (const auto& r : note.second) bytes += vectorBytes(r.events);
+    }
+  }
+  // The moving-note buffers belong to the track being edited, which is the selected one
+  if (&track == &trackManager.getSelectedTrack()) {
+    const auto& moving = editManager.movingNote;
+    bytes += vectorBytes(moving.deletedNotes) + vectorBytes(moving.deletedEvents) +
+             vectorBytes(moving.deletedEventIndices);
+  }
+  return bytes;
+}
+
+}  // namespace
+
+TrackMemoryUsage MemoryMonitor::trackUsage(const Track& track) {
+  TrackMemoryUsage usage{};
+  const TrackArena& arena = track.getArena();
+  usage.eventBytes = track.getEventBytes();
+  usage.undoBytes = TrackUndo::getUndoBytes(track);
+  usage.clearUndoBytes = TrackUndo::getClearUndoBytes(track);
+  usage.editBytes = editBytesFor(track);
+  usage.playbackBytes = track.getPlaybackBytes();
+  usage.sysexBytes = track.getSysExStore().capacityBytes();
+  usage.undoLevels = (uint16_t)TrackUndo::getUndoEntries(track).size();
+  usage.pagedUndoLevels = (uint16_t)StorageManager::pagedUndoLevels(track);
+  usage.arenaUsed = arena.used();
+  usage.arenaCapacity = arena.capacity();
+  usage.arenaLargestFree = arena.largestFreeBlock();
+  usage.arenaOverflows = arena.getOverflowCount();
+  return usage;
+}
+
+SystemMemoryUsage MemoryMonitor::systemUsage() {
+  SystemMemoryUsage usage{};
+#if defined(__IMXRT1062__)
+  char stackTop;
+  char* brk = __brkval ? __brkval : (char*)&_heap_start;
+  struct mallinfo info = mallinfo();
+  usage.measured = true;
+  usage.ram1Free = (size_t)(&stackTop - (char*)&_ebss);
+  usage.ram2Free = (size_t)((char*)&_heap_end - brk) + info.fordblks;
+  usage.heapUsed = info.uordblks;
+  size_t brkBytes = (size_t)(brk - (char*)&_heap_start);
+  if (brkBytes > heapHighWater) heapHighWater = brkBytes;
+  if (usage.ram1Free < ram1LowWater) ram1LowWater = usage.ram1Free;
+  usage.heapHighWater = heapHighWater;
+  usage.ram1FreeLowWater = ram1LowWater;
+#endif
+  return usage;
+}
+
+void MemoryMonitor::sample() {
+  systemUsage();  // Updates the marks as a side effect
+}
+
+void MemoryMonitor::dump(Print& out) {
+  SystemMemoryUsage sys = systemUsage();
+  if (sys.measured) {
+    out.printf("[Memory] RAM1 free %lu (low %lu)  RAM2 free %lu  heap %lu (high %lu)\n",
+               (unsigned long)sys.ram1Free, (unsigned long)sys.ram1FreeLowWater, (unsigned long)sys.ram2Free,
+               (unsigned long)sys.heapUsed, (unsigned long)sys.heapHighWater);
+  } else {
+    out.println("[Memory] Board figures not available on this build");
+  }
+  out.println("  trk   events     undo  clrundo     edit playback    sysex  lvl/card  arena used/cap (largest)  ovf");
+  for (uint8_t i = 0; i < Config::NUM_TRACKS; ++i) {
+    TrackMemoryUsage t = trackUsage(trackManager.getTrack(i));
+    out.printf("  %3u %8lu %8lu %8lu %8lu %8lu %8lu  %3u/%-4u %8lu/%-8lu (%lu) %lu\n", i + 1,
+               (unsigned long)t.eventBytes, (unsigned long)t.undoBytes, (unsigned long)t.clearUndoBytes,
+               (unsigned long)t.editBytes, (unsigned long)t.playbackBytes, (unsigned long)t.sysexBytes,
+               t.undoLevels, t.pagedUndoLevels,
+               (unsigned long)t.arenaUsed, (unsigned long)t.arenaCapacity, (unsigned long)t.arenaLargestFree, (unsigned long)t.arenaOverflows);
+  }
+}
+
+void MemoryMonitor::pollSerial() {
+  while (Serial.available() > 0) {
+    if (Serial.peek() == 'm') {
+      Serial.read();
+      dump(Serial);
+      continue;
+    }
+#if defined(LOOPER_PROFILE) || defined(LOOPER_STRESS)
+    break;  // Leave it for the profiler / stress commands
+#else
+    Serial.read();
+#endif
+  }
+}
+
+bool MemoryMonitor::admitRecording(Track& track, bool overdub) {
+  SystemMemoryUsage sys = systemUsage();
+  if (sys.measured && sys.ram2Free < Config::HEAP_MIN_FREE_BYTES) {
+    logger.log(CAT_TRACK, LOG_WARNING, "RAM2 low (%lu bytes free), take refused", (unsigned long)sys.ram2Free);
+    return false;
+  }
+  // A new take reuses the cleared event buffer; an overdub's layer is merged into the current
+  // events later, so it needs room for both
+  size_t kept = overdub ? track.getMidiEventCount() : 0;
+  size_t needed = kept + Config::RECORD_MIN_FREE_EVENTS;
+  if (track.getLayerCount() == 0 && track.getMidiEvents().capacity() >= needed) return true;
+  if (TrackUndo::makeArenaRoom(track, needed * sizeof(MidiEvent))) return true;
+  logger.log(CAT_TRACK, LOG_WARNING, "Track memory full (%lu of %lu bytes), take refused",
+             (unsigned long)track.getArena().used(), (unsigned long)track.getArena().capacity());
+  return false;
+}
+
+uint8_t MemoryMonitor::arenaPercent(const Track& track) {
+  const TrackArena& arena = track.getArena();
+  if (arena.capacity() == 0) return 0;
+  return (uint8_t)((uint64_t)arena.used() * 100 / arena.capacity());
+}
+
+bool MemoryMonitor::nearLimit(const Track& track) {
+  if (arenaPercent(track) >= Config::MEMORY_WARN_PERCENT) return true;
+  SystemMemoryUsage sys = systemUsage();
+  return sys.measured && sys.ram2Free < Config::HEAP_MIN_FREE_BYTES;
+}
@@ -0,0 +1,471 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "MidiFile.h"
+#include "Globals.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "ClockManager.h"
+#include "StorageManager.h"
+#include "TimeSignature.h"
+#include <SD.h>
+#include <Arduino.h>
+#include <string.h>
+#include <algorithm>
+
+static constexpr uint8_t META = 0xFF;
+static constexpr uint8_t META_TRACK_NAME = 0x03;
+static constexpr uint8_t META_END_OF_TRACK = 0x2F;
+static constexpr uint8_t META_TEMPO = 0x51;
+static constexpr uint8_t META_TIME_SIGNATURE = 0x58;
+static constexpr uint8_t META_SEQUENCER = 0x7F;
+static constexpr uint8_t SEQUENCER_ID = 0x7D;     // Non-commercial manufacturer ID
+static constexpr uint8_t SEQUENCER_LOOP = 'L';    // Payload: loop length, 32-bit big endian ticks
+
+// -------------------------
+// Buffered writer / reader
+// -------------------------
+
+// The one transfer buffer, shared by export and import (loop() context only)
+static uint8_t ioBuffer[MidiFile::BUFFER_BYTES];
+
+class SmfWriter {
+public:
+    explicit SmfWriter(File& file) : file(file) {}
+
+    void byte(uint8_t b) {
+        if (used == sizeof(ioBuffer)) flush();
+        ioBuffer[used++] = b;
+    }
+    void bytes(const void* data, size_t len) {
+        const uint8_t* p = (const uint8_t*)data;
+        while (len--) byte(*p++);
+    }
+    void be16(uint16_t v) { byte(v >> 8); byte(v & 0xFF); }
+    void be32(uint32_t v) { be16(v >> 16); be16(v & 0xFFFF); }
+    void varint(uint32_t v) {
+        uint8_t out[4];
+        int n = 0;
+        do {
+            out[n++] = v & 0x7F;
+            v >>= 7;
+        } while (v && n < 4);
+        while (n > 1) byte(out[--n] | 0x80);
+        byte(out[0]);
+    }
+    void flush() {
+        if (used && file.write(ioBuffer, used) != used) failed = true;
+        used = 0;
+    }
+    uint64_t position() { flush(); return file.position(); }
+    // Patch a big-endian length already written at pos
+    void patch32(uint64_t pos, uint32_t v) {
+        flush();
+        uint64_t end = file.position();
+        uint8_t be[4] = {(uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v};
+        if (!file.seek(pos) || file.write(be, 4) != 4 || !file.seek(end)) failed = true;
+    }
+    bool failed = false;
+
+private:
+    File& file;
+    size_t used = 0;
+};
+
+class SmfReader {
+public:
+    explicit SmfReader(File& file) : file(file) {}
+
+    bool byte(uint8_t& b) {
+        if (pos == len) {
+            int got = file.read(ioBuffer, sizeof(ioBuffer));
+            if (got <= 0) return false;
+            len = (size_t)got;
+            pos = 0;
+        }
+        b = ioBuffer[pos++];
+        consumed++;
+        return true;
+    }
+    bool be16(uint16_t& v) {
+        uint8_t a, b;
+        if (!byte(a) || !byte(b)) return false;
+        v = (uint16_t)((a << 8) | b);
+        return true;
+    }
+    bool be32(uint32_t& v) {
+        uint16_t a, b;
+        if (!be16(a) || !be16(b)) return false;
+        v = ((uint32_t)a << 16) | b;
+        return true;
+    }
+    bool varint(uint32_t& v) {
+        v = 0;
+        for (int i = 0; i < 4; ++i) {
+            uint8_t b;
+            if (!byte(b)) return false;
+            v = (v << 7) | (b & 0x7F);
+            if (!(b & 0x80)) return true;
+        }
+        return false;  // More than 4 bytes: not a valid SMF quantity
+    }
+    bool skip(uint32_t n) {
+        uint8_t b;
+        while (n--) {
+            if (!byte(b)) return false;
+        }
+        return true;
+    }
+    uint32_t consumed = 0;  // Bytes read so far
+
+private:
+    File& file;
+    size_t pos = 0;
+    size_t len = 0;
+};
+
+// -------------------------
+// Export
+// -------------------------
+
+// Status byte for a looper event, or 0 when it has no SMF channel message
+static uint8_t statusOf(const MidiEvent& evt) {
+    uint8_t ch = (evt.channel - 1) & 0x0F;
+    switch (evt.type) {
+        case midi::NoteOff:
+            // Velocity-0 NoteOn keeps running status across a run of notes
+            return (uint8_t)((evt.data.noteData.velocity ? 0x80 : 0x90) | ch);
+        case midi::NoteOn:
+        case midi::AfterTouchPoly:
+        case midi::ControlChange:
+        case midi::PitchBend:
+        case midi::ProgramChange:
+        case midi::AfterTouchChannel:
+            return (uint8_t)(evt.type | ch);
+        default:
+            return 0;
+    }
+}
+
+static void writeChannelEvent(SmfWriter& w, const MidiEvent& evt, uint8_t status, uint8_t& runningStatus) {
+    if (status != runningStatus) w.byte(status);
+    runningStatus = status;
+    switch (evt.type) {
+        case midi::NoteOn:
+        case midi::NoteOff:
+            w.byte(evt.data.noteData.note & 0x7F);
+            w.byte(evt.data.noteData.velocity & 0x7F);
+            break;
+        case midi::AfterTouchPoly:
+            w.byte(evt.data.polyATData.note & 0x7F);
+            w.byte(evt.data.polyATData.pressure & 0x7F);
+            break;
+        case midi::ControlChange:
+            w.byte(evt.data.ccData.cc & 0x7F);
+            w.byte(evt.data.ccData.value & 0x7F);
+            break;
+        case midi::PitchBend: {
+            uint16_t bend = (uint16_t)(evt.data.pitchBend + 8192);
+            w.byte(bend & 0x7F);
+            w.byte((bend >> 7) & 0x7F);
+            break;
+        }
+        case midi::ProgramChange:
+            w.byte(evt.data.program & 0x7F);
+            break;
+        default:  // AfterTouchChannel
+            w.byte(evt.data.channelPressure & 0x7F);
+            break;
+    }
+}
+
+// Start a chunk; returns the position of its length field
+static uint64_t beginChunk(SmfWriter& w, const char* id) {
+    w.bytes(id, 4);
+    uint64_t lengthPos = w.position();
+    w.be32(0);
+    return lengthPos;
+}
+
+static void endChunk(SmfWriter& w, uint64_t lengthPos) {
+    uint64_t end = w.position();
+    w.patch32(lengthPos, (uint32_t)(end - lengthPos - 4));
+}
+
+static void writeConductor(SmfWriter& w) {
+    uint64_t lengthPos = beginChunk(w, "MTrk");
+    uint32_t usPerQuarter = (uint32_t)(60000000.0f / (bpm > 0 ? bpm : 120.0f));
+    w.varint(0);
+    w.byte(META); w.byte(META_TEMPO); w.varint(3);
+    w.byte(usPerQuarter >> 16); w.byte(usPerQuarter >> 8); w.byte(usPerQuarter);
+    w.varint(0);
+    w.byte(META); w.byte(META_TIME_SIGNATURE); w.varint(4);
+    Timing::Meter meter = timeSignature.getMeter();
+    uint8_t log2Denominator = (uint8_t)__builtin_ctz(meter.denominator);
+    w.byte(meter.numerator); w.byte(log2Denominator);
+    w.byte(96 / meter.denominator); w.byte(8);  // One click per beat (24 clocks a quarter)
+    w.varint(0);
+    w.byte(META); w.byte(META_END_OF_TRACK); w.varint(0);
+    endChunk(w, lengthPos);
+}
+
+static void writeTrack(SmfWriter& w, uint8_t index, const Track& track) {
+    uint64_t lengthPos = beginChunk(w, "MTrk");
+    char name[12];
+    snprintf(name, sizeof(name), "Track %u", (unsigned)index + 1);
+    w.varint(0);
+    w.byte(META); w.byte(META_TRACK_NAME); w.varint(strlen(name)); w.bytes(name, strlen(name));
+    uint32_t loopLength = track.getLoopLength();
+    w.varint(0);
+    w.byte(META); w.byte(META_SEQUENCER); w.varint(6);
+    w.byte(SEQUENCER_ID); w.byte(SEQUENCER_LOOP); w.be32(loopLength);
+
+    uint32_t lastTick = 0;
+    uint8_t runningStatus = 0;
+    for (const auto& evt : track.getMidiEvents()) {
+        uint8_t status = statusOf(evt);
+        if (!status) continue;
+        uint32_t tick = evt.tick > lastTick ? evt.tick : lastTick;  // Events are sorted; never go back
+        w.varint(tick - lastTick);
+        lastTick = tick;
+        writeChannelEvent(w, evt, status, runningStatus);
+    }
+    w.varint(loopLength > lastTick ? loopLength - lastTick : 0);
+    w.byte(META); w.byte(META_END_OF_TRACK); w.varint(0);
+    endChunk(w, lengthPos);
+}
+
+bool MidiFile::exportSession(const char* path) {
+    char tempPath[64];
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", path);
+    SD.remove(tempPath);
+    File file = SD.open(tempPath, FILE_WRITE);
+    if (!file) {
+        Serial.print("[MidiFile] ERROR: Could not open file for writing: ");
+        Serial.println(tempPath);
+        return false;
+    }
+    SmfWriter w(file);
+
+    uint64_t lengthPos = beginChunk(w, "MThd");
+    w.be16(1);                                      // Type 1: simultaneous tracks
+    w.be16(1 + trackManager.getTrackCount());       // Conductor + one per track
+    w.be16(Config::INTERNAL_PPQN);
+    endChunk(w, lengthPos);
+    writeConductor(w);
+    for (uint8_t i = 0; i < trackManager.getTrackCount(); ++i) writeTrack(w, i, trackManager.getTrack(i));
+    w.flush();
+    bool ok = !w.failed;
+    file.close();
+
+    if (ok) {
+        SD.remove(path);
+        ok = SD.rename(tempPath, path);
+    }
+    if (!ok) {
+        SD.remove(tempPath);
+        Serial.print("[MidiFile] ERROR: Export failed: ");
+        Serial.println(path);
+        return false;
+    }
+    Serial.print("[MidiFile] Exported ");
+    Serial.println(path);
+    return true;
+}
+
+// -------------------------
+// Import
+// -------------------------
+
+// Channel message with its data bytes as a looper event
+static bool decodeChannelEvent(uint8_t status, uint8_t d1, uint8_t d2, uint32_t tick, MidiEvent& out) {
+    uint8_t ch = (status & 0x0F) + 1;
+    switch (status & 0xF0) {
+        case 0x80: out = MidiEvent::NoteOff(tick, ch, d1, d2); return true;
+        case 0x90: out = d2 ? MidiEvent::NoteOn(tick, ch, d1, d2) : MidiEvent::NoteOff(tick, ch, d1); return true;
+        case 0xA0: out = MidiEvent::PolyAftertouch(tick, ch, d1, d2); return true;
+        case 0xB0: out = MidiEvent::ControlChange(tick, ch, d1, d2); return true;
+        case 0xC0: out = MidiEvent::ProgramChange(tick, ch, d1); return true;
+        case 0xD0: out = MidiEvent::ChannelAftertouch(tick, ch, d1); return true;
+        case 0xE0: out = MidiEvent::PitchBend(tick, ch, (int16_t)(((d2 << 7) | d1) - 8192)); return true;
+        default: return false;
+    }
+}
+
+struct ImportState {
+    uint16_t division = Config::INTERNAL_PPQN;
+    uint8_t nextTrack = 0;
+    bool tempoSet = false;
+    bool meterSet = false;
+    uint32_t ticksPerBar = timeSignature.ticksPerBar();
+    bool full = false;
+};
+
+// Read one MTrk body into the next free track. Returns false on a malformed chunk.
+static bool readTrackChunk(SmfReader& r, uint32_t length, ImportState& st) {
+    uint32_t end = r.consumed + length;
+    uint64_t sourceTick = 0;
+    uint8_t runningStatus = 0;
+    uint32_t loopLength = 0;
+    uint32_t lastTick = 0;
+    uint32_t endOfTrack = 0;
+    Track* track = nullptr;
+    bool fits = st.nextTrack < Config::NUM_TRACKS;
+    bool hasEvents = false;
+    // This MTrk becomes the next track: cleared, with a clear-undo snapshot
+    auto claim = [&]() {
+        if (track || !fits) return;
+        track = &trackManager.getTrack(st.nextTrack);
+        if (!track->isEmpty()) TrackUndo::pushClearTrackSnapshot(*track);
+        track->clear();
+    };
+
+    // Parse to the chunk end; a malformed or cut chunk still keeps the events read so far
+    auto parse = [&]() {
+        while (r.consumed < end) {
+            uint32_t delta;
+            uint8_t b;
+            if (!r.varint(delta) || !r.byte(b)) return false;
+            sourceTick += delta;
+            uint32_t tick = (uint32_t)(sourceTick * Config::INTERNAL_PPQN / st.division);
+
+            if (b == META) {
+                uint8_t type;
+                uint32_t len;
+                if (!r.byte(type) || !r.varint(len)) return false;
+                if (type == META_TEMPO && len == 3 && !st.tempoSet) {
+                    uint8_t t[3];
+                    if (!r.byte(t[0]) || !r.byte(t[1]) || !r.byte(t[2])) return false;
+                    uint32_t us = ((uint32_t)t[0] << 16) | (t[1] << 8) | t[2];
+                    if (us) clockManager.setBpm((uint16_t)(60000000.0f / us + 0.5f));
+                    st.tempoSet = true;
+                } else if (type == META_TIME_SIGNATURE && len == 4 && !st.meterSet) {
+                    uint8_t sig[4];
+                    for (uint8_t& b : sig) {
+                        if (!r.byte(b)) return false;
+                    }
+                    Timing::Meter meter{sig[0], (uint8_t)(sig[1] < 8 ? 1u << sig[1] : 0)};
+                    if (timeSignature.setMeter(meter, clockManager.getCurrentTick())) {
+                        st.ticksPerBar = Config::TIMING.ticksPerBar(meter);
+                    }
+                    st.meterSet = true;
+                } else if (type == META_SEQUENCER && len == 6) {
+                    uint8_t id, kind;
+                    uint32_t value;
+                    if (!r.byte(id) || !r.byte(kind) || !r.be32(value)) return false;
+                    if (id == SEQUENCER_ID && kind == SEQUENCER_LOOP) {
+                        // Written by exportSession(): one MTrk per track, empty ones included
+                        loopLength = value;
+                        claim();
+                    }
+                } else {
+                    if (type == META_END_OF_TRACK) endOfTrack = tick;
+                    if (!r.skip(len)) return false;
+                }
+                continue;
+            }
+            if (b == 0xF0 || b == 0xF7) {  // SysEx: skipped
+                uint32_t len;
+                if (!r.varint(len) || !r.skip(len)) return false;
+                runningStatus = 0;
+                continue;
+            }
+
+            uint8_t status = b, d1 = 0, d2 = 0;
+            if (b & 0x80) {
+                if (!r.byte(d1)) return false;
+                runningStatus = b;
+            } else {
+                if (!runningStatus) return false;  // Data byte without a status
+                status = runningStatus;
+                d1 = b;
+            }
+            uint8_t kind = status & 0xF0;
+            if (kind != 0xC0 && kind != 0xD0 && !r.byte(d2)) return false;
+
+            MidiEvent evt;
+            if (!fits || !decodeChannelEvent(status, d1 & 0x7F, d2 & 0x7F, tick, evt)) continue;
+            claim();
+            hasEvents = true;
+            if (!track->insertEvent(evt)) {
+                st.full = true;
+                fits = false;
+                continue;
+            }
+            lastTick = tick;
+        }
+        return true;
+    };
+    bool good = parse();
+
+    if (track && !hasEvents) {
+        st.nextTrack++;  // Exported empty track: stays empty
+    } else if (track) {
+        if (loopLength == 0) {
+            uint32_t endTick = std::max(endOfTrack, lastTick + 1);
+            loopLength = ((endTick + st.ticksPerBar - 1) / st.ticksPerBar) * st.ticksPerBar;
+        } else {
+            loopLength = (uint32_t)((uint64_t)loopLength * Config::INTERNAL_PPQN / st.division);
+        }
+        track->setLoopLength(loopLength);
+        track->forceSetState(TRACK_STOPPED);
+        StorageManager::journalTrackEvents(*track);
+        if (trackManager.getMasterLoopLength() == 0) trackManager.setMasterLoopLength(loopLength);
+        st.nextTrack++;
+    }
+    return good;
+}
+
+bool MidiFile::importSession(const char* path) {
+    File file = SD.open(path, FILE_READ);
+    if (!file) {
+        Serial.print("[MidiFile] ERROR: Could not open file for reading: ");
+        Serial.println(path);
+        return false;
+    }
+    SmfReader r(file);
+
+    ImportState st;
+    bool ok = true;
+    char id[4];
+    uint32_t length = 0;
+    uint16_t format = 0, tracks = 0;
+    auto readId = [&]() {
+        for (char& c : id) {
+            uint8_t b;
+            if (!r.byte(b)) return false;
+            c = (char)b;
+        }
+        return r.be32(length);
+    };
+    if (!readId() || memcmp(id, "MThd", 4) != 0 || length < 6 || !r.be16(format) || !r.be16(tracks) ||
+        !r.be16(st.division) || !r.skip(length - 6)) {
+        ok = false;
+    } else if (format > 1 || st.division == 0 || (st.division & 0x8000)) {
+        Serial.println("[MidiFile] ERROR: Only type 0/1 files with a PPQN division are supported");
+        ok = false;
+    }
+
+    uint16_t chunks = 0;
+    while (ok && chunks < tracks && readId()) {
+        if (memcmp(id, "MTrk", 4) == 0) {
+            ok = readTrackChunk(r, length, st);
+            chunks++;
+        } else {
+            ok = r.skip(length);  // Unknown chunk types are skipped
+        }
+    }
+    file.close();
+
+    if (!ok) {
+        Serial.print("[MidiFile] ERROR: Malformed MIDI file: ");
+        Serial.println(path);
+    }
+    if (st.full) Serial.println("[MidiFile] WARNING: Track full, remaining events dropped");
+    if (st.nextTrack >= Config::NUM_TRACKS && chunks < tracks) {
+        Serial.println("[MidiFile] WARNING: More MIDI tracks than looper tracks, extra ones skipped");
+    }
+    Serial.print("[MidiFile] Imported tracks: ");
+    Serial.println(st.nextTrack);
+    return ok;
+}
@@ -7,42 +7,358 @@
 #include "MidiHandler.h"
 #include "Logger.h"
 #include "MidiEvent.h"
+#include "MidiParser.h"
+#include "RingBuffer.h"
+#include "StressTest.h"
+#include <IntervalTimer.h>
+#include <USBHost_t36.h>
+#include <algorithm>
+
+// --- Input stage (filled by captureInput() at interrupt level) ---
+struct CapturedMessage {
+  uint8_t type, channel, data1, data2;  // SysEx: length in data1/data2, bytes in inputSysExQueue
+  uint8_t source;                       // InputSource
+  MidiInputStamp stamp;
+};
+static SpscRingBuffer<CapturedMessage, MidiConfig::INPUT_QUEUE_MESSAGES> inputQueue;  // Every source, arrival order
+static SpscRingBuffer<uint8_t, 1024> inputSysExQueue;  // Bytes of the SysEx messages in inputQueue
+
+// Per source; `queued` is written by the ISR only, `taken` by loop() only
+struct SourceCounters {
+  volatile uint32_t queued;
+  volatile uint32_t taken;
+  volatile uint32_t overflows;
+  volatile uint32_t stalls;
+  volatile uint16_t highWater;
+};
+static SourceCounters sourceCounters[NUM_INPUT_SOURCES];
+static uint8_t firstSource = 0;  // Round-robin start of the next capture pass
+static MidiParser dinParser;
+
+// Messages queued by the current capture pass: the thru forwards them at its end
+static constexpr uint8_t PASS_MESSAGES =
+    MidiConfig::INPUT_USB_BUDGET + MidiConfig::INPUT_DIN_BUDGET + MidiConfig::INPUT_HOST_BUDGET;
+static CapturedMessage passMessages[PASS_MESSAGES];
+static uint8_t passCount = 0;
+
+// Thru output held while another writer has the ports; pushed by the input ISR, drained by the writer
+struct ThruOutput {
+  MidiEvent event;
+  uint8_t dest;
+};
+static SpscRingBuffer<ThruOutput, MidiConfig::THRU_QUEUE_EVENTS> thruOutQueue;
+
+static USBHost usbHost;
+static USBHub usbHostHub(usbHost);
+static MIDIDevice_BigBuffer usbHostMidi(usbHost);
+
+// Clock master output held while a port is busy; pushed by the clock ISR, drained by the writer
+struct ClockOutput {
+  uint8_t type;
+  uint16_t songPosition;
+};
+static SpscRingBuffer<ClockOutput, Config::CLOCK_OUTPUT_QUEUE> clockOutQueue;
+static volatile uint32_t droppedSysEx = 0;               // Not a whole F0 ... F7 message
+static IntervalTimer inputTimer;
+
+/**
+ * MIDI library transport for the DIN output. Input is read by captureInput() with MidiParser, so
+ * the library reads nothing and runs no soft thru. Output goes straight to Serial8.
+ */
+class SerialOutputTransport {
+public:
+  static const bool thruActivated = false;
+
+  bool begin() {
+    Serial8.begin(31250);
+    return true;
+  }
+  bool beginTransmission(midi::MidiType) { return true; }
+  void write(byte value) { Serial8.write(value); }
+  void endTransmission() {}
+
+  unsigned available() { return 0; }
+  byte read() { return 0; }
+};
 
-MIDI_CREATE_INSTANCE(HardwareSerial, Serial8, MIDIserial);  // Teensy Serial8 for 5-pin DIN MIDI
+static SerialOutputTransport serialTransport;
+midi::MidiInterface<SerialOutputTransport> MIDIserial(serialTransport);  // Teensy Serial8 for 5-pin DIN MIDI
 
 MidiHandler midiHandler;  // Global instance
 
 MidiHandler::MidiHandler()
-  : outputUSB(true), outputSerial(true) {}
+  : outputUSB(true), outputSerial(true) {
+  thru[SOURCE_SERIAL] = ThruConfig{true, ROUTE_DIN, false, true};  // The DIN soft thru the looper always had
+  thru[SOURCE_USB_HOST] = ThruConfig{true, 0, true, false};        // Host port controllers play the selected track's synth
+  compileRoutes();
+}
 
 void MidiHandler::setup() {
   MIDIserial.begin(MidiConfig::CHANNEL_OMNI);  // Listen to all channels
+  // Room for a dense tick's worth of DIN output so batch writes do not block
+  static uint8_t serialTxBuffer[256];
+  Serial8.addMemoryForWrite(serialTxBuffer, sizeof(serialTxBuffer));
+  // DIN input waits in the serial buffer while the input queue has no room for it
+  static uint8_t serialRxBuffer[256];
+  Serial8.addMemoryForRead(serialRxBuffer, sizeof(serialRxBuffer));
+  if (MidiConfig::USB_HOST_INPUT) usbHost.begin();
+  // Below the clock timer's priority so tick timing is not disturbed
+  inputTimer.begin([] { midiHandler.captureInput(); }, MidiConfig::INPUT_CAPTURE_INTERVAL_US);
+  inputTimer.priority(160);
 }
 
-void MidiHandler::handleMidiInput() {
-  // --- USB MIDI Input ---
-  while (usbMIDI.read()) {
-    handleMidiMessage(
-      usbMIDI.getType(),
-      usbMIDI.getChannel(),
-      usbMIDI.getData1(),
-      usbMIDI.getData2(),
-      SOURCE_USB);
+// Interrupt level: room in the merged queue for one more message of the source
+static bool inputRoom(InputSource source) {
+  const SourceCounters& c = sourceCounters[source];
+  return c.queued - c.taken < MidiConfig::INPUT_SOURCE_SHARE && inputQueue.size() < inputQueue.capacity();
+}
+
+static void queueInput(InputSource source, uint8_t type, uint8_t channel, uint8_t data1, uint8_t data2,
+                       const MidiInputStamp& stamp) {
+  SourceCounters& c = sourceCounters[source];
+  if (!inputQueue.push({type, channel, data1, data2, (uint8_t)source, stamp})) {
+    c.overflows++;
+    return;
+  }
+  c.queued++;
+  uint32_t depth = c.queued - c.taken;
+  if (depth > c.highWater) c.highWater = (uint16_t)depth;
+  if (type != midi::SystemExclusive && passCount < PASS_MESSAGES) {
+    passMessages[passCount++] = {type, channel, data1, data2, (uint8_t)source, stamp};
+  }
+}
+
+// The bytes go next to the message; the port's buffer is reused by its next read
+static void queueSysEx(InputSource source, const uint8_t* bytes, uint16_t length, const MidiInputStamp& stamp) {
+  if (!bytes || length > Config::SYSEX_MAX_MESSAGE_BYTES ||
+      inputSysExQueue.capacity() - inputSysExQueue.size() < length) {
+    sourceCounters[source].overflows++;
+    return;
+  }
+  for (uint16_t i = 0; i < length; ++i) inputSysExQueue.push(bytes[i]);
+  queueInput(source, midi::SystemExclusive, 0, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8), stamp);
+}
+
+// usbMIDI and the USB host MIDIDevice share the reading API
+template <typename Port>
+static void capturePort(Port& port, InputSource source, uint8_t budget, const MidiInputStamp& stamp) {
+  for (uint8_t n = 0; n < budget; ++n) {
+    if (!inputRoom(source)) {
+      sourceCounters[source].stalls++;  // Left in the driver's buffer until loop() catches up
+      return;
+    }
+    if (!port.read()) return;
+    uint8_t type = port.getType();
+    if (type == midi::SystemExclusive) {
+      queueSysEx(source, port.getSysExArray(), port.getSysExArrayLength(), stamp);
+    } else {
+      queueInput(source, type, port.getChannel(), port.getData1(), port.getData2(), stamp);
+    }
+  }
+}
+
+static void captureSerial(const MidiInputStamp& stamp) {
+  for (uint8_t n = 0; n < MidiConfig::INPUT_DIN_BUDGET && Serial8.available() > 0;) {
+    if (!inputRoom(SOURCE_SERIAL)) {
+      sourceCounters[SOURCE_SERIAL].stalls++;
+      return;
+    }
+    MidiParser::Message m;
+    if (!dinParser.feed((uint8_t)Serial8.read(), m)) continue;
+    n++;
+    if (m.type == midi::SystemExclusive) {
+      queueSysEx(SOURCE_SERIAL, dinParser.sysExData(), dinParser.sysExLength(), stamp);
+    } else {
+      queueInput(SOURCE_SERIAL, m.type, m.channel, m.data1, m.data2, stamp);
+    }
+  }
+}
+
+// Runs in the input IntervalTimer ISR. Each source gives at most its budget per pass and the
+// first source rotates, so a flood on one port cannot starve the others; all of them go into one
+// queue in arrival order, stamped with the pass's time and clock position.
+// The USB drivers are not reentrant: USB is read only while the pass holds the ports, which every
+// other USB access holds too. When another writer has them, USB input waits for the next pass.
+void MidiHandler::captureInput() {
+  MidiInputStamp stamp;
+  stamp.micros = micros();
+  clockManager.getTickPosition(stamp.tick, stamp.tickFracQ16);
+  const bool usb = claimPort();
+
+  for (uint8_t i = 0; i < NUM_INPUT_SOURCES; ++i) {
+    uint8_t source = firstSource + i;
+    if (source >= NUM_INPUT_SOURCES) source -= NUM_INPUT_SOURCES;
+    switch (source) {
+      case SOURCE_USB:
+        if (usb) capturePort(usbMIDI, SOURCE_USB, MidiConfig::INPUT_USB_BUDGET, stamp);
+        break;
+      case SOURCE_SERIAL:
+        captureSerial(stamp);
+        break;
+      case SOURCE_USB_HOST:
+        if (usb && MidiConfig::USB_HOST_INPUT) capturePort(usbHostMidi, SOURCE_USB_HOST, MidiConfig::INPUT_HOST_BUDGET, stamp);
+        break;
+    }
+  }
+  if (usb) endPortWrite();
+  if (++firstSource >= NUM_INPUT_SOURCES) firstSource = 0;
+  if (passCount) forwardThru();
+}
+
+// A captured channel or real-time message as an event for the output stage; false for the rest
+static bool thruEvent(const CapturedMessage& m, MidiEvent& evt) {
+  switch (m.type) {
+    case midi::NoteOn:            evt = MidiEvent::NoteOn(0, m.channel, m.data1, m.data2); return true;
+    case midi::NoteOff:           evt = MidiEvent::NoteOff(0, m.channel, m.data1, m.data2); return true;
+    case midi::AfterTouchPoly:    evt = MidiEvent::PolyAftertouch(0, m.channel, m.data1, m.data2); return true;
+    case midi::ControlChange:     evt = MidiEvent::ControlChange(0, m.channel, m.data1, m.data2); return true;
+    case midi::ProgramChange:     evt = MidiEvent::ProgramChange(0, m.channel, m.data1); return true;
+    case midi::AfterTouchChannel: evt = MidiEvent::ChannelAftertouch(0, m.channel, m.data1); return true;
+    case midi::PitchBend:
+      evt = MidiEvent::PitchBend(0, m.channel, (int16_t)(((m.data2 << 7) | m.data1) - 8192));
+      return true;
+    case midi::SongPosition:      evt = MidiEvent::SongPosition(0, (uint16_t)(m.data1 | (m.data2 << 7))); return true;
+    case midi::Clock:             evt = MidiEvent::Clock(0); return true;
+    case midi::Start:             evt = MidiEvent::Start(0); return true;
+    case midi::Continue:          evt = MidiEvent::Continue(0); return true;
+    case midi::Stop:              evt = MidiEvent::Stop(0); return true;
+    default:                      return false;
   }
+}
 
-  // --- Serial MIDI Input (DIN) ---
-  while (MIDIserial.read()) {
-    handleMidiMessage(
-      MIDIserial.getType(),
-      MIDIserial.getChannel(),
-      MIDIserial.getData1(),
-      MIDIserial.getData2(),
-      SOURCE_SERIAL);
+// Input ISR, end of a capture pass: the pass's messages through each source's thru route, written
+// as one batch now, or held for the writer while another one has the ports
+void MidiHandler::forwardThru() {
+  MidiEvent events[PASS_MESSAGES];
+  uint8_t dest[PASS_MESSAGES];
+  uint8_t n = 0;
+  const RouteTables& tables = routing();  // One published set for the whole pass
+  const uint8_t selected = trackManager.getSelectedTrackIndex();
+  for (uint8_t i = 0; i < passCount; ++i) {
+    const CapturedMessage& m = passMessages[i];
+    RouteEntry entry = tables.thru[m.source];
+    if (entry.passKinds == 0) continue;
+    if (tables.thruFollows & (1u << m.source)) {
+      uint8_t kinds = entry.passKinds;
+      entry = tables.tracks[selected < Config::NUM_TRACKS ? selected : SYSTEM_ROUTE];
+      entry.passKinds &= kinds;
+    }
+    MidiEvent evt;
+    if (thruEvent(m, evt) && applyRoute(entry, evt, events[n], dest[n])) n++;
+  }
+  passCount = 0;
+  if (n == 0) return;
+  if (!claimPort()) {
+    for (uint8_t i = 0; i < n; ++i) {
+      if (thruOutQueue.push({events[i], dest[i]})) thruForwarded++;  // Full: counted as an overflow
+    }
+    return;
   }
+  writeRouted(events, dest, n);  // After the clock and thru output held earlier
+  thruForwarded += n;
+  endPortWrite();
 }
 
-void MidiHandler::handleMidiMessage(byte type, byte channel, byte data1, byte data2, InputSource source) {
-  uint32_t tickNow = clockManager.getCurrentTick();
+void MidiHandler::writeThruOutput() {
+  MidiEvent events[16];
+  uint8_t dest[16];
+  ThruOutput out;
+  uint8_t n = 0;
+  while (thruOutQueue.pop(out)) {
+    events[n] = out.event;
+    dest[n++] = out.dest;
+    if (n == 16) {
+      writeRouted(events, dest, n);
+      n = 0;
+    }
+  }
+  if (n) writeRouted(events, dest, n);
+}
+
+void MidiHandler::setThru(InputSource source, const ThruConfig& config) {
+  if (source >= NUM_INPUT_SOURCES) return;
+  thru[source] = config;
+  compileRoutes();
+}
+
+const ThruConfig& MidiHandler::getThru(InputSource source) const {
+  return thru[source < NUM_INPUT_SOURCES ? source : SOURCE_USB];
+}
+
+uint32_t MidiHandler::getThruOverflowCount() const {
+  return thruOutQueue.getOverflowCount();
+}
+
+uint32_t MidiHandler::getInputOverflowCount() const {
+  uint32_t n = droppedSysEx + dinParser.getDroppedSysEx();
+  for (const auto& c : sourceCounters) n += c.overflows;
+  return n;
+}
+
+uint32_t MidiHandler::getInputHighWaterMark() const {
+  return inputQueue.getHighWaterMark();
+}
+
+InputSourceStats MidiHandler::getInputStats(InputSource source) const {
+  InputSourceStats stats;
+  if (source >= NUM_INPUT_SOURCES) return stats;
+  const SourceCounters& c = sourceCounters[source];
+  stats.messages = c.queued;
+  stats.depth = c.queued - c.taken;
+  stats.highWater = c.highWater;
+  stats.overflows = c.overflows + (source == SOURCE_SERIAL ? dinParser.getDroppedSysEx() : 0);
+  stats.stalls = c.stalls;
+  return stats;
+}
+
+bool MidiHandler::takeInput(InputMessage& msg) {
+  static uint8_t sysex[Config::SYSEX_MAX_MESSAGE_BYTES];
+  CapturedMessage captured;
+  if (!inputQueue.pop(captured)) return false;
+  msg.type = captured.type;
+  msg.channel = captured.channel;
+  msg.data1 = captured.data1;
+  msg.data2 = captured.data2;
+  msg.source = (InputSource)captured.source;
+  msg.stamp = captured.stamp;
+  msg.sysex = nullptr;
+  msg.sysexLength = 0;
+  if (captured.type == midi::SystemExclusive) {
+    msg.sysexLength = captured.data1 | (captured.data2 << 8);
+    for (uint16_t i = 0; i < msg.sysexLength; ++i) inputSysExQueue.pop(sysex[i]);
+    msg.sysex = sysex;
+  }
+  sourceCounters[captured.source].taken++;
+  return true;
+}
+
+// Where held controller values go once the thinner releases them
+static void recordOnSelectedTrack(midi::MidiType type, uint8_t channel, uint8_t data1, uint8_t data2, uint32_t tick) {
+  trackManager.getSelectedTrack().recordMidiEvents(type, channel, data1, data2, tick);
+}
+
+void MidiHandler::handleMidiInput() {
+  if (MidiConfig::USB_HOST_INPUT) {
+    beginPortWrite();  // Device enumeration touches the host driver the capture ISR reads
+    usbHost.Task();
+    endPortWrite();
+  }
+  InputMessage msg;
+  while (takeInput(msg)) {
+    if (msg.type == midi::SystemExclusive) {
+      handleSysEx(msg.sysex, msg.sysexLength, msg.stamp);
+    } else {
+      handleMidiMessage(msg.type, msg.channel, msg.data1, msg.data2, msg.stamp);
+    }
+  }
+
+  // Held controller values whose lane went quiet
+  if (thinControllers) controllerThinner.flushIdle(clockManager.getCurrentTick(), recordOnSelectedTrack);
+}
+
+void MidiHandler::handleMidiMessage(byte type, byte channel, byte data1, byte data2, const MidiInputStamp& stamp) {
+  // Record at the tick the message arrived, not when loop() got to it
+  uint32_t tickNow = stamp.nearestTick();
 
   switch (type) {
     case midi::NoteOn:
@@ -68,12 +384,16 @@ void MidiHandler::handleMidiMessage(byte type, byte channel, byte data1, byte da
       handleAfterTouch(channel, data1, tickNow);
       break;
 
+    case midi::AfterTouchPoly:
+      handlePolyAfterTouch(channel, data1, data2, tickNow);
+      break;
+
     case midi::ProgramChange:
       handleProgramChange(channel, data1, tickNow);
       break;
 
     case midi::Clock:
-      clockManager.onMidiClockPulse();
+      clockManager.onMidiClockPulse(stamp.micros);
       break;
 
     case midi::Start:
@@ -88,11 +408,24 @@ void MidiHandler::handleMidiMessage(byte type, byte channel, byte data1, byte da
       handleMidiContinue();
       break;
 
+    case midi::SongPosition:
+      clockManager.onSongPosition((uint16_t)(data1 | (data2 << 7)));  // 14-bit count of 16ths
+      break;
+
     default:
       break;  // Ignore unsupported messages
   }
 }
 
+// Only whole messages are recorded: a truncated or split one cannot be played back as sent
+void MidiHandler::handleSysEx(const uint8_t* data, uint16_t length, const MidiInputStamp& stamp) {
+  if (!data || length < 2 || data[0] != 0xF0 || data[length - 1] != 0xF7) {
+    droppedSysEx++;
+    return;
+  }
+  trackManager.getSelectedTrack().recordSysEx(data, length, stamp.nearestTick());
+}
+
 // --- Individual Message Handlers ---
 void MidiHandler::handleNoteOn(byte channel, byte note, byte velocity, uint32_t tickNow) {
   trackManager.getSelectedTrack().noteOn(channel, note, velocity, tickNow);
@@ -103,15 +436,35 @@ void MidiHandler::handleNoteOff(byte channel, byte note, byte velocity, uint32_t
 }
 
 void MidiHandler::handleControlChange(byte channel, byte control, byte value, uint32_t tickNow) {
-  trackManager.getSelectedTrack().recordMidiEvents(midi::ControlChange, channel, control, value, tickNow);
+  recordController(midi::ControlChange, channel, control, value, tickNow);
 }
 
 void MidiHandler::handlePitchBend(byte channel, int pitchValue, uint32_t tickNow) {
-  // Not yet implemented
+  recordController(midi::PitchBend, channel, pitchValue & 0x7F, (pitchValue >> 7) & 0x7F, tickNow);
 }
 
 void MidiHandler::handleAfterTouch(byte channel, byte pressure, uint32_t tickNow) {
-  // Not yet implemented
+  recordController(midi::AfterTouchChannel, channel, pressure, 0, tickNow);
+}
+
+void MidiHandler::handlePolyAfterTouch(byte channel, byte note, byte pressure, uint32_t tickNow) {
+  recordController(midi::AfterTouchPoly, channel, note, pressure, tickNow);
+}
+
+// Controller messages reach the track through the thinning stage
+void MidiHandler::recordController(midi::MidiType type, byte channel, byte data1, byte data2, uint32_t tickNow) {
+  Track& track = trackManager.getSelectedTrack();
+  if (!track.isRecording() && !track.isOverdubbing()) {
+    controllerThinner.reset();  // The next take starts without history
+    return;
+  }
+  if (thinControllers && !controllerThinner.accept(type, channel, data1, data2, tickNow, recordOnSelectedTrack)) return;
+  track.recordMidiEvents(type, channel, data1, data2, tickNow);
+}
+
+void MidiHandler::setControllerThinning(bool enable) {
+  thinControllers = enable;
+  controllerThinner.reset();
 }
 
 void MidiHandler::handleProgramChange(byte channel, byte program, uint32_t tickNow) {
@@ -123,79 +476,176 @@ void MidiHandler::handleMidiStart() {
 }
 
 void MidiHandler::handleMidiStop() {
-  // broadcast All-Notes-Off on every track
-  for (size_t i = 0; i < trackManager.getTrackCount(); ++i) {
-    Track &t = trackManager.getTrack(i);
-    t.sendAllNotesOff();
-    t.stopPlaying();  // update LCD state to STOPPED if desired
-  }
+  // All-Notes-Off and stop on every track; Continue restarts the ones that were playing
+  trackManager.pauseForTransport();
   clockManager.onMidiStop();
 }
 
 void MidiHandler::handleMidiContinue() {
-  clockManager.setExternalClockPresent(true);
-  clockManager.setLastMidiClockTime(micros());
+  clockManager.onMidiContinue();
 }
 
 // --- MIDI Output ---
+static bool isChannelMessage(midi::MidiType type) {
+    return type >= midi::NoteOff && type <= midi::PitchBend;
+}
+
+// Kind bit for RouteEntry::passKinds: the status high nibble for channel messages, 7 otherwise
+static uint8_t kindBit(midi::MidiType type) {
+    return (uint8_t)(1u << (isChannelMessage(type) ? ((uint8_t)type >> 4) & 7 : 7));
+}
+
 void MidiHandler::sendMidiEvent(const MidiEvent& event) {
-    // Route and send the event to both USB and Serial as appropriate
+    enqueue(routing().tracks[SYSTEM_ROUTE], event);
+}
+
+void MidiHandler::sendTrackEvent(uint8_t trackIndex, const MidiEvent& event) {
+    enqueue(routing().tracks[trackIndex < Config::NUM_TRACKS ? trackIndex : SYSTEM_ROUTE], event);
+}
+
+void MidiHandler::sendTrackSysEx(uint8_t trackIndex, const uint8_t* data, uint16_t length) {
+    const RouteEntry& entry = routing().tracks[trackIndex < Config::NUM_TRACKS ? trackIndex : SYSTEM_ROUTE];
+    if (!(entry.passKinds & kindBit(midi::SystemExclusive))) return;
+    flushOutput();  // Keep wire order with the events already batched
+    beginPortWrite();
+    if (entry.dest & ROUTE_USB) {
+        usbMIDI.sendSysEx(length, data, true, entry.dest >> 4);
+        usbMIDI.send_now();
+    }
+    if (entry.dest & ROUTE_DIN) {
+        MIDIserial.sendSysEx(length, data, true);
+        serialRunningStatus = 0;
+        lastSerialOutputMs = millis();
+    }
+    endPortWrite();
+}
+
+bool MidiHandler::route(const RouteEntry& entry, const MidiEvent& event, MidiEvent& routed, uint8_t& dest) const {
+    STRESS_TAP_OUTPUT(event);  // As played, before routing
+    return applyRoute(entry, event, routed, dest);
+}
+
+bool MidiHandler::applyRoute(const RouteEntry& entry, const MidiEvent& event, MidiEvent& routed, uint8_t& dest) const {
+    if (!(entry.passKinds & kindBit(event.type)) || !(entry.dest & (ROUTE_USB | ROUTE_DIN))) return false;
+    routed = event;
+    if (entry.channel && isChannelMessage(event.type)) routed.channel = entry.channel;
+    dest = entry.dest;
+    return true;
+}
+
+bool MidiHandler::routeTrackEvent(uint8_t trackIndex, const MidiEvent& event, MidiEvent& routed, uint8_t& dest) {
+    return route(routing().tracks[trackIndex < Config::NUM_TRACKS ? trackIndex : SYSTEM_ROUTE], event, routed, dest);
+}
+
+void MidiHandler::enqueue(const RouteEntry& entry, const MidiEvent& event) {
+    MidiEvent routed;
+    uint8_t dest;
+    if (route(entry, event, routed, dest)) sendRouted(routed, dest);
+}
+
+// Queue a routed event for the current batch; outside a batch it is sent at once
+void MidiHandler::sendRouted(const MidiEvent& routed, uint8_t dest) {
+    if (outBatchCount >= OUTPUT_BATCH_SIZE) flushOutput();
+    outBatch[outBatchCount] = routed;
+    outDest[outBatchCount++] = dest;
+    if (batchDepth == 0) flushOutput();
+}
+
+void MidiHandler::beginOutputBatch() {
+    batchDepth++;
+}
+
+void MidiHandler::endOutputBatch() {
+    if (batchDepth > 0 && --batchDepth == 0) flushOutput();
+}
+
+void MidiHandler::flushOutput() {
+    if (outBatchCount == 0) return;
+    writeRouted(outBatch, outDest, outBatchCount);
+    outBatchCount = 0;
+}
+
+void MidiHandler::writeRouted(const MidiEvent* events, const uint8_t* dest, uint8_t count) {
+    beginPortWrite();
+    uint8_t ports = 0;
+    for (uint8_t i = 0; i < count; ++i) ports |= dest[i];
+
+    if (ports & ROUTE_USB) {
+        for (uint8_t i = 0; i < count; ++i) {
+            if (dest[i] & ROUTE_USB) sendUsb(events[i], dest[i] >> 4);
+        }
+        usbMIDI.send_now();
+    }
+
+    if (ports & ROUTE_DIN) {
+        uint32_t nowMs = millis();
+        if (nowMs - lastSerialOutputMs > MidiConfig::RUNNING_STATUS_REFRESH_MS) serialRunningStatus = 0;
+        uint8_t bytes[OUTPUT_BATCH_SIZE * 3];
+        size_t len = 0;
+        for (uint8_t i = 0; i < count; ++i) {
+            if (!(dest[i] & ROUTE_DIN)) continue;
+            if (isChannelMessage(events[i].type)) {
+                len += encodeSerialChannelMessage(events[i], bytes + len);
+            } else {
+                // Keep wire order: write what is gathered before the library sends this one
+                if (len) Serial8.write(bytes, len);
+                len = 0;
+                sendSerialNonChannel(events[i]);
+            }
+        }
+        if (len) Serial8.write(bytes, len);
+        lastSerialOutputMs = nowMs;
+    }
+    endPortWrite();
+}
+
+// Channel messages as USB-MIDI packets; the flush sends them with one send_now()
+void MidiHandler::sendUsb(const MidiEvent& event, uint8_t cable) {
     switch (event.type) {
         case midi::NoteOn:
-            if (outputUSB) usbMIDI.sendNoteOn(event.data.noteData.note, event.data.noteData.velocity, event.channel);
-            if (outputSerial) MIDIserial.sendNoteOn(event.data.noteData.note, event.data.noteData.velocity, event.channel);
-            break;
         case midi::NoteOff:
-            if (outputUSB) usbMIDI.sendNoteOff(event.data.noteData.note, event.data.noteData.velocity, event.channel);
-            if (outputSerial) MIDIserial.sendNoteOff(event.data.noteData.note, event.data.noteData.velocity, event.channel);
+            usbMIDI.send(event.type, event.data.noteData.note, event.data.noteData.velocity, event.channel, cable);
             break;
         case midi::ControlChange:
-            if (outputUSB) usbMIDI.sendControlChange(event.data.ccData.cc, event.data.ccData.value, event.channel);
-            if (outputSerial) MIDIserial.sendControlChange(event.data.ccData.cc, event.data.ccData.value, event.channel);
+            usbMIDI.send(event.type, event.data.ccData.cc, event.data.ccData.value, event.channel, cable);
+            break;
+        case midi::PitchBend: {
+            uint16_t bend = (uint16_t)(event.data.pitchBend + 8192);
+            usbMIDI.send(event.type, bend & 0x7F, (bend >> 7) & 0x7F, event.channel, cable);
             break;
-        case midi::PitchBend:
-            if (outputUSB) usbMIDI.sendPitchBend(event.data.pitchBend, event.channel);
-            if (outputSerial) MIDIserial.sendPitchBend(event.data.pitchBend, event.channel);
+        }
+        case midi::AfterTouchPoly:
+            usbMIDI.send(event.type, event.data.polyATData.note, event.data.polyATData.pressure, event.channel, cable);
             break;
         case midi::AfterTouchChannel:
-            if (outputUSB) usbMIDI.sendAfterTouch(event.data.channelPressure, event.channel);
-            if (outputSerial) MIDIserial.sendAfterTouch(event.data.channelPressure, event.channel);
+            usbMIDI.send(event.type, event.data.channelPressure, 0, event.channel, cable);
             break;
         case midi::ProgramChange:
-            if (outputUSB) usbMIDI.sendProgramChange(event.data.program, event.channel);
-            if (outputSerial) MIDIserial.sendProgramChange(event.data.program, event.channel);
+            usbMIDI.send(event.type, event.data.program, 0, event.channel, cable);
             break;
         case midi::SystemExclusive:
-            if (outputUSB) usbMIDI.sendSysEx(event.data.sysexData.length, event.data.sysexData.data, true);
-            if (outputSerial) MIDIserial.sendSysEx(event.data.sysexData.length, event.data.sysexData.data, true);
+            // Sent from the track's SysEx store by sendTrackSysEx(), never batched
             break;
         case midi::TimeCodeQuarterFrame:
-            if (outputUSB) usbMIDI.sendRealTime(midi::MidiType::TimeCodeQuarterFrame);
-            if (outputSerial) MIDIserial.sendRealTime(midi::MidiType::TimeCodeQuarterFrame);
+            usbMIDI.sendRealTime(midi::MidiType::TimeCodeQuarterFrame, cable);
             break;
         case midi::SongPosition:
-            if (outputUSB) usbMIDI.sendSongPosition(event.data.songPosition);
-            if (outputSerial) MIDIserial.sendSongPosition(event.data.songPosition);
+            usbMIDI.sendSongPosition(event.data.songPosition, cable);
             break;
         case midi::SongSelect:
-            if (outputUSB) usbMIDI.sendSongSelect(event.data.songNumber);
-            if (outputSerial) MIDIserial.sendSongSelect(event.data.songNumber);
+            usbMIDI.sendSongSelect(event.data.songNumber, cable);
             break;
         case midi::Clock:
-            if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Clock);
-            if (outputSerial) MIDIserial.sendRealTime(midi::Clock);
+            usbMIDI.sendRealTime(usbMIDI.Clock, cable);
             break;
         case midi::Start:
-            if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Start);
-            if (outputSerial) MIDIserial.sendRealTime(midi::Start);
+            usbMIDI.sendRealTime(usbMIDI.Start, cable);
             break;
         case midi::Stop:
-            if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Stop);
-            if (outputSerial) MIDIserial.sendRealTime(midi::Stop);
+            usbMIDI.sendRealTime(usbMIDI.Stop, cable);
             break;
         case midi::Continue:
-            if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Continue);
-            if (outputSerial) MIDIserial.sendRealTime(midi::Continue);
+            usbMIDI.sendRealTime(usbMIDI.Continue, cable);
             break;
         default:
             // Unsupported or unhandled event type
@@ -203,6 +653,77 @@ void MidiHandler::sendMidiEvent(const MidiEvent& event) {
     }
 }
 
+// Raw DIN bytes for a channel message, omitting the status byte when running status allows
+size_t MidiHandler::encodeSerialChannelMessage(const MidiEvent& event, uint8_t* out) {
+    uint8_t status = (uint8_t)event.type | ((event.channel - 1) & 0x0F);
+    size_t n = 0;
+    if (!MidiConfig::SERIAL_RUNNING_STATUS || status != serialRunningStatus) out[n++] = status;
+    serialRunningStatus = status;
+    switch (event.type) {
+        case midi::NoteOn:
+        case midi::NoteOff:
+            out[n++] = event.data.noteData.note & 0x7F;
+            out[n++] = event.data.noteData.velocity & 0x7F;
+            break;
+        case midi::ControlChange:
+            out[n++] = event.data.ccData.cc & 0x7F;
+            out[n++] = event.data.ccData.value & 0x7F;
+            break;
+        case midi::PitchBend: {
+            uint16_t bend = (uint16_t)(event.data.pitchBend + 8192);
+            out[n++] = bend & 0x7F;
+            out[n++] = (bend >> 7) & 0x7F;
+            break;
+        }
+        case midi::AfterTouchChannel:
+            out[n++] = event.data.channelPressure & 0x7F;
+            break;
+        case midi::ProgramChange:
+            out[n++] = event.data.program & 0x7F;
+            break;
+        case midi::AfterTouchPoly:
+            out[n++] = event.data.polyATData.note & 0x7F;
+            out[n++] = event.data.polyATData.pressure & 0x7F;
+            break;
+        default:
+            break;
+    }
+    return n;
+}
+
+// System messages go through the MIDI library; system common ends running status
+void MidiHandler::sendSerialNonChannel(const MidiEvent& event) {
+    switch (event.type) {
+        case midi::TimeCodeQuarterFrame:
+            MIDIserial.sendRealTime(midi::MidiType::TimeCodeQuarterFrame);
+            serialRunningStatus = 0;
+            break;
+        case midi::SongPosition:
+            MIDIserial.sendSongPosition(event.data.songPosition);
+            serialRunningStatus = 0;
+            break;
+        case midi::SongSelect:
+            MIDIserial.sendSongSelect(event.data.songNumber);
+            serialRunningStatus = 0;
+            break;
+        case midi::Clock:
+            MIDIserial.sendRealTime(midi::Clock);
+            break;
+        case midi::Start:
+            MIDIserial.sendRealTime(midi::Start);
+            break;
+        case midi::Stop:
+            MIDIserial.sendRealTime(midi::Stop);
+            break;
+        case midi::Continue:
+            MIDIserial.sendRealTime(midi::Continue);
+            break;
+        default:
+            // SysEx goes through sendTrackSysEx(); other types are unsupported
+            break;
+    }
+}
+
 // For immediate output, tick is set to 0 because the event is sent right now and the value is no used in the function
 void MidiHandler::sendNoteOn(uint8_t channel, uint8_t note, uint8_t velocity) {
     sendMidiEvent(MidiEvent::NoteOn(0, channel, note, velocity));
@@ -230,30 +751,161 @@ void MidiHandler::sendProgramChange(uint8_t channel, uint8_t program) {
 
 // --- Clock / Transport Output ---
 void MidiHandler::sendClock() {
-  if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Clock);
-  if (outputSerial) MIDIserial.sendRealTime(midi::Clock);
+  beginPortWrite();
+  writeSystemRealTime(midi::Clock, 0);
+  endPortWrite();
 }
 
 void MidiHandler::sendStart() {
-  if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Start);
-  if (outputSerial) MIDIserial.sendRealTime(midi::Start);
+  beginPortWrite();
+  writeSystemRealTime(midi::Start, 0);
+  endPortWrite();
 }
 
 void MidiHandler::sendStop() {
-  if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Stop);
-  if (outputSerial) MIDIserial.sendRealTime(midi::Stop);
+  beginPortWrite();
+  writeSystemRealTime(midi::Stop, 0);
+  endPortWrite();
 }
 
 void MidiHandler::sendContinueMIDI() {
-  if (outputUSB) usbMIDI.sendRealTime(usbMIDI.Continue);
-  if (outputSerial) MIDIserial.sendRealTime(midi::Continue);
+  beginPortWrite();
+  writeSystemRealTime(midi::Continue, 0);
+  endPortWrite();
+}
+
+void MidiHandler::sendSongPosition(uint16_t sixteenths) {
+  beginPortWrite();
+  writeSystemRealTime(midi::SongPosition, sixteenths);
+  endPortWrite();
+}
+
+// Runs in the clock timer ISR. A writer holding the port drains the queue before its own data.
+void MidiHandler::queueClockOutput(midi::MidiType type, uint16_t songPosition) {
+  if (!clockOutQueue.push({(uint8_t)type, songPosition})) return;  // Counted as an overflow
+  if (claimPort()) endPortWrite();  // Claiming writes the queue
+}
+
+void MidiHandler::flushClockOutput() {
+  if (clockOutQueue.empty()) return;
+  beginPortWrite();
+  endPortWrite();
+}
+
+uint32_t MidiHandler::getClockOutputOverflowCount() const {
+  return clockOutQueue.getOverflowCount();
+}
+
+void MidiHandler::beginPortWrite() {
+  noInterrupts();
+  uint8_t depth = ++outputBusy;
+  interrupts();
+  if (depth == 1) {
+    writeClockOutput();
+    writeThruOutput();
+  }
+}
+
+// Interrupt level: the test and the claim are one step, so two writers never both take the port
+bool MidiHandler::claimPort() {
+  noInterrupts();
+  bool claimed = outputBusy == 0;
+  if (claimed) outputBusy = 1;
+  interrupts();
+  if (claimed) {
+    writeClockOutput();
+    writeThruOutput();
+  }
+  return claimed;
+}
+
+// Clock and thru queued while this writer held the port go out before the port is released; the
+// port is only let go with both queues found empty, so nothing queued meanwhile is left waiting
+void MidiHandler::endPortWrite() {
+  if (outputBusy > 1) {
+    outputBusy--;  // Nested: only the holder changes a held count
+    return;
+  }
+  for (;;) {
+    writeClockOutput();
+    writeThruOutput();
+    noInterrupts();
+    bool held = !clockOutQueue.empty() || !thruOutQueue.empty();
+    if (!held) outputBusy = 0;
+    interrupts();
+    if (!held) return;
+  }
+}
+
+void MidiHandler::writeClockOutput() {
+  ClockOutput out;
+  while (clockOutQueue.pop(out)) writeSystemRealTime(out.type, out.songPosition);
+}
+
+// Clock and transport through the system route, sent on USB at once
+void MidiHandler::writeSystemRealTime(uint8_t type, uint16_t songPosition) {
+  uint8_t dest = routing().tracks[SYSTEM_ROUTE].dest;
+  if (dest & ROUTE_USB) {
+    if (type == midi::SongPosition) usbMIDI.sendSongPosition(songPosition, dest >> 4);
+    else usbMIDI.sendRealTime(type, dest >> 4);
+    usbMIDI.send_now();
+  }
+  if (dest & ROUTE_DIN) {
+    if (type == midi::SongPosition) {
+      MIDIserial.sendSongPosition(songPosition);
+      serialRunningStatus = 0;  // System common cancels running status; real-time does not
+    } else {
+      MIDIserial.sendRealTime((midi::MidiType)type);
+    }
+  }
+  if (type == midi::Clock) clockManager.onClockOutput(micros());
 }
 
 // --- Output Routing ---
 void MidiHandler::setOutputUSB(bool enable) {
   outputUSB = enable;
+  compileRoutes();
 }
 
 void MidiHandler::setOutputSerial(bool enable) {
   outputSerial = enable;
+  compileRoutes();
+}
+
+void MidiHandler::setTrackRoute(uint8_t trackIndex, const TrackRoute& route) {
+  if (trackIndex >= Config::NUM_TRACKS) return;
+  routes[trackIndex] = route;
+  compileRoutes();
+}
+
+const TrackRoute& MidiHandler::getTrackRoute(uint8_t trackIndex) const {
+  return routes[trackIndex < Config::NUM_TRACKS ? trackIndex : 0];
+}
+
+// Fold each route and the global switches into the entries the send paths read. The tables are
+// built in the copy no one reads and published with one index store, so an ISR never sees an
+// entry half rewritten.
+void MidiHandler::compileRoutes() {
+  RouteTables& next = routeTables[activeRoutes ^ 1];
+  const uint8_t enabled = (outputUSB ? ROUTE_USB : 0) | (outputSerial ? ROUTE_DIN : 0);
+  for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+    const TrackRoute& r = routes[t];
+    RouteEntry& e = next.tracks[t];
+    e.dest = (uint8_t)((r.ports & enabled) | ((r.usbCable & 0x0F) << 4));
+    e.channel = (r.channel >= 1 && r.channel <= 16) ? r.channel : 0;
+    // FILTER_NOTES covers kinds 0 and 1 (NoteOff, NoteOn); each later filter bit is one kind
+    uint8_t blocked = (r.filter & FILTER_NOTES) ? 0x03 : 0;
+    blocked |= (uint8_t)((r.filter & ~FILTER_NOTES) << 1);
+    e.passKinds = (uint8_t)~blocked | 0x80;
+  }
+  next.tracks[SYSTEM_ROUTE] = RouteEntry{enabled, 0, 0xFF};
+  // Thru: channel messages, plus system real-time when asked; passKinds 0 = off
+  next.thruFollows = 0;
+  for (uint8_t s = 0; s < NUM_INPUT_SOURCES; ++s) {
+    const ThruConfig& t = thru[s];
+    next.thru[s] = RouteEntry{(uint8_t)(t.ports & enabled), 0,
+                              (uint8_t)(t.enabled ? (t.realTime ? 0xFF : 0x7F) : 0)};
+    if (t.followSelectedTrack) next.thruFollows |= (uint8_t)(1u << s);
+  }
+  activeRoutes ^= 1;
 }
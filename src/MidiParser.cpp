@@ -0,0 +1,88 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "MidiParser.h"
+
+void MidiParser::reset() {
+  status = 0;
+  needed = 0;
+  have = 0;
+  inSysEx = false;
+  sysexOverflow = false;
+  sysexLength = 0;
+}
+
+bool MidiParser::feed(uint8_t byte, Message& msg) {
+  if (byte >= 0xF8) {
+    // Real-time: may come between any two bytes
+    msg = {byte, 0, 0, 0};
+    return true;
+  }
+
+  if (byte < 0x80) {
+    if (inSysEx) {
+      if (sysexLength < Config::SYSEX_MAX_MESSAGE_BYTES - 1) sysex[sysexLength++] = byte;  // Room for F7
+      else sysexOverflow = true;
+      return false;
+    }
+    if (status == 0) return false;  // No status to apply it to
+    data[have++] = byte;
+    if (have < needed) return false;
+    have = 0;
+    if (status < 0xF0) {
+      msg = {(uint8_t)(status & 0xF0), (uint8_t)((status & 0x0F) + 1), data[0], needed > 1 ? data[1] : (uint8_t)0};
+    } else {
+      msg = {status, 0, data[0], needed > 1 ? data[1] : (uint8_t)0};
+      status = 0;  // System common: no running status
+    }
+    return true;
+  }
+
+  if (byte == 0xF7) {
+    if (!inSysEx) return false;
+    inSysEx = false;
+    if (sysexOverflow) {
+      droppedSysEx++;
+      return false;
+    }
+    sysex[sysexLength++] = byte;
+    msg = {0xF0, 0, 0, 0};  // midi::SystemExclusive
+    return true;
+  }
+
+  // Any other status ends an unfinished SysEx
+  if (inSysEx) {
+    inSysEx = false;
+    droppedSysEx++;
+  }
+  have = 0;
+  if (byte < 0xF0) {
+    status = byte;
+    uint8_t kind = byte & 0xF0;
+    needed = (kind == 0xC0 || kind == 0xD0) ? 1 : 2;
+    return false;
+  }
+  status = 0;
+  switch (byte) {
+    case 0xF0:
+      inSysEx = true;
+      sysexOverflow = false;
+      sysexLength = 0;
+      sysex[sysexLength++] = byte;
+      return false;
+    case 0xF1:  // Time code quarter frame
+    case 0xF3:  // Song select
+      status = byte;
+      needed = 1;
+      return false;
+    case 0xF2:  // Song position
+      status = byte;
+      needed = 2;
+      return false;
+    case 0xF6:  // Tune request
+      msg = {byte, 0, 0, 0};
+      return true;
+    default:    // F4, F5 undefined
+      return false;
+  }
+}
@@ -0,0 +1,137 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "NoteLanes.h"
+#include <algorithm>
+
+// Does [start, end) overlap [qs, qe), directly or with either one shifted by a loop?
+static bool hits(uint32_t start, uint32_t end, uint32_t qs, uint32_t qe, uint32_t loopLength) {
+    return (start < qe && qs < end) || (start + loopLength < qe) || (qs + loopLength < end);
+}
+
+uint32_t NoteLanes::lengthOf(uint32_t startTick, uint32_t endTick, uint32_t loopLength) {
+    return endTick >= startTick ? endTick - startTick : (loopLength - startTick) + endTick;
+}
+
+bool NoteLanes::overlaps(uint32_t start1, uint32_t end1, uint32_t start2, uint32_t end2, uint32_t loopLength) {
+    if (loopLength == 0) return false;
+    uint32_t s1 = start1 % loopLength;
+    uint32_t s2 = start2 % loopLength;
+    return hits(s2, s2 + lengthOf(start2, end2, loopLength), s1, s1 + lengthOf(start1, end1, loopLength), loopLength);
+}
+
+NoteLanes::Entry NoteLanes::entryFor(const DisplayNote& note) const {
+    uint32_t start = loopLengthTicks ? note.startTick % loopLengthTicks : note.startTick;
+    return Entry{start, start + lengthOf(note.startTick, note.endTick, loopLengthTicks), note};
+}
+
+void NoteLanes::rebuild(const std::vector<DisplayNote>& notes, uint32_t loopLength, uint32_t generation) {
+    for (auto& lane : lanes) {
+        lane.entries.clear();
+        lane.unordered = 0;
+    }
+    loopLengthTicks = loopLength;
+    for (const auto& dn : notes) lanes[dn.note & 0x7F].entries.push_back(entryFor(dn));
+    for (auto& lane : lanes) {
+        std::stable_sort(lane.entries.begin(), lane.entries.end(),
+                         [](const Entry& a, const Entry& b) { return a.start < b.start; });
+        for (size_t i = 1; i < lane.entries.size(); ++i) lane.unordered += brokenPair(lane, i);
+    }
+    eventsGeneration = generation;
+    built = true;
+}
+
+void NoteLanes::clear() {
+    for (auto& lane : lanes) {
+        std::vector<Entry>().swap(lane.entries);
+        lane.unordered = 0;
+    }
+    built = false;
+}
+
+// Pair (second - 1, second) has its ends out of start order
+bool NoteLanes::brokenPair(const Lane& lane, size_t second) {
+    return second > 0 && second < lane.entries.size() && lane.entries[second - 1].end > lane.entries[second].end;
+}
+
+// Add (sign 1) or remove (sign -1) the two pairs around index from the lane's count
+void NoteLanes::countPairs(Lane& lane, size_t index, int sign) {
+    lane.unordered += sign * (int)(brokenPair(lane, index) + brokenPair(lane, index + 1));
+}
+
+size_t NoteLanes::lowerBound(const Lane& lane, uint32_t start) const {
+    return std::lower_bound(lane.entries.begin(), lane.entries.end(), start,
+                            [](const Entry& e, uint32_t s) { return e.start < s; }) - lane.entries.begin();
+}
+
+int NoteLanes::indexOf(const Lane& lane, uint32_t startTick) const {
+    uint32_t start = loopLengthTicks ? startTick % loopLengthTicks : startTick;
+    for (size_t i = lowerBound(lane, start); i < lane.entries.size() && lane.entries[i].start == start; ++i) {
+        if (lane.entries[i].note.startTick == startTick) return (int)i;
+    }
+    return -1;
+}
+
+void NoteLanes::insert(const DisplayNote& note) {
+    Lane& lane = lanes[note.note & 0x7F];
+    Entry e = entryFor(note);
+    size_t i = std::upper_bound(lane.entries.begin(), lane.entries.end(), e.start,
+                                [](uint32_t s, const Entry& x) { return s < x.start; }) - lane.entries.begin();
+    lane.unordered -= brokenPair(lane, i);
+    lane.entries.insert(lane.entries.begin() + i, e);
+    countPairs(lane, i, 1);
+}
+
+bool NoteLanes::remove(uint8_t pitch, uint32_t startTick) {
+    Lane& lane = lanes[pitch & 0x7F];
+    int i = indexOf(lane, startTick);
+    if (i < 0) return false;
+    countPairs(lane, i, -1);
+    lane.entries.erase(lane.entries.begin() + i);
+    lane.unordered += brokenPair(lane, i);
+    return true;
+}
+
+bool NoteLanes::setEnd(uint8_t pitch, uint32_t startTick, uint32_t endTick) {
+    Lane& lane = lanes[pitch & 0x7F];
+    int i = indexOf(lane, startTick);
+    if (i < 0) return false;
+    countPairs(lane, i, -1);
+    Entry& e = lane.entries[i];
+    e.note.endTick = endTick;
+    e.end = e.start + lengthOf(startTick, endTick, loopLengthTicks);
+    countPairs(lane, i, 1);
+    return true;
+}
+
+const NoteLanes::DisplayNote* NoteLanes::find(uint8_t pitch, uint32_t startTick) const {
+    const Lane& lane = lanes[pitch & 0x7F];
+    int i = indexOf(lane, startTick);
+    return i < 0 ? nullptr : &lane.entries[i].note;
+}
+
+void NoteLanes::overlapping(uint8_t pitch, uint32_t startTick, uint32_t endTick, std::vector<DisplayNote>& out) const {
+    const Lane& lane = lanes[pitch & 0x7F];
+    const auto& entries = lane.entries;
+    const uint32_t L = loopLengthTicks;
+    if (L == 0 || entries.empty()) return;
+    uint32_t qs = startTick % L;
+    uint32_t qe = qs + lengthOf(startTick, endTick, L);
+
+    if (lane.unordered) {
+        for (const auto& e : entries) {
+            if (hits(e.start, e.end, qs, qe, L)) out.push_back(e.note);
+        }
+        return;
+    }
+
+    // Ends are in start order: the direct overlaps are one contiguous run
+    size_t first = std::partition_point(entries.begin(), entries.end(),
+                                        [&](const Entry& e) { return e.end <= qs; }) - entries.begin();
+    size_t last = first;
+    while (last < entries.size() && entries[last].start < qe) out.push_back(entries[last++].note);
+    // Query running past the loop end: notes at the loop start
+    for (size_t i = 0; i < first && entries[i].start + L < qe; ++i) out.push_back(entries[i].note);
+    // Notes running past the loop end into the query
+    for (size_t i = entries.size(); i > last && qs + L < entries[i - 1].end; --i) out.push_back(entries[i - 1].note);
+}
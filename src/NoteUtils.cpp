@@ -2,10 +2,30 @@
 //  Licensed under the PolyForm Noncommercial 1.0.0
 
 #include "NoteUtils.h"
+#include "Profiler.h"
 
-std::vector<NoteUtils::DisplayNote> NoteUtils::reconstructNotes(const std::vector<MidiEvent>& midiEvents, uint32_t loopLength) {
-    using DisplayNote = NoteUtils::DisplayNote;
+uint32_t NoteUtils::wrapPosition(int32_t position, uint32_t loopLength) {
+    if (position < 0) {
+        position = (int32_t)loopLength + position;
+        while (position < 0) {
+            position += (int32_t)loopLength;
+        }
+    } else if (position >= (int32_t)loopLength) {
+        position = position % (int32_t)loopLength;
+    }
+    return (uint32_t)position;
+}
+
+std::vector<NoteUtils::DisplayNote> NoteUtils::reconstructNotes(const EventList& midiEvents, uint32_t loopLength) {
     std::vector<DisplayNote> notes;
+    reconstructNotesInto(midiEvents, loopLength, notes);
+    return notes;
+}
+
+void NoteUtils::reconstructNotesInto(const EventList& midiEvents, uint32_t loopLength, std::vector<DisplayNote>& notes) {
+    PROFILE_SCOPE(PROBE_RECONSTRUCT_NOTES);
+    using DisplayNote = NoteUtils::DisplayNote;
+    notes.clear();
     std::map<uint8_t, std::vector<DisplayNote>> activeNoteStacks;
 
     for (const auto& evt : midiEvents) {
@@ -35,15 +55,21 @@ std::vector<NoteUtils::DisplayNote> NoteUtils::reconstructNotes(const std::vecto
             notes.push_back(dn);
         }
     }
-
-    return notes;
 }
 
 // Build a fast lookup index for NoteOn/NoteOff events
-NoteUtils::EventIndex NoteUtils::buildEventIndex(const std::vector<MidiEvent>& midiEvents) {
+NoteUtils::EventIndex NoteUtils::buildEventIndex(const EventList& midiEvents) {
+    EventIndex index;
+    buildEventIndexInto(midiEvents, index);
+    return index;
+}
+
+void NoteUtils::buildEventIndexInto(const EventList& midiEvents, EventIndex& index) {
     using Key = NoteUtils::Key;
-    EventIndexMap onIndex;
-    EventIndexMap offIndex;
+    EventIndexMap& onIndex = index.first;
+    EventIndexMap& offIndex = index.second;
+    onIndex.clear();
+    offIndex.clear();
     onIndex.reserve(midiEvents.size());
     offIndex.reserve(midiEvents.size());
     for (size_t i = 0; i < midiEvents.size(); ++i) {
@@ -56,5 +82,4 @@ NoteUtils::EventIndex NoteUtils::buildEventIndex(const std::vector<MidiEvent>& m
             else offIndex[key] = i;
         }
     }
-    return {std::move(onIndex), std::move(offIndex)};
 } 
\ No newline at end of file
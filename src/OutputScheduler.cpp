@@ -0,0 +1,140 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "OutputScheduler.h"
+#include "MidiHandler.h"
+#include <IntervalTimer.h>
+
+OutputScheduler outputScheduler;
+static IntervalTimer outputTimer;
+
+static constexpr uint32_t MIN_WAIT_US = 2;       // Shortest one-shot the timer is armed for
+static constexpr uint8_t WRITE_BATCH = 16;       // Events written per port flush in the ISR
+
+static void outputTimerIsr() {
+  outputScheduler.onTimer();
+}
+
+void OutputScheduler::setup() {
+  // Above the input capture timer, below the clock: a due event waits for a tick, not for input
+  outputTimer.priority(144);
+}
+
+void OutputScheduler::schedule(uint8_t trackIndex, const MidiEvent& event, uint32_t deadlineMicros) {
+  uint32_t now = micros();
+  if (!earlier(now, deadlineMicros) || count >= Config::OUTPUT_QUEUE_EVENTS) {
+    sentAtOnce++;
+    midiHandler.sendTrackEvent(trackIndex, event);
+    return;
+  }
+  Entry entry;
+  if (!midiHandler.routeTrackEvent(trackIndex, event, entry.event, entry.dest)) return;
+  entry.deadline = deadlineMicros;
+  entry.track = trackIndex;
+
+  noInterrupts();
+  bool first = count == 0 || earlier(deadlineMicros, heap[0].deadline);
+  push(entry);
+  if (first) arm(deadlineMicros - now);
+  interrupts();
+}
+
+// Pending NoteOns never sound; NoteOffs and the rest go out now so nothing is left hanging
+void OutputScheduler::cancelTrack(uint8_t trackIndex) {
+  if (count == 0) return;
+  // loop() context only; kept off the stack
+  static Entry flush[Config::OUTPUT_QUEUE_EVENTS];
+  uint16_t flushCount = 0;
+
+  noInterrupts();
+  uint16_t kept = 0;
+  for (uint16_t i = 0; i < count; ++i) {
+    const Entry& e = heap[i];
+    if (e.track != trackIndex) {
+      heap[kept++] = e;
+    } else if (!e.event.isNoteOn()) {
+      flush[flushCount++] = e;
+    }
+  }
+  if (kept != count) {
+    count = kept;
+    for (uint16_t i = count / 2; i-- > 0;) siftDown(i);
+    uint32_t now = micros();
+    arm(count == 0 ? 0 : (earlier(now, heap[0].deadline) ? heap[0].deadline - now : MIN_WAIT_US));
+  }
+  interrupts();
+
+  for (uint16_t i = 0; i < flushCount; ++i) midiHandler.sendRouted(flush[i].event, flush[i].dest);
+}
+
+uint32_t OutputScheduler::service(uint32_t nowMicros) {
+  if (count == 0) return 0;
+  if (!midiHandler.claimPort()) return Config::OUTPUT_RETRY_US;
+  MidiEvent events[WRITE_BATCH];
+  uint8_t dest[WRITE_BATCH];
+  while (count > 0 && !earlier(nowMicros, heap[0].deadline)) {
+    uint8_t n = 0;
+    while (n < WRITE_BATCH && count > 0 && !earlier(nowMicros, heap[0].deadline)) {
+      uint32_t late = nowMicros - heap[0].deadline;
+      if (late > maxLateMicros) maxLateMicros = late;
+      events[n] = heap[0].event;
+      dest[n++] = heap[0].dest;
+      popTop();
+    }
+    midiHandler.writeRouted(events, dest, n);
+    sentOnTime += n;
+  }
+  midiHandler.releasePort();
+  if (count == 0) return 0;
+  uint32_t wait = heap[0].deadline - nowMicros;
+  return wait < MIN_WAIT_US ? MIN_WAIT_US : wait;
+}
+
+// Runs in the one-shot timer ISR
+void OutputScheduler::onTimer() {
+  arm(service(micros()));
+}
+
+void OutputScheduler::arm(uint32_t waitMicros) {
+  outputTimer.end();
+  if (waitMicros == 0) return;
+  outputTimer.begin(outputTimerIsr, waitMicros < MIN_WAIT_US ? MIN_WAIT_US : waitMicros);
+}
+
+void OutputScheduler::resetStats() {
+  sentOnTime = 0;
+  sentAtOnce = 0;
+  maxLateMicros = 0;
+}
+
+// --- Min-heap by deadline (interrupts off or in the ISR) ---
+
+void OutputScheduler::push(const Entry& entry) {
+  uint16_t i = count++;
+  while (i > 0) {
+    uint16_t parent = (i - 1) / 2;
+    if (!earlier(entry.deadline, heap[parent].deadline)) break;
+    heap[i] = heap[parent];
+    i = parent;
+  }
+  heap[i] = entry;
+}
+
+void OutputScheduler::popTop() {
+  if (--count == 0) return;
+  heap[0] = heap[count];
+  siftDown(0);
+}
+
+void OutputScheduler::siftDown(uint16_t i) {
+  Entry entry = heap[i];
+  for (;;) {
+    uint16_t child = 2 * i + 1;
+    if (child >= count) break;
+    if (child + 1 < count && earlier(heap[child + 1].deadline, heap[child].deadline)) ++child;
+    if (!earlier(heap[child].deadline, entry.deadline)) break;
+    heap[i] = heap[child];
+    i = child;
+  }
+  heap[i] = entry;
+}
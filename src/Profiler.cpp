@@ -0,0 +1,103 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "Profiler.h"
+
+#ifdef LOOPER_PROFILE
+
+namespace {
+
+struct ProbeStats {
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  uint32_t histogram[32];  // Bucket k counts samples in [2^k, 2^(k+1)) cycles
+};
+
+const char* const probeNames[NUM_PROFILE_PROBES] = {
+  "updateAllTracks",
+  "DisplayManager::update",
+  "StorageManager::update",
+  "StorageManager::saveState",
+  "reconstructNotes",
+  "EditState::onEncoderTurn",
+  "EditState::onButtonPress",
+};
+
+ProbeStats stats[NUM_PROFILE_PROBES];
+
+const char* const counterNames[NUM_PROFILE_COUNTERS] = {
+  "playback overruns",
+  "playback dropped events",
+};
+
+uint32_t counters[NUM_PROFILE_COUNTERS];
+
+float cyclesToMicros(uint64_t cycles) {
+  return (float)cycles / (F_CPU_ACTUAL / 1000000.0f);
+}
+
+}  // namespace
+
+void Profiler::setup() {
+  ARM_DEMCR |= ARM_DEMCR_TRCENA;
+  ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+  reset();
+}
+
+void Profiler::reset() {
+  for (auto& s : stats) {
+    s = ProbeStats{};
+    s.minCycles = UINT32_MAX;
+  }
+  for (auto& c : counters) c = 0;
+}
+
+void Profiler::record(ProfileProbe probe, uint32_t cycles) {
+  if (probe >= NUM_PROFILE_PROBES) return;
+  ProbeStats& s = stats[probe];
+  s.count++;
+  s.totalCycles += cycles;
+  if (cycles < s.minCycles) s.minCycles = cycles;
+  if (cycles > s.maxCycles) s.maxCycles = cycles;
+  s.histogram[31 - __builtin_clz(cycles | 1)]++;
+}
+
+void Profiler::count(ProfileCounter counter, uint32_t n) {
+  if (counter < NUM_PROFILE_COUNTERS) counters[counter] += n;
+}
+
+void Profiler::dump(Print& out) {
+  out.printf("[Profiler] %lu MHz; times in us\n", (unsigned long)(F_CPU_ACTUAL / 1000000));
+  for (uint8_t p = 0; p < NUM_PROFILE_PROBES; ++p) {
+    const ProbeStats& s = stats[p];
+    if (s.count == 0) {
+      out.printf("  %-26s -\n", probeNames[p]);
+      continue;
+    }
+    out.printf("  %-26s n=%lu min=%.1f mean=%.1f max=%.1f\n", probeNames[p], (unsigned long)s.count,
+               cyclesToMicros(s.minCycles), cyclesToMicros(s.totalCycles / s.count), cyclesToMicros(s.maxCycles));
+    out.print("    log2 cycles:");
+    for (uint8_t k = 0; k < 32; ++k) {
+      if (s.histogram[k]) out.printf(" %u:%lu", k, (unsigned long)s.histogram[k]);
+    }
+    out.println();
+  }
+  for (uint8_t c = 0; c < NUM_PROFILE_COUNTERS; ++c) {
+    out.printf("  %-26s %lu\n", counterNames[c], (unsigned long)counters[c]);
+  }
+}
+
+void Profiler::pollSerial() {
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c == 'p') dump(Serial);
+    else if (c == 'r') {
+      reset();
+      Serial.println("[Profiler] Reset");
+    }
+  }
+}
+
+#endif  // LOOPER_PROFILE
@@ -0,0 +1,75 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "Scheduler.h"
+
+Scheduler scheduler;
+
+bool Scheduler::addTask(const char* name, TaskFn fn, TaskPriority priority, uint32_t budgetMicros,
+                        uint32_t intervalMillis) {
+  if (taskCount >= MAX_TASKS || !fn) {
+    Serial.print("[Scheduler] ERROR: Cannot add task "); Serial.println(name);
+    return false;
+  }
+  // Keep the table in priority order; a new task goes after the others of its priority
+  uint8_t at = taskCount;
+  while (at > 0 && tasks[at - 1].priority > priority) {
+    tasks[at] = tasks[at - 1];
+    --at;
+  }
+  tasks[at] = Task{name, fn, priority, budgetMicros, intervalMillis, 0, false, false, TaskStats{}};
+  ++taskCount;
+  return true;
+}
+
+void Scheduler::runService() {
+  if (!service) return;
+  uint32_t start = micros();
+  if (serviceRan && start - lastServiceEnd > maxServiceGap) maxServiceGap = start - lastServiceEnd;
+  service();
+  lastServiceEnd = micros();
+  serviceRan = true;
+}
+
+void Scheduler::runPass() {
+  runService();
+  for (uint8_t i = 0; i < taskCount; ++i) {
+    Task& task = tasks[i];
+    uint32_t now = millis();
+    if (!task.resume) {
+      if (task.started && now - task.lastStartMillis < task.intervalMillis) continue;
+      task.lastStartMillis = now;
+      task.started = true;
+    }
+    uint32_t start = micros();
+    task.resume = task.fn(task.budgetMicros);
+    uint32_t elapsed = micros() - start;
+    task.stats.slices++;
+    if (elapsed > task.stats.maxMicros) task.stats.maxMicros = elapsed;
+    if (elapsed > task.budgetMicros) task.stats.overruns++;
+    runService();
+  }
+}
+
+void Scheduler::resetStats() {
+  for (uint8_t i = 0; i < taskCount; ++i) tasks[i].stats = TaskStats{};
+  maxServiceGap = 0;
+  serviceRan = false;
+}
+
+void Scheduler::dump(Print& out) {
+  out.printf("[Scheduler] longest gap between input polls %lu us\n", (unsigned long)maxServiceGap);
+  for (uint8_t i = 0; i < taskCount; ++i) {
+    const Task& t = tasks[i];
+    out.printf("  %-10s budget %5lu us  slices %lu  max %lu us  over budget %lu\n", t.name,
+               (unsigned long)t.budgetMicros, (unsigned long)t.stats.slices, (unsigned long)t.stats.maxMicros,
+               (unsigned long)t.stats.overruns);
+  }
+}
+
+void Scheduler::pollSerial() {
+  while (Serial.available() > 0 && Serial.peek() == 't') {
+    Serial.read();
+    dump(Serial);
+  }
+}
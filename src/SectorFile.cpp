@@ -0,0 +1,159 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "SectorFile.h"
+#include <string.h>
+
+static_assert(Config::STORAGE_BLOCK_BYTES % Config::SD_SECTOR_BYTES == 0, "blocks of whole sectors");
+
+File SectorFile::create(const char* path, uint64_t reserveBytes) {
+#if defined(__IMXRT1062__)
+  // Through SdFat directly: the SD wrapper has no preallocation. The clusters stay with the
+  // (still empty) file when it is closed and reopened from its start.
+  FsFile f = SD.sdfs.open(path, O_RDWR | O_CREAT | O_TRUNC);
+  if (!f) return File();
+  if (reserveBytes > 0 && !f.preAllocate(reserveBytes)) {
+    Serial.println("[SectorFile] No contiguous space to preallocate, writing a fragmented file");
+  }
+  f.close();
+  return SD.open(path, FILE_WRITE_BEGIN);
+#else
+  (void)reserveBytes;
+  SD.remove(path);
+  return SD.open(path, FILE_WRITE_BEGIN);
+#endif
+}
+
+// -------------------------
+// SectorWriter
+// -------------------------
+
+bool SectorWriter::open(const char* path, uint64_t reserveBytes) {
+  close();
+  file = SectorFile::create(path, reserveBytes);
+  if (!file) return false;
+  opened = true;
+  failed = false;
+  start = 0;
+  fill = 0;
+  blockWrites = 0;
+  return true;
+}
+
+bool SectorWriter::drain() {
+  if (fill == 0) return true;
+  if (failed || file.write(buffer, fill) != fill) {
+    failed = true;
+    return false;
+  }
+  start += fill;
+  fill = 0;
+  blockWrites++;
+  return true;
+}
+
+size_t SectorWriter::write(const uint8_t* data, size_t size) {
+  if (!opened || failed) return 0;
+  size_t done = 0;
+  while (done < size) {
+    size_t n = size - done;
+    if (n > Config::STORAGE_BLOCK_BYTES - fill) n = Config::STORAGE_BLOCK_BYTES - fill;
+    memcpy(buffer + fill, data + done, n);
+    fill += n;
+    done += n;
+    if (fill == Config::STORAGE_BLOCK_BYTES && !drain()) return 0;
+  }
+  return size;
+}
+
+bool SectorWriter::finish() {
+  if (!opened) return false;
+  bool ok = drain();
+  // A preallocated file would otherwise keep the whole reservation
+  ok = ok && file.truncate(start);
+  file.flush();
+  file.close();
+  opened = false;
+  return ok;
+}
+
+void SectorWriter::close() {
+  if (opened) file.close();
+  opened = false;
+  fill = 0;
+}
+
+// -------------------------
+// SectorReader
+// -------------------------
+
+bool SectorReader::open(const char* path) {
+  close();
+  file = SD.open(path, FILE_READ);
+  if (!file) return false;
+  opened = true;
+  length = file.size();
+  pos = 0;
+  filePos = 0;
+  bufStart = 0;
+  bufFill = 0;
+  return true;
+}
+
+void SectorReader::close() {
+  if (opened) file.close();
+  opened = false;
+  length = 0;
+  pos = 0;
+  bufFill = 0;
+}
+
+bool SectorReader::seek(uint64_t to) {
+  if (!opened || to > length) return false;
+  pos = to;
+  return true;
+}
+
+// Load the block holding pos
+bool SectorReader::refill() {
+  bufStart = pos - pos % Config::SD_SECTOR_BYTES;
+  bufFill = 0;
+  uint64_t n = length - bufStart;
+  if (n > Config::STORAGE_BLOCK_BYTES) n = Config::STORAGE_BLOCK_BYTES;
+  if (filePos != bufStart && !file.seek(bufStart)) return false;
+  int got = file.read(buffer, (size_t)n);
+  if (got <= 0) return false;
+  bufFill = got;
+  filePos = bufStart + got;
+  return pos < bufStart + bufFill;
+}
+
+int SectorReader::read(uint8_t* data, size_t size) {
+  if (!opened) return -1;
+  size_t done = 0;
+  while (done < size && pos < length) {
+    if (bufFill > 0 && pos >= bufStart && pos < bufStart + bufFill) {
+      size_t n = (size_t)(bufStart + bufFill - pos);
+      if (n > size - done) n = size - done;
+      memcpy(data + done, buffer + (pos - bufStart), n);
+      pos += n;
+      done += n;
+      continue;
+    }
+    uint64_t want = size - done;
+    if (want > length - pos) want = length - pos;
+    if (want >= Config::STORAGE_BLOCK_BYTES && pos % Config::SD_SECTOR_BYTES == 0) {
+      // Whole sectors straight into place; the last partial one goes through the buffer
+      size_t n = (size_t)(want - want % Config::SD_SECTOR_BYTES);
+      if (filePos != pos && !file.seek(pos)) break;
+      int got = file.read(data + done, n);
+      if (got <= 0) break;
+      pos += got;
+      done += got;
+      filePos = pos;
+      continue;
+    }
+    if (!refill()) break;
+  }
+  return (int)done;
+}
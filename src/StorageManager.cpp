@@ -7,16 +7,36 @@
 #include <SD.h>
 #include <Arduino.h>
 #include "TrackUndo.h"
+#include "LooperState.h"
+#include "EditManager.h"
+#include <vector>
+#include <deque>
+#include <string.h>
+#include "Profiler.h"
+#include "SectorFile.h"
 
-#define STORAGE_FILENAME "/midilooper_state.raw"
-#define STORAGE_VERSION 1
+#define STORAGE_FILENAME LOOPER_STORAGE_DIR "/midilooper_state.raw"  // v1 monolithic file, migrated on load
+#define CHECKPOINT_FILENAME LOOPER_STORAGE_DIR "/midilooper.ckp"
+#define CHECKPOINT_TEMP_FILENAME LOOPER_STORAGE_DIR "/midilooper.ckp.tmp"
+#define JOURNAL_FILENAME LOOPER_STORAGE_DIR "/midilooper.jnl"
+#define STORAGE_VERSION_V1 1
+#define STORAGE_VERSION 2
 
-// Helper to write raw data
-static bool writeRaw(File &file, const void *data, size_t size) {
+static constexpr uint32_t CHECKPOINT_MAGIC = 0x4B434C4D;       // "MLCK"
+static constexpr uint32_t JOURNAL_MAGIC = 0x4E4A4C4D;          // "MLJN"
+static constexpr uint32_t SAVE_COALESCE_MS = 250;              // quiet time before buffered changes are written
+static constexpr uint32_t SAVE_CHUNK_EVENTS = 32;              // checkpoint events written per step
+static constexpr uint32_t JOURNAL_FORCE_FLUSH_BYTES = 4096;    // write without waiting once this much is buffered
+static constexpr uint32_t JOURNAL_COMPACT_BYTES = 64 * 1024;   // compact into a checkpoint past this size
+static constexpr uint32_t RECORD_INLINE_MAX = 32;              // largest fixed-size record payload
+
+// Helper to write raw data (to the journal File or a checkpoint SectorWriter)
+template <typename Out>
+static bool writeRaw(Out &file, const void *data, size_t size) {
     return file.write((const uint8_t*)data, size) == size;
 }
 // Helper to read raw data
-static bool readRaw(File &file, void *data, size_t size) {
+static bool readRaw(SectorReader &file, void *data, size_t size) {
     // Check if enough bytes remain
     if ((file.size() - file.position()) < size) {
         Serial.print("[StorageManager] readRaw: Not enough bytes left in file. Needed: ");
@@ -36,77 +56,1219 @@ static bool readRaw(File &file, void *data, size_t size) {
     return true;
 }
 
+// -------------------------
+// Record format (v2)
+// -------------------------
+// Checkpoint and journal files are both sequences of records:
+//   RecordHeader | `length` payload bytes | CRC32 over header and payload
+// A checkpoint is BEGIN, SESSION, per-track TRACK_STATE/[SYSEX_BYTES]/TRACK_EVENTS/UNDO_DELTA.../UNDO_SNAPSHOT, END and is
+// only valid when END is present. A journal is BEGIN followed by change records; replay stops at
+// the first torn or corrupt record. Both BEGIN records carry a generation number and a journal is
+// only replayed on top of the checkpoint with the same generation.
+
+enum RecordType : uint8_t {
+    REC_CHECKPOINT_BEGIN = 1,  // StorageHeader
+    REC_CHECKPOINT_END,        // uint32_t generation
+    REC_JOURNAL_BEGIN,         // StorageHeader
+    REC_SESSION,               // SessionRecord
+    REC_TRACK_STATE,           // TrackStateRecord
+    REC_TRACK_EVENTS,          // uint32_t count + MidiEvents: replaces the track's event list
+    REC_UNDO_SNAPSHOT,         // uint32_t count + MidiEvents: one full undo level (checkpoint only)
+    REC_EVENT_INSERT,          // MidiEvent
+    REC_EVENT_DELETE,          // MidiEvent
+    REC_UNDO_PUSH,             // no payload: push a snapshot of the current events
+    REC_UNDO_DROP,             // no payload: discard the last snapshot
+    REC_UNDO_RESTORE,          // no payload: restore and remove the last snapshot
+    REC_TRACK_CLEAR,           // no payload
+    REC_UNDO_DELTA,            // uint32_t removed, uint32_t inserted + UndoChanges: one sealed undo level (checkpoint only)
+    REC_SYSEX_BYTES            // uint32_t offset + bytes: the track's SysEx store from offset on
+};
+
+struct RecordHeader {
+    uint8_t type;
+    uint8_t track;
+    uint16_t reserved;
+    uint32_t length;  // payload bytes
+};
+
+struct StorageHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t generation;
+    uint16_t eventSize;  // sizeof(MidiEvent) when written
+    uint8_t numTracks;
+    uint8_t reserved;
+};
+
+struct SessionRecord {
+    uint32_t looperState;
+    uint32_t masterLoopLength;
+    uint8_t selectedTrack;
+    uint8_t reserved[3];
+};
+
+struct TrackStateRecord {
+    uint32_t state;
+    uint32_t startLoopTick;
+    uint32_t loopLengthTicks;
+    uint8_t muted;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(RecordHeader) == 8, "RecordHeader layout is part of the file format");
+static_assert(sizeof(StorageHeader) == 16, "StorageHeader layout is part of the file format");
+static_assert(sizeof(SessionRecord) == 12, "SessionRecord layout is part of the file format");
+static_assert(sizeof(TrackStateRecord) == 16, "TrackStateRecord layout is part of the file format");
+static_assert(sizeof(MidiEvent) <= RECORD_INLINE_MAX, "MidiEvent must fit an inline record payload");
+
+// Files written before MidiEvent was packed to 8 bytes hold 16-byte events: tick, type, channel,
+// two pad bytes and an 8-byte data union (room for the old SysEx pointer). They are decoded on
+// load and the state is then rewritten in the current layout.
+static constexpr uint16_t LEGACY_EVENT_SIZE = 16;
+static constexpr uint16_t LEGACY_EVENT_DATA_OFFSET = 8;
+static_assert(LEGACY_EVENT_SIZE <= RECORD_INLINE_MAX, "Legacy MidiEvent must fit an inline record payload");
+
+static uint16_t fileEventSize = sizeof(MidiEvent);  // Event layout of the file being read
+static std::vector<uint8_t> sysexPayload;           // Payload of the last REC_SYSEX_BYTES read
+static bool legacyLayoutLoaded = false;             // Some loaded file used the legacy layout
+
+static MidiEvent decodeEvent(const uint8_t* raw) {
+    MidiEvent evt;
+    if (fileEventSize == sizeof(MidiEvent)) {
+        memcpy(&evt, raw, sizeof(evt));
+        return evt;
+    }
+    memcpy(&evt.tick, raw, sizeof(evt.tick));
+    evt.type = (midi::MidiType)raw[4];
+    evt.channel = raw[5];
+    memcpy(&evt.data, raw + LEGACY_EVENT_DATA_OFFSET, sizeof(evt.data));
+    return evt;
+}
+
+// CRC-32 (IEEE 802.3, reflected), nibble table. Chainable: crc32Update(crc32Update(0, a), b) == crc(a|b)
+static uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+    };
+    const uint8_t* p = (const uint8_t*)data;
+    crc = ~crc;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static StorageHeader makeStorageHeader(uint32_t magic, uint32_t generation) {
+    StorageHeader h = {};
+    h.magic = magic;
+    h.version = STORAGE_VERSION;
+    h.generation = generation;
+    h.eventSize = sizeof(MidiEvent);
+    h.numTracks = Config::NUM_TRACKS;
+    return h;
+}
+
+static SessionRecord makeSessionRecord(LooperState state) {
+    SessionRecord r = {};
+    r.looperState = (uint32_t)state;
+    r.masterLoopLength = trackManager.getMasterLoopLength();
+    r.selectedTrack = trackManager.getSelectedTrackIndex();
+    return r;
+}
+
+static TrackStateRecord makeTrackStateRecord(const Track& track) {
+    TrackStateRecord r = {};
+    // Ensure we save the state as TRACK_PLAYING when still in overdubbing to avoid state machine corruption
+    TrackState stateToSave = track.getState();
+    if (stateToSave == TRACK_OVERDUBBING) stateToSave = TRACK_PLAYING;
+    r.state = (uint32_t)stateToSave;
+    r.startLoopTick = track.getStartLoopTick();
+    r.loopLengthTicks = track.getLoopLength();
+    r.muted = track.isMuted();
+    return r;
+}
+
+// Streamed record writing (checkpoints): header, payload in pieces, CRC
+static bool beginRecord(SectorWriter& file, RecordType type, uint8_t track, uint32_t length, uint32_t& crc) {
+    RecordHeader hdr = {type, track, 0, length};
+    crc = crc32Update(0, &hdr, sizeof(hdr));
+    return writeRaw(file, &hdr, sizeof(hdr));
+}
+
+static bool writeRecordPayload(SectorWriter& file, const void* data, uint32_t size, uint32_t& crc) {
+    crc = crc32Update(crc, data, size);
+    return writeRaw(file, data, size);
+}
+
+static bool endRecord(SectorWriter& file, uint32_t crc) {
+    return writeRaw(file, &crc, sizeof(crc));
+}
+
+static bool writeRecord(SectorWriter& file, RecordType type, uint8_t track, const void* payload, uint32_t size) {
+    uint32_t crc = 0;
+    if (!beginRecord(file, type, track, size, crc)) return false;
+    if (size > 0 && !writeRecordPayload(file, payload, size, crc)) return false;
+    return endRecord(file, crc);
+}
+
+// Size a list for a record; false when it is on a track's arena that cannot hold it (track arenas
+// never fall back to the heap)
+template <typename List>
+static bool resizeForRecord(List& list, uint32_t count) {
+    TrackArena* arena = list.get_allocator().arena;
+    if (count > list.capacity() && arena && !arena->canAllocate((size_t)count * sizeof(typename List::value_type))) {
+        Serial.print("[StorageManager] ERROR: No track memory for a record of ");
+        Serial.print(count);
+        Serial.println(" entries");
+        return false;
+    }
+    list.reserve(count);  // Exactly: resize() alone may grow past it
+    list.resize(count);
+    return true;
+}
+
+// Event and change arrays are read straight into place in the current layout, and one element
+// at a time through decodeEvent() for a legacy file. The CRC always covers the bytes on the card.
+static bool readEvents(SectorReader& file, EventList& events, uint32_t count, uint32_t& crc) {
+    if (!resizeForRecord(events, count)) return false;
+    if (fileEventSize == sizeof(MidiEvent)) {
+        uint32_t bytes = count * sizeof(MidiEvent);
+        if (bytes > 0 && file.read((uint8_t*)events.data(), bytes) != (int)bytes) return false;
+        crc = crc32Update(crc, events.data(), bytes);
+        return true;
+    }
+    uint8_t raw[LEGACY_EVENT_SIZE];
+    for (uint32_t i = 0; i < count; ++i) {
+        if (file.read(raw, fileEventSize) != (int)fileEventSize) return false;
+        crc = crc32Update(crc, raw, fileEventSize);
+        events[i] = decodeEvent(raw);
+    }
+    return true;
+}
+
+static bool readChanges(SectorReader& file, ChangeList& changes, uint32_t count, uint32_t& crc) {
+    if (!resizeForRecord(changes, count)) return false;
+    if (fileEventSize == sizeof(MidiEvent)) {
+        uint32_t bytes = count * sizeof(UndoChange);
+        if (bytes > 0 && file.read((uint8_t*)changes.data(), bytes) != (int)bytes) return false;
+        crc = crc32Update(crc, changes.data(), bytes);
+        return true;
+    }
+    uint8_t raw[sizeof(uint32_t) + LEGACY_EVENT_SIZE];
+    uint32_t stride = sizeof(uint32_t) + fileEventSize;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (file.read(raw, stride) != (int)stride) return false;
+        crc = crc32Update(crc, raw, stride);
+        memcpy(&changes[i].index, raw, sizeof(uint32_t));
+        changes[i].event = decodeEvent(raw + sizeof(uint32_t));
+    }
+    return true;
+}
+
+// Read a record header and check that the whole record is on the card; starts the CRC
+static bool readRecordHeader(SectorReader& file, RecordHeader& hdr, uint32_t& crc) {
+    uint32_t available = file.size() - file.position();
+    if (available < sizeof(hdr)) return false;
+    if (file.read((uint8_t*)&hdr, sizeof(hdr)) != (int)sizeof(hdr)) return false;
+    if (available - sizeof(hdr) < (uint64_t)hdr.length + sizeof(uint32_t)) return false;
+    crc = crc32Update(0, &hdr, sizeof(hdr));
+    return true;
+}
+
+static uint32_t recordBytes(const RecordHeader& hdr) {
+    return sizeof(hdr) + hdr.length + sizeof(uint32_t);
+}
+
+// Read the payload and CRC of a record whose header was just read. Fixed-size payloads land in
+// `inline`; event-list payloads in `events`; undo deltas in `delta`; SysEx bytes in
+// sysexPayload. Returns false on a torn
+// record, a bad length, or a CRC mismatch.
+static bool readRecordBody(SectorReader& file, const RecordHeader& hdr, uint32_t crc, uint8_t* inlinePayload,
+                           EventList& events, UndoEntry& delta) {
+    if (hdr.type == REC_TRACK_EVENTS || hdr.type == REC_UNDO_SNAPSHOT) {
+        uint32_t count = 0;
+        if (hdr.length < sizeof(count)) return false;
+        if (file.read((uint8_t*)&count, sizeof(count)) != (int)sizeof(count)) return false;
+        if (hdr.length != sizeof(count) + (uint64_t)count * fileEventSize) return false;
+        crc = crc32Update(crc, &count, sizeof(count));
+        if (!readEvents(file, events, count, crc)) return false;
+    } else if (hdr.type == REC_UNDO_DELTA) {
+        uint32_t counts[2] = {0, 0};
+        if (hdr.length < sizeof(counts)) return false;
+        if (file.read((uint8_t*)counts, sizeof(counts)) != (int)sizeof(counts)) return false;
+        if (hdr.length != sizeof(counts) + ((uint64_t)counts[0] + counts[1]) * (sizeof(uint32_t) + fileEventSize)) return false;
+        crc = crc32Update(crc, counts, sizeof(counts));
+        if (!readChanges(file, delta.removed, counts[0], crc)) return false;
+        if (!readChanges(file, delta.inserted, counts[1], crc)) return false;
+    } else if (hdr.type == REC_SYSEX_BYTES) {
+        if (hdr.length < sizeof(uint32_t) || hdr.length > sizeof(uint32_t) + Config::SYSEX_STORE_BYTES) return false;
+        sysexPayload.resize(hdr.length);
+        if (file.read(sysexPayload.data(), hdr.length) != (int)hdr.length) return false;
+        crc = crc32Update(crc, sysexPayload.data(), hdr.length);
+    } else {
+        if (hdr.length > RECORD_INLINE_MAX) return false;
+        if (hdr.length > 0 && file.read(inlinePayload, hdr.length) != (int)hdr.length) return false;
+        crc = crc32Update(crc, inlinePayload, hdr.length);
+    }
+    uint32_t storedCrc = 0;
+    if (file.read((uint8_t*)&storedCrc, sizeof(storedCrc)) != (int)sizeof(storedCrc)) return false;
+    return storedCrc == crc;
+}
+
+// Read one record. Returns false at end of file or wherever readRecordBody() fails.
+static bool readRecord(SectorReader& file, RecordHeader& hdr, uint8_t* inlinePayload, EventList& events,
+                       UndoEntry& delta) {
+    uint32_t crc = 0;
+    return readRecordHeader(file, hdr, crc) && readRecordBody(file, hdr, crc, inlinePayload, events, delta);
+}
+
+// Accepts the current and the legacy event layout and selects it for the rest of the file
+static bool validStorageHeader(const RecordHeader& hdr, const uint8_t* payload, uint32_t magic) {
+    if (hdr.length != sizeof(StorageHeader)) return false;
+    StorageHeader h;
+    memcpy(&h, payload, sizeof(h));
+    if (h.magic != magic || h.version != STORAGE_VERSION) {
+        Serial.print("[StorageManager] ERROR: Unsupported storage version: ");
+        Serial.println(h.version);
+        return false;
+    }
+    if ((h.eventSize != sizeof(MidiEvent) && h.eventSize != LEGACY_EVENT_SIZE) ||
+        h.numTracks != Config::NUM_TRACKS) {
+        Serial.println("[StorageManager] ERROR: Event size or track count mismatch");
+        return false;
+    }
+    fileEventSize = h.eventSize;
+    if (fileEventSize != sizeof(MidiEvent)) legacyLayoutLoaded = true;
+    return true;
+}
+
+static uint32_t storageHeaderGeneration(const uint8_t* payload) {
+    StorageHeader h;
+    memcpy(&h, payload, sizeof(h));
+    return h.generation;
+}
+
+// sysexPayload onto a store: offset, then the bytes from there
+static void applySysExPayload(SysExStore& store, const std::vector<uint8_t>& payload) {
+    uint32_t offset = 0;
+    memcpy(&offset, payload.data(), sizeof(offset));
+    store.restore(offset, payload.data() + sizeof(offset), payload.size() - sizeof(offset));
+}
+
+static void applyTrackStateRecord(Track& track, const TrackStateRecord& r) {
+    track.forceSetState((TrackState)r.state);
+    if ((bool)r.muted != track.isMuted()) track.toggleMuteTrack();
+    track.setLoopLength(r.loopLengthTicks);
+}
+
+static void applySessionRecord(const SessionRecord& r, LooperState& state) {
+    state = (LooperState)r.looperState;
+    trackManager.setMasterLoopLength(r.masterLoopLength);
+    trackManager.setSelectedTrack(r.selectedTrack);
+}
+
+// -------------------------
+// Journal state
+// -------------------------
+
+static bool storageReady = false;           // set once loadState() has prepared checkpoint + journal
+static bool replaying = false;              // suppress journal hooks while applying loaded records
+static uint32_t generation = 0;             // generation of the live checkpoint/journal pair
+static File journalFile;
+static uint32_t journalBytes = 0;           // bytes in the journal file on card
+static bool journalBroken = false;          // a journal write failed; next step is a fresh checkpoint
+static std::vector<uint8_t> pendingJournal; // records not yet written to the card
+static uint32_t pendingOffset = 0;          // bytes of pendingJournal already written
+static uint32_t recordSerial = 0;           // bumped by every appended record
+static uint32_t lastRequestMillis = 0;
+static uint32_t lastHeaderCheckMillis = 0;
+static SectorReader cardReader;             // synchronous loads
+static SectorReader pageReader;             // undo page-ins, which a replayed record can trigger
+static bool headerCheckDue = false;
+// Header values as the journal currently describes them; diffed against live values
+static SessionRecord journaledSession = {};
+static TrackStateRecord journaledTrack[Config::NUM_TRACKS] = {};
+
+// Undo levels left in CHECKPOINT_FILENAME at load, oldest first. Each is a REC_UNDO_DELTA or
+// REC_UNDO_SNAPSHOT record, read (and CRC checked) only when TrackUndo pages it in.
+struct PagedUndoRecord {
+    uint32_t offset;  // Record header position in the checkpoint
+    uint32_t bytes;   // Header, payload and CRC
+    uint8_t type;
+};
+static std::vector<PagedUndoRecord> pagedUndo[Config::NUM_TRACKS];
+static uint32_t pagedSerial = 0;            // bumped whenever a paged list changes
+
+// Background restore at boot (beginRestore()). Tracks changed by the user before their saved
+// state arrived keep the user's content; the restore then ends in a fresh checkpoint.
+static bool restoring = false;
+static uint32_t restoreTouched = 0;         // tracks changed by the user while restoring
+static uint32_t restoredTracks = 0;         // tracks whose checkpoint state has been applied
+
+static bool journalActive() {
+    return storageReady && !replaying;
+}
+
+static bool journalActive(const Track& track) {
+    if (restoring && !replaying) restoreTouched |= 1u << trackManager.getTrackIndex(track);
+    return journalActive();
+}
+
+static void appendRecord(RecordType type, uint8_t track, const void* a, uint32_t aLen,
+                         const void* b = nullptr, uint32_t bLen = 0) {
+    RecordHeader hdr = {type, track, 0, aLen + bLen};
+    uint32_t crc = crc32Update(0, &hdr, sizeof(hdr));
+    if (aLen) crc = crc32Update(crc, a, aLen);
+    if (bLen) crc = crc32Update(crc, b, bLen);
+    const uint8_t* p = (const uint8_t*)&hdr;
+    pendingJournal.insert(pendingJournal.end(), p, p + sizeof(hdr));
+    if (aLen) pendingJournal.insert(pendingJournal.end(), (const uint8_t*)a, (const uint8_t*)a + aLen);
+    if (bLen) pendingJournal.insert(pendingJournal.end(), (const uint8_t*)b, (const uint8_t*)b + bLen);
+    p = (const uint8_t*)&crc;
+    pendingJournal.insert(pendingJournal.end(), p, p + sizeof(crc));
+    recordSerial++;
+    StorageManager::requestSave();
+}
+
+// Append records for header values that changed since they were last journaled
+static void journalHeaderChanges() {
+    SessionRecord session = makeSessionRecord(looperState.getLooperState());
+    if (memcmp(&session, &journaledSession, sizeof(session)) != 0) {
+        appendRecord(REC_SESSION, 0, &session, sizeof(session));
+        journaledSession = session;
+    }
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        TrackStateRecord r = makeTrackStateRecord(trackManager.getTrack(t));
+        if (memcmp(&r, &journaledTrack[t], sizeof(r)) != 0) {
+            appendRecord(REC_TRACK_STATE, t, &r, sizeof(r));
+            journaledTrack[t] = r;
+        }
+    }
+}
+
+static void captureJournaledHeaders(LooperState state) {
+    journaledSession = makeSessionRecord(state);
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        journaledTrack[t] = makeTrackStateRecord(trackManager.getTrack(t));
+    }
+}
+
+static bool startNewJournal(uint32_t gen) {
+    journalFile.close();
+    // Reserved up to the compaction size, so appends land in contiguous clusters
+    journalFile = SectorFile::create(JOURNAL_FILENAME, JOURNAL_COMPACT_BYTES + JOURNAL_FORCE_FLUSH_BYTES);
+    if (!journalFile) {
+        Serial.print("[StorageManager] ERROR: Could not open file for writing: ");
+        Serial.println(JOURNAL_FILENAME);
+        journalBroken = true;
+        return false;
+    }
+    // The BEGIN record in one write at the start of the first sector
+    StorageHeader h = makeStorageHeader(JOURNAL_MAGIC, gen);
+    RecordHeader hdr = {REC_JOURNAL_BEGIN, 0, 0, sizeof(h)};
+    uint32_t crc = crc32Update(crc32Update(0, &hdr, sizeof(hdr)), &h, sizeof(h));
+    uint8_t record[sizeof(hdr) + sizeof(h) + sizeof(crc)];
+    memcpy(record, &hdr, sizeof(hdr));
+    memcpy(record + sizeof(hdr), &h, sizeof(h));
+    memcpy(record + sizeof(hdr) + sizeof(h), &crc, sizeof(crc));
+    if (!writeRaw(journalFile, record, sizeof(record))) {
+        Serial.println("[StorageManager] ERROR: Failed to write journal header");
+        journalBroken = true;
+        return false;
+    }
+    journalFile.flush();
+    journalBytes = journalFile.size();
+    journalBroken = false;
+    return true;
+}
+
+static bool openJournalForAppend() {
+    journalFile = SD.open(JOURNAL_FILENAME, FILE_WRITE);
+    if (!journalFile) {
+        Serial.print("[StorageManager] ERROR: Could not open file for writing: ");
+        Serial.println(JOURNAL_FILENAME);
+        journalBroken = true;
+        return false;
+    }
+    journalBytes = journalFile.size();
+    return true;
+}
+
+// Write buffered records within the time slice; the tail of a partly written record is
+// simply torn on power loss and ignored by replay. Writes end on sector boundaries, so only
+// the last sector of a slice is partly filled.
+static void writePendingJournal(uint32_t sliceStart, uint32_t budgetMicros) {
+    while (pendingOffset < pendingJournal.size() && (micros() - sliceStart) < budgetMicros) {
+        uint32_t remaining = pendingJournal.size() - pendingOffset;
+        uint32_t toBoundary = Config::SD_SECTOR_BYTES - journalBytes % Config::SD_SECTOR_BYTES;
+        uint32_t n = remaining < toBoundary ? remaining : toBoundary;
+        if (!writeRaw(journalFile, pendingJournal.data() + pendingOffset, n)) {
+            Serial.println("[StorageManager] ERROR: Failed to append to journal");
+            journalBroken = true;
+            return;
+        }
+        pendingOffset += n;
+        journalBytes += n;
+    }
+    journalFile.flush();
+    if (pendingOffset >= pendingJournal.size()) {
+        pendingJournal.clear();
+        pendingOffset = 0;
+    }
+}
+
+// -------------------------
+// Checkpoint (compaction) job
+// -------------------------
+// A checkpoint is written as a sequence of small steps (one record or one chunk of events
+// per step) so it can be spread over several loop() iterations. Data goes to
+// CHECKPOINT_TEMP_FILENAME first and is renamed over CHECKPOINT_FILENAME only once the
+// END record is written. Any journal record appended, or paged undo level read, meanwhile
+// aborts the job.
+
+enum SaveStage : uint8_t {
+    SAVE_IDLE,
+    SAVE_HEADER,
+    SAVE_TRACK_HEADER,
+    SAVE_TRACK_SYSEX,
+    SAVE_TRACK_EVENTS,
+    SAVE_UNDO_PAGED,
+    SAVE_UNDO_SNAPSHOT_COUNT,
+    SAVE_UNDO_SNAPSHOT_EVENTS,
+    SAVE_FOOTER,
+    SAVE_COMMIT
+};
+
+struct SaveJob {
+    SaveStage stage = SAVE_IDLE;
+    SectorWriter file;
+    uint32_t serial = 0;       // recordSerial when the job started
+    uint32_t generation = 0;   // generation being written
+    uint8_t track = 0;         // track being written
+    uint32_t undoIndex = 0;    // undo snapshot being written
+    uint32_t eventCount = 0;   // event count of the current record
+    uint32_t eventOffset = 0;  // events of the current record already written
+    uint32_t crc = 0;          // running CRC of the current record
+    SectorReader source;       // previous checkpoint, open while paged undo records are copied
+    uint32_t pagedSerial = 0;  // pagedSerial when the job started
+    uint32_t pagedIndex = 0;   // paged undo record being copied
+    uint32_t copyOffset = 0;   // bytes of that record already copied
+    std::vector<PagedUndoRecord> paged[Config::NUM_TRACKS];  // where the copies landed
+    SessionRecord session = {};
+    TrackStateRecord trackState[Config::NUM_TRACKS] = {};
+};
+
+static SaveJob saveJob;
+
+static void abortSaveJob() {
+    if (saveJob.stage == SAVE_IDLE) return;
+    saveJob.file.close();
+    saveJob.source.close();
+    SD.remove(CHECKPOINT_TEMP_FILENAME);
+    saveJob.stage = SAVE_IDLE;
+}
+
+static bool failSaveJob(const char* what) {
+    Serial.print("[StorageManager] ERROR: Failed to write ");
+    Serial.print(what);
+    Serial.print(" for track ");
+    Serial.println(saveJob.track);
+    abortSaveJob();
+    return false;
+}
+
+// Size of the checkpoint about to be written, reserved on the card before the first block
+static uint64_t estimateCheckpointBytes() {
+    const uint32_t framing = sizeof(RecordHeader) + 2 * sizeof(uint32_t);  // header, count, CRC
+    uint64_t bytes = 3 * (framing + RECORD_INLINE_MAX) + sizeof(SessionRecord);
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        const Track& track = trackManager.getTrack(t);
+        bytes += 3 * framing + sizeof(TrackStateRecord) + track.getSysExStore().size() +
+                 track.getMidiEventCount() * sizeof(MidiEvent);
+        for (const PagedUndoRecord& rec : pagedUndo[t]) bytes += rec.bytes;
+        for (const UndoEntry& entry : TrackUndo::getUndoEntries(track)) {
+            bytes += framing + (entry.open ? entry.base.size() * sizeof(MidiEvent)
+                                           : (entry.removed.size() + entry.inserted.size()) * sizeof(UndoChange));
+        }
+    }
+    return bytes;
+}
+
+static bool beginSaveJob(const LooperState& state) {
+    abortSaveJob();
+    if (!saveJob.file.open(CHECKPOINT_TEMP_FILENAME, estimateCheckpointBytes())) {
+        Serial.print("[StorageManager] ERROR: Could not open file for writing: ");
+        Serial.println(CHECKPOINT_TEMP_FILENAME);
+        return false;
+    }
+    bool anyPaged = false;
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        saveJob.paged[t].clear();
+        anyPaged = anyPaged || !pagedUndo[t].empty();
+    }
+    if (anyPaged) {
+        if (!saveJob.source.open(CHECKPOINT_FILENAME)) {
+            Serial.print("[StorageManager] ERROR: Could not open file for reading: ");
+            Serial.println(CHECKPOINT_FILENAME);
+            saveJob.file.close();
+            SD.remove(CHECKPOINT_TEMP_FILENAME);
+            return false;
+        }
+    }
+    saveJob.serial = recordSerial;
+    saveJob.pagedSerial = pagedSerial;
+    saveJob.generation = generation + 1;
+    saveJob.session = makeSessionRecord(state);
+    saveJob.track = 0;
+    saveJob.stage = SAVE_HEADER;
+    return true;
+}
+
+static bool beginEventListRecord(RecordType type, uint32_t count) {
+    saveJob.eventCount = count;
+    saveJob.eventOffset = 0;
+    uint32_t length = sizeof(count) + count * sizeof(MidiEvent);
+    return beginRecord(saveJob.file, type, saveJob.track, length, saveJob.crc) &&
+           writeRecordPayload(saveJob.file, &count, sizeof(count), saveJob.crc);
+}
+
+// Write up to SAVE_CHUNK_EVENTS of the current event list; sets done when the record is complete
+static bool writeEventChunk(const EventList& events, bool& done) {
+    if (events.size() != saveJob.eventCount) return failSaveJob("events (list changed while saving)");
+    uint32_t remaining = saveJob.eventCount - saveJob.eventOffset;
+    uint32_t n = remaining < SAVE_CHUNK_EVENTS ? remaining : SAVE_CHUNK_EVENTS;
+    if (n > 0 && !writeRecordPayload(saveJob.file, events.data() + saveJob.eventOffset, n * sizeof(MidiEvent), saveJob.crc)) {
+        return failSaveJob("midiEvents");
+    }
+    saveJob.eventOffset += n;
+    done = (saveJob.eventOffset >= saveJob.eventCount);
+    if (done && !endRecord(saveJob.file, saveJob.crc)) return failSaveJob("midiEvents crc");
+    return true;
+}
+
+// Perform one bounded step of the checkpoint job. Returns false on error (job aborted).
+static bool saveStep() {
+    SectorWriter& file = saveJob.file;
+    switch (saveJob.stage) {
+        case SAVE_HEADER: {
+            StorageHeader h = makeStorageHeader(CHECKPOINT_MAGIC, saveJob.generation);
+            if (!writeRecord(file, REC_CHECKPOINT_BEGIN, 0, &h, sizeof(h))) return failSaveJob("checkpoint header");
+            if (!writeRecord(file, REC_SESSION, 0, &saveJob.session, sizeof(saveJob.session))) return failSaveJob("session");
+            saveJob.track = 0;
+            saveJob.stage = SAVE_TRACK_HEADER;
+            return true;
+        }
+        case SAVE_TRACK_HEADER: {
+            Track& track = trackManager.getTrack(saveJob.track);
+            TrackStateRecord& r = saveJob.trackState[saveJob.track];
+            r = makeTrackStateRecord(track);
+            if (!writeRecord(file, REC_TRACK_STATE, saveJob.track, &r, sizeof(r))) return failSaveJob("trackState");
+            uint32_t sysexBytes = track.getSysExStore().size();
+            if (sysexBytes > 0) {
+                // Ahead of the events that refer to it
+                uint32_t offset = 0;
+                saveJob.eventCount = sysexBytes;
+                saveJob.eventOffset = 0;
+                if (!beginRecord(file, REC_SYSEX_BYTES, saveJob.track, sizeof(offset) + sysexBytes, saveJob.crc) ||
+                    !writeRecordPayload(file, &offset, sizeof(offset), saveJob.crc)) {
+                    return failSaveJob("sysex");
+                }
+                saveJob.stage = SAVE_TRACK_SYSEX;
+                return true;
+            }
+            if (!beginEventListRecord(REC_TRACK_EVENTS, track.getMidiEvents().size())) return failSaveJob("midiCount");
+            saveJob.stage = SAVE_TRACK_EVENTS;
+            return true;
+        }
+        case SAVE_TRACK_SYSEX: {
+            // Same chunk size as the events; eventCount / eventOffset count bytes here
+            const Track& track = trackManager.getTrack(saveJob.track);
+            const SysExStore& store = track.getSysExStore();
+            if (store.size() != saveJob.eventCount) return failSaveJob("sysex (store changed while saving)");
+            uint32_t remaining = saveJob.eventCount - saveJob.eventOffset;
+            uint32_t n = remaining < SAVE_CHUNK_EVENTS * sizeof(MidiEvent) ? remaining : SAVE_CHUNK_EVENTS * sizeof(MidiEvent);
+            if (!writeRecordPayload(file, store.data() + saveJob.eventOffset, n, saveJob.crc)) return failSaveJob("sysex");
+            saveJob.eventOffset += n;
+            if (saveJob.eventOffset < saveJob.eventCount) return true;
+            if (!endRecord(file, saveJob.crc)) return failSaveJob("sysex crc");
+            if (!beginEventListRecord(REC_TRACK_EVENTS, track.getMidiEvents().size())) return failSaveJob("midiCount");
+            saveJob.stage = SAVE_TRACK_EVENTS;
+            return true;
+        }
+        case SAVE_TRACK_EVENTS: {
+            bool done = false;
+            if (!writeEventChunk(trackManager.getTrack(saveJob.track).getMidiEvents(), done)) return false;
+            if (done) {
+                saveJob.pagedIndex = 0;
+                saveJob.copyOffset = 0;
+                saveJob.stage = SAVE_UNDO_PAGED;
+            }
+            return true;
+        }
+        case SAVE_UNDO_PAGED: {
+            // Levels still on the card are older than the resident ones: copy their records as they are
+            const auto& paged = pagedUndo[saveJob.track];
+            if (saveJob.pagedIndex >= paged.size()) {
+                saveJob.undoIndex = 0;
+                saveJob.stage = SAVE_UNDO_SNAPSHOT_COUNT;
+                return true;
+            }
+            const PagedUndoRecord& rec = paged[saveJob.pagedIndex];
+            if (saveJob.copyOffset == 0) {
+                saveJob.paged[saveJob.track].push_back({(uint32_t)file.position(), rec.bytes, rec.type});
+                if (!saveJob.source.seek(rec.offset)) return failSaveJob("paged undo");
+            }
+            uint8_t chunk[SAVE_CHUNK_EVENTS * sizeof(MidiEvent)];
+            uint32_t remaining = rec.bytes - saveJob.copyOffset;
+            uint32_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+            if (saveJob.source.read(chunk, n) != (int)n || !writeRaw(file, chunk, n)) return failSaveJob("paged undo");
+            saveJob.copyOffset += n;
+            if (saveJob.copyOffset >= rec.bytes) {
+                saveJob.pagedIndex++;
+                saveJob.copyOffset = 0;
+            }
+            return true;
+        }
+        case SAVE_UNDO_SNAPSHOT_COUNT: {
+            const auto& history = TrackUndo::getUndoEntries(trackManager.getTrack(saveJob.track));
+            if (saveJob.undoIndex >= history.size()) {
+                // Track done, move to the next one
+                saveJob.track++;
+                saveJob.stage = (saveJob.track < Config::NUM_TRACKS) ? SAVE_TRACK_HEADER : SAVE_FOOTER;
+                return true;
+            }
+            const UndoEntry& entry = history[saveJob.undoIndex];
+            if (!entry.open) {
+                // Sealed levels are small (bounded by the undo budget): write in one step
+                uint32_t counts[2] = {(uint32_t)entry.removed.size(), (uint32_t)entry.inserted.size()};
+                uint32_t length = sizeof(counts) + (counts[0] + counts[1]) * sizeof(UndoChange);
+                if (!beginRecord(file, REC_UNDO_DELTA, saveJob.track, length, saveJob.crc) ||
+                    !writeRecordPayload(file, counts, sizeof(counts), saveJob.crc) ||
+                    !writeRecordPayload(file, entry.removed.data(), counts[0] * sizeof(UndoChange), saveJob.crc) ||
+                    !writeRecordPayload(file, entry.inserted.data(), counts[1] * sizeof(UndoChange), saveJob.crc) ||
+                    !endRecord(file, saveJob.crc)) {
+                    return failSaveJob("undo delta");
+                }
+                saveJob.undoIndex++;
+                return true;
+            }
+            if (!beginEventListRecord(REC_UNDO_SNAPSHOT, entry.base.size())) {
+                return failSaveJob("midiHistory snapCount");
+            }
+            saveJob.stage = SAVE_UNDO_SNAPSHOT_EVENTS;
+            return true;
+        }
+        case SAVE_UNDO_SNAPSHOT_EVENTS: {
+            const auto& history = TrackUndo::getUndoEntries(trackManager.getTrack(saveJob.track));
+            if (saveJob.undoIndex >= history.size()) return failSaveJob("midiHistory (changed while saving)");
+            bool done = false;
+            if (!writeEventChunk(history[saveJob.undoIndex].base, done)) return false;
+            if (done) {
+                saveJob.undoIndex++;
+                saveJob.stage = SAVE_UNDO_SNAPSHOT_COUNT;
+            }
+            return true;
+        }
+        case SAVE_FOOTER: {
+            if (!writeRecord(file, REC_CHECKPOINT_END, 0, &saveJob.generation, sizeof(saveJob.generation))) {
+                Serial.println("[StorageManager] ERROR: Failed to write checkpoint end");
+                abortSaveJob();
+                return false;
+            }
+            saveJob.stage = SAVE_COMMIT;
+            return true;
+        }
+        case SAVE_COMMIT: {
+            if (!file.finish()) {
+                Serial.println("[StorageManager] ERROR: Failed to write checkpoint tail");
+                abortSaveJob();
+                return false;
+            }
+            saveJob.source.close();
+            SD.remove(CHECKPOINT_FILENAME);
+            if (!SD.rename(CHECKPOINT_TEMP_FILENAME, CHECKPOINT_FILENAME)) {
+                Serial.println("[StorageManager] ERROR: Failed to replace checkpoint file");
+                abortSaveJob();
+                return false;
+            }
+            saveJob.stage = SAVE_IDLE;
+            // The checkpoint now holds everything; start an empty journal of the same generation
+            generation = saveJob.generation;
+            for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) pagedUndo[t].swap(saveJob.paged[t]);
+            journaledSession = saveJob.session;
+            for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) journaledTrack[t] = saveJob.trackState[t];
+            startNewJournal(generation);
+            Serial.print("[StorageManager] Checkpoint saved, generation ");
+            Serial.println(generation);
+            return true;
+        }
+        default:
+            return true;
+    }
+}
+
+static void restoreSlice(uint32_t sliceStart, uint32_t budgetMicros);  // Background restore, see beginRestore()
+
 bool StorageManager::saveState(const LooperState& state) {
+    PROFILE_SCOPE(PROBE_SAVE_STATE);
     Serial.println("[StorageManager] Saving state to SD card...");
-    File file = SD.open(STORAGE_FILENAME, FILE_WRITE);
-    if (!file) {
-        Serial.print("[StorageManager] ERROR: Could not open file for writing: ");
-        Serial.println(STORAGE_FILENAME);
+    // Buffered records are superseded by the checkpoint
+    pendingJournal.clear();
+    pendingOffset = 0;
+    if (!beginSaveJob(state)) return false;
+    while (saveJob.stage != SAVE_IDLE) {
+        if (!saveStep()) return false;
+    }
+    return !journalBroken;
+}
+
+void StorageManager::requestSave() {
+    lastRequestMillis = millis();
+    headerCheckDue = true;
+}
+
+bool StorageManager::isSavePending() {
+    return !pendingJournal.empty() || headerCheckDue || journalBroken || saveJob.stage != SAVE_IDLE;
+}
+
+void StorageManager::update(uint32_t budgetMicros) {
+    if (restoring) {
+        restoreSlice(micros(), budgetMicros);
+        return;
+    }
+    if (!storageReady) return;
+    PROFILE_SCOPE(PROBE_STORAGE_UPDATE);
+    uint32_t sliceStart = micros();
+    uint32_t now = millis();
+
+    if (saveJob.stage != SAVE_IDLE) {
+        // A new change would be lost when the journal is reset; retry once things are quiet
+        if (saveJob.serial != recordSerial || saveJob.pagedSerial != pagedSerial) {
+            abortSaveJob();
+        } else {
+            while (saveJob.stage != SAVE_IDLE && (micros() - sliceStart) < budgetMicros) {
+                if (!saveStep()) break;
+            }
+            return;
+        }
+    }
+
+    // Header values (state, mute, loop length, selection) are diffed rather than hooked
+    if (headerCheckDue || now - lastHeaderCheckMillis >= SAVE_COALESCE_MS) {
+        headerCheckDue = false;
+        lastHeaderCheckMillis = now;
+        journalHeaderChanges();
+    }
+
+    // Edits mutate events in place and journal the result on exit
+    bool editing = editManager.getCurrentState() != nullptr;
+
+    if (journalBroken) {
+        if (!editing && beginSaveJob(looperState.getLooperState())) {
+            // The checkpoint supersedes everything buffered
+            pendingJournal.clear();
+            pendingOffset = 0;
+        }
+        return;
+    }
+
+    if (!pendingJournal.empty()) {
+        // Wait for bursts of changes (undo spam, overdub passes) to settle
+        bool quiet = (now - lastRequestMillis) >= SAVE_COALESCE_MS;
+        if (quiet || pendingJournal.size() - pendingOffset >= JOURNAL_FORCE_FLUSH_BYTES) {
+            writePendingJournal(sliceStart, budgetMicros);
+        }
+        return;
+    }
+
+    if (journalBytes > JOURNAL_COMPACT_BYTES && !editing) {
+        Serial.println("[StorageManager] Compacting journal");
+        beginSaveJob(looperState.getLooperState());
+    }
+}
+
+// -------------------------
+// Journal hooks
+// -------------------------
+
+void StorageManager::journalEventInserted(const Track& track, const MidiEvent& evt) {
+    if (!journalActive(track)) return;
+    appendRecord(REC_EVENT_INSERT, trackManager.getTrackIndex(track), &evt, sizeof(evt));
+}
+
+void StorageManager::journalSysExStored(const Track& track, uint16_t offset) {
+    if (!journalActive(track)) return;
+    const SysExStore& store = track.getSysExStore();
+    uint32_t from = offset;
+    appendRecord(REC_SYSEX_BYTES, trackManager.getTrackIndex(track), &from, sizeof(from),
+                 store.data() + offset, store.size() - offset);
+}
+
+void StorageManager::journalEventDeleted(const Track& track, const MidiEvent& evt) {
+    if (!journalActive(track)) return;
+    appendRecord(REC_EVENT_DELETE, trackManager.getTrackIndex(track), &evt, sizeof(evt));
+}
+
+void StorageManager::journalTrackEvents(const Track& track) {
+    if (!journalActive(track)) return;
+    const auto& events = track.getMidiEvents();
+    uint32_t count = events.size();
+    appendRecord(REC_TRACK_EVENTS, trackManager.getTrackIndex(track), &count, sizeof(count),
+                 events.data(), count * sizeof(MidiEvent));
+}
+
+void StorageManager::journalTrackCleared(const Track& track) {
+    if (!journalActive(track)) return;
+    uint8_t t = trackManager.getTrackIndex(track);
+    appendRecord(REC_TRACK_CLEAR, t, nullptr, 0);
+    // Replay of a clear resets the header too; diff later changes against that
+    journaledTrack[t].state = TRACK_EMPTY;
+    journaledTrack[t].startLoopTick = 0;
+    journaledTrack[t].loopLengthTicks = 0;
+}
+
+void StorageManager::journalUndoPushed(const Track& track) {
+    if (!journalActive(track)) return;
+    appendRecord(REC_UNDO_PUSH, trackManager.getTrackIndex(track), nullptr, 0);
+}
+
+void StorageManager::journalUndoDropped(const Track& track) {
+    if (!journalActive(track)) return;
+    appendRecord(REC_UNDO_DROP, trackManager.getTrackIndex(track), nullptr, 0);
+}
+
+void StorageManager::journalUndoRestored(const Track& track) {
+    if (!journalActive(track)) return;
+    appendRecord(REC_UNDO_RESTORE, trackManager.getTrackIndex(track), nullptr, 0);
+}
+
+// -------------------------
+// Paged undo levels
+// -------------------------
+
+size_t StorageManager::pagedUndoLevels(const Track& track) {
+    return pagedUndo[trackManager.getTrackIndex(track)].size();
+}
+
+bool StorageManager::pageInUndoLevel(const Track& track, UndoEntry& entry) {
+    auto& paged = pagedUndo[trackManager.getTrackIndex(track)];
+    if (paged.empty()) return false;
+    PagedUndoRecord rec = paged.back();
+    paged.pop_back();
+    pagedSerial++;
+
+    // Only checkpoints in the current layout are paged
+    uint16_t layout = fileEventSize;
+    fileEventSize = sizeof(MidiEvent);
+    RecordHeader hdr;
+    uint8_t payload[RECORD_INLINE_MAX];
+    SectorReader& file = pageReader;
+    bool ok = file.open(CHECKPOINT_FILENAME) && file.seek(rec.offset) && readRecord(file, hdr, payload, entry.base, entry) &&
+              hdr.type == rec.type;
+    file.close();
+    fileEventSize = layout;
+    if (!ok) {
+        // The levels below depend on this one
+        Serial.println("[StorageManager] ERROR: Undo level on the card is unreadable, dropping older levels");
+        paged.clear();
         return false;
     }
-    file.seek(0); // Overwrite
+    entry.open = (hdr.type == REC_UNDO_SNAPSHOT);
+    return true;
+}
+
+void StorageManager::dropPagedUndo(const Track& track, size_t count) {
+    auto& paged = pagedUndo[trackManager.getTrackIndex(track)];
+    if (count == 0 || paged.empty()) return;
+    paged.erase(paged.begin(), paged.begin() + (count < paged.size() ? count : paged.size()));
+    pagedSerial++;
+}
+
+// -------------------------
+// Loading
+// -------------------------
+
+static bool sameEvent(const MidiEvent& a, const MidiEvent& b) {
+    return a.tick == b.tick && a.type == b.type && a.channel == b.channel &&
+           a.data.noteData.note == b.data.noteData.note &&
+           a.data.noteData.velocity == b.data.noteData.velocity;
+}
+
+// Where a load stages a track's lists: on its arena while the track holds no events, so they are
+// swapped in without a copy. Over live events the arena may not hold both, so they stage on the
+// heap and are copied in once the live ones are gone.
+static TrackArena* stagingArena(const Track& track) {
+    return track.hasData() ? nullptr : track.eventAllocator().arena;
+}
+
+// Install a track read from a checkpoint. `events` is swapped in when it is on the track's arena.
+static void applyLoadedTrack(uint8_t t, const TrackStateRecord& header, EventList& events,
+                             const std::vector<uint8_t>& sysex, std::deque<UndoEntry>&& history,
+                             std::vector<PagedUndoRecord>& paged) {
+    Track& track = trackManager.getTrack(t);
+    applyTrackStateRecord(track, header);
+    track.getSysExStore().restore(0, sysex.data(), sysex.size());
+    if (events.get_allocator() == track.eventAllocator()) {
+        track.editMidiEvents().swap(events);  // Same arena: no copy
+        track.markEventsChanged();
+    } else {
+        TrackUndo::clearHistory(track);
+        EventList(track.eventAllocator()).swap(track.editMidiEvents());
+        track.markEventsChanged();
+        if (!track.assignEvents(events)) {
+            Serial.print("[StorageManager] ERROR: No track memory for the events of track "); Serial.println(t);
+        }
+    }
+    TrackUndo::restoreHistory(track, std::move(history));
+    if (!paged.empty() && paged.back().type != REC_UNDO_SNAPSHOT) {
+        Serial.print("[StorageManager] Undo history without a full newest level, discarding it for track ");
+        Serial.println(t);
+        paged.clear();
+    }
+    pagedUndo[t].swap(paged);
+    pagedSerial++;
+}
 
-    uint32_t version = STORAGE_VERSION;
-    if (!writeRaw(file, &version, sizeof(version))) { Serial.println("[StorageManager] ERROR: Failed to write version"); file.close(); return false; }
+// Read and validate a whole checkpoint before touching the live tracks. Events are read into
+// lists on each empty track's arena and swapped in (see stagingArena()). Undo records of CHECKPOINT_FILENAME in the current
+// layout are skipped and left on the card (pagedUndo); those of the temporary file or a legacy
+// layout are read in full, since the file is about to be replaced.
+static bool loadCheckpoint(const char* filename, LooperState& state) {
+    SectorReader& file = cardReader;
+    if (!file.open(filename)) return false;
+    bool mayPage = strcmp(filename, CHECKPOINT_FILENAME) == 0;
 
-    // Save looper state
-    uint32_t looperStateVal = (uint32_t)state;
-    if (!writeRaw(file, &looperStateVal, sizeof(looperStateVal))) { Serial.println("[StorageManager] ERROR: Failed to write looper state"); file.close(); return false; }
+    struct TrackLoadData {
+        explicit TrackLoadData(TrackArena* arena) : midiEvents(ArenaAllocator<MidiEvent>(arena)), arena(arena) {}
+        TrackStateRecord header = {};
+        EventList midiEvents;
+        std::vector<uint8_t> sysex;
+        std::deque<UndoEntry> midiHistory;
+        std::vector<PagedUndoRecord> paged;
+        TrackArena* arena;
+    };
+    std::vector<TrackLoadData> tracksData;
+    tracksData.reserve(Config::NUM_TRACKS);
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        tracksData.emplace_back(stagingArena(trackManager.getTrack(t)));
+    }
+    SessionRecord session = {};
+    uint32_t fileGeneration = 0;
+    bool begun = false, ended = false, paging = false;
 
-    // Save master loop length
-    uint32_t masterLoopLength = trackManager.getMasterLoopLength();
-    if (!writeRaw(file, &masterLoopLength, sizeof(masterLoopLength))) { Serial.println("[StorageManager] ERROR: Failed to write master loop length"); file.close(); return false; }
+    RecordHeader hdr;
+    uint8_t payload[RECORD_INLINE_MAX];
+    EventList events;
+    UndoEntry delta;
+    while (!ended) {
+        uint32_t offset = file.position();
+        uint32_t crc = 0;
+        if (!readRecordHeader(file, hdr, crc)) break;
+        if (begun && hdr.track >= Config::NUM_TRACKS) break;
+        TrackLoadData* td = begun ? &tracksData[hdr.track] : nullptr;
+        bool undoRecord = hdr.type == REC_UNDO_SNAPSHOT || hdr.type == REC_UNDO_DELTA;
+        if (td && undoRecord && paging) {
+            td->paged.push_back({offset, recordBytes(hdr), hdr.type});
+            if (!file.seek(offset + recordBytes(hdr))) break;
+            continue;
+        }
+        // Event lists go straight to their destination
+        EventList* eventsTarget = &events;
+        UndoEntry* deltaTarget = &delta;
+        if (td && hdr.type == REC_TRACK_EVENTS) {
+            eventsTarget = &td->midiEvents;
+        } else if (td && undoRecord) {
+            td->midiHistory.emplace_back(td->arena);
+            td->midiHistory.back().open = (hdr.type == REC_UNDO_SNAPSHOT);
+            eventsTarget = &td->midiHistory.back().base;
+            deltaTarget = &td->midiHistory.back();
+        }
+        if (!readRecordBody(file, hdr, crc, payload, *eventsTarget, *deltaTarget)) break;
+        if (!begun) {
+            if (hdr.type != REC_CHECKPOINT_BEGIN || !validStorageHeader(hdr, payload, CHECKPOINT_MAGIC)) break;
+            fileGeneration = storageHeaderGeneration(payload);
+            paging = mayPage && fileEventSize == sizeof(MidiEvent);
+            begun = true;
+            continue;
+        }
+        bool ok = true;
+        switch (hdr.type) {
+            case REC_SESSION:
+                ok = hdr.length == sizeof(session);
+                if (ok) memcpy(&session, payload, sizeof(session));
+                break;
+            case REC_TRACK_STATE:
+                ok = hdr.length == sizeof(td->header);
+                if (ok) memcpy(&td->header, payload, sizeof(td->header));
+                break;
+            case REC_SYSEX_BYTES:
+                td->sysex.assign(sysexPayload.begin() + sizeof(uint32_t), sysexPayload.end());
+                break;
+            case REC_TRACK_EVENTS:
+            case REC_UNDO_SNAPSHOT:
+            case REC_UNDO_DELTA:
+                break;
+            case REC_CHECKPOINT_END: {
+                uint32_t endGeneration = 0;
+                ok = hdr.length == sizeof(endGeneration);
+                if (ok) memcpy(&endGeneration, payload, sizeof(endGeneration));
+                ended = ok && endGeneration == fileGeneration;
+                break;
+            }
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) break;
+    }
+    file.close();
+    if (!ended) {
+        Serial.print("[StorageManager] ERROR: Checkpoint incomplete or corrupt: ");
+        Serial.println(filename);
+        return false;
+    }
 
-    // Save all tracks
-    uint8_t numTracks = Config::NUM_TRACKS;
-    if (!writeRaw(file, &numTracks, sizeof(numTracks))) { Serial.println("[StorageManager] ERROR: Failed to write numTracks"); file.close(); return false; }
-    for (uint8_t t = 0; t < numTracks; ++t) {
-        Track &track = trackManager.getTrack(t);
-        // Track state
-        TrackState stateToSave = track.getState();
-        // Ensure we save the state as TRACK_PLAYING when still in overdubbing to avoid state machine corruption
-        if (stateToSave == TRACK_OVERDUBBING) stateToSave = TRACK_PLAYING;
-        uint32_t trackState = (uint32_t)stateToSave;
-        if (!writeRaw(file, &trackState, sizeof(trackState))) { Serial.print("[StorageManager] ERROR: Failed to write trackState for track "); Serial.println(t); file.close(); return false; }
-        // Muted
-        bool muted = track.isMuted();
-        if (!writeRaw(file, &muted, sizeof(muted))) { Serial.print("[StorageManager] ERROR: Failed to write muted for track "); Serial.println(t); file.close(); return false; }
-        // Timing
-        uint32_t startLoopTick = track.getStartLoopTick();
-        uint32_t loopLengthTicks = track.getLoopLength();
-        if (!writeRaw(file, &startLoopTick, sizeof(startLoopTick))) { Serial.print("[StorageManager] ERROR: Failed to write startLoopTick for track "); Serial.println(t); file.close(); return false; }
-        if (!writeRaw(file, &loopLengthTicks, sizeof(loopLengthTicks))) { Serial.print("[StorageManager] ERROR: Failed to write loopLengthTicks for track "); Serial.println(t); file.close(); return false; }
-        // MidiEvents
-        const auto &midiEvents = track.getMidiEvents();
-        uint32_t midiCount = midiEvents.size();
-        if (!writeRaw(file, &midiCount, sizeof(midiCount))) { Serial.print("[StorageManager] ERROR: Failed to write midiCount for track "); Serial.println(t); file.close(); return false; }
-        if (midiCount > 0 && !writeRaw(file, midiEvents.data(), midiCount * sizeof(MidiEvent))) { Serial.print("[StorageManager] ERROR: Failed to write midiEvents for track "); Serial.println(t); file.close(); return false; }
-        // Undo history (midi)
-        const auto &midiHistory = TrackUndo::getMidiHistory(track);
-        uint32_t undoCount = midiHistory.size();
-        if (!writeRaw(file, &undoCount, sizeof(undoCount))) { Serial.print("[StorageManager] ERROR: Failed to write undoCount for track "); Serial.println(t); file.close(); return false; }
-        for (const auto &snapshot : midiHistory) {
-            uint32_t snapCount = snapshot.size();
-            if (!writeRaw(file, &snapCount, sizeof(snapCount))) { Serial.print("[StorageManager] ERROR: Failed to write midiHistory snapCount for track "); Serial.println(t); file.close(); return false; }
-            if (snapCount > 0 && !writeRaw(file, snapshot.data(), snapCount * sizeof(MidiEvent))) { Serial.print("[StorageManager] ERROR: Failed to write midiHistory snapshot for track "); Serial.println(t); file.close(); return false; }
-        }
-    }
-    // Save selected track index
-    uint8_t selectedTrackIdx = trackManager.getSelectedTrackIndex();
-    if (!file.write(&selectedTrackIdx, sizeof(selectedTrackIdx))) {
-        Serial.println("[StorageManager] ERROR: Failed to write selected track index");
+    // Only apply loaded data if everything succeeded
+    applySessionRecord(session, state);
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        TrackLoadData& td = tracksData[t];
+        applyLoadedTrack(t, td.header, td.midiEvents, td.sysex, std::move(td.midiHistory), td.paged);
+    }
+    generation = fileGeneration;
+    Serial.print("[StorageManager] Checkpoint loaded, generation ");
+    Serial.println(generation);
+    return true;
+}
+
+static void applyJournalRecord(const RecordHeader& hdr, const uint8_t* payload,
+                               EventList& events, LooperState& state) {
+    Track& track = trackManager.getTrack(hdr.track);
+    switch (hdr.type) {
+        case REC_SESSION: {
+            SessionRecord r;
+            memcpy(&r, payload, sizeof(r));
+            applySessionRecord(r, state);
+            break;
+        }
+        case REC_TRACK_STATE: {
+            TrackStateRecord r;
+            memcpy(&r, payload, sizeof(r));
+            applyTrackStateRecord(track, r);
+            break;
+        }
+        case REC_TRACK_EVENTS:
+            if (!track.assignEvents(events)) {  // Copied into the track's arena
+                Serial.print("[StorageManager] ERROR: No track memory for the journaled events of track ");
+                Serial.println(hdr.track);
+            }
+            break;
+        case REC_EVENT_INSERT:
+            track.insertEvent(decodeEvent(payload));
+            break;
+        case REC_SYSEX_BYTES:
+            applySysExPayload(track.getSysExStore(), sysexPayload);
+            break;
+        case REC_EVENT_DELETE: {
+            MidiEvent evt = decodeEvent(payload);
+            auto& midiEvents = track.editMidiEvents();
+            for (auto it = midiEvents.begin(); it != midiEvents.end(); ++it) {
+                if (sameEvent(*it, evt)) { track.eraseEvent(it); break; }
+            }
+            break;
+        }
+        case REC_UNDO_PUSH:
+            TrackUndo::pushUndoSnapshot(track);
+            break;
+        case REC_UNDO_DROP:
+            TrackUndo::popLastUndo(track);
+            break;
+        case REC_UNDO_RESTORE:
+            TrackUndo::undoOverdub(track);
+            break;
+        case REC_TRACK_CLEAR:
+            // Mirror Track::clear() without going through the state machine
+            track.editMidiEvents().clear();
+            track.markEventsChanged();
+            TrackUndo::clearHistory(track);
+            track.setLoopLength(0);
+            track.forceSetState(TRACK_EMPTY);
+            break;
+        default:
+            break;
+    }
+}
+
+static uint32_t expectedPayloadSize(uint8_t type) {
+    switch (type) {
+        case REC_SESSION:      return sizeof(SessionRecord);
+        case REC_TRACK_STATE:  return sizeof(TrackStateRecord);
+        case REC_EVENT_INSERT:
+        case REC_EVENT_DELETE: return fileEventSize;
+        default:               return 0;
+    }
+}
+
+static bool validJournalRecord(const RecordHeader& hdr) {
+    if (hdr.track < Config::NUM_TRACKS && hdr.type == REC_SYSEX_BYTES) return true;  // Length checked on read
+    return hdr.track < Config::NUM_TRACKS && hdr.type >= REC_SESSION && hdr.type != REC_UNDO_SNAPSHOT &&
+           hdr.type <= REC_TRACK_CLEAR &&
+           (hdr.type == REC_TRACK_EVENTS || hdr.length == expectedPayloadSize(hdr.type));
+}
+
+// Journal BEGIN record of the live generation
+static bool openJournalForReplay(SectorReader& file) {
+    RecordHeader hdr;
+    uint8_t payload[RECORD_INLINE_MAX];
+    EventList events;
+    UndoEntry delta;
+    if (!readRecord(file, hdr, payload, events, delta) || hdr.type != REC_JOURNAL_BEGIN ||
+        !validStorageHeader(hdr, payload, JOURNAL_MAGIC) || storageHeaderGeneration(payload) != generation) {
+        Serial.println("[StorageManager] Journal does not match checkpoint, ignoring it");
+        return false;
+    }
+    return true;
+}
+
+// Replay the journal matching the loaded checkpoint. Returns false when the journal is
+// missing, belongs to another generation, or ends in a torn/corrupt record.
+static bool replayJournal(LooperState& state) {
+    SectorReader& file = cardReader;
+    if (!file.open(JOURNAL_FILENAME)) return false;
+
+    if (!openJournalForReplay(file)) {
         file.close();
         return false;
     }
+
+    RecordHeader hdr;
+    uint8_t payload[RECORD_INLINE_MAX];
+    EventList events;
+    UndoEntry delta;
+    uint32_t applied = 0;
+    bool clean = true;
+    while (file.position() < file.size()) {
+        if (!readRecord(file, hdr, payload, events, delta) || !validJournalRecord(hdr)) {
+            clean = false;
+            break;
+        }
+        applyJournalRecord(hdr, payload, events, state);
+        applied++;
+    }
     file.close();
-    Serial.println("[StorageManager] State saved successfully.");
-    return true;
+    Serial.print("[StorageManager] Journal records replayed: ");
+    Serial.println(applied);
+    if (!clean) Serial.println("[StorageManager] Journal ends in a torn or corrupt record; discarding the tail");
+    return clean;
 }
 
-bool StorageManager::loadState(LooperState& state) {
-    Serial.println("[StorageManager] Loading state from SD card...");
-    File file = SD.open(STORAGE_FILENAME, FILE_READ);
-    if (!file) {
+static bool loadLegacyState(LooperState& state) {
+    Serial.println("[StorageManager] Loading v1 state file...");
+    fileEventSize = LEGACY_EVENT_SIZE;  // v1 files predate the packed event layout
+    SectorReader& file = cardReader;
+    if (!file.open(STORAGE_FILENAME)) {
         Serial.print("[StorageManager] ERROR: Could not open file for reading: ");
         Serial.println(STORAGE_FILENAME);
         return false;
@@ -119,7 +1281,7 @@ bool StorageManager::loadState(LooperState& state) {
         return false;
     }
     Serial.println("[StorageManager] Version read OK");
-    if (version != STORAGE_VERSION) {
+    if (version != STORAGE_VERSION_V1) {
         Serial.print("[StorageManager] ERROR: Version mismatch. Found: ");
         Serial.println(version);
         file.close();
@@ -163,8 +1325,8 @@ bool StorageManager::loadState(LooperState& state) {
         bool muted;
         uint32_t startLoopTick;
         uint32_t loopLengthTicks;
-        std::vector<MidiEvent> midiEvents;
-        std::vector<std::vector<MidiEvent>> midiHistory;
+        EventList midiEvents;
+        std::vector<EventList> midiHistory;
     };
     std::vector<TrackLoadData> tracksData(numTracks);
 
@@ -204,7 +1366,7 @@ bool StorageManager::loadState(LooperState& state) {
             return false;
         }
         // Check for struct size mismatch or corrupt file
-        size_t midiBytesNeeded = midiCount * sizeof(MidiEvent);
+        size_t midiBytesNeeded = midiCount * fileEventSize;
         if ((file.size() - file.position()) < midiBytesNeeded) {
             Serial.print("[StorageManager] ERROR: Not enough bytes for midiEvents. Expected ");
             Serial.print(midiBytesNeeded);
@@ -214,8 +1376,9 @@ bool StorageManager::loadState(LooperState& state) {
             file.close();
             return false;
         }
-        std::vector<MidiEvent> midiEvents(midiCount);
-        if (midiCount > 0 && !readRaw(file, midiEvents.data(), midiCount * sizeof(MidiEvent))) {
+        EventList midiEvents;
+        uint32_t unusedCrc = 0;
+        if (!readEvents(file, midiEvents, midiCount, unusedCrc)) {
             Serial.print("[StorageManager] ERROR: Failed to read midiEvents for track "); Serial.println(t);
             file.close();
             return false;
@@ -227,7 +1390,7 @@ bool StorageManager::loadState(LooperState& state) {
             file.close();
             return false;
         }
-        std::vector<std::vector<MidiEvent>> midiHistory;
+        std::vector<EventList> midiHistory;
         for (uint32_t u = 0; u < undoCount; ++u) {
             uint32_t snapCount = 0;
             if (!readRaw(file, &snapCount, sizeof(snapCount))) {
@@ -236,7 +1399,7 @@ bool StorageManager::loadState(LooperState& state) {
                 return false;
             }
             // Check for struct size mismatch or corrupt file for snapshot
-            size_t snapBytesNeeded = snapCount * sizeof(MidiEvent);
+            size_t snapBytesNeeded = snapCount * fileEventSize;
             if ((file.size() - file.position()) < snapBytesNeeded) {
                 Serial.print("[StorageManager] ERROR: Not enough bytes for midiHistory snapshot. Expected ");
                 Serial.print(snapBytesNeeded);
@@ -246,8 +1409,8 @@ bool StorageManager::loadState(LooperState& state) {
                 file.close();
                 return false;
             }
-            std::vector<MidiEvent> snapshot(snapCount);
-            if (snapCount > 0 && !readRaw(file, snapshot.data(), snapCount * sizeof(MidiEvent))) {
+            EventList snapshot;
+            if (!readEvents(file, snapshot, snapCount, unusedCrc)) {
                 Serial.print("[StorageManager] ERROR: Failed to read midiHistory snapshot for track "); Serial.println(t);
                 file.close();
                 return false;
@@ -271,7 +1434,7 @@ bool StorageManager::loadState(LooperState& state) {
         trackManager.setSelectedTrack(0);
     }
     file.close();
-    Serial.println("[StorageManager] State loaded successfully.");
+    Serial.println("[StorageManager] v1 state loaded successfully.");
 
     // Only apply loaded data if everything succeeded
     state = loadedLooperState;
@@ -281,12 +1444,334 @@ bool StorageManager::loadState(LooperState& state) {
         track.forceSetState(tracksData[t].state);
         if (tracksData[t].muted != track.isMuted()) track.toggleMuteTrack();
         track.setLoopLength(tracksData[t].loopLengthTicks);
-        track.getMidiEvents() = tracksData[t].midiEvents;
-        auto &midiHistory = TrackUndo::getMidiHistory(track);
-        midiHistory.clear();
-        for (const auto& snapshot : tracksData[t].midiHistory) {
-            midiHistory.push_back(snapshot);
+        if (!track.assignEvents(tracksData[t].midiEvents)) {
+            Serial.print("[StorageManager] ERROR: No track memory for the events of track "); Serial.println(t);
+        }
+        track.getSysExStore().reset();  // v1 kept SysEx as pointers, never their bytes
+        std::deque<UndoEntry> history;
+        for (auto& snapshot : tracksData[t].midiHistory) {
+            history.emplace_back();
+            history.back().open = true;
+            history.back().base.swap(snapshot);
+        }
+        TrackUndo::restoreHistory(track, std::move(history));
+    }
+    return true;
+}
+
+bool StorageManager::loadState(LooperState& state) {
+    Serial.println("[StorageManager] Loading state from SD card...");
+    replaying = true;
+    legacyLayoutLoaded = false;
+    // Levels of a previous load refer to a checkpoint that may not survive this one
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) pagedUndo[t].clear();
+    pagedSerial++;
+    bool loaded = loadCheckpoint(CHECKPOINT_FILENAME, state);
+    // Power lost between removing the old checkpoint and renaming the new one into place
+    if (!loaded && SD.exists(CHECKPOINT_TEMP_FILENAME)) loaded = loadCheckpoint(CHECKPOINT_TEMP_FILENAME, state);
+    bool journalClean = loaded && replayJournal(state);
+    if (journalClean && legacyLayoutLoaded) {
+        // New records must not be appended to a journal in the old event layout
+        Serial.println("[StorageManager] Converting 16-byte events to the packed layout");
+        journalClean = false;
+    }
+    bool migrated = false;
+    if (!loaded && SD.exists(STORAGE_FILENAME)) {
+        loaded = migrated = loadLegacyState(state);
+    }
+    replaying = false;
+    storageReady = true;
+
+    captureJournaledHeaders(state);
+    if (journalClean) {
+        openJournalForAppend();
+    } else {
+        // Fresh card, migrated v1 file, legacy layout or damaged journal: start over from a new checkpoint
+        if (saveState(state) && migrated) {
+            SD.remove(STORAGE_FILENAME);
+            Serial.println("[StorageManager] Migrated v1 state file to checkpoint + journal");
+        }
+    }
+    if (loaded) Serial.println("[StorageManager] State loaded successfully.");
+    return loaded;
+}
+
+// -------------------------
+// Background restore
+// -------------------------
+// beginRestore() reads the checkpoint one record (or one chunk of events) per step from
+// update(). Each track is installed as soon as its records are complete, so it can play while
+// the next one loads. The journal is then replayed a record per step onto the live tracks. A
+// layout the incremental reader does not handle (temporary checkpoint, v1 file, 16-byte
+// events) or a corrupt checkpoint falls back to the synchronous loadState().
+
+static constexpr uint32_t RESTORE_CHUNK_EVENTS = 256;   // checkpoint events read per step
+
+enum RestoreStage : uint8_t {
+    RESTORE_IDLE,
+    RESTORE_CHECKPOINT,
+    RESTORE_TRACK_EVENTS,
+    RESTORE_JOURNAL
+};
+
+struct RestoreJob {
+    RestoreStage stage = RESTORE_IDLE;
+    SectorReader file;
+    LooperState* state = nullptr;
+    bool begun = false;
+    uint32_t fileGeneration = 0;
+    int16_t track = -1;                       // track whose records are being read
+    TrackStateRecord header = {};
+    std::vector<EventList> staged;            // per track, on the track's arena (see stagingArena())
+    std::vector<uint8_t> sysex;               // SysEx store of the track being read
+    std::vector<PagedUndoRecord> paged;
+    uint32_t eventOffset = 0;                 // events of the TRACK_EVENTS record read so far
+    uint32_t crc = 0;                         // running CRC of that record
+    uint32_t applied = 0;                     // journal records replayed
+};
+
+static RestoreJob restoreJob;
+
+static void applyRestoredTrack() {
+    if (restoreJob.track < 0) return;
+    uint8_t t = (uint8_t)restoreJob.track;
+    restoreJob.track = -1;
+    Track& track = trackManager.getTrack(t);
+    if (((restoreTouched >> t) & 1) || !track.isEmpty() || track.getState() != TRACK_EMPTY) {
+        restoreTouched |= 1u << t;
+        Serial.print("[StorageManager] Track ");
+        Serial.print(t);
+        Serial.println(" changed before its saved state was restored, keeping it");
+        return;
+    }
+    applyLoadedTrack(t, restoreJob.header, restoreJob.staged[t], restoreJob.sysex, std::deque<UndoEntry>(),
+                     restoreJob.paged);
+    journaledTrack[t] = restoreJob.header;
+    restoredTracks |= 1u << t;
+}
+
+static void endRestore() {
+    restoreJob.file.close();
+    std::vector<EventList>().swap(restoreJob.staged);
+    std::vector<uint8_t>().swap(restoreJob.sysex);
+    restoreJob.stage = RESTORE_IDLE;
+    restoring = false;
+}
+
+static bool fallBackToLoadState() {
+    Serial.println("[StorageManager] Background restore not possible, loading synchronously");
+    endRestore();
+    // Start the full load from empty tracks
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        if (!((restoredTracks >> t) & 1)) continue;
+        Track& track = trackManager.getTrack(t);
+        track.editMidiEvents().clear();
+        track.markEventsChanged();
+        track.getSysExStore().reset();
+        TrackUndo::clearHistory(track);
+        track.setLoopLength(0);
+        track.forceSetState(TRACK_EMPTY);
+    }
+    restoredTracks = 0;
+    return StorageManager::loadState(*restoreJob.state);
+}
+
+static void finishRestore(bool journalClean) {
+    endRestore();
+    storageReady = true;
+    Serial.print("[StorageManager] Journal records replayed: ");
+    Serial.println(restoreJob.applied);
+    if (journalClean && restoreTouched == 0) {
+        openJournalForAppend();
+    } else {
+        // Damaged journal, or changes made while restoring that were not journaled:
+        // update() writes everything into a new checkpoint
+        journalBroken = true;
+    }
+    // Header values the user changed meanwhile differ from the journaled ones
+    headerCheckDue = true;
+    Serial.println("[StorageManager] State restored.");
+}
+
+// One checkpoint record; false when the checkpoint cannot be restored incrementally
+static bool restoreCheckpointStep() {
+    SectorReader& file = restoreJob.file;
+    uint32_t offset = file.position();
+    RecordHeader hdr;
+    uint32_t crc = 0;
+    uint8_t payload[RECORD_INLINE_MAX];
+    EventList events;
+    UndoEntry delta;
+    if (!readRecordHeader(file, hdr, crc)) return false;
+
+    if (!restoreJob.begun) {
+        if (hdr.type != REC_CHECKPOINT_BEGIN || !readRecordBody(file, hdr, crc, payload, events, delta) ||
+            !validStorageHeader(hdr, payload, CHECKPOINT_MAGIC)) {
+            return false;
+        }
+        if (fileEventSize != sizeof(MidiEvent)) return false;  // Converted by loadState()
+        restoreJob.fileGeneration = storageHeaderGeneration(payload);
+        restoreJob.begun = true;
+        return true;
+    }
+    if (hdr.track >= Config::NUM_TRACKS) return false;
+
+    switch (hdr.type) {
+        case REC_SESSION: {
+            if (hdr.length != sizeof(SessionRecord) || !readRecordBody(file, hdr, crc, payload, events, delta)) return false;
+            memcpy(&journaledSession, payload, sizeof(journaledSession));
+            applySessionRecord(journaledSession, *restoreJob.state);
+            return true;
+        }
+        case REC_TRACK_STATE: {
+            if (hdr.length != sizeof(TrackStateRecord) || !readRecordBody(file, hdr, crc, payload, events, delta)) return false;
+            applyRestoredTrack();
+            restoreJob.track = hdr.track;
+            memcpy(&restoreJob.header, payload, sizeof(restoreJob.header));
+            restoreJob.sysex.clear();
+            restoreJob.paged.clear();
+            return true;
         }
+        case REC_SYSEX_BYTES:
+            if (hdr.track != restoreJob.track || !readRecordBody(file, hdr, crc, payload, events, delta)) return false;
+            restoreJob.sysex.assign(sysexPayload.begin() + sizeof(uint32_t), sysexPayload.end());
+            return true;
+        case REC_TRACK_EVENTS: {
+            // Read in chunks by RESTORE_TRACK_EVENTS
+            uint32_t count = 0;
+            if (hdr.track != restoreJob.track || hdr.length < sizeof(count)) return false;
+            if (file.read((uint8_t*)&count, sizeof(count)) != (int)sizeof(count)) return false;
+            if (hdr.length != sizeof(count) + (uint64_t)count * sizeof(MidiEvent)) return false;
+            restoreJob.crc = crc32Update(crc, &count, sizeof(count));
+            if (!resizeForRecord(restoreJob.staged[hdr.track], count)) return false;
+            restoreJob.eventOffset = 0;
+            restoreJob.stage = RESTORE_TRACK_EVENTS;
+            return true;
+        }
+        case REC_UNDO_SNAPSHOT:
+        case REC_UNDO_DELTA:
+            // Left on the card, as in loadCheckpoint()
+            if (hdr.track != restoreJob.track) return false;
+            restoreJob.paged.push_back({offset, recordBytes(hdr), hdr.type});
+            return file.seek(offset + recordBytes(hdr));
+        case REC_CHECKPOINT_END: {
+            uint32_t endGeneration = 0;
+            if (hdr.length != sizeof(endGeneration) || !readRecordBody(file, hdr, crc, payload, events, delta)) return false;
+            memcpy(&endGeneration, payload, sizeof(endGeneration));
+            if (endGeneration != restoreJob.fileGeneration) return false;
+            applyRestoredTrack();
+            file.close();
+            generation = restoreJob.fileGeneration;
+            Serial.print("[StorageManager] Checkpoint restored, generation ");
+            Serial.println(generation);
+            restoreJob.applied = 0;
+            if (!restoreJob.file.open(JOURNAL_FILENAME) || !openJournalForReplay(restoreJob.file)) {
+                finishRestore(false);
+                return true;
+            }
+            restoreJob.stage = RESTORE_JOURNAL;
+            return true;
+        }
+        default:
+            return false;
     }
+}
+
+static bool restoreEventsStep() {
+    EventList& events = restoreJob.staged[restoreJob.track];
+    uint32_t remaining = events.size() - restoreJob.eventOffset;
+    uint32_t n = remaining < RESTORE_CHUNK_EVENTS ? remaining : RESTORE_CHUNK_EVENTS;
+    uint32_t bytes = n * sizeof(MidiEvent);
+    MidiEvent* dst = events.data() + restoreJob.eventOffset;
+    if (bytes > 0 && restoreJob.file.read((uint8_t*)dst, bytes) != (int)bytes) return false;
+    restoreJob.crc = crc32Update(restoreJob.crc, dst, bytes);
+    restoreJob.eventOffset += n;
+    if (restoreJob.eventOffset < events.size()) return true;
+    uint32_t storedCrc = 0;
+    if (restoreJob.file.read((uint8_t*)&storedCrc, sizeof(storedCrc)) != (int)sizeof(storedCrc)) return false;
+    restoreJob.stage = RESTORE_CHECKPOINT;
+    return storedCrc == restoreJob.crc;
+}
+
+// One journal record onto the live tracks
+static void restoreJournalStep() {
+    SectorReader& file = restoreJob.file;
+    if (file.position() >= file.size()) {
+        finishRestore(true);
+        return;
+    }
+    RecordHeader hdr;
+    uint8_t payload[RECORD_INLINE_MAX];
+    EventList events;
+    UndoEntry delta;
+    if (!readRecord(file, hdr, payload, events, delta) || !validJournalRecord(hdr)) {
+        Serial.println("[StorageManager] Journal ends in a torn or corrupt record; discarding the tail");
+        finishRestore(false);
+        return;
+    }
+    restoreJob.applied++;
+    if ((restoreTouched >> hdr.track) & 1) return;  // The user's content replaced the saved one
+    // Keep the journaled header values in step, as journalHeaderChanges() would
+    if (hdr.type == REC_SESSION) memcpy(&journaledSession, payload, sizeof(journaledSession));
+    if (hdr.type == REC_TRACK_STATE) memcpy(&journaledTrack[hdr.track], payload, sizeof(TrackStateRecord));
+    if (hdr.type == REC_TRACK_CLEAR) {
+        journaledTrack[hdr.track].state = TRACK_EMPTY;
+        journaledTrack[hdr.track].startLoopTick = 0;
+        journaledTrack[hdr.track].loopLengthTicks = 0;
+    }
+    replaying = true;
+    applyJournalRecord(hdr, payload, events, *restoreJob.state);
+    replaying = false;
+}
+
+static void restoreSlice(uint32_t sliceStart, uint32_t budgetMicros) {
+    while (restoring && (micros() - sliceStart) < budgetMicros) {
+        bool ok = true;
+        switch (restoreJob.stage) {
+            case RESTORE_CHECKPOINT:   ok = restoreCheckpointStep(); break;
+            case RESTORE_TRACK_EVENTS: ok = restoreEventsStep(); break;
+            case RESTORE_JOURNAL:      restoreJournalStep(); break;
+            default:                   endRestore(); break;
+        }
+        if (!ok) {
+            Serial.println("[StorageManager] ERROR: Checkpoint incomplete or corrupt: " CHECKPOINT_FILENAME);
+            fallBackToLoadState();
+        }
+    }
+}
+
+bool StorageManager::beginRestore(LooperState& state) {
+    abortSaveJob();
+    restoreJob.state = &state;
+    legacyLayoutLoaded = false;
+    storageReady = false;
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) pagedUndo[t].clear();
+    pagedSerial++;
+    restoreTouched = 0;
+    restoredTracks = 0;
+    // The restored state supersedes anything buffered
+    pendingJournal.clear();
+    pendingOffset = 0;
+    journalFile.close();
+    if (!restoreJob.file.open(CHECKPOINT_FILENAME)) return loadState(state);  // Fresh card, interrupted compaction or v1 file
+
+    Serial.println("[StorageManager] Restoring state in the background...");
+    restoreJob.staged.clear();
+    restoreJob.staged.reserve(Config::NUM_TRACKS);
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        restoreJob.staged.emplace_back(ArenaAllocator<MidiEvent>(stagingArena(trackManager.getTrack(t))));
+    }
+    restoreJob.begun = false;
+    restoreJob.track = -1;
+    restoreJob.stage = RESTORE_CHECKPOINT;
+    restoring = true;
     return true;
-} 
\ No newline at end of file
+}
+
+bool StorageManager::isRestoring() {
+    return restoring;
+}
+
+bool StorageManager::isTrackRestored(uint8_t track) {
+    return !restoring || (((restoredTracks | restoreTouched) >> track) & 1);
+}
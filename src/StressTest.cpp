@@ -0,0 +1,335 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "StressTest.h"
+
+#ifdef LOOPER_STRESS
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "Globals.h"
+#include "ClockManager.h"
+#include "Logger.h"
+#include "MidiHandler.h"
+#include "TimeSignature.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+
+namespace {
+
+// One generated message; tick is relative to the start of recording
+struct StreamEvent {
+  uint32_t tick;
+  uint8_t type;
+  uint8_t data1;
+  uint8_t data2;
+};
+
+constexpr uint8_t STREAM_BASE_PITCH = 36;
+constexpr uint8_t STREAM_PITCH_SPAN = 48;
+constexpr uint8_t STREAM_CC = 74;
+
+// Output tap state, live while a run is capturing playback
+bool capturing = false;
+bool tapSimulated = true;
+uint8_t tapChannel = 0;
+uint32_t tapLoopLength = 0;
+uint32_t tapWindowStart = 0;
+uint32_t tapWindowEnd = 0;
+uint32_t tapNowTick = 0;  // Simulated wall-clock tick
+StressReport* tapReport = nullptr;
+std::map<uint64_t, uint32_t> playedCounts;
+
+uint64_t eventKey(uint8_t type, uint8_t data1, uint32_t tickInLoop) {
+  return ((uint64_t)type << 40) | ((uint64_t)data1 << 32) | tickInLoop;
+}
+
+uint8_t latenessBucket(uint32_t ticks) {
+  if (ticks <= 2) return ticks;
+  uint8_t bucket = 3;
+  uint32_t limit = 4;
+  while (ticks > limit && bucket < StressReport::LATENESS_BUCKETS - 1) {
+    limit *= 2;
+    bucket++;
+  }
+  return bucket;
+}
+
+// Notes on a fixed grid with random velocities, pitches rotating so a pitch is never reused
+// while it still sounds; optional CC sweep. Everything ends a 16th before the loop does.
+void generateStream(const StressConfig& config, uint32_t loopLength, std::vector<StreamEvent>& out) {
+  uint32_t rng = config.seed ? config.seed : 1;
+  auto random7 = [&rng]() {
+    rng = rng * 1664525u + 1013904223u;
+    return (uint8_t)((rng >> 16) & 0x7F);
+  };
+
+  const uint32_t tail = Config::TICKS_PER_16TH_STEP;
+  const uint8_t chord = std::max<uint8_t>(1, std::min<uint8_t>(config.chordSize, STREAM_PITCH_SPAN));
+  const uint32_t interval = std::max<uint32_t>(1, ticksPerQuarterNote / std::max<uint8_t>(1, config.notesPerBeat));
+  const uint32_t reuseTicks = (STREAM_PITCH_SPAN / chord) * interval;
+  const uint32_t noteLength = std::max<uint32_t>(1, std::min<uint32_t>(config.noteLengthTicks, reuseTicks - 1));
+
+  out.clear();
+  uint32_t onset = 0;
+  for (uint32_t t = 0; t + noteLength + tail < loopLength; t += interval, ++onset) {
+    for (uint8_t j = 0; j < chord; ++j) {
+      uint8_t pitch = STREAM_BASE_PITCH + (onset * chord + j) % STREAM_PITCH_SPAN;
+      out.push_back({t, midi::NoteOn, pitch, (uint8_t)(random7() | 1)});
+      out.push_back({t + noteLength, midi::NoteOff, pitch, 0});
+    }
+  }
+  if (config.ccPerBeat) {
+    uint32_t ccInterval = std::max<uint32_t>(1, ticksPerQuarterNote / config.ccPerBeat);
+    for (uint32_t t = 0; t + tail < loopLength; t += ccInterval) {
+      out.push_back({t, midi::ControlChange, STREAM_CC, random7()});
+    }
+  }
+  std::stable_sort(out.begin(), out.end(),
+                   [](const StreamEvent& a, const StreamEvent& b) { return a.tick < b.tick; });
+}
+
+// Match the track's events against the stream by type, data1 and tick
+void compareRecording(const std::vector<StreamEvent>& stream, const EventList& events, StressReport& report) {
+  std::map<uint16_t, std::vector<uint32_t>> recordedTicks;
+  for (const MidiEvent& e : events) {
+    recordedTicks[(uint16_t)((e.type << 8) | e.data.noteData.note)].push_back(e.tick);
+  }
+  for (const StreamEvent& s : stream) {
+    auto it = recordedTicks.find((uint16_t)((s.type << 8) | s.data1));
+    if (it == recordedTicks.end() || it->second.empty()) {
+      report.recordMissed++;
+      continue;
+    }
+    std::vector<uint32_t>& ticks = it->second;
+    size_t best = 0;
+    uint32_t bestError = UINT32_MAX;
+    for (size_t i = 0; i < ticks.size(); ++i) {
+      uint32_t error = ticks[i] > s.tick ? ticks[i] - s.tick : s.tick - ticks[i];
+      if (error < bestError) {
+        bestError = error;
+        best = i;
+      }
+    }
+    if (bestError > Config::TICKS_PER_CLOCK) {
+      report.recordMissed++;
+      continue;
+    }
+    if (bestError > 0) report.recordShifted++;
+    report.recordMaxErrorTicks = std::max(report.recordMaxErrorTicks, bestError);
+    ticks.erase(ticks.begin() + best);
+  }
+  for (const auto& entry : recordedTicks) report.recordExtra += entry.second.size();
+}
+
+void comparePlayback(const EventList& events, uint32_t loopLength, uint8_t passes, StressReport& report) {
+  std::map<uint64_t, uint32_t> expected;
+  for (const MidiEvent& e : events) {
+    expected[eventKey(e.type, e.data.noteData.note, e.tick % loopLength)] += passes;
+  }
+  report.expectedPlayback = events.size() * passes;
+  for (const auto& entry : expected) {
+    auto it = playedCounts.find(entry.first);
+    uint32_t got = it == playedCounts.end() ? 0 : it->second;
+    if (got < entry.second) report.playMissed += entry.second - got;
+    else report.playExtra += got - entry.second;
+  }
+  for (const auto& entry : playedCounts) {
+    if (expected.find(entry.first) == expected.end()) report.playExtra += entry.second;
+  }
+}
+
+}  // namespace
+
+StressReport StressTest::run(const StressConfig& config) {
+  StressReport report;
+  if (config.trackIndex >= Config::NUM_TRACKS || config.loopBars == 0 || config.notesPerBeat == 0) {
+    return report;
+  }
+  if (!config.simulatedClock && !clockManager.isClockRunning()) {
+    logger.error("StressTest: start the clock before a run against it");
+    return report;
+  }
+
+  const uint32_t loopLength = config.loopBars * timeSignature.ticksPerBar();
+  std::vector<StreamEvent> stream;
+  generateStream(config, loopLength, stream);
+  const uint32_t lastStreamTick = stream.empty() ? 0 : stream.back().tick;
+
+  Track& track = trackManager.getTrack(config.trackIndex);
+  uint8_t previousSelection = trackManager.getSelectedTrackIndex();
+  if (!track.isEmpty()) track.clear();
+  TrackUndo::clearHistory(track);
+  track.resetPlaybackStats();
+  trackManager.setSelectedTrack(config.trackIndex);
+  // Every message of the stream is matched against the recording
+  const bool thinning = midiHandler.getControllerThinning();
+  midiHandler.setControllerThinning(false);
+
+  const uint32_t inputOverflowsBefore = midiHandler.getInputOverflowCount();
+  const uint32_t droppedTicksBefore = clockManager.getDroppedTickEvents();
+  const uint32_t logDroppedBefore = logger.getDroppedCount();
+
+  const uint32_t t0 = config.simulatedClock ? 0 : clockManager.getCurrentTick() + 1;
+  const uint32_t recordEnd = t0 + loopLength;
+  const uint32_t end = recordEnd + config.playbackLoops * loopLength;
+  const uint32_t microsPerTick = (uint32_t)(60000000.0f / (bpm * ticksPerQuarterNote));
+
+  playedCounts.clear();
+  tapReport = &report;
+  tapSimulated = config.simulatedClock;
+  tapChannel = config.channel;
+  tapLoopLength = loopLength;
+  tapWindowStart = recordEnd;
+  tapWindowEnd = end;
+
+  track.setState(TRACK_ARMED);
+  track.startRecording(t0);
+
+  size_t nextInput = 0;
+  bool recordingClosed = false;
+
+  // One pass of loop(): tick processing first, then the input that has arrived by `now`
+  uint32_t nextTick = t0;
+  auto service = [&](uint32_t now) {
+    if (config.simulatedClock) {
+      tapNowTick = now;
+      while (nextTick <= now) trackManager.updateAllTracks(nextTick++);
+    } else {
+      clockManager.processPendingTicks();
+    }
+    while (nextInput < stream.size() && t0 + stream[nextInput].tick <= now) {
+      const StreamEvent& s = stream[nextInput++];
+      MidiInputStamp stamp{micros(), t0 + s.tick, 0};
+      midiHandler.handleMidiMessage(s.type, config.channel, s.data1, s.data2, stamp);
+      report.sent++;
+    }
+    // Close the loop once the whole take is in, like a stop pressed in the quiet tail
+    if (!recordingClosed && nextInput == stream.size() && now > t0 + lastStreamTick) {
+      track.stopRecording(recordEnd);
+      track.stopOverdubbing();
+      capturing = true;
+      recordingClosed = true;
+    }
+  };
+
+  if (config.simulatedClock) {
+    for (uint32_t now = t0; now < end; ++now) {
+      bool stalled = config.stallEveryTicks && (now - t0) % config.stallEveryTicks < config.stallTicks;
+      if (!stalled) service(now);
+    }
+    service(end - 1);
+  } else {
+    uint32_t nextStall = t0 + config.stallEveryTicks;
+    const uint32_t drainUntil = end + config.stallTicks + Config::TICKS_PER_CLOCK;
+    for (;;) {
+      uint32_t now = clockManager.getCurrentTick();
+      if (now >= drainUntil) break;
+      if (config.stallEveryTicks && now >= nextStall) {
+        nextStall += config.stallEveryTicks;
+        delayMicroseconds(config.stallTicks * microsPerTick);  // The clock ISR keeps running
+        continue;
+      }
+      service(now);
+    }
+  }
+  capturing = false;
+  tapReport = nullptr;
+
+  report.completed = recordingClosed;
+  report.recorded = track.getMidiEventCount();
+  compareRecording(stream, track.getMidiEvents(), report);
+  comparePlayback(track.getMidiEvents(), loopLength, config.playbackLoops, report);
+  report.playbackJumps = track.getPlaybackJumpCount();
+  report.skippedTicks = track.getSkippedTickCount();
+  report.playbackOverruns = track.getOverrunCount();
+  report.playbackDropped = track.getDroppedEventCount();
+  report.tickQueueHighWater = clockManager.getTickQueueHighWater();
+  report.droppedTicks = clockManager.getDroppedTickEvents() - droppedTicksBefore;
+  report.inputHighWater = midiHandler.getInputHighWaterMark();
+  report.inputOverflows = midiHandler.getInputOverflowCount() - inputOverflowsBefore;
+  report.logDropped = logger.getDroppedCount() - logDroppedBefore;
+
+  // Leave the scratch track empty again
+  track.clear();
+  TrackUndo::clearHistory(track);
+  trackManager.setSelectedTrack(previousSelection);
+  midiHandler.setControllerThinning(thinning);
+  return report;
+}
+
+void StressTest::onOutput(const MidiEvent& event) {
+  if (!capturing || !tapReport || event.channel != tapChannel) return;
+  uint32_t now = tapSimulated ? tapNowTick : clockManager.getCurrentTick();
+  uint32_t tickInLoop = event.tick % tapLoopLength;
+
+  // Offset from the nearest tick where this event was due; beyond half a loop counts as early
+  uint32_t offset = (now % tapLoopLength + tapLoopLength - tickInLoop) % tapLoopLength;
+  bool early = offset > tapLoopLength / 2;
+  uint32_t due = early ? now + (tapLoopLength - offset) : now - offset;
+  if (due < tapWindowStart || due >= tapWindowEnd) return;
+
+  StressReport& report = *tapReport;
+  report.played++;
+  playedCounts[eventKey(event.type, event.data.noteData.note, tickInLoop)]++;
+  if (early) {
+    report.early++;
+    return;
+  }
+  report.lateness[latenessBucket(offset)]++;
+  report.totalLatenessTicks += offset;
+  report.maxLatenessTicks = std::max(report.maxLatenessTicks, offset);
+}
+
+void StressTest::print(const StressReport& report, Print& out) {
+  static const char* const bucketNames[StressReport::LATENESS_BUCKETS] = {
+    "0", "1", "2", "3-4", "5-8", "9-16", "17-32", ">32"
+  };
+  out.printf("[StressTest] %s\n", report.passed() ? "PASS" : "FAIL");
+  if (!report.completed) {
+    out.println("  run did not complete");
+    return;
+  }
+  out.printf("  record: sent=%lu recorded=%lu missed=%lu shifted=%lu extra=%lu maxErr=%lu ticks\n",
+             (unsigned long)report.sent, (unsigned long)report.recorded, (unsigned long)report.recordMissed,
+             (unsigned long)report.recordShifted, (unsigned long)report.recordExtra,
+             (unsigned long)report.recordMaxErrorTicks);
+  out.printf("  playback: expected=%lu played=%lu missed=%lu extra=%lu early=%lu jumps=%lu skippedTicks=%lu "
+             "overruns=%lu dropped=%lu\n",
+             (unsigned long)report.expectedPlayback, (unsigned long)report.played,
+             (unsigned long)report.playMissed, (unsigned long)report.playExtra, (unsigned long)report.early,
+             (unsigned long)report.playbackJumps, (unsigned long)report.skippedTicks,
+             (unsigned long)report.playbackOverruns, (unsigned long)report.playbackDropped);
+  uint32_t onTime = report.played - report.early;
+  out.printf("  lateness: max=%lu mean=%.2f ticks; histogram", (unsigned long)report.maxLatenessTicks,
+             onTime ? (double)report.totalLatenessTicks / onTime : 0.0);
+  for (uint8_t b = 0; b < StressReport::LATENESS_BUCKETS; ++b) {
+    if (report.lateness[b]) out.printf(" %s:%lu", bucketNames[b], (unsigned long)report.lateness[b]);
+  }
+  out.println();
+  out.printf("  queues: tick hw=%lu/%u dropped=%lu; input hw=%lu overflows=%lu; log dropped=%lu\n",
+             (unsigned long)report.tickQueueHighWater, (unsigned)ClockManager::TICK_QUEUE_SIZE,
+             (unsigned long)report.droppedTicks, (unsigned long)report.inputHighWater,
+             (unsigned long)report.inputOverflows, (unsigned long)report.logDropped);
+}
+
+void StressTest::pollSerial() {
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c != 's' && c != 'S') continue;
+    StressConfig config;
+    config.trackIndex = Config::NUM_TRACKS - 1;
+    if (c == 'S') {
+      config.notesPerBeat = 16;
+      config.chordSize = 4;
+      config.ccPerBeat = 8;
+      config.simulatedClock = false;
+    }
+    Serial.printf("[StressTest] Running on track %u (%s clock)\n", config.trackIndex + 1,
+                  config.simulatedClock ? "simulated" : "running");
+    print(run(config), Serial);
+  }
+}
+
+#endif  // LOOPER_STRESS
@@ -0,0 +1,74 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "SysExStore.h"
+#include "Globals.h"
+#include <algorithm>
+#include <string.h>
+
+static_assert(Config::SYSEX_STORE_BYTES <= 0x10000, "SysEx events address their store with 16-bit offsets");
+
+static constexpr size_t MIN_GROWTH_BYTES = 256;
+
+// Capacity the pool grows to for one more message: doubling, within the configured limit
+static size_t grownCapacity(size_t capacity, size_t need) {
+  size_t grown = std::max({capacity * 2, need, MIN_GROWTH_BYTES});
+  return std::min(grown, (size_t)Config::SYSEX_STORE_BYTES);
+}
+
+size_t SysExStore::growthFor(uint16_t length) const {
+  size_t need = bytes.size() + HEADER + length;
+  if (need <= bytes.capacity()) return 0;
+  return grownCapacity(bytes.capacity(), need);
+}
+
+bool SysExStore::append(const uint8_t* data, uint16_t length, uint16_t& offset) {
+  if (length < 2 || data[0] != 0xF0 || data[length - 1] != 0xF7) return false;
+  size_t need = bytes.size() + HEADER + length;
+  if (need > Config::SYSEX_STORE_BYTES) return false;
+  if (need > bytes.capacity()) {
+    size_t grown = grownCapacity(bytes.capacity(), need);
+    if (!fits(grown)) return false;
+    bytes.reserve(grown);
+  }
+  offset = (uint16_t)bytes.size();
+  bytes.push_back(length & 0xFF);
+  bytes.push_back(length >> 8);
+  bytes.insert(bytes.end(), data, data + length);
+  return true;
+}
+
+// The arena (when the pool has one) can hold a pool of `capacity` bytes
+bool SysExStore::fits(size_t capacity) const {
+  TrackArena* arena = bytes.get_allocator().arena;
+  return !arena || arena->canAllocate(capacity);
+}
+
+const uint8_t* SysExStore::message(uint16_t offset, uint16_t& length) const {
+  length = 0;
+  if ((size_t)offset + HEADER > bytes.size()) return nullptr;
+  uint16_t n = bytes[offset] | (bytes[offset + 1] << 8);
+  const uint8_t* msg = bytes.data() + offset + HEADER;
+  if (n < 2 || (size_t)offset + HEADER + n > bytes.size() || msg[0] != 0xF0 || msg[n - 1] != 0xF7) return nullptr;
+  length = n;
+  return msg;
+}
+
+void SysExStore::restore(uint32_t offset, const uint8_t* data, uint32_t length) {
+  if ((size_t)offset + length > Config::SYSEX_STORE_BYTES) return;
+  if ((size_t)offset + length > bytes.capacity()) {
+    if (!fits(offset + length)) return;
+    bytes.reserve(offset + length);
+  }
+  bytes.resize(offset);
+  bytes.insert(bytes.end(), data, data + length);
+}
+
+void SysExStore::truncate(size_t size) {
+  if (size < bytes.size()) bytes.resize(size);
+}
+
+void SysExStore::reset() {
+  bytes.clear();
+  bytes.shrink_to_fit();
+}
@@ -0,0 +1,86 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "TimeSignature.h"
+
+TimeSignature timeSignature;
+
+const Timing::TickDivider TimeSignature::SIXTEENTH(Config::TICKS_PER_16TH_STEP);
+const Timing::TickDivider TimeSignature::CLOCK(Config::TICKS_PER_CLOCK);
+
+TimeSignature::TimeSignature() {
+  reset();
+}
+
+TimeSignature::Segment TimeSignature::makeSegment(Timing::Meter meter, uint32_t startTick, uint32_t startBar) {
+  Segment seg;
+  seg.startTick = startTick;
+  seg.startBar = startBar;
+  seg.meter = meter;
+  seg.bar = Timing::TickDivider(Config::TIMING.ticksPerBar(meter));
+  seg.beat = Timing::TickDivider(Config::TIMING.ticksPerBeat(meter));
+  return seg;
+}
+
+bool TimeSignature::reset(Timing::Meter meter) {
+  if (!meter.valid()) return false;
+  segments[0] = makeSegment(meter, 0, 0);
+  count = 1;
+  return true;
+}
+
+bool TimeSignature::setMeter(Timing::Meter meter, uint32_t tick) {
+  if (!meter.valid()) return false;
+  const Segment& at = segmentAt(tick);
+  uint32_t bars, inBar;
+  at.bar.divmod(tick - at.startTick, bars, inBar);
+  if (inBar) ++bars;
+  uint32_t startTick = at.startTick + bars * at.bar.divisor();
+  uint32_t startBar = at.startBar + bars;
+  if (startTick == 0) return reset(meter);
+
+  // Changes at or after the new one are replaced by it (set after a locate backwards)
+  while (count > 1 && segments[count - 1].startTick >= startTick) --count;
+  if (segments[count - 1].meter == meter) return true;
+  if (count == Config::METER_CHANGES) {
+    // Dropping the second entry lets the first one extend over it; later bar numbers stay right
+    for (uint8_t i = 1; i + 1 < count; ++i) segments[i] = segments[i + 1];
+    --count;
+  }
+  segments[count++] = makeSegment(meter, startTick, startBar);
+  return true;
+}
+
+const TimeSignature::Segment& TimeSignature::segmentAt(uint32_t tick) const {
+  for (uint8_t i = count - 1; i > 0; --i) {
+    if (tick >= segments[i].startTick) return segments[i];
+  }
+  return segments[0];
+}
+
+bool TimeSignature::isBarStart(uint32_t tick) const {
+  const Segment& seg = segmentAt(tick);
+  return seg.bar.mod(tick - seg.startTick) == 0;
+}
+
+uint32_t TimeSignature::barStartAtOrBefore(uint32_t tick) const {
+  const Segment& seg = segmentAt(tick);
+  return tick - seg.bar.mod(tick - seg.startTick);
+}
+
+TimeSignature::Position TimeSignature::positionIn(const Segment& seg, uint32_t ticks, uint32_t firstBar) {
+  uint32_t bars, inBar, beats, inBeat, sixteenths, inSixteenth;
+  seg.bar.divmod(ticks, bars, inBar);
+  seg.beat.divmod(inBar, beats, inBeat);
+  SIXTEENTH.divmod(inBeat, sixteenths, inSixteenth);
+  return Position{firstBar + bars + 1, (uint8_t)(beats + 1), (uint8_t)(sixteenths + 1), (uint16_t)inSixteenth};
+}
+
+TimeSignature::Position TimeSignature::position(uint32_t tick) const {
+  const Segment& seg = segmentAt(tick);
+  return positionIn(seg, tick - seg.startTick, seg.startBar);
+}
+
+TimeSignature::Position TimeSignature::loopPosition(uint32_t tickInLoop) const {
+  return positionIn(newest(), tickInLoop, 0);
+}
@@ -5,11 +5,17 @@
 #include "Track.h"
 #include "ClockManager.h"
 #include "MidiHandler.h"
+#include "OutputScheduler.h"
 #include "Logger.h"
 #include "TrackStateMachine.h"
 #include "LooperState.h"
-#include <algorithm>  // for std::sort
+#include <algorithm>  // for std::sort, std::upper_bound
+#include <atomic>
+#include <iterator>   // std::back_inserter
 #include "StorageManager.h"
+#include "TrackManager.h"
+#include "TimeSignature.h"
+#include "Profiler.h"
 #include "stdint.h"
 
 // -------------------------
@@ -22,10 +28,18 @@ Track::Track()
     startLoopTick(0),
     loopLengthTicks(0),
     lastTickInLoop(0),
-    pendingNotes(),
-    midiEvents()
+    arena(),
+    midiEvents(ArenaAllocator<MidiEvent>(&arena)),
+    sysex(&arena),
+    playBuffers{PlaybackBuffer(&arena), PlaybackBuffer(&arena)}
  {}
 
+// Bind this track's slot and fixed memory region; called once per track by TrackManager at boot
+void Track::attachArena(uint8_t trackIndex) {
+  index = trackIndex;
+  arena.attachTrackRegion(trackIndex);
+}
+
 // -------------------------
 // Getters
 // -------------------------
@@ -67,14 +81,27 @@ bool Track::transitionState(TrackState newState) {
   }
 
   TrackState oldState = trackState;
+  if (oldState == TRACK_OVERDUBBING && newState != TRACK_OVERDUBBING) sealLayer();
   trackState = newState;
+  publishState();
+  if (newState == TRACK_PLAYING || newState == TRACK_OVERDUBBING) preparePlayback();
 
   logger.logStateTransition("Track", TrackStateMachine::toString(oldState), TrackStateMachine::toString(newState));
   return true;
 }
 
 // Required for loading state from SD card else the state machine will corrupt the state
-void Track::forceSetState(TrackState newState) { trackState = newState; }
+void Track::forceSetState(TrackState newState) {
+  if (trackState == TRACK_OVERDUBBING && newState != TRACK_OVERDUBBING) sealLayer();
+  trackState = newState;
+  publishState();
+  if (newState == TRACK_PLAYING || newState == TRACK_OVERDUBBING) preparePlayback();
+}
+
+// Mirror the state into TrackManager's table (tracks outside TrackManager have no slot)
+void Track::publishState() {
+  if (index < Config::NUM_TRACKS) trackManager.onTrackStateChanged(index, trackState);
+}
 
 // -------------------------
 // Recording control
@@ -85,9 +112,16 @@ void Track::startRecording(uint32_t currentTick) {
     return;
   }
   // Clear out any old data
+  overdubLayers.clear();
+  layerOpen = false;
   midiEvents.clear();
-  pendingNotes.clear();       // any hanging NoteOns
-  nextEventIndex = 0;         // so playback will start from the top
+  markEventsChanged();
+  releasePlayback();
+  full = false;
+  pendingNotes.reset();       // any hanging NoteOns
+  reserveRecordingCapacity();
+  StorageManager::journalTrackEvents(*this);
+  playCursorValid = false;    // so playback re-seats on the next tick
   lastTickInLoop = 0;
 
   // Stamp the new start tick quantized to a beat.
@@ -99,10 +133,10 @@ void Track::startRecording(uint32_t currentTick) {
 // Helpers for stopRecording 
 // -------------------------
 
-const uint32_t Track::TICKS_PER_BAR = Config::TICKS_PER_BAR;
+// Bars are those of the meter at the take's start, so a 7/8 take loops in 7/8 bars
 
 uint32_t Track::quantizeStart(uint32_t original) const {
-    return (original / TICKS_PER_BAR) * TICKS_PER_BAR;
+    return timeSignature.barStartAtOrBefore(original);
 }
 
 void Track::shiftMidiEvents(int32_t offset) {
@@ -111,6 +145,7 @@ void Track::shiftMidiEvents(int32_t offset) {
     }
     std::sort(midiEvents.begin(), midiEvents.end(),
               [](auto &a, auto &b){ return a.tick < b.tick; });
+    markEventsChanged();
 }
 
 uint32_t Track::findLastEventTick() const {
@@ -122,24 +157,26 @@ uint32_t Track::findLastEventTick() const {
 }
 
 uint32_t Track::computeLoopLengthTicks(uint32_t lastTick) const {
-    uint32_t fullBars = lastTick / TICKS_PER_BAR;
-    uint32_t rem      = lastTick % TICKS_PER_BAR;
-    uint32_t grace    = TICKS_PER_BAR / 6;  // More generous grace window
+    const Timing::TickDivider& bar = timeSignature.barAt(startLoopTick);
+    const uint32_t ticksPerBar = bar.divisor();
+    uint32_t fullBars, rem;
+    bar.divmod(lastTick, fullBars, rem);
+    uint32_t grace    = ticksPerBar / 6;  // More generous grace window
 
     if (rem <= grace) {
-        return (fullBars > 0 ? fullBars : 1) * TICKS_PER_BAR;
+        return (fullBars > 0 ? fullBars : 1) * ticksPerBar;
     }
 
     // Special case: very short pass (accidental press?)
-    if (lastTick < TICKS_PER_BAR / 2) {
-        return TICKS_PER_BAR;
+    if (lastTick < ticksPerBar / 2) {
+        return ticksPerBar;
     }
 
-    return (fullBars + 1) * TICKS_PER_BAR;
+    return (fullBars + 1) * ticksPerBar;
 }
 
 void Track::resetPlaybackState(uint32_t currentTick) {
-    nextEventIndex = 0;
+    playCursorValid = false;
     lastTickInLoop = (currentTick - startLoopTick) % loopLengthTicks;
 }
 
@@ -148,23 +185,11 @@ void Track::finalizePendingNotes(uint32_t offAbsTick) {
     TrackState prev = trackState;
     trackState = TRACK_RECORDING;
 
-    // 1) Copy out the pending keys
-    std::vector<std::pair<uint8_t,uint8_t>> toClose;
-    toClose.reserve(pendingNotes.size());
-    for (auto const &kv : pendingNotes) {
-        toClose.push_back(kv.first);
-    }
-
-    // 2) Emit a noteOff() for each key (this will record the NoteEvent
-    //    but no longer erase inside the map)
-    for (auto const &key : toClose) {
-        uint8_t note    = key.first;
-        uint8_t channel = key.second;
+    // Emit a noteOff() for each held note; noteOff() clears its slot as it goes
+    pendingNotes.forEach([&](uint8_t channel, uint8_t note) {
         noteOff(channel, note, 0, offAbsTick);
-    }
-
-    // 3) Now safely clear all remaining pending notes
-    pendingNotes.clear();
+    });
+    pendingNotes.reset();
 
     // Restore the real state
     trackState = prev;
@@ -182,17 +207,19 @@ void Track::stopRecording(uint32_t currentTick) {
 
   // Use the actual time between start and stop as the loop length
   uint32_t rawLength = currentTick - startLoopTick;
-  uint32_t rem       = rawLength % TICKS_PER_BAR;
-  uint32_t grace     = TICKS_PER_BAR / 2;  // Allow 1/8 bar grace window
+  const Timing::TickDivider& bar = timeSignature.barAt(startLoopTick);
+  uint32_t bars, rem;
+  bar.divmod(rawLength, bars, rem);
+  uint32_t grace     = bar.divisor() / 2;  // Allow 1/8 bar grace window
 
   if (rem <= grace) {
-      loopLengthTicks = (rawLength / TICKS_PER_BAR) * TICKS_PER_BAR;
+      loopLengthTicks = bars * bar.divisor();
   } else {
-      loopLengthTicks = ((rawLength / TICKS_PER_BAR) + 1) * TICKS_PER_BAR;
+      loopLengthTicks = (bars + 1) * bar.divisor();
   }
 
   // Reset playback state for next pass
-  nextEventIndex = 0;
+  playCursorValid = false;
   lastTickInLoop = 0;
   startLoopTick = 0;
   logger.logTrackEvent("Recording stopped", currentTick, "start=%lu length=%lu", startLoopTick, loopLengthTicks);
@@ -216,6 +243,8 @@ void Track::startPlaying(uint32_t currentTick) {
     startLoopTick = 0;
     // for support to pickup in the middle or quintized start live looping to master clock:
     //startLoopTick = currentTick - ((currentTick - startLoopTick) % loopLengthTicks);
+    // Joining mid-loop: seat the cursor here and sound what is already held
+    locate(currentTick, true);
     logger.logTrackEvent("Playback started", currentTick);
   }
 }
@@ -226,6 +255,7 @@ void Track::startPlaying(uint32_t currentTick) {
 
 void Track::startOverdubbing(uint32_t currentTick) {
   if (!setState(TRACK_OVERDUBBING)) return;
+  // The take's layer opens with its first event and reserves its own room
   logger.logTrackEvent("Overdubbing started", currentTick);
 }
 
@@ -237,7 +267,7 @@ void Track::stopOverdubbing() {
   // Reset playback state
   startLoopTick = 0;
   resetPlaybackState(0);
-  StorageManager::saveState(looperState.getLooperState()); // Save after overdubbing
+  StorageManager::requestSave(); // Save after overdubbing
 }
 
 // -------------------------
@@ -246,7 +276,8 @@ void Track::stopOverdubbing() {
 
 void Track::stopPlaying() {
   if (isEmpty()) return; // Nothing to stop, empty track
-  sendAllNotesOff();  // first kill all sounding notes
+  sendSoundingNoteOffs();  // first end the notes this track left sounding
+  pendingNotes.reset();
 
   // then transition to the stopped state
   setState(TRACK_STOPPED);
@@ -267,6 +298,7 @@ void Track::togglePlayStop() {
 
 void Track::toggleMuteTrack() {
   muted = !muted;
+  if (muted) sendSoundingNoteOffs();  // Playback stops sending, so end what is still held
 }
 
 bool Track::isMuted() const {
@@ -274,11 +306,19 @@ bool Track::isMuted() const {
 }
 
 bool Track::hasData() const {
-  return !midiEvents.empty();
+  return !midiEvents.empty() || !overdubLayers.empty();
 }
 
 size_t Track::getMidiEventCount() const {
-  return midiEvents.size();
+  size_t count = midiEvents.size();
+  for (const auto& layer : overdubLayers) count += layer.size();
+  return count;
+}
+
+size_t Track::getEventBytes() const {
+  size_t bytes = midiEvents.capacity() * sizeof(MidiEvent);
+  for (const auto& layer : overdubLayers) bytes += layer.capacity() * sizeof(MidiEvent);
+  return bytes;
 }
 
 // -------------------------
@@ -293,143 +333,947 @@ void Track::clear() {
     }
 
     // Remove all recorded events
+    overdubLayers.clear();
+    layerOpen = false;
     midiEvents.clear();
+    markEventsChanged();
+    releasePlayback();
+    full = false;
 
     // Reset timing
     startLoopTick = 0;
     loopLengthTicks = 0;
 
     // Clear undo history
-    midiHistory.clear();
+    TrackUndo::clearHistory(*this);
+
+    // SysEx bytes go too, unless a clear copy may still bring back events that use them
+    if (!TrackUndo::clearCopiesUseSysEx(*this)) sysex.reset();
 
     // Go back to "never recorded"
     setState(TRACK_EMPTY);
+    StorageManager::journalTrackCleared(*this);
 
     // Log the clear action
     logger.logTrackEvent("Track cleared", clockManager.getCurrentTick());
 }
 
-void Track::recordMidiEvents(midi::MidiType type, byte channel, byte data1, byte data2, uint32_t currentTick) {
-  if ((isRecording() && !isPlaying()) || isOverdubbing()) {
-    uint32_t tickRelative;
-
-    // First pass: build the loop
-    if (isRecording() && !isPlaying()) {
-      tickRelative = currentTick - startLoopTick;
-
-    // Overdub passes: wrap every hit back into the loop
-    } else if (isOverdubbing()) {
-      // defensive: loopLengthTicks was set when you stopped recording
-      if (loopLengthTicks == 0) return;
-      tickRelative = (currentTick - startLoopTick) % loopLengthTicks;
-      
+// Make room for one more event in `list` (midiEvents or a layer), growing it by `step`. Growth is
+// checked against the arena first, evicting old undo levels if that makes it fit; when even one
+// more slot does not fit the track reports full.
+bool Track::reserveForInsert(EventList& list, size_t step) {
+  if (list.size() == list.capacity()) {
+    size_t size = list.size();
+    if (TrackUndo::makeArenaRoom(*this, (size + step) * sizeof(MidiEvent))) {
+      list.reserve(size + step);
+    } else if (arena.canAllocate((size + 1) * sizeof(MidiEvent))) {
+      list.reserve(size + 1);
     } else {
-      return;
+      if (!full) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Track full (%u events), dropping input", (unsigned)getMidiEventCount());
+      }
+      full = true;
+      return false;
     }
+  }
+  full = false;
+  return true;
+}
+
+// Insert a recorded event, keeping the list sorted. Shared by live recording and
+// journal replay so both produce the same event order.
+// **Keep events sorted by tick** so playback scanning never misses a wrapped-back note during overdubbing.
+// The event goes after any events already at the same tick (arrival order).
+// When the arena is full the event is dropped (see reserveForInsert()).
+bool Track::insertEvent(const MidiEvent& evt) {
+  flattenLayers();
+  if (!reserveForInsert(midiEvents, recordReserveEvents())) return false;
+  bool summarized = summaryCurrent();
+  midiEvents.insert(sortedPosition(evt.tick), evt);
+  if (summarized) summary.add(evt);
+  hashedEdit(0, hashEvent(evt), summarized);
+  return true;
+}
 
-    // Prevent duplicate midiEvents at the same tick with same parameters
-    for (const auto& e : midiEvents) {
-      if (e.tick == tickRelative && e.type == type && e.channel == channel && e.data.noteData.note == data1 && e.data.noteData.velocity == data2) {
-        return;  // Skip duplicate event
+// -------------------------
+// Overdub layers
+// -------------------------
+
+// Overdub input goes into the take's own layer. Its first event opens the layer (merging the oldest
+// one in if the track already holds Config::OVERDUB_MAX_LAYERS) and journals an undo push, so a
+// replayed journal keeps the events before the take as the level the layer stands for.
+bool Track::insertIntoLayer(const MidiEvent& evt) {
+  if (!layerOpen) {
+    if (overdubLayers.size() >= Config::OVERDUB_MAX_LAYERS) {
+      mergeBottomLayer();
+      preparePlayback();
+    }
+    overdubLayers.emplace_back(ArenaAllocator<MidiEvent>(&arena));
+    if (!reserveForInsert(overdubLayers.back(), Config::OVERDUB_LAYER_RESERVE_EVENTS)) {
+      overdubLayers.pop_back();
+      return false;
+    }
+    layerOpen = true;
+    layerCursors[overdubLayers.size() - 1] = 0;
+    StorageManager::journalUndoPushed(*this);
+  } else if (!reserveForInsert(overdubLayers.back(), Config::OVERDUB_LAYER_RESERVE_EVENTS)) {
+    return false;
+  }
+  EventList& layer = overdubLayers.back();
+  auto pos = std::upper_bound(layer.begin(), layer.end(), evt.tick,
+                              [](uint32_t t, const MidiEvent& e) { return t < e.tick; });
+  uint32_t at = pos - layer.begin();
+  layer.insert(pos, evt);
+  // Recorded at (or before) the tick playback is on: it sounds from the next pass, not as an echo
+  uint32_t& cursor = layerCursors[overdubLayers.size() - 1];
+  if (at <= cursor) ++cursor;
+  bool summarized = summaryCurrent();
+  if (summarized) summary.add(evt);
+  hashedEdit(0, hashEvent(evt), summarized, false);
+  return true;
+}
+
+void Track::sealLayer() {
+  layerOpen = false;
+  // A transform renders midiEvents alone: merge the take in so it plays transformed
+  if (!transform.isIdentity() || transformPending) flattenLayers();
+}
+
+// The oldest layer joins midiEvents, its events after the ones already at their tick. The events
+// before it stay as an undo level (the one its journal record stands for) when the arena has room
+// for both lists. Otherwise the layer is merged in place if midiEvents has the capacity, giving
+// the level up, and dropped if it has not.
+void Track::mergeBottomLayer() {
+  const EventList& layer = overdubLayers.front();
+  size_t total = midiEvents.size() + layer.size();
+  auto byTick = [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; };
+  if (TrackUndo::makeArenaRoom(*this, total * sizeof(MidiEvent))) {
+    EventList merged{ArenaAllocator<MidiEvent>(&arena)};
+    merged.reserve(total);
+    std::merge(midiEvents.begin(), midiEvents.end(), layer.begin(), layer.end(), std::back_inserter(merged), byTick);
+    TrackUndo::pushUndoLevel(*this, std::move(midiEvents));
+    midiEvents = std::move(merged);
+  } else if (midiEvents.capacity() >= total) {
+    logger.log(CAT_TRACK, LOG_WARNING, "Track memory low, overdub layer merged without an undo level");
+    size_t kept = midiEvents.size();
+    midiEvents.insert(midiEvents.end(), layer.begin(), layer.end());
+    std::inplace_merge(midiEvents.begin(), midiEvents.begin() + kept, midiEvents.end(), byTick);
+  } else {
+    logger.log(CAT_TRACK, LOG_WARNING, "Track full (%u events), overdub layer of %u events dropped",
+               (unsigned)midiEvents.size(), (unsigned)layer.size());
+    full = true;
+    if (layerOpen && overdubLayers.size() == 1) pendingNotes.reset();  // As dropTopLayer()
+    sendSoundingNoteOffs();
+    ++eventsGeneration;  // Hash and summary are recomputed once when next read
+  }
+  overdubLayers.pop_front();
+  for (size_t l = 0; l < overdubLayers.size(); ++l) layerCursors[l] = layerCursors[l + 1];
+  if (overdubLayers.empty()) {
+    layerOpen = false;
+    EventList().swap(layerView);
+  }
+  // Same events, so the hash and summary hold; the caller prepares playback of midiEvents
+  hashedEdit(0, 0, summaryCurrent());
+}
+
+void Track::flattenLayers() {
+  if (overdubLayers.empty()) return;
+  while (!overdubLayers.empty()) mergeBottomLayer();
+  preparePlayback();
+}
+
+// Background merge (see TrackManager::compactLayers()); the open layer is left to its take
+bool Track::compactLayers() {
+  size_t sealed = overdubLayers.size() - (layerOpen ? 1 : 0);
+  if (sealed <= Config::OVERDUB_FLATTEN_LAYERS) return false;
+  mergeBottomLayer();
+  preparePlayback();
+  return true;
+}
+
+// Undo of the newest take: the layer is dropped whole and playback keeps its buffer
+void Track::dropTopLayer() {
+  if (layerOpen) pendingNotes.reset();  // Notes held in the dropped take would end in the next layer
+  overdubLayers.pop_back();
+  layerOpen = false;
+  if (overdubLayers.empty()) EventList().swap(layerView);
+  sendSoundingNoteOffs();
+  ++eventsGeneration;  // Hash and summary are recomputed once when next read
+}
+
+const EventList& Track::eventsView() const {
+  if (overdubLayers.empty()) return midiEvents;
+  if (layerViewGeneration != eventsGeneration) {
+    layerView.clear();
+    layerView.reserve(getMidiEventCount());
+    uint32_t cursor = 0;
+    uint32_t cursors[Config::OVERDUB_MAX_LAYERS] = {};
+    mergeDue(midiEvents.data(), midiEvents.size(), cursor, cursors, UINT32_MAX,
+             [&](const MidiEvent& evt, int, uint32_t) { layerView.push_back(evt); });
+    layerViewGeneration = eventsGeneration;
+  }
+  return layerView;
+}
+
+// -------------------------
+// Hashed edits
+// -------------------------
+
+EventList::iterator Track::eraseEvent(EventList::iterator pos) {
+  uint32_t removed = hashEvent(*pos);
+  bool summarized = summaryCurrent() && summary.remove(*pos);
+  auto next = midiEvents.erase(pos);
+  hashedEdit(removed, 0, summarized);
+  return next;
+}
+
+bool Track::commitEdit(EventEdit& edit) {
+  if (edit.empty()) return true;
+  flattenLayers();  // Indices are into the merged view, which flattening keeps in order
+  auto& removals = edit.removals;
+  auto& additions = edit.additions;
+  std::sort(removals.begin(), removals.end());
+  size_t kept = midiEvents.size() - removals.size();
+  size_t total = kept + additions.size();
+  if (total > midiEvents.capacity()) {
+    if (!TrackUndo::makeArenaRoom(*this, total * sizeof(MidiEvent))) {
+      logger.log(CAT_TRACK, LOG_WARNING, "Track full (%u events), edit not applied", (unsigned)midiEvents.size());
+      full = true;
+      edit.clear();
+      return false;
+    }
+    midiEvents.reserve(total);
+  }
+  full = false;
+
+  uint32_t removedHash = 0, addedHash = 0;
+  for (uint32_t r : removals) removedHash += hashEvent(midiEvents[r]);
+  for (const auto& evt : additions) addedHash += hashEvent(evt);
+  bool summarized = summaryCurrent();
+  for (uint32_t r : removals) summarized = summarized && summary.remove(midiEvents[r]);
+  if (summarized) {
+    for (const auto& evt : additions) summary.add(evt);
+  }
+
+  // Compact the kept events to the front
+  size_t w = removals.empty() ? midiEvents.size() : removals[0];
+  for (size_t i = w, r = 0; i < midiEvents.size(); ++i) {
+    if (r < removals.size() && removals[r] == i) { ++r; continue; }
+    midiEvents[w++] = midiEvents[i];
+  }
+
+  // Merge the sorted additions in from the back; NoteOffs go ahead at their tick (see EventEdit)
+  std::stable_sort(additions.begin(), additions.end(), [](const MidiEvent& a, const MidiEvent& b) {
+    return a.tick < b.tick || (a.tick == b.tick && isNoteOffEvent(a) && !isNoteOffEvent(b));
+  });
+  midiEvents.resize(total);
+  size_t i = kept, j = additions.size(), k = total;
+  while (j > 0) {
+    const MidiEvent& add = additions[j - 1];
+    if (i > 0 && (midiEvents[i - 1].tick > add.tick ||
+                  (midiEvents[i - 1].tick == add.tick && isNoteOffEvent(add)))) {
+      midiEvents[--k] = midiEvents[--i];
+    } else {
+      midiEvents[--k] = add;
+      --j;
+    }
+  }
+
+  hashedEdit(removedHash, addedHash, summarized);
+  edit.clear();
+  preparePlayback();
+  return true;
+}
+
+bool Track::isNoteOffEvent(const MidiEvent& evt) {
+  return evt.type == midi::NoteOff || (evt.type == midi::NoteOn && evt.data.noteData.velocity == 0);
+}
+
+// First event after tick
+EventList::iterator Track::sortedPosition(uint32_t tick) {
+  return std::upper_bound(midiEvents.begin(), midiEvents.end(), tick,
+                          [](uint32_t t, const MidiEvent& e){ return t < e.tick; });
+}
+
+bool EventEdit::isStaged(size_t index) const {
+  return std::find(removals.begin(), removals.end(), (uint32_t)index) != removals.end();
+}
+
+bool EventEdit::remove(size_t index) {
+  if (index >= events.size() || isStaged(index)) return false;
+  removals.push_back((uint32_t)index);
+  return true;
+}
+
+bool EventEdit::move(size_t index, uint32_t tick) {
+  if (!remove(index)) return false;
+  MidiEvent evt = events[index];
+  evt.tick = tick;
+  additions.push_back(evt);
+  return true;
+}
+
+bool EventEdit::replace(size_t index, const MidiEvent& evt) {
+  if (!remove(index)) return false;
+  additions.push_back(evt);
+  return true;
+}
+
+// Bump the generation; the hash moves with it only if it was current before the edit, the
+// summary only if the caller updated it. An edit to a layer (inBase false) leaves playback's buffer.
+void Track::hashedEdit(uint32_t removedHash, uint32_t addedHash, bool summarized, bool inBase) {
+  bool current = contentHashGeneration == eventsGeneration;
+  if (inBase) {
+    markEventsChanged();
+  } else {
+    ++eventsGeneration;
+  }
+  if (current) {
+    contentHash += addedHash - removedHash;
+    contentHashGeneration = eventsGeneration;
+  }
+  if (summarized) summaryGeneration = eventsGeneration;
+}
+
+uint32_t Track::getContentHash() const {
+  if (contentHashGeneration != eventsGeneration) {
+    uint32_t sum = 0;
+    for (const auto& evt : midiEvents) sum += hashEvent(evt);
+    for (const auto& layer : overdubLayers) {
+      for (const auto& evt : layer) sum += hashEvent(evt);
+    }
+    contentHash = sum;
+    contentHashGeneration = eventsGeneration;
+  }
+  return contentHash;
+}
+
+// All eight bytes of the event (tick, type, channel, data) through a 64-bit finalizer, so
+// nearby events land far apart and their sum does not cancel
+uint32_t Track::hashEvent(const MidiEvent& evt) {
+  uint16_t data;
+  memcpy(&data, &evt.data, sizeof(data));
+  uint64_t h = ((uint64_t)evt.tick << 32) | ((uint64_t)(uint8_t)evt.type << 24) |
+               ((uint64_t)evt.channel << 16) | data;
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return (uint32_t)h;
+}
+
+// -------------------------
+// Note view cache
+// -------------------------
+
+const std::vector<NoteUtils::DisplayNote>& Track::getDisplayNotes() const {
+  if (cachedNotesGeneration != eventsGeneration || cachedNotesLoopLength != loopLengthTicks) {
+    NoteUtils::reconstructNotesInto(eventsView(), loopLengthTicks, cachedNotes);
+    cachedNotesGeneration = eventsGeneration;
+    cachedNotesLoopLength = loopLengthTicks;
+  }
+  return cachedNotes;
+}
+
+bool Track::summaryCurrent() const {
+  return summaryGeneration == eventsGeneration && summary.getLoopLength() == loopLengthTicks;
+}
+
+const TrackSummary& Track::getSummary() const {
+  if (!summaryCurrent()) {
+    summary.rebuild(eventsView(), loopLengthTicks);
+    summaryGeneration = eventsGeneration;
+  }
+  return summary;
+}
+
+const NoteUtils::EventIndex& Track::getEventIndex() const {
+  if (cachedIndexGeneration != eventsGeneration) {
+    NoteUtils::buildEventIndexInto(eventsView(), cachedIndex);
+    cachedIndexGeneration = eventsGeneration;
+  }
+  return cachedIndex;
+}
+
+// Config::RECORD_RESERVE_EVENTS, or an eighth of a smaller arena
+size_t Track::recordReserveEvents() const {
+  size_t share = arena.capacity() / 8 / sizeof(MidiEvent);
+  if (arena.capacity() == 0 || share > Config::RECORD_RESERVE_EVENTS) return Config::RECORD_RESERVE_EVENTS;
+  return share;
+}
+
+// Reserve headroom before a take so recording does not reallocate mid-pass.
+// Skipped when the arena cannot hold it; insertEvent() then grows in smaller steps.
+void Track::reserveRecordingCapacity() {
+  size_t wanted = midiEvents.size() + recordReserveEvents();
+  if (midiEvents.capacity() < wanted && arena.canAllocate(wanted * sizeof(MidiEvent))) {
+    midiEvents.reserve(wanted);
+  }
+}
+
+// Loop-relative tick of an input arriving at currentTick; false when the track is not taking input
+bool Track::recordingTick(uint32_t currentTick, uint32_t& tickRelative) const {
+  // First pass: build the loop
+  if (isRecording() && !isPlaying()) {
+    tickRelative = currentTick - startLoopTick;
+    return true;
+  }
+  // Overdub passes: wrap every hit back into the loop
+  if (isOverdubbing()) {
+    // defensive: loopLengthTicks was set when you stopped recording
+    if (loopLengthTicks == 0) return false;
+    tickRelative = (currentTick - startLoopTick) % loopLengthTicks;
+    return true;
+  }
+  return false;
+}
+
+void Track::recordMidiEvents(midi::MidiType type, byte channel, byte data1, byte data2, uint32_t currentTick) {
+  uint32_t tickRelative;
+  if (recordingTick(currentTick, tickRelative)) {
+    // Prevent duplicate midiEvents at the same tick with same parameters (only the equal-tick range can match)
+    auto isDuplicate = [&](const EventList& list) {
+      auto first = std::lower_bound(list.begin(), list.end(), tickRelative,
+                                    [](const MidiEvent& e, uint32_t tick){ return e.tick < tick; });
+      for (auto it = first; it != list.end() && it->tick == tickRelative; ++it) {
+        if (it->type == type && it->channel == channel && it->data.noteData.note == data1 && it->data.noteData.velocity == data2) {
+          return true;
+        }
       }
+      return false;
+    };
+    if (isDuplicate(midiEvents)) return;  // Skip duplicate event
+    for (const auto& layer : overdubLayers) {
+      if (isDuplicate(layer)) return;
     }
 
+    MidiEvent evt;
     switch (type) {
         case midi::NoteOn:
-            midiEvents.push_back(MidiEvent::NoteOn(tickRelative, channel, data1, data2));
+            evt = MidiEvent::NoteOn(tickRelative, channel, data1, data2);
             break;
         case midi::NoteOff:
-            midiEvents.push_back(MidiEvent::NoteOff(tickRelative, channel, data1, data2));
+            evt = MidiEvent::NoteOff(tickRelative, channel, data1, data2);
             break;
         case midi::ControlChange:
-            midiEvents.push_back(MidiEvent::ControlChange(tickRelative, channel, data1, data2));
+            evt = MidiEvent::ControlChange(tickRelative, channel, data1, data2);
             break;
         case midi::ProgramChange:
-            midiEvents.push_back(MidiEvent::ProgramChange(tickRelative, channel, data1));
+            evt = MidiEvent::ProgramChange(tickRelative, channel, data1);
             break;
         case midi::AfterTouchChannel:
-            midiEvents.push_back(MidiEvent::ChannelAftertouch(tickRelative, channel, data1));
+            evt = MidiEvent::ChannelAftertouch(tickRelative, channel, data1);
+            break;
+        case midi::AfterTouchPoly:
+            evt = MidiEvent::PolyAftertouch(tickRelative, channel, data1, data2);
             break;
         case midi::PitchBend:
-            midiEvents.push_back(MidiEvent::PitchBend(tickRelative, channel, (int16_t)((data2 << 7) | data1)));
+            // 14-bit wire value, 8192 = centre
+            evt = MidiEvent::PitchBend(tickRelative, channel, (int16_t)(((data2 << 7) | data1) - 8192));
             break;
         // Add other cases as needed
         default:
             // Optionally handle or ignore other types
-            break;
+            return;
     }
 
     // Log the event
-    if (!midiEvents.empty()) {
-        logger.logMidiEvent(midiEvents.back());
-    }
-    // **Keep events sorted by tick** so playback scanning never misses a wrapped-back note during overdubbing
-    std::sort(midiEvents.begin(), midiEvents.end(),
-            [](auto &a, auto &b){ return a.tick < b.tick; });
+    logger.logMidiEvent(evt);
+    if (!(isOverdubbing() ? insertIntoLayer(evt) : insertEvent(evt))) return;
+    StorageManager::journalEventInserted(*this, evt);
+  }
+}
 
+// The bytes go into the SysEx store first; the event only points at them
+void Track::recordSysEx(const uint8_t* data, uint16_t length, uint32_t currentTick) {
+  uint32_t tickRelative;
+  if (!recordingTick(currentTick, tickRelative)) return;
+  size_t growth = sysex.growthFor(length);
+  if (growth > 0 && !TrackUndo::makeArenaRoom(*this, growth)) {
+    logger.log(CAT_TRACK, LOG_WARNING, "Track memory full, dropping %u-byte SysEx", (unsigned)length);
+    return;
+  }
+  uint16_t offset;
+  if (!sysex.append(data, length, offset)) {
+    logger.log(CAT_TRACK, LOG_WARNING, "SysEx store full (%u bytes), dropping %u-byte SysEx",
+               (unsigned)sysex.size(), (unsigned)length);
+    return;
   }
+  MidiEvent evt = MidiEvent::SysEx(tickRelative, offset);
+  if (!(isOverdubbing() ? insertIntoLayer(evt) : insertEvent(evt))) {
+    sysex.truncate(offset);
+    return;
+  }
+  StorageManager::journalSysExStored(*this, offset);
+  StorageManager::journalEventInserted(*this, evt);
 }
 
 void Track::playMidiEvents(uint32_t currentTick, bool isAudible) {
-  if (!isAudible || muted || midiEvents.empty() || loopLengthTicks == 0)
+  if (!isAudible || muted || loopLengthTicks == 0) {
+    playCursorValid = false;  // Unmuting re-seats instead of catching up on the silent ticks
     return;
+  }
 
-  // Compute position in the loop
-  uint32_t tickInLoop = (currentTick - startLoopTick) % loopLengthTicks;
-
-  // Reset at loop boundary
-  if (tickInLoop < lastTickInLoop) {
-    nextEventIndex = 0;
-    logger.debug("Loop wrapped, resetting index");
+  // A transform change waits for the loop start (or a jump) so a pass never mixes two renders,
+  // and for its render to be prepared
+  if (transformPending &&
+      (!playCursorValid || currentTick != lastPlayedTick + 1 || lastTickInLoop + 1 >= loopLengthTicks) &&
+      playbackCurrent(playBuffers[publishedPlayback ^ 1], pendingTransform)) {
+    applyPendingTransform();
+  }
+  bool rebuilt = publishPlayback();
+  if (playback().events.empty() && overdubLayers.empty()) {
+    playCursorValid = false;
+    return;
   }
 
-  // Remember where we were
-  uint32_t prevTickInLoop = lastTickInLoop;
+  uint32_t tickInLoop;
+  if (playCursorValid && currentTick == lastPlayedTick + 1) {
+    // Steady state: step the loop position instead of dividing
+    tickInLoop = lastTickInLoop + 1;
+    if (tickInLoop >= loopLengthTicks) {
+      tickInLoop = 0;
+      nextEventIndex = 0;
+      for (size_t l = 0; l < overdubLayers.size(); ++l) layerCursors[l] = 0;
+    } else if (rebuilt) {
+      nextEventIndex = firstEntryAtOrAfter(tickInLoop);
+      seatLayerCursors(tickInLoop);
+    }
+  } else if (playCursorValid && currentTick > lastPlayedTick + 1 &&
+             currentTick - lastPlayedTick - 1 < loopLengthTicks) {
+    // Overrun: the ISR or loop() ran late and ticks were stepped over. Their events go out now,
+    // in order, then this tick's
+    uint32_t missed = currentTick - lastPlayedTick - 1;
+    playOverrunCount++;
+    playSkippedTicks += missed;
+    PROFILE_COUNT(COUNTER_PLAYBACK_OVERRUNS, 1);
+    tickInLoop = (currentTick - startLoopTick) % loopLengthTicks;
+    catchUp((lastTickInLoop + 1) % loopLengthTicks, missed, tickInLoop);
+    nextEventIndex = firstEntryAtOrAfter(tickInLoop);
+    seatLayerCursors(tickInLoop);
+  } else {
+    // Jump: fire what is due from this tick on; events on stepped-over ticks are not played
+    if (playCursorValid) {
+      playJumpCount++;
+      if (currentTick > lastPlayedTick + 1) playSkippedTicks += currentTick - lastPlayedTick - 1;
+    }
+    tickInLoop = (currentTick - startLoopTick) % loopLengthTicks;
+    nextEventIndex = firstEntryAtOrAfter(tickInLoop);
+    seatLayerCursors(tickInLoop);
+  }
+  lastPlayedTick = currentTick;
   lastTickInLoop = tickInLoop;
+  playCursorValid = true;
+
+  const PlaybackBuffer& buffer = playback();
+  const auto& events = buffer.events;
+  const uint16_t* offsets = buffer.offsets.empty() ? nullptr : buffer.offsets.data();
+  if (overdubLayers.empty()) {
+    while (nextEventIndex < events.size() && events[nextEventIndex].tick <= tickInLoop) {
+      uint32_t i = nextEventIndex++;
+      sendMidiEvent(events[i], offsets ? offsets[i] : 0);
+    }
+    return;
+  }
+  mergeDue(events.data(), events.size(), nextEventIndex, layerCursors, tickInLoop,
+           [&](const MidiEvent& evt, int layer, uint32_t i) {
+             sendMidiEvent(evt, (layer < 0 && offsets) ? offsets[i] : 0);
+           });
+}
 
-  // Now send anything whose tick falls in (prevTickInLoop, tickInLoop]
-  while (nextEventIndex < midiEvents.size()) {
-    const MidiEvent &evt = midiEvents[nextEventIndex];
-    uint32_t evTick = evt.tick % loopLengthTicks;
+// Events of `count` stepped-over ticks from fromTick (loop ticks, wrapping at the loop end), in
+// order and on time for tickInLoop. Up to PLAYBACK_CATCHUP_BURST of them are sent, none missed by
+// more than PLAYBACK_CATCHUP_TICKS; past that only the NoteOffs of sounding notes go out, so a
+// late burst stays bounded and no note is left hanging.
+void Track::catchUp(uint32_t fromTick, uint32_t count, uint32_t tickInLoop) {
+  const PlaybackBuffer& buffer = playback();
+  const auto& events = buffer.events;
+  uint32_t burst = Config::PLAYBACK_CATCHUP_BURST;
+  uint32_t dropped = 0;
+  auto late = [&](const MidiEvent& evt) {
+    uint32_t ago = tickInLoop >= evt.tick ? tickInLoop - evt.tick : tickInLoop + loopLengthTicks - evt.tick;
+    if (burst > 0 && ago <= Config::PLAYBACK_CATCHUP_TICKS) {
+      burst--;
+      sendMidiEvent(evt);  // Already late: no sub-tick deadline
+    } else if ((evt.type == midi::NoteOn || evt.type == midi::NoteOff) &&
+               !evt.isNoteOn() && soundingNotes.test(evt.channel, evt.data.noteData.note)) {
+      sendMidiEvent(evt);
+    } else {
+      dropped++;
+    }
+  };
+  while (count > 0) {
+    uint32_t span = std::min(count, loopLengthTicks - fromTick);
+    uint32_t lastTick = fromTick + span - 1;
+    nextEventIndex = firstEntryAtOrAfter(fromTick);
+    seatLayerCursors(fromTick);
+    if (overdubLayers.empty()) {
+      while (nextEventIndex < events.size() && events[nextEventIndex].tick <= lastTick) {
+        late(events[nextEventIndex++]);
+      }
+    } else {
+      mergeDue(events.data(), events.size(), nextEventIndex, layerCursors, lastTick,
+               [&](const MidiEvent& evt, int, uint32_t) { late(evt); });
+    }
+    count -= span;
+    fromTick = 0;
+  }
+  if (dropped) {
+    playDroppedEvents += dropped;
+    PROFILE_COUNT(COUNTER_PLAYBACK_DROPPED, dropped);
+  }
+}
+
+// k-way merge of the published events and the layers: fn(evt, layer, index) for each event at or
+// before lastTick in tick order, moving the cursors past it. At a tick the published events
+// (layer -1) go first, then the layers oldest first, the order flattening puts them in.
+template <typename Fn>
+void Track::mergeDue(const MidiEvent* base, uint32_t baseSize, uint32_t& baseCursor, uint32_t* cursors,
+                     uint32_t lastTick, Fn&& fn) const {
+  const int layers = (int)overdubLayers.size();
+  for (;;) {
+    int from = -2;  // Nothing due
+    uint32_t tick = 0;
+    if (baseCursor < baseSize && base[baseCursor].tick <= lastTick) {
+      from = -1;
+      tick = base[baseCursor].tick;
+    }
+    for (int l = 0; l < layers; ++l) {
+      const EventList& layer = overdubLayers[l];
+      if (cursors[l] < layer.size() && layer[cursors[l]].tick <= lastTick && (from == -2 || layer[cursors[l]].tick < tick)) {
+        from = l;
+        tick = layer[cursors[l]].tick;
+      }
+    }
+    if (from == -2) return;
+    if (from < 0) {
+      uint32_t i = baseCursor++;
+      fn(base[i], -1, i);
+    } else {
+      uint32_t i = cursors[from]++;
+      fn(overdubLayers[from][i], from, i);
+    }
+  }
+}
 
-    //logger.debug("Checking evt[%d] → evTick=%lu  prev=%lu…%lu",
-    //             nextEventIndex, evTick, prevTickInLoop, tickInLoop);
+void Track::seatLayerCursors(uint32_t tickInLoop) {
+  for (size_t l = 0; l < overdubLayers.size(); ++l) {
+    const EventList& layer = overdubLayers[l];
+    layerCursors[l] = std::lower_bound(layer.begin(), layer.end(), tickInLoop,
+                                       [](const MidiEvent& e, uint32_t t) { return e.tick < t; }) - layer.begin();
+  }
+}
 
-    // If this event just *now* should fire:
-    if ( prevTickInLoop < evTick && evTick <= tickInLoop ) {
-      sendMidiEvent(evt);
-      nextEventIndex++;
+bool Track::playbackCurrent(const PlaybackBuffer& buffer, const TrackTransform& with) const {
+  return buffer.generation == baseGeneration && buffer.loopLength == loopLengthTicks && buffer.transform == with;
+}
+
+// One playback buffer for the current events and loop length, sub-tick offsets included
+size_t Track::playbackCopyBytes() const {
+  size_t n = midiEvents.size();
+  size_t buckets = loopLengthTicks / Config::TICKS_PER_16TH_STEP + 2;
+  size_t bytes = TrackArena::blockBytes(n * sizeof(MidiEvent)) + TrackArena::blockBytes(buckets * sizeof(uint32_t));
+  if (Config::SUBTICK_OUTPUT) bytes += TrackArena::blockBytes(n * sizeof(uint16_t));
+  return bytes;
+}
+
+// Copy the events (or their render with `with`) into `buffer`, ordered by loop-relative tick and
+// bucketed per 16th step. Only reads midiEvents; the buffer is not the published one. A render
+// with sub-tick offsets reorders through a second copy, so it needs twice the room. When the arena
+// cannot hold that even after evicting undo levels, the buffer is emptied and false returned.
+bool Track::buildPlayback(PlaybackBuffer& buffer, const TrackTransform& with) {
+  auto& events = buffer.events;
+  auto& offsets = buffer.offsets;
+  size_t need = playbackCopyBytes();
+  if (Config::SUBTICK_OUTPUT && !with.isIdentity()) need *= 2;
+  if (!arena.canAllocate(need)) {
+    releaseBuffer(buffer);  // Its contents are replaced anyway
+    if (!TrackUndo::makeArenaRoom(*this, need)) return false;
+  }
+  offsets.clear();
+  if (!with.isIdentity()) {
+    with.render(midiEvents, loopLengthTicks, events, Config::SUBTICK_OUTPUT ? &offsets : nullptr);
+  } else {
+    events.assign(midiEvents.begin(), midiEvents.end());
+  }
+  for (auto& evt : events) {
+    if (evt.tick >= loopLengthTicks) evt.tick %= loopLengthTicks;
+  }
+  // Events are sorted by absolute tick; only those past the loop end land out of order
+  auto byTick = [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; };
+  if (!std::is_sorted(events.begin(), events.end(), byTick)) {
+    if (offsets.empty()) {
+      std::stable_sort(events.begin(), events.end(), byTick);
+    } else {
+      // Move each sub-tick offset with its event
+      std::vector<uint32_t> order(events.size());
+      for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+      std::stable_sort(order.begin(), order.end(),
+                       [&](uint32_t a, uint32_t b) { return events[a].tick < events[b].tick; });
+      EventList sortedEvents(events.size(), MidiEvent(), events.get_allocator());
+      OffsetList sortedOffsets(events.size(), 0, offsets.get_allocator());
+      for (uint32_t i = 0; i < order.size(); ++i) {
+        sortedEvents[i] = events[order[i]];
+        sortedOffsets[i] = offsets[order[i]];
+      }
+      events.swap(sortedEvents);
+      offsets.swap(sortedOffsets);
+    }
+  }
+
+  constexpr uint32_t step = Config::TICKS_PER_16TH_STEP;
+  uint32_t numBuckets = (loopLengthTicks + step - 1) / step;
+  buffer.buckets.reserve(numBuckets + 1);  // Exactly, as playbackCopyBytes() counts it
+  buffer.buckets.resize(numBuckets + 1);
+  uint32_t e = 0;
+  for (uint32_t b = 0; b <= numBuckets; ++b) {
+    while (e < events.size() && events[e].tick < b * step) ++e;
+    buffer.buckets[b] = e;
+  }
+  buffer.generation = baseGeneration;
+  buffer.loopLength = loopLengthTicks;
+  buffer.transform = with;
+  return true;
+}
+
+// loop(), off the tick path: the unpublished buffer for the current events and loop length, rendered
+// with the pending transform when one waits for the loop start. When it does not fit the track is
+// full and playback keeps the published buffer.
+bool Track::preparePlayback() {
+  if (loopLengthTicks == 0) return false;  // Nothing to play yet
+  const TrackTransform& with = getTransform();
+  PlaybackBuffer& back = playBuffers[publishedPlayback ^ 1];
+  if (playbackCurrent(back, with) || playbackCurrent(playback(), with)) return false;
+  if (!buildPlayback(back, with)) {
+    if (!full) {
+      logger.log(CAT_TRACK, LOG_WARNING, "Track full (%u events), playback keeps the previous copy",
+                 (unsigned)getMidiEventCount());
     }
-    // If it's still coming later in this pass, bail out:
-    else if (evTick > tickInLoop) {
-      break;
+    full = true;
+    return false;
+  }
+  return true;
+}
+
+// Until the next buffer is prepared, playback carries on with the one it has
+bool Track::publishPlayback() {
+  if (playbackCurrent(playback(), transform)) return false;
+  uint8_t back = publishedPlayback ^ 1;
+  if (!playbackCurrent(playBuffers[back], transform)) return false;
+  // The buffer is complete before the index that publishes it is stored
+  std::atomic_signal_fence(std::memory_order_release);
+  publishedPlayback = back;
+  return true;
+}
+
+// Not playing: give both buffers' arena space back
+void Track::releasePlayback() {
+  for (auto& buffer : playBuffers) releaseBuffer(buffer);
+}
+
+void Track::releaseBuffer(PlaybackBuffer& buffer) {
+  EventList(buffer.events.get_allocator()).swap(buffer.events);
+  std::vector<uint32_t, ArenaAllocator<uint32_t>>(buffer.buckets.get_allocator()).swap(buffer.buckets);
+  OffsetList(buffer.offsets.get_allocator()).swap(buffer.offsets);
+  buffer.generation = 0;
+}
+
+size_t Track::getPlaybackBytes() const {
+  size_t bytes = 0;
+  for (const auto& buffer : playBuffers) {
+    bytes += buffer.events.capacity() * sizeof(MidiEvent) + buffer.buckets.capacity() * sizeof(uint32_t) +
+             buffer.offsets.capacity() * sizeof(uint16_t);
+  }
+  return bytes;
+}
+
+// Binary search inside the tick's 16th bucket
+uint32_t Track::firstEntryAtOrAfter(uint32_t tickInLoop) const {
+  const PlaybackBuffer& buffer = playback();
+  uint32_t b = tickInLoop / Config::TICKS_PER_16TH_STEP;
+  if (b + 1 >= buffer.buckets.size()) return buffer.events.size();
+  auto first = buffer.events.begin() + buffer.buckets[b];
+  auto last = buffer.events.begin() + buffer.buckets[b + 1];
+  return std::lower_bound(first, last, tickInLoop,
+                          [](const MidiEvent& e, uint32_t t) { return e.tick < t; }) - buffer.events.begin();
+}
+
+// -------------------------
+// Locate and chase
+// -------------------------
+
+// Move playback to currentTick: the next playMidiEvents() seats its cursor there without counting a
+// jump. Notes left on at the old position are ended; with chase, the notes held at the new position
+// and the latest controller and program values before it are sent (see Config::CHASE_*).
+void Track::locate(uint32_t currentTick, bool chase) {
+  sendSoundingNoteOffs();
+  playCursorValid = false;
+  if (!chase || muted || !hasData() || loopLengthTicks == 0) return;
+  if (trackState != TRACK_PLAYING && trackState != TRACK_OVERDUBBING) return;
+  preparePlayback();  // A no-op unless a change has not been prepared yet
+  publishPlayback();
+  chaseAt((currentTick - startLoopTick) % loopLengthTicks);
+}
+
+// State at tickInLoop from two passes over the published events and the layers: the whole loop gives
+// what is carried over the loop end, then the entries before tickInLoop bring it up to the position. NoteOffs at the
+// position itself are applied so those notes are not restarted; the cursor plays the rest at the tick.
+void Track::chaseAt(uint32_t tickInLoop) {
+  // loop() context only; kept off the stack
+  static NoteTable held;
+  static NoteSet ccSeen;
+  static uint8_t ccValue[NoteSet::CHANNELS][128];
+  uint16_t programSeen = 0;
+  uint8_t program[NoteSet::CHANNELS];
+  held.reset();
+  ccSeen.reset();
+
+  auto apply = [&](const MidiEvent& evt) {
+    uint8_t ch = (evt.channel - 1) & 0x0F;
+    if (evt.isNoteOn()) {
+      held.set(evt.channel, evt.data.noteData.note, evt.data.noteData.velocity);
+    } else if (evt.isNoteOff()) {
+      held.clear(evt.channel, evt.data.noteData.note);
+    } else if (evt.type == midi::ControlChange && evt.data.ccData.cc < 120) {  // Not channel mode messages
+      ccSeen.set(evt.channel, evt.data.ccData.cc);
+      ccValue[ch][evt.data.ccData.cc] = evt.data.ccData.value;
+    } else if (evt.type == midi::ProgramChange) {
+      programSeen |= 1u << ch;
+      program[ch] = evt.data.program;
     }
-    // Otherwise we missed it entirely—skip it so we don't hang:
-    else {
-      nextEventIndex++;
+  };
+  const auto& events = playback().events;
+  uint32_t cursor = 0;
+  uint32_t cursors[Config::OVERDUB_MAX_LAYERS] = {};
+  mergeDue(events.data(), events.size(), cursor, cursors, UINT32_MAX,
+           [&](const MidiEvent& evt, int, uint32_t) { apply(evt); });
+  cursor = 0;
+  memset(cursors, 0, sizeof(cursors));
+  mergeDue(events.data(), events.size(), cursor, cursors, tickInLoop, [&](const MidiEvent& evt, int, uint32_t) {
+    if (evt.tick < tickInLoop || evt.isNoteOff()) apply(evt);
+  });
+
+  uint32_t now = clockManager.getCurrentTick();
+  if (Config::CHASE_CONTROLLERS_ON_LOCATE) {
+    for (uint8_t ch = 0; ch < NoteSet::CHANNELS; ++ch) {
+      if (programSeen & (1u << ch)) sendMidiEvent(MidiEvent::ProgramChange(now, ch + 1, program[ch]));
     }
+    ccSeen.forEach([&](uint8_t channel, uint8_t cc) {
+      sendMidiEvent(MidiEvent::ControlChange(now, channel, cc, ccValue[channel - 1][cc]));
+    });
+  }
+  if (Config::CHASE_NOTES_ON_LOCATE) {
+    held.forEach([&](uint8_t channel, uint8_t note) {
+      sendMidiEvent(MidiEvent::NoteOn(now, channel, note, held.velocity(channel, note)));
+    });
+  }
+}
+
+// -------------------------
+// Playback transform
+// -------------------------
+
+void Track::setTransform(const TrackTransform& t) {
+  TrackTransform next = t;
+  next.quantizeStrength = std::min<uint8_t>(next.quantizeStrength, 100);
+  next.swing = std::min<uint8_t>(next.swing, 100);
+  if (next == getTransform()) return;
+  flattenLayers();  // The render is built from midiEvents alone
+  pendingTransform = next;
+  transformPending = true;
+  // Not playing: nothing to keep in step with, apply now
+  if (trackState != TRACK_PLAYING && trackState != TRACK_OVERDUBBING) applyPendingTransform();
+  preparePlayback();
+}
+
+void Track::applyPendingTransform() {
+  // Notes started under the old transpose would not get their NoteOff from the new render
+  if (pendingTransform.transpose != transform.transpose) sendSoundingNoteOffs();
+  transform = pendingTransform;
+  transformPending = false;
+}
+
+// The list replaces midiEvents when the arena can hold it (old undo levels are evicted for it)
+bool Track::assignEvents(const EventList& events) {
+  flattenLayers();
+  if (events.size() > midiEvents.capacity() &&
+      !TrackUndo::makeArenaRoom(*this, events.size() * sizeof(MidiEvent))) {
+    full = true;
+    return false;
+  }
+  midiEvents.assign(events.begin(), events.end());
+  markEventsChanged();
+  return true;
+}
+
+bool Track::commitTransform() {
+  flattenLayers();
+  if (transformPending) applyPendingTransform();
+  if (transform.isIdentity() || midiEvents.empty()) return false;
+  EventList rendered;
+  transform.render(midiEvents, loopLengthTicks, rendered);
+  bool pushed = TrackUndo::pushUndoSnapshot(*this);
+  if (!assignEvents(rendered)) {
+    if (pushed) TrackUndo::popLastUndo(*this);
+    logger.log(CAT_TRACK, LOG_WARNING, "Track full (%u events), transform not committed", (unsigned)midiEvents.size());
+    return false;
   }
+  // The events now sound as the transform did; playback carries on without a jump
+  transform = TrackTransform();
+  preparePlayback();
+  StorageManager::journalTrackEvents(*this);
+  logger.logTrackEvent("Transform committed", clockManager.getCurrentTick());
+  return true;
 }
 
-void Track::sendMidiEvent(const MidiEvent& evt) {
+void Track::sendMidiEvent(const MidiEvent& evt, uint16_t fracQ16) {
   if (trackState != TRACK_PLAYING && trackState != TRACK_OVERDUBBING) return;
   isPlayingBack = true;  // Mark playback so noteOn/noteOff ignores it
-  midiHandler.sendMidiEvent(evt);
+  if (evt.type == midi::SystemExclusive) {
+    uint16_t length;
+    const uint8_t* bytes = sysex.message(evt.data.sysexOffset, length);
+    if (bytes) midiHandler.sendTrackSysEx(index, bytes, length);
+  } else if (fracQ16) {
+    // Between ticks: sent by the output scheduler fracQ16 of a tick after this tick elapsed
+    outputScheduler.schedule(index, evt, clockManager.microsAtTickFraction(fracQ16));
+  } else {
+    midiHandler.sendTrackEvent(index, evt);
+  }
   isPlayingBack = false;  // Reset playback state
+  if (evt.type == midi::NoteOn && evt.data.noteData.velocity > 0) {
+    soundingNotes.set(evt.channel, evt.data.noteData.note);
+  } else if (evt.type == midi::NoteOn || evt.type == midi::NoteOff) {
+    soundingNotes.clear(evt.channel, evt.data.noteData.note);
+  }
+}
+
+// NoteOff for exactly the notes playback left on, instead of a CC 123 on every channel
+void Track::sendSoundingNoteOffs() {
+  outputScheduler.cancelTrack(index);  // NoteOffs still waiting for their deadline go now
+  if (soundingNotes.empty()) return;
+  isPlayingBack = true;
+  soundingNotes.forEach([&](uint8_t channel, uint8_t note) {
+    midiHandler.sendTrackEvent(index, MidiEvent::NoteOff(clockManager.getCurrentTick(), channel, note));
+  });
+  isPlayingBack = false;
+  soundingNotes.reset();
 }
 
 void Track::sendAllNotesOff() {
+  outputScheduler.cancelTrack(index);
   // Control Change 123 = All Notes Off
-  for (uint8_t ch = 0; ch < 16; ++ch) {
-    midiHandler.sendControlChange(ch, 123, 0);
+  for (uint8_t ch = 1; ch <= 16; ++ch) {
+    midiHandler.sendTrackEvent(index, MidiEvent::ControlChange(0, ch, 123, 0));
   }
   // also clear any half-open pending notes so they don't get forced later
-  pendingNotes.clear();
+  pendingNotes.reset();
+  soundingNotes.reset();
   logger.logTrackEvent("All Notes Off sent", clockManager.getCurrentTick());
 }
 
 uint32_t Track::getTicksPerBar() {
-    return TICKS_PER_BAR;
+    return timeSignature.ticksPerBar();
 }
 
 bool Track::isEmpty() const{
@@ -465,7 +1309,9 @@ uint32_t Track::getLoopLength() const {
 }
 
 void Track::setLoopLength(uint32_t ticks) {
+  if (ticks != loopLengthTicks) flattenLayers();  // Layer ticks are positions in the old loop
   loopLengthTicks = ticks;
+  preparePlayback();
 }
 
 // Display functions
@@ -473,13 +1319,8 @@ void Track::noteOn(uint8_t channel, uint8_t note, uint8_t velocity, uint32_t tic
   if (isPlayingBack) return;  // Ignore playback-triggered MIDI events
 
   if (trackState == TRACK_RECORDING || trackState == TRACK_OVERDUBBING) {
-    // Store pending note for later duration fix
-    pendingNotes[{note, channel}] = PendingNote{
-      note,
-      channel,
-      tick,
-      velocity
-    };
+    // Hold the note until its NoteOff (or finalizePendingNotes() on stop)
+    pendingNotes.set(channel, note, velocity);
 
     recordMidiEvents(midi::NoteOn, channel, note, velocity, tick);
   }
@@ -489,11 +1330,8 @@ void Track::noteOff(uint8_t channel, uint8_t note, uint8_t velocity, uint32_t ti
   if (isPlayingBack) return;
 
   if (trackState == TRACK_RECORDING || trackState == TRACK_OVERDUBBING) {
-    auto key = std::make_pair(note, channel);
-    auto it = pendingNotes.find(key);
-    if (it != pendingNotes.end()) {
+    if (pendingNotes.clear(channel, note)) {
       recordMidiEvents(midi::NoteOff, channel, note, 0, tick);  // Use velocity 0 to mark end
-      pendingNotes.erase(it);
     } else {
       logger.log(CAT_MIDI, LOG_WARNING,
                  "NoteOff for note %d on ch %d with no matching NoteOn",
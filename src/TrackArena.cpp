@@ -0,0 +1,126 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "TrackArena.h"
+#include "Globals.h"
+#include <Arduino.h>
+#include <stdlib.h>
+
+// Arenas with a region, for ownerOf() lookups during deallocation
+static TrackArena* attachedArenas[Config::NUM_TRACKS] = {};
+static uint8_t attachedCount = 0;
+
+void TrackArena::attachTrackRegion(uint8_t trackIndex) {
+    if (trackIndex >= Config::NUM_TRACKS || base) return;
+    // PSRAM: an even share of the fitted chips (8 or 16 MB)
+    if (external_psram_size > 0) {
+        size_t bytes = extmemBytesPerTrack();
+        void* region = extmem_malloc(bytes);
+        if (region) {
+            attach(region, bytes);
+            extmem = true;
+            return;
+        }
+    }
+    // RAM2: the heap lives in DMAMEM, so one allocation at boot gives a fixed region there
+    // without reserving RAM2 statically on boards that do have PSRAM
+    void* region = malloc(Config::TRACK_ARENA_BYTES);
+    if (region) {
+        attach(region, Config::TRACK_ARENA_BYTES);
+    } else {
+        Serial.print("[TrackArena] ERROR: No memory for track region "); Serial.println(trackIndex);
+    }
+}
+
+size_t TrackArena::extmemBytesPerTrack() {
+    size_t pool = (size_t)external_psram_size * 1024 * 1024 / 100 * Config::TRACK_ARENA_EXTMEM_PERCENT;
+    return pool / Config::NUM_TRACKS;
+}
+
+void TrackArena::attach(void* region, size_t bytes) {
+    uintptr_t start = ((uintptr_t)region + ALIGN - 1) & ~(uintptr_t)(ALIGN - 1);
+    bytes -= start - (uintptr_t)region;
+    bytes &= ~(ALIGN - 1);
+    if (base || bytes < HEADER + ALIGN || attachedCount >= Config::NUM_TRACKS) return;
+    base = (uint8_t*)start;
+    capacityBytes = bytes;
+    usedBytes = 0;
+    freeList = (Block*)base;
+    freeList->size = bytes;
+    freeList->next = nullptr;
+    attachedArenas[attachedCount++] = this;
+}
+
+size_t TrackArena::blockBytes(size_t bytes) {
+    if (bytes == 0) bytes = 1;
+    return HEADER + ((bytes + ALIGN - 1) & ~(ALIGN - 1));
+}
+
+void* TrackArena::allocate(size_t bytes) {
+    if (!base) return nullptr;
+    size_t need = blockBytes(bytes);
+    Block** link = &freeList;
+    for (Block* b = freeList; b; link = &b->next, b = b->next) {
+        if (b->size < need) continue;
+        if (b->size - need >= HEADER + ALIGN) {
+            // Split: the tail stays on the free list in b's place
+            Block* rest = (Block*)((uint8_t*)b + need);
+            rest->size = b->size - need;
+            rest->next = b->next;
+            *link = rest;
+            b->size = need;
+        } else {
+            *link = b->next;
+        }
+        usedBytes += b->size;
+        return (uint8_t*)b + HEADER;
+    }
+    overflowCount++;
+    return nullptr;
+}
+
+void TrackArena::deallocate(void* ptr) {
+    if (!owns(ptr)) return;
+    Block* b = (Block*)((uint8_t*)ptr - HEADER);
+    usedBytes -= b->size;
+
+    // Insert in address order, then merge with the neighbours
+    Block* prev = nullptr;
+    Block* next = freeList;
+    while (next && next < b) { prev = next; next = next->next; }
+    b->next = next;
+    if (prev) prev->next = b; else freeList = b;
+
+    if (next && (uint8_t*)b + b->size == (uint8_t*)next) {
+        b->size += next->size;
+        b->next = next->next;
+    }
+    if (prev && (uint8_t*)prev + prev->size == (uint8_t*)b) {
+        prev->size += b->size;
+        prev->next = b->next;
+    }
+}
+
+bool TrackArena::owns(const void* ptr) const {
+    return base && (const uint8_t*)ptr >= base && (const uint8_t*)ptr < base + capacityBytes;
+}
+
+bool TrackArena::canAllocate(size_t bytes) const {
+    if (!base) return true;  // No region: heap-backed, no budget
+    return largestFreeBlock() >= blockBytes(bytes);
+}
+
+size_t TrackArena::largestFreeBlock() const {
+    size_t largest = 0;
+    for (Block* b = freeList; b; b = b->next) {
+        if (b->size > largest) largest = b->size;
+    }
+    return largest;
+}
+
+TrackArena* TrackArena::ownerOf(const void* ptr) {
+    for (uint8_t i = 0; i < attachedCount; ++i) {
+        if (attachedArenas[i]->owns(ptr)) return attachedArenas[i];
+    }
+    return nullptr;
+}
@@ -7,15 +7,16 @@
 #include "StorageManager.h"
 #include "LooperState.h"
 #include "Logger.h"
+#include "MemoryMonitor.h"
+#include "Profiler.h"
+#include "TrackStateMachine.h"
+#include "TimeSignature.h"
 
 TrackManager trackManager;
 
 TrackManager::TrackManager() {
   for (uint8_t i = 0; i < Config::NUM_TRACKS; i++) {
-    pendingRecord[i] = false;
-    pendingStop[i] = false;
-    muted[i] = false;
-    soloed[i] = false;
+    tracks[i].attachArena(i);
   }
   autoAlignEnabled = false;
   masterLoopLength = 0;
@@ -30,10 +31,11 @@ void TrackManager::startRecordingTrack(uint8_t trackIndex, uint32_t currentTick)
   if (!clockManager.isClockRunning()) {
     // Arm the track and set pendingRecord so it will start when the clock starts
     tracks[trackIndex].setState(TRACK_ARMED);
-    pendingRecord[trackIndex] = true;
+    table.pendingRecord |= bit(trackIndex);
     logger.log(CAT_TRACK, LOG_INFO, "Track %d armed, waiting for clock to start recording", trackIndex);
     return;
   }
+  if (!MemoryMonitor::admitRecording(tracks[trackIndex], false)) return;
   tracks[trackIndex].startRecording(currentTick);
   tracks[trackIndex].isArmed();  // sets state to TRACK_ARMED and logs
 }
@@ -53,20 +55,19 @@ void TrackManager::stopRecordingTrack(uint8_t trackIndex) {
   if (autoAlignEnabled) {
     tracks[trackIndex].setLoopLength(masterLoopLength);
   }
-  Serial.println("Saving state after recording");
-  StorageManager::saveState(looperState.getLooperState()); // Save after recording
+  StorageManager::requestSave(); // Save after recording
 }
 
 void TrackManager::queueRecordingTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) pendingRecord[trackIndex] = true;
+  if (trackIndex < Config::NUM_TRACKS) table.pendingRecord |= bit(trackIndex);
 }
 
 void TrackManager::queueStopRecordingTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) pendingStop[trackIndex] = true;
+  if (trackIndex < Config::NUM_TRACKS) table.pendingStop |= bit(trackIndex);
 }
 
 void TrackManager::startOverdubbingTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) {
+  if (trackIndex < Config::NUM_TRACKS && MemoryMonitor::admitRecording(tracks[trackIndex], true)) {
     tracks[trackIndex].startOverdubbing(clockManager.getCurrentTick());
   }
 }
@@ -74,24 +75,22 @@ void TrackManager::startOverdubbingTrack(uint8_t trackIndex) {
 // Quantized Actions ------------------------------------------
 
 void TrackManager::handleQuantizedStart(uint32_t currentTick) {
-  if (currentTick % ticksPerBar != 0) return;
+  if (!timeSignature.isBarStart(currentTick)) return;
 
-  for (uint8_t i = 0; i < Config::NUM_TRACKS; i++) {
-    if (pendingRecord[i]) {
-      startRecordingTrack(i, currentTick);
-      pendingRecord[i] = false;
-    }
+  for (uint32_t pending = table.pendingRecord; pending; pending &= pending - 1) {
+    uint8_t i = (uint8_t)__builtin_ctz(pending);
+    startRecordingTrack(i, currentTick);
+    table.pendingRecord &= ~bit(i);
   }
 }
 
 void TrackManager::handleQuantizedStop(uint32_t currentTick) {
-  if (currentTick % ticksPerBar != 0) return;
+  if (!timeSignature.isBarStart(currentTick)) return;
 
-  for (uint8_t i = 0; i < Config::NUM_TRACKS; i++) {
-    if (pendingStop[i]) {
-      stopRecordingTrack(i);
-      pendingStop[i] = false;
-    }
+  for (uint32_t pending = table.pendingStop; pending; pending &= pending - 1) {
+    uint8_t i = (uint8_t)__builtin_ctz(pending);
+    stopRecordingTrack(i);
+    table.pendingStop &= ~bit(i);
   }
 }
 
@@ -105,6 +104,49 @@ void TrackManager::stopPlayingTrack(uint8_t trackIndex) {
   if (trackIndex < Config::NUM_TRACKS) tracks[trackIndex].stopPlaying();
 }
 
+// -------------------------
+// Transport
+// -------------------------
+
+// One merge per call, so a slice never pays for more than one layer; tracks take turns
+bool TrackManager::compactLayers() {
+  for (uint8_t n = 0; n < Config::NUM_TRACKS; ++n) {
+    uint8_t i = nextCompactTrack;
+    nextCompactTrack = (uint8_t)((i + 1) % Config::NUM_TRACKS);
+    if (tracks[i].compactLayers()) return true;
+  }
+  return false;
+}
+
+// Playback buffers left stale by edits outside the commit points (see Track::preparePlayback())
+bool TrackManager::preparePlayback() {
+  for (uint8_t n = 0; n < Config::NUM_TRACKS; ++n) {
+    uint8_t i = nextPrepareTrack;
+    nextPrepareTrack = (uint8_t)((i + 1) % Config::NUM_TRACKS);
+    if (tracks[i].preparePlayback()) return true;
+  }
+  return false;
+}
+
+void TrackManager::locateAll(uint32_t currentTick) {
+  for (uint32_t m = table.active; m; m &= m - 1) tracks[__builtin_ctz(m)].locate(currentTick, true);
+}
+
+void TrackManager::pauseForTransport() {
+  transportPaused = 0;
+  for (uint8_t i = 0; i < Config::NUM_TRACKS; ++i) {
+    TrackState s = table.state[i];
+    if (s == TRACK_PLAYING || s == TRACK_OVERDUBBING) transportPaused |= bit(i);
+    tracks[i].sendAllNotesOff();
+    tracks[i].stopPlaying();
+  }
+}
+
+void TrackManager::resumeFromTransport(uint32_t currentTick) {
+  for (uint32_t m = transportPaused; m; m &= m - 1) tracks[__builtin_ctz(m)].startPlaying(currentTick);
+  transportPaused = 0;
+}
+
 void TrackManager::clearTrack(uint8_t trackIndex) {
   if (trackIndex < Config::NUM_TRACKS) tracks[trackIndex].clear();
 
@@ -124,30 +166,27 @@ void TrackManager::clearTrack(uint8_t trackIndex) {
 // Mute / Solo ------------------------------------------------
 
 void TrackManager::muteTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) muted[trackIndex] = true;
+  if (trackIndex < Config::NUM_TRACKS) table.muted |= bit(trackIndex);
 }
 
 void TrackManager::unmuteTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) muted[trackIndex] = false;
+  if (trackIndex < Config::NUM_TRACKS) table.muted &= ~bit(trackIndex);
 }
 
 void TrackManager::toggleMuteTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) muted[trackIndex] = !muted[trackIndex];
+  if (trackIndex < Config::NUM_TRACKS) table.muted ^= bit(trackIndex);
 }
 
 void TrackManager::soloTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) soloed[trackIndex] = true;
+  if (trackIndex < Config::NUM_TRACKS) table.soloed |= bit(trackIndex);
 }
 
 void TrackManager::unsoloTrack(uint8_t trackIndex) {
-  if (trackIndex < Config::NUM_TRACKS) soloed[trackIndex] = false;
+  if (trackIndex < Config::NUM_TRACKS) table.soloed &= ~bit(trackIndex);
 }
 
 bool TrackManager::anyTrackSoloed() const {
-  for (uint8_t i = 0; i < Config::NUM_TRACKS; i++) {
-    if (soloed[i]) return true;
-  }
-  return false;
+  return table.soloed != 0;
 }
 
 bool TrackManager::isTrackAudible(uint8_t trackIndex) const {
@@ -176,7 +215,7 @@ uint32_t TrackManager::getMasterLoopLength() const {
 // Track Info Accessors ---------------------------------------
 
 TrackState TrackManager::getTrackState(uint8_t trackIndex) const {
-  return (trackIndex < Config::NUM_TRACKS) ? tracks[trackIndex].getState() : TRACK_STOPPED;
+  return (trackIndex < Config::NUM_TRACKS) ? table.state[trackIndex] : TRACK_STOPPED;
 }
 
 uint32_t TrackManager::getTrackLength(uint8_t trackIndex) const {
@@ -209,24 +248,44 @@ void TrackManager::setup() {
 }
 
 void TrackManager::updateAllTracks(uint32_t currentTick) {
-  // Called from ClockManager.internalUpdateClockTick and updateMidiClockTick
-  for (uint8_t i = 0; i < Config::NUM_TRACKS; i++) {
-    if (pendingRecord[i]) {
+  // Called from loop() via ClockManager::processPendingTicks() and the MIDI clock/start handlers,
+  // never from the timer ISR, so MIDI output, logging and saving are safe here.
+  // Everything the tracks play on this tick goes out as one batch.
+  PROFILE_SCOPE(PROBE_UPDATE_ALL_TRACKS);
+  // Only tracks that record, play or have a pending action are visited.
+  midiHandler.beginOutputBatch();
+  const bool barStart = table.pendingRecord && timeSignature.isBarStart(currentTick);
+  for (uint32_t visit = table.active | table.pendingRecord | table.pendingStop; visit; visit &= visit - 1) {
+    uint8_t i = (uint8_t)__builtin_ctz(visit);
+    if (table.pendingRecord & bit(i)) {
       // Wait for the next bar boundary
-      //if (currentTick == 0 || (currentTick % Track::getTicksPerBar()) == 0) {
-      if (currentTick == 0 || (currentTick % Track::getTicksPerBar()) == 0) {
+      if (currentTick == 0 || barStart) {
         startRecordingTrack(i, currentTick);
-        pendingRecord[i] = false;
+        table.pendingRecord &= ~bit(i);
       }
     }
 
-    if (pendingStop[i]) {
+    if (table.pendingStop & bit(i)) {
       stopRecordingTrack(i);
-      pendingStop[i] = false;
+      table.pendingStop &= ~bit(i);
     }
 
-    bool audible = isTrackAudible(i);
-    tracks[i].playMidiEvents(currentTick, audible);
+    if (table.active & bit(i)) tracks[i].playMidiEvents(currentTick, isTrackAudible(i));
   }
+  midiHandler.endOutputBatch();
+}
+
+
+uint8_t TrackManager::getTrackIndex(const Track& track) const {
+  return (uint8_t)(&track - tracks);
 }
 
+void TrackManager::onTrackStateChanged(uint8_t trackIndex, TrackState state) {
+  if (trackIndex >= Config::NUM_TRACKS) return;
+  table.state[trackIndex] = state;
+  if (TrackStateMachine::runsOnTick(state)) {
+    table.active |= bit(trackIndex);
+  } else {
+    table.active &= ~bit(trackIndex);
+  }
+}
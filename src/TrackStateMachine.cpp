@@ -47,4 +47,16 @@ const char* toString(TrackState state) {
     }
 }
 
+bool runsOnTick(TrackState state) {
+    switch (state) {
+        case TRACK_RECORDING:
+        case TRACK_STOPPED_RECORDING:
+        case TRACK_PLAYING:
+        case TRACK_OVERDUBBING:
+            return true;
+        default:
+            return false;
+    }
+}
+
 }  // namespace TrackStateMachine
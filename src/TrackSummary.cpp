@@ -0,0 +1,40 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "TrackSummary.h"
+#include <string.h>
+
+void TrackSummary::rebuild(const EventList& events, uint32_t length) {
+  loopLength = length;
+  memset(noteCounts, 0, sizeof(noteCounts));
+  memset(otherCounts, 0, sizeof(otherCounts));
+  for (const auto& evt : events) {
+    uint8_t* count = countFor(evt);
+    if (count && *count < UINT8_MAX) ++*count;
+  }
+  ++version;
+}
+
+void TrackSummary::add(const MidiEvent& evt) {
+  uint8_t* count = countFor(evt);
+  if (!count || *count == UINT8_MAX) return;
+  ++*count;
+  ++version;
+}
+
+bool TrackSummary::remove(const MidiEvent& evt) {
+  uint8_t* count = countFor(evt);
+  if (!count) return true;
+  if (*count == 0 || *count == UINT8_MAX) return false;
+  --*count;
+  ++version;
+  return true;
+}
+
+uint8_t* TrackSummary::countFor(const MidiEvent& evt) {
+  if (loopLength == 0) return nullptr;  // Still recording the first take: rebuilt at its end
+  bool noteStart = evt.type == midi::NoteOn && evt.data.noteData.velocity > 0;
+  if (!noteStart && (evt.type == midi::NoteOn || evt.type == midi::NoteOff)) return nullptr;
+  uint16_t column = (uint16_t)((uint64_t)(evt.tick % loopLength) * COLUMNS / loopLength);
+  return noteStart ? &noteCounts[column] : &otherCounts[column];
+}
@@ -0,0 +1,140 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#include "TrackTransform.h"
+#include "NoteTable.h"
+#include <algorithm>
+
+static bool isNoteOff(const MidiEvent& evt) {
+  return evt.type == midi::NoteOff || (evt.type == midi::NoteOn && evt.data.noteData.velocity == 0);
+}
+
+uint32_t TrackTransform::moveStart(uint32_t tick, uint16_t* fracQ16) const {
+  if (fracQ16) *fracQ16 = 0;
+  if (quantizeStrength == 0 || quantizeGrid == 0) return tick;
+  uint32_t grid = quantizeGrid;
+  uint32_t step = (tick + grid / 2) / grid;
+  // Q16 ticks, so the swing and strength percentages keep their fraction of a tick
+  int64_t target = ((int64_t)step * grid) << 16;
+  if (step & 1) target += ((((int64_t)swing * 2 - 100) * grid) << 16) / 100;
+  int64_t from = (int64_t)tick << 16;
+  int64_t moved = from + (target - from) * quantizeStrength / 100;
+  if (moved < 0) return 0;
+  if (fracQ16) *fracQ16 = (uint16_t)(moved & 0xFFFF);
+  return (uint32_t)(moved >> 16);
+}
+
+void TrackTransform::render(const EventList& events, uint32_t loopLength, EventList& out, OffsetList* offsets) const {
+  // loop() context only; kept off the stack
+  static NoteSet open;       // NoteOns waiting for their NoteOff
+  static NoteSet dropped;    // NoteOns transposed out of range: drop their NoteOff too
+  static uint32_t openAt[NoteSet::CHANNELS][NoteSet::NOTES];     // Index in out
+  static uint32_t openStart[NoteSet::CHANNELS][NoteSet::NOTES];  // Original start tick
+  open.reset();
+  dropped.reset();
+  out.clear();
+  out.reserve(events.size());
+  std::vector<uint32_t> wrappedOffs;  // NoteOffs ahead of any NoteOn of their note
+  OffsetList frac{ArenaAllocator<uint16_t>(out.get_allocator())};  // Sub-tick start per out entry (only with offsets)
+  bool anyFrac = false;
+  if (offsets) frac.reserve(events.size());
+  auto emit = [&](const MidiEvent& r, uint16_t f) {
+    out.push_back(r);
+    if (offsets) frac.push_back(f);
+    anyFrac |= f != 0;
+  };
+
+  auto transposed = [&](uint8_t note) { return (int)note + transpose; };
+  auto endTick = [&](uint8_t ch, uint8_t note, uint32_t length) {
+    uint32_t scaled = (uint32_t)((uint64_t)length * lengthScale / 100);
+    return out[openAt[ch][note]].tick + (scaled ? scaled : 1);
+  };
+  auto closeNote = [&](const MidiEvent& evt, uint32_t length) {
+    uint8_t ch = (evt.channel - 1) & 0x0F, note = evt.data.noteData.note & 0x7F;
+    MidiEvent r = evt;
+    r.tick = endTick(ch, note, length);
+    r.data.noteData.note = (uint8_t)transposed(note);
+    open.clear(evt.channel, note);
+    emit(r, offsets ? frac[openAt[ch][note]] : 0);
+  };
+
+  for (uint32_t i = 0; i < events.size(); ++i) {
+    const MidiEvent& evt = events[i];
+    MidiEvent r = evt;
+    uint8_t ch = (evt.channel - 1) & 0x0F;
+    if (evt.type == midi::NoteOn && !isNoteOff(evt)) {
+      uint8_t note = evt.data.noteData.note & 0x7F;
+      int n = transposed(note);
+      if (n < 0 || n > 127) {
+        dropped.set(evt.channel, note);
+        continue;
+      }
+      uint32_t v = (uint32_t)evt.data.noteData.velocity * velocityScale / 100;
+      uint16_t f;
+      r.tick = moveStart(evt.tick, &f);
+      r.data.noteData.note = (uint8_t)n;
+      r.data.noteData.velocity = (uint8_t)std::clamp<uint32_t>(v, 1, 127);
+      open.set(evt.channel, note);
+      openAt[ch][note] = out.size();
+      openStart[ch][note] = evt.tick;
+      emit(r, f);
+    } else if (isNoteOff(evt)) {
+      uint8_t note = evt.data.noteData.note & 0x7F;
+      if (open.test(evt.channel, note)) {
+        closeNote(evt, evt.tick - openStart[ch][note]);
+      } else {
+        wrappedOffs.push_back(i);  // Settled once all NoteOns are seen
+      }
+    } else if (evt.type == midi::AfterTouchPoly) {
+      int n = transposed(evt.data.polyATData.note);
+      if (n < 0 || n > 127) continue;
+      r.data.polyATData.note = (uint8_t)n;
+      emit(r, 0);
+    } else {
+      emit(r, 0);
+    }
+  }
+
+  // Notes still open run over the loop end into the NoteOffs seen before them
+  for (uint32_t i : wrappedOffs) {
+    const MidiEvent& evt = events[i];
+    uint8_t ch = (evt.channel - 1) & 0x0F, note = evt.data.noteData.note & 0x7F;
+    if (open.test(evt.channel, note)) {
+      closeNote(evt, evt.tick + loopLength - openStart[ch][note]);
+    } else if (dropped.clear(evt.channel, note)) {
+      continue;
+    } else {
+      int n = transposed(note);
+      if (n < 0 || n > 127) continue;
+      MidiEvent r = evt;
+      r.data.noteData.note = (uint8_t)n;
+      emit(r, 0);
+    }
+  }
+
+  if (!offsets || !anyFrac) {
+    if (offsets) offsets->clear();
+    std::stable_sort(out.begin(), out.end(), [](const MidiEvent& a, const MidiEvent& b) {
+      return a.tick < b.tick || (a.tick == b.tick && isNoteOff(a) && !isNoteOff(b));
+    });
+    return;
+  }
+
+  // Order by tick plus fraction, NoteOffs first at the same instant; events and offsets together
+  std::vector<uint32_t> order(out.size());
+  for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    const MidiEvent& x = out[a];
+    const MidiEvent& y = out[b];
+    if (x.tick != y.tick) return x.tick < y.tick;
+    if (frac[a] != frac[b]) return frac[a] < frac[b];
+    return isNoteOff(x) && !isNoteOff(y);
+  });
+  EventList sorted(out.size(), MidiEvent(), out.get_allocator());
+  offsets->resize(out.size());
+  for (uint32_t i = 0; i < order.size(); ++i) {
+    sorted[i] = out[order[i]];
+    (*offsets)[i] = frac[order[i]];
+  }
+  out.swap(sorted);
+}
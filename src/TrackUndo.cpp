@@ -7,58 +7,379 @@
 #include "Logger.h"
 #include "ClockManager.h"
 #include "Globals.h"
+#include <string.h>
+
+// -------------------------
+// Delta helpers
+// -------------------------
+
+static bool sameEvent(const MidiEvent& a, const MidiEvent& b) {
+    return memcmp(&a, &b, sizeof(MidiEvent)) == 0;
+}
+
+static bool isSortedByTick(const EventList& events) {
+    for (size_t i = 1; i < events.size(); ++i) {
+        if (events[i].tick < events[i - 1].tick) return false;
+    }
+    return true;
+}
+
+// Call fn(i, iEnd, j, jEnd) for each tick group that differs between `from` and `to`. Tick groups
+// that are identical in both lists are shared; a group that differs is stored whole on both
+// sides, which keeps reconstruction exact (including the order within a tick) without needing an
+// LCS. Lists not sorted by tick differ as a whole.
+template <typename Fn>
+static void forEachChangedGroup(const EventList& from, const EventList& to, Fn&& fn) {
+    if (!isSortedByTick(from) || !isSortedByTick(to)) {
+        fn(0, from.size(), 0, to.size());
+        return;
+    }
+    size_t i = 0, j = 0;
+    while (i < from.size() || j < to.size()) {
+        uint32_t tick;
+        if (i >= from.size()) tick = to[j].tick;
+        else if (j >= to.size()) tick = from[i].tick;
+        else tick = std::min(from[i].tick, to[j].tick);
+
+        size_t iEnd = i, jEnd = j;
+        while (iEnd < from.size() && from[iEnd].tick == tick) ++iEnd;
+        while (jEnd < to.size() && to[jEnd].tick == tick) ++jEnd;
+
+        bool same = (iEnd - i) == (jEnd - j);
+        for (size_t k = 0; same && k < iEnd - i; ++k) same = sameEvent(from[i + k], to[j + k]);
+        if (!same) fn(i, iEnd, j, jEnd);
+        i = iEnd;
+        j = jEnd;
+    }
+}
+
+// Changes computeDelta() records for `from` into `to`
+struct DeltaSize {
+    size_t removed = 0, inserted = 0;
+    size_t bytes() const {
+        return TrackArena::blockBytes(removed * sizeof(UndoChange)) + TrackArena::blockBytes(inserted * sizeof(UndoChange));
+    }
+};
+
+static DeltaSize deltaSize(const EventList& from, const EventList& to) {
+    DeltaSize size;
+    forEachChangedGroup(from, to, [&](size_t i, size_t iEnd, size_t j, size_t jEnd) {
+        size.removed += iEnd - i;
+        size.inserted += jEnd - j;
+    });
+    return size;
+}
+
+// Record the changes turning `from` into `to` in entry.removed / entry.inserted, allocated once at
+// their exact size. The caller has checked the entry's arena for size.bytes().
+static void computeDelta(const EventList& from, const EventList& to, const DeltaSize& size, UndoEntry& entry) {
+    ChangeList(entry.removed.get_allocator()).swap(entry.removed);
+    ChangeList(entry.inserted.get_allocator()).swap(entry.inserted);
+    entry.removed.reserve(size.removed);
+    entry.inserted.reserve(size.inserted);
+    forEachChangedGroup(from, to, [&](size_t i, size_t iEnd, size_t j, size_t jEnd) {
+        for (size_t k = i; k < iEnd; ++k) entry.removed.push_back({(uint32_t)k, from[k]});
+        for (size_t k = j; k < jEnd; ++k) entry.inserted.push_back({(uint32_t)k, to[k]});
+    });
+}
+
+// Events in the state an entry describes, rebuilt from `next`
+static size_t restoredSize(const EventList& next, const UndoEntry& entry) {
+    return next.size() - entry.inserted.size() + entry.removed.size();
+}
+
+// Rebuild the state an entry describes from the state that followed it. The caller has checked
+// the entry's arena for restoredSize() events.
+static EventList applyDeltaBackwards(const EventList& next, const UndoEntry& entry) {
+    EventList out(entry.base.get_allocator());  // Same arena as the entry it replaces
+    size_t target = restoredSize(next, entry);
+    out.reserve(target);
+    size_t ni = 0, ii = 0, ri = 0;
+    while (out.size() < target) {
+        if (ri < entry.removed.size() && entry.removed[ri].index == out.size()) {
+            out.push_back(entry.removed[ri++].event);
+            continue;
+        }
+        while (ii < entry.inserted.size() && entry.inserted[ii].index == ni) { ++ni; ++ii; }
+        if (ni >= next.size()) break;  // inconsistent delta; return what we have
+        out.push_back(next[ni++]);
+    }
+    return out;
+}
+
+// Turn the newest level into a delta against `next`, the state that follows it. Older levels are
+// evicted when the delta does not fit; when it still does not, the history is given up (the older
+// deltas are rebuilt from this level).
+static void sealTop(Track& track, std::deque<UndoEntry>& history, size_t& historyBytes, const EventList& next) {
+    if (history.empty() || !history.back().open) return;
+    DeltaSize size = deltaSize(history.back().base, next);
+    if (!TrackUndo::makeArenaRoom(track, size.bytes())) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Track memory full, undo history given up");
+        TrackUndo::clearHistory(track);
+        return;
+    }
+    UndoEntry& top = history.back();
+    historyBytes -= top.bytes();
+    computeDelta(top.base, next, size, top);
+    EventList(top.base.get_allocator()).swap(top.base);
+    top.open = false;
+    historyBytes += top.bytes();
+}
+
+// After the newest entry is removed, turn the new newest entry back into a full copy.
+// `state` is the state that followed it (the removed entry's base). Older levels are evicted for
+// the copy; when it still does not fit, the rest of the history is given up.
+static void reopenTop(Track& track, std::deque<UndoEntry>& history, size_t& historyBytes, const EventList& state) {
+    if (history.empty() || history.back().open) return;
+    if (!TrackUndo::makeArenaRoom(track, restoredSize(state, history.back()) * sizeof(MidiEvent))) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Track memory full, undo history given up");
+        TrackUndo::clearHistory(track);
+        return;
+    }
+    UndoEntry& top = history.back();
+    historyBytes -= top.bytes();
+    top.base = applyDeltaBackwards(state, top);
+    ChangeList(top.removed.get_allocator()).swap(top.removed);
+    ChangeList(top.inserted.get_allocator()).swap(top.inserted);
+    top.open = true;
+    historyBytes += top.bytes();
+}
+
+// Levels still on the card (StorageManager::pagedUndoLevels) are older than every resident
+// level and hold no RAM, so they are evicted first and all at once before a resident level goes.
+static void evictOldestResident(Track& track, std::deque<UndoEntry>& history, size_t& historyBytes) {
+    StorageManager::dropPagedUndo(track, StorageManager::pagedUndoLevels(track));
+    historyBytes -= history.front().bytes();
+    history.pop_front();
+}
+
+static void enforceUndoBudget(Track& track, std::deque<UndoEntry>& history, size_t& historyBytes) {
+    size_t paged = StorageManager::pagedUndoLevels(track);
+    if (paged > 0 && history.size() + paged > Config::MAX_UNDO_HISTORY) {
+        StorageManager::dropPagedUndo(track, history.size() + paged - Config::MAX_UNDO_HISTORY);
+    }
+    size_t budget = TrackUndo::undoBudgetBytes(track);
+    while (history.size() > 1 && (historyBytes > budget || history.size() > Config::MAX_UNDO_HISTORY)) {
+        evictOldestResident(track, history, historyBytes);
+    }
+}
+
+// Make sure the newest level is in RAM, paging it in from the card once the resident history is
+// used up. Returns false when there is no level left.
+static bool pageInTop(Track& track, std::deque<UndoEntry>& history, size_t& historyBytes) {
+    if (!history.empty()) return true;
+    if (StorageManager::pagedUndoLevels(track) == 0) return false;
+    history.emplace_back(track.eventAllocator().arena);
+    if (!StorageManager::pageInUndoLevel(track, history.back())) {
+        history.pop_back();
+        return false;
+    }
+    historyBytes += history.back().bytes();
+    return true;
+}
 
 // Undo overdub
-void TrackUndo::pushUndoSnapshot(Track& track) {
-    track.midiHistory.push_back(track.midiEvents);
+bool TrackUndo::pushUndoSnapshot(Track& track) {
+    track.flattenLayers();
+    auto& history = track.midiHistory;
+    pageInTop(track, history, track.midiHistoryBytes);
+    // The previous newest level no longer needs a full copy: it becomes a delta against now
+    sealTop(track, history, track.midiHistoryBytes, track.midiEvents);
+    // Make room in the track's arena for the new full copy, oldest levels first
+    size_t bytes = track.midiEvents.size() * sizeof(MidiEvent);
+    while (!history.empty() && !track.arena.canAllocate(bytes)) {
+        evictOldestResident(track, history, track.midiHistoryBytes);
+    }
+    if (!makeArenaRoom(track, bytes)) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Track memory full, change made without an undo level");
+        clearHistory(track);  // Paged levels are rebuilt from a newest level that is gone
+        return false;
+    }
+    history.emplace_back(&track.arena);
+    history.back().open = true;
+    history.back().base = track.midiEvents;
+    track.midiHistoryBytes += history.back().bytes();
+    enforceUndoBudget(track, history, track.midiHistoryBytes);
     track.midiEventCountAtLastSnapshot = track.midiEvents.size();
+    StorageManager::journalUndoPushed(track);
+    return true;
+}
+
+// The events before a merged overdub layer: moved in as the newest level, no copy. The layer
+// journaled its undo push when it opened.
+void TrackUndo::pushUndoLevel(Track& track, EventList&& state) {
+    auto& history = track.midiHistory;
+    pageInTop(track, history, track.midiHistoryBytes);
+    sealTop(track, history, track.midiHistoryBytes, state);
+    history.emplace_back(&track.arena);
+    history.back().open = true;
+    history.back().base = std::move(state);
+    track.midiHistoryBytes += history.back().bytes();
+    enforceUndoBudget(track, history, track.midiHistoryBytes);
 }
 
 void TrackUndo::undoOverdub(Track& track) {
-    if (!canUndo(track)) {
+    if (!track.overdubLayers.empty()) {
+        // The newest take is still a layer of its own: dropping it is the undo
+        track.dropTopLayer();
+        StorageManager::journalUndoRestored(track);
+        logger.logTrackEvent("Overdub undone", clockManager.getCurrentTick());
+        StorageManager::requestSave();
+        return;
+    }
+    auto& history = track.midiHistory;
+    if (!pageInTop(track, history, track.midiHistoryBytes)) {
         logger.log(CAT_TRACK, LOG_WARNING, "Cannot undo overdub right now");
         return;
     }
-    track.midiEvents = peekLastMidiSnapshot(track);
+    track.midiHistoryBytes -= history.back().bytes();
+    track.midiEvents = std::move(history.back().base);
+    track.markEventsChanged();
     track.midiEventCountAtLastSnapshot = track.midiEvents.size();
-    popLastUndo(track);
+    history.pop_back();
+    pageInTop(track, history, track.midiHistoryBytes);
+    reopenTop(track, history, track.midiHistoryBytes, track.midiEvents);
+    track.preparePlayback();
+    StorageManager::journalUndoRestored(track);
     logger.debug("Undo restored snapshot: midiEvents=%d snapshotSize=%d",
                  track.midiEvents.size(), getUndoCount(track));
     logger.logTrackEvent("Overdub undone", clockManager.getCurrentTick());
-    StorageManager::saveState(looperState.getLooperState());
+    StorageManager::requestSave();
 }
 
 size_t TrackUndo::getUndoCount(const Track& track) {
-    return track.midiHistory.size();
+    return track.overdubLayers.size() + track.midiHistory.size() + StorageManager::pagedUndoLevels(track);
 }
 
 bool TrackUndo::canUndo(const Track& track) {
-    return !track.midiHistory.empty();
+    return getUndoCount(track) > 0;
 }
 
 void TrackUndo::popLastUndo(Track& track) {
-    if (track.midiHistory.empty()) {
+    auto& history = track.midiHistory;
+    if (!pageInTop(track, history, track.midiHistoryBytes)) {
         logger.log(CAT_TRACK, LOG_WARNING, "Attempted to pop undo snapshot, but none exist");
         return;
     }
-    track.midiHistory.pop_back();
+    track.midiHistoryBytes -= history.back().bytes();
+    EventList state = std::move(history.back().base);
+    history.pop_back();
+    pageInTop(track, history, track.midiHistoryBytes);
+    reopenTop(track, history, track.midiHistoryBytes, state);
+    StorageManager::journalUndoDropped(track);
+}
+
+const EventList& TrackUndo::peekLastMidiSnapshot(const Track& track) {
+    return track.midiHistory.back().base;
+}
+
+const EventList& TrackUndo::getCurrentMidiSnapshot(const Track& track) {
+    return track.getMidiEvents();
 }
 
-const std::vector<MidiEvent>& TrackUndo::peekLastMidiSnapshot(const Track& track) {
-    return track.midiHistory.back();
+size_t TrackUndo::getUndoBytes(const Track& track) {
+    return track.midiHistoryBytes;
 }
 
-std::deque<std::vector<MidiEvent>>& TrackUndo::getMidiHistory(Track& track) {
+const std::deque<UndoEntry>& TrackUndo::getUndoEntries(const Track& track) {
     return track.midiHistory;
 }
 
-const std::vector<MidiEvent>& TrackUndo::getCurrentMidiSnapshot(const Track& track) {
-    return track.midiEvents;
+void TrackUndo::clearHistory(Track& track) {
+    track.midiHistory.clear();
+    track.midiHistoryBytes = 0;
+    StorageManager::dropPagedUndo(track, StorageManager::pagedUndoLevels(track));
+}
+
+void TrackUndo::restoreHistory(Track& track, std::deque<UndoEntry>&& entries) {
+    clearHistory(track);
+    if (entries.empty()) return;
+    if (!entries.back().open) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Undo history without a full newest level, discarding it");
+        return;
+    }
+    size_t loaded = entries.size();
+    // Walk from the newest level down, sealing any full copies against the level above. A level
+    // whose state or delta does not fit its arena is dropped with the ones below it.
+    bool openBelowTop = false;
+    for (size_t i = 0; i + 1 < entries.size(); ++i) openBelowTop = openBelowTop || entries[i].open;
+    EventList next;
+    if (openBelowTop) next = entries.back().base;
+    for (size_t i = entries.size() - 1; openBelowTop && i-- > 0;) {
+        UndoEntry& e = entries[i];
+        TrackArena* arena = e.base.get_allocator().arena;
+        if (!e.open && arena && !arena->canAllocate(restoredSize(next, e) * sizeof(MidiEvent))) {
+            entries.erase(entries.begin(), entries.begin() + i + 1);
+            break;
+        }
+        EventList state = e.open ? std::move(e.base) : applyDeltaBackwards(next, e);
+        if (e.open) {
+            DeltaSize size = deltaSize(state, next);
+            if (arena && !arena->canAllocate(size.bytes())) {
+                entries.erase(entries.begin(), entries.begin() + i + 1);
+                break;
+            }
+            computeDelta(state, next, size, e);
+            EventList(e.base.get_allocator()).swap(e.base);
+            e.open = false;
+        }
+        next.swap(state);
+    }
+    // Move the loaded levels into the track's arena, newest first: a steal when they were read
+    // into it, else a copy, and the oldest levels that do not fit are dropped
+    for (size_t i = entries.size(); i-- > 0;) {
+        UndoEntry& e = entries[i];
+        if (e.base.get_allocator().arena != &track.arena && !track.arena.canAllocate(e.bytes())) break;
+        track.midiHistory.emplace_front(&track.arena);
+        UndoEntry& dst = track.midiHistory.front();
+        dst.open = e.open;
+        dst.base = std::move(e.base);
+        dst.removed = std::move(e.removed);
+        dst.inserted = std::move(e.inserted);
+        track.midiHistoryBytes += dst.bytes();
+    }
+    if (track.midiHistory.size() < loaded) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Track memory full, %u loaded undo levels dropped",
+                   (unsigned)(loaded - track.midiHistory.size()));
+    }
+    enforceUndoBudget(track, track.midiHistory, track.midiHistoryBytes);
+}
+
+// The arena left once the events, their two playback copies and a take's record reserve are
+// counted. An arena without a region budgets as a RAM2 one.
+size_t TrackUndo::undoBudgetBytes(const Track& track) {
+    size_t capacity = track.arena.capacity() ? track.arena.capacity() : Config::TRACK_ARENA_BYTES;
+    size_t live = TrackArena::blockBytes(track.midiEvents.size() * sizeof(MidiEvent)) + 2 * track.playbackCopyBytes() +
+                  TrackArena::blockBytes(track.recordReserveEvents() * sizeof(MidiEvent));
+    return capacity > live ? capacity - live : 0;
+}
+
+bool TrackUndo::makeArenaRoom(Track& track, size_t bytes) {
+    size_t evicted = 0;
+    while (!track.arena.canAllocate(bytes)) {
+        if (track.midiHistory.size() > 1) {
+            evictOldestResident(track, track.midiHistory, track.midiHistoryBytes);
+        } else if (track.clearMidiHistory.size() > 1) {
+            track.clearMidiHistory.pop_front();
+            if (!track.clearStateHistory.empty()) track.clearStateHistory.pop_front();
+            if (!track.clearLengthHistory.empty()) track.clearLengthHistory.pop_front();
+        } else {
+            break;
+        }
+        ++evicted;
+    }
+    if (evicted > 0) logger.log(CAT_TRACK, LOG_INFO, "Evicted %u undo levels for memory", (unsigned)evicted);
+    return track.arena.canAllocate(bytes);
 }
 
 // Undo clear
 void TrackUndo::pushClearTrackSnapshot(Track& track) {
-    track.clearMidiHistory.push_back(track.midiEvents);
+    track.flattenLayers();
+    if (!makeArenaRoom(track, track.midiEvents.size() * sizeof(MidiEvent))) {
+        logger.log(CAT_TRACK, LOG_WARNING, "Track memory full, cleared without an undo copy");
+        return;
+    }
+    track.clearMidiHistory.emplace_back(track.midiEvents, track.midiEvents.get_allocator());
     track.clearStateHistory.push_back(track.trackState);
     track.clearLengthHistory.push_back(track.loopLengthTicks);
     if (track.clearMidiHistory.size() > Config::MAX_UNDO_HISTORY) track.clearMidiHistory.pop_front();
@@ -68,7 +389,8 @@ void TrackUndo::pushClearTrackSnapshot(Track& track) {
 
 void TrackUndo::undoClearTrack(Track& track) {
     if (!track.clearMidiHistory.empty()) {
-        track.midiEvents = track.clearMidiHistory.back();
+        track.midiEvents = std::move(track.clearMidiHistory.back());  // Same arena: no copy
+        track.markEventsChanged();
         track.clearMidiHistory.pop_back();
     }
     if (!track.clearStateHistory.empty()) {
@@ -82,20 +404,25 @@ void TrackUndo::undoClearTrack(Track& track) {
     if (!track.midiEvents.empty() && (track.trackState == TRACK_EMPTY)) {
         track.setState(TRACK_STOPPED);
     }
+    track.preparePlayback();
+    StorageManager::journalTrackEvents(track);
 }
 
 bool TrackUndo::canUndoClearTrack(const Track& track) {
     return (!track.clearMidiHistory.empty());
 }
 
-// Compute a rolling FNV-1a hash of the track's current midiEvents
-uint32_t TrackUndo::computeMidiHash(const Track& track) {
-    uint32_t hash = 2166136261u;
-    for (auto const& evt : track.getMidiEvents()) {
-        hash ^= static_cast<uint32_t>(evt.type); hash *= 16777619u;
-        hash ^= evt.tick;                    hash *= 16777619u;
-        hash ^= evt.data.noteData.note;      hash *= 16777619u;
-        hash ^= evt.data.noteData.velocity;  hash *= 16777619u;
+bool TrackUndo::clearCopiesUseSysEx(const Track& track) {
+    for (const auto& events : track.clearMidiHistory) {
+        for (const auto& evt : events) {
+            if (evt.type == midi::SystemExclusive) return true;
+        }
     }
-    return hash;
-} 
\ No newline at end of file
+    return false;
+}
+
+size_t TrackUndo::getClearUndoBytes(const Track& track) {
+    size_t bytes = 0;
+    for (const auto& events : track.clearMidiHistory) bytes += events.capacity() * sizeof(MidiEvent);
+    return bytes;
+}
@@ -6,76 +6,120 @@
 #include "Logger.h"
 #include "ClockManager.h"
 #include "MidiHandler.h"
+#include "OutputScheduler.h"
 #include "TrackManager.h"
 #include "ButtonManager.h"
 #include "DisplayManager.h"
 #include "LooperState.h"
 #include "Looper.h"
 #include "Track.h"
+#include "StorageManager.h"
 #include "Globals.h"
+#include "Profiler.h"
+#include "StressTest.h"
+#include "Benchmark.h"
+#include "MemoryMonitor.h"
+#include "Scheduler.h"
 
-void setup() {
-  // Simple led Check to see if Teensy is responding
-  pinMode(LED_BUILTIN, OUTPUT);
-  digitalWrite(LED_BUILTIN, HIGH);  // Turn on LED for 200ms
-  delay(200);
-  digitalWrite(LED_BUILTIN, LOW);
-  
-  buttonManager.setup({Buttons::RECORD, Buttons::PLAY, Buttons::ENCODER_BUTTON_PIN});
-  Serial.begin(115200);
-  while (!Serial && millis() < 2000) delay(10);  // Teensy-safe wait
+// Runs before and between every scheduler slice
+static void serviceRealtime() {
+  // Play out ticks queued by the clock ISR
+  clockManager.processPendingTicks();
+  // Poll MIDI input
+  midiHandler.handleMidiInput();
+  clockManager.checkClockSource();
+}
 
-  // Initialize logger first with Serial.begin
-  logger.setup(LOG_DEBUG);  // Set to LOG_INFO for production
-  // Initialize looper and load last project and states
-  looper.setup();
-  //loadConfig();
+// Update looper state to set button logic, then the less time sensitive modules
+static bool runControls(uint32_t) {
+  looperState.update();
+  buttonManager.update();
+  looper.update();
+  return false;
+}
 
-  trackManager.setup();
+// Write pending state changes to SD in small time-budgeted slices
+static bool runStorage(uint32_t budgetMicros) {
+  StorageManager::update(budgetMicros);
+  return false;
+}
 
-  // // Log initial track states
-  for (uint8_t i = 0; i < trackManager.getTrackCount(); ++i) {
-    TrackState state = trackManager.getTrack(i).getState();
-    logger.debug("Track %d state: %s", i, trackManager.getTrack(i).getStateName(state));
-  }
+// One frame at a steady rate, drawn a few regions per slice
+static bool runDisplay(uint32_t budgetMicros) {
+  return !displayManager.updateSlice(budgetMicros);
+}
 
+// Merge surplus overdub layers into their tracks' events, one per slice
+static bool runLayerCompaction(uint32_t) {
+  return trackManager.compactLayers();
+}
 
-  for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
-    Track &track = trackManager.getTrack(t);
-    // ... after setState ...
-    Serial.print("Track "); Serial.print(t); Serial.print(" loaded state: ");
-    Serial.println(track.getStateName(track.getState()));
+// Build the next playback buffer of a track whose events changed, one per slice
+static bool runPlaybackPrepare(uint32_t) {
+  return trackManager.preparePlayback();
 }
 
-  // Initialize other components
+// Print queued log messages in a bounded slice
+static bool runLogDrain(uint32_t budgetMicros) {
+  logger.drain(budgetMicros);
+  return false;
+}
+
+// Requests over USB serial: task and memory reports, profiler and stress runs (when compiled in)
+static bool runSerialCommands(uint32_t) {
+  MemoryMonitor::sample();
+  scheduler.pollSerial();
+  MemoryMonitor::pollSerial();
+  PROFILE_POLL();
+  STRESS_POLL();
+  return false;
+}
+
+void setup() {
+  // Simple led Check to see if Teensy is responding; it stays lit until the saved state is restored
+  pinMode(LED_BUILTIN, OUTPUT);
+  digitalWrite(LED_BUILTIN, HIGH);
+
+  // Stage 1: clock and MIDI I/O, so thru and clock run within milliseconds of power-up
+  Serial.begin(115200);
+  while (!Serial && millis() < Config::BOOT_SERIAL_WAIT_MS) delay(10);  // Teensy-safe wait
+  logger.setup(LOG_DEBUG);  // Set to LOG_INFO for production
+  PROFILE_SETUP();
+#ifdef LOOPER_BENCH
+  // Benchmark firmware: the timing run replaces the looper (see Benchmark.h)
+  Benchmark::setup();
+  return;
+#endif
+  trackManager.setup();
   clockManager.setup();
   midiHandler.setup();
- 
+  outputScheduler.setup();
+  buttonManager.setup({Buttons::RECORD, Buttons::PLAY, Buttons::ENCODER_BUTTON_PIN});
+
+  // Stage 2: display (splash until the first frame)
   displayManager.setup();
-  Serial.println("Main: Dispaly Setup done");
+  Serial.println("Main: Display setup done");
+
+  // Stage 3: SD card; tracks are restored one by one from loop() via StorageManager::update()
   looper.setup();
 
-  
+  scheduler.setService(serviceRealtime);
+  scheduler.addTask("controls", runControls, TASK_PRIORITY_HIGH, Config::CONTROL_SLICE_BUDGET_US);
+  scheduler.addTask("playback", runPlaybackPrepare, TASK_PRIORITY_HIGH, Config::CONTROL_SLICE_BUDGET_US);
+  scheduler.addTask("display", runDisplay, TASK_PRIORITY_NORMAL, Config::DISPLAY_SLICE_BUDGET_US,
+                    LCD::DISPLAY_UPDATE_INTERVAL);
+  scheduler.addTask("storage", runStorage, TASK_PRIORITY_NORMAL, Config::STORAGE_SLICE_BUDGET_US);
+  scheduler.addTask("layers", runLayerCompaction, TASK_PRIORITY_LOW, Config::CONTROL_SLICE_BUDGET_US,
+                    Config::LAYER_FLATTEN_INTERVAL_MS);
+  scheduler.addTask("log", runLogDrain, TASK_PRIORITY_LOW, Config::LOG_DRAIN_BUDGET_US);
+  scheduler.addTask("serial", runSerialCommands, TASK_PRIORITY_LOW, Config::CONTROL_SLICE_BUDGET_US);
 }
 
 void loop() {
-  //Serial.println("Main: Loop");
-  uint32_t now = millis();
-  // Poll MIDI input
-  midiHandler.handleMidiInput();
-
-  // Update looper state to set button logic
-  looperState.update();
-
-  // Update less time sensitive modules
-  buttonManager.update();
-  looper.update();
-
-  
-  // Only update display if enough time has passed (steady-rate)
-  if (now - lastDisplayUpdate >= LCD::DISPLAY_UPDATE_INTERVAL) {
-    lastDisplayUpdate = now;
-    displayManager.update();
-  }
+#ifdef LOOPER_BENCH
+  Benchmark::pollSerial();
+  return;
+#endif
+  // Every task gets one slice per pass; ticks and MIDI input are serviced between slices
+  scheduler.runPass();
 }
-
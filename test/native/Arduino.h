@@ -0,0 +1,179 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host stand-in for the Teensy Arduino core, just enough for the looper sources to build on
+// [env:native]. Timing is the host's steady clock; serial output goes to stdout and MIDI output
+// is discarded. Definitions live in native_shims.cpp.
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cstdarg>
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+typedef uint8_t byte;
+
+#define LED_BUILTIN 13
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+
+#define DMAMEM
+#define EXTMEM
+#define FASTRUN
+#define FLASHMEM
+#define PROGMEM
+
+#define F_CPU 600000000
+#define F_CPU_ACTUAL 600000000
+
+// DWT cycle counter (Profiler.h); reads as 0 on the host
+extern volatile uint32_t native_dwt_cyccnt, native_demcr, native_dwt_ctrl;
+#define ARM_DWT_CYCCNT native_dwt_cyccnt
+#define ARM_DEMCR native_demcr
+#define ARM_DEMCR_TRCENA (1 << 24)
+#define ARM_DWT_CTRL native_dwt_ctrl
+#define ARM_DWT_CTRL_CYCCNTENA 1
+
+// PSRAM: reported as fitted so track arenas get the large EXTMEM budget
+extern uint8_t external_psram_size;
+void* extmem_malloc(size_t bytes);
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+void attachInterrupt(int irq, void (*isr)(), int mode);
+int digitalPinToInterrupt(int pin);
+void noInterrupts();
+void interrupts();
+void __disable_irq();
+void __enable_irq();
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+
+class Print {
+public:
+  size_t print(const char* s);
+  size_t print(char c);
+  size_t print(int v);
+  size_t print(unsigned int v);
+  size_t print(long v);
+  size_t print(unsigned long v);
+  size_t print(double v, int digits = 2);
+  size_t println();
+  size_t println(const char* s);
+  size_t println(int v);
+  size_t println(unsigned int v);
+  size_t println(long v);
+  size_t println(unsigned long v);
+  size_t println(double v, int digits = 2);
+  int printf(const char* format, ...);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t* data, size_t len);
+  int availableForWrite();
+};
+
+class usb_serial_class : public Print {
+public:
+  void begin(long baud);
+  operator bool();
+  int available();
+  int read();
+  int peek();
+  void flush();
+};
+extern usb_serial_class Serial;
+
+class HardwareSerial : public Print {
+public:
+  void begin(long baud);
+  int available();
+  int read();
+  int peek();
+  void flush();
+  void addMemoryForRead(void* buffer, size_t size);
+  void addMemoryForWrite(void* buffer, size_t size);
+};
+extern HardwareSerial Serial1, Serial8;
+
+class usb_midi_class {
+public:
+  enum MidiType {
+    InvalidType = 0x00, NoteOff = 0x80, NoteOn = 0x90, AfterTouchPoly = 0xA0, ControlChange = 0xB0,
+    ProgramChange = 0xC0, AfterTouchChannel = 0xD0, PitchBend = 0xE0, SystemExclusive = 0xF0,
+    TimeCodeQuarterFrame = 0xF1, SongPosition = 0xF2, SongSelect = 0xF3, TuneRequest = 0xF6,
+    Clock = 0xF8, Start = 0xFA, Continue = 0xFB, Stop = 0xFC, ActiveSensing = 0xFE, SystemReset = 0xFF
+  };
+  bool read(uint8_t channel = 0);
+  uint8_t getType();
+  uint8_t getChannel();
+  uint8_t getData1();
+  uint8_t getData2();
+  uint8_t getCable();
+  uint8_t* getSysExArray();
+  uint16_t getSysExArrayLength();
+  void sendNoteOn(uint8_t note, uint8_t velocity, uint8_t channel, uint8_t cable = 0);
+  void sendNoteOff(uint8_t note, uint8_t velocity, uint8_t channel, uint8_t cable = 0);
+  void sendControlChange(uint8_t control, uint8_t value, uint8_t channel, uint8_t cable = 0);
+  void sendProgramChange(uint8_t program, uint8_t channel, uint8_t cable = 0);
+  void sendPitchBend(int value, uint8_t channel, uint8_t cable = 0);
+  void sendAfterTouch(uint8_t pressure, uint8_t channel, uint8_t cable = 0);
+  void sendAfterTouchPoly(uint8_t note, uint8_t pressure, uint8_t channel, uint8_t cable = 0);
+  void sendPolyPressure(uint8_t note, uint8_t pressure, uint8_t channel, uint8_t cable = 0);
+  void sendSysEx(uint32_t length, const uint8_t* data, bool hasTerm = false, uint8_t cable = 0);
+  void sendRealTime(uint8_t type, uint8_t cable = 0);
+  void sendSongPosition(uint16_t beats, uint8_t cable = 0);
+  void sendSongSelect(uint8_t song, uint8_t cable = 0);
+  void send(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel, uint8_t cable = 0);
+  void send_now();
+};
+extern usb_midi_class usbMIDI;
+
+// MIDI output seen by the shims, for tests that check what was sent. Off by default so long
+// runs do not grow it.
+namespace NativeCapture {
+  struct UsbMessage { uint8_t type, data1, data2, channel, cable; };
+  struct UsbSysEx { const uint8_t* data; std::vector<uint8_t> bytes; bool hasTerm; uint8_t cable; };
+  extern bool enabled;
+  extern std::vector<UsbMessage> usb;     // usbMIDI.send(), sendRealTime() and sendSongPosition() calls
+  extern std::vector<UsbSysEx> usbSysEx;  // usbMIDI.sendSysEx() calls, with the caller's pointer
+  extern std::vector<uint8_t> serial8;    // Bytes written to Serial8
+  struct SdAccess { uint64_t offset; size_t bytes; };
+  extern std::vector<SdAccess> sdWrites;  // SD File::write() calls
+  extern std::vector<SdAccess> sdReads;   // SD File::read() calls
+  void clear();
+}
+
+// Input the shims' ports deliver, for tests that drive the MIDI input stage. Empty by default.
+namespace NativeInput {
+  struct UsbMessage { uint8_t type, channel, data1, data2; std::vector<uint8_t> sysex; };
+  extern std::deque<UsbMessage> usb;      // Read by usbMIDI.read()
+  extern std::deque<UsbMessage> host;     // Read by MIDIDevice::read() (USBHost_t36.h)
+  extern std::deque<uint8_t> serial8;     // Bytes Serial8.read() returns
+  void clear();
+
+  // A usbMIDI-style reader over one of the queues
+  struct UsbReader {
+    std::deque<UsbMessage>& queue;
+    UsbMessage current{};
+    bool read() {
+      if (queue.empty()) return false;
+      current = queue.front();
+      queue.pop_front();
+      return true;
+    }
+  };
+}
@@ -0,0 +1,6 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <SSD1322.h>
+extern const GFXfont Font5x7FixedMono;
@@ -0,0 +1,16 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host stand-in: timers never fire, so ticks only advance when a test calls into the sources
+#pragma once
+#include <cstdint>
+
+class IntervalTimer {
+public:
+  bool begin(void (*callback)(), float microseconds);
+  bool begin(void (*callback)(), uint32_t microseconds);
+  void update(float microseconds);
+  void update(uint32_t microseconds);
+  void end();
+  void priority(uint8_t level);
+};
@@ -0,0 +1,58 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host stand-in for the FortySevenEffects MIDI library: the interface reads nothing and sends
+// nowhere, so the looper sources build and run without a serial port.
+#pragma once
+#include <Arduino.h>
+
+namespace midi {
+
+enum MidiType : uint8_t {
+  InvalidType = 0x00, NoteOff = 0x80, NoteOn = 0x90, AfterTouchPoly = 0xA0, ControlChange = 0xB0,
+  ProgramChange = 0xC0, AfterTouchChannel = 0xD0, PitchBend = 0xE0, SystemExclusive = 0xF0,
+  TimeCodeQuarterFrame = 0xF1, SongPosition = 0xF2, SongSelect = 0xF3, Undefined_F4 = 0xF4,
+  Undefined_F5 = 0xF5, TuneRequest = 0xF6, SystemExclusiveEnd = 0xF7, Clock = 0xF8, Tick = 0xF9,
+  Start = 0xFA, Continue = 0xFB, Stop = 0xFC, Undefined_FD = 0xFD, ActiveSensing = 0xFE,
+  SystemReset = 0xFF
+};
+
+typedef uint8_t Channel;
+typedef uint8_t DataByte;
+
+struct DefaultSettings {
+  static const bool UseRunningStatus = false;
+  static const bool HandleNullVelocityNoteOnAsNoteOff = true;
+  static const bool Use1ByteParsing = true;
+  static const unsigned SysExMaxSize = 128;
+};
+
+template <class Transport, class Settings = DefaultSettings>
+class MidiInterface {
+public:
+  explicit MidiInterface(Transport&) {}
+  void begin(Channel = 1) {}
+  bool read() { return false; }
+  MidiType getType() const { return InvalidType; }
+  Channel getChannel() const { return 0; }
+  DataByte getData1() const { return 0; }
+  DataByte getData2() const { return 0; }
+  const byte* getSysExArray() const { return nullptr; }
+  unsigned getSysExArrayLength() const { return 0; }
+  void sendNoteOn(DataByte, DataByte, Channel) {}
+  void sendNoteOff(DataByte, DataByte, Channel) {}
+  void sendControlChange(DataByte, DataByte, Channel) {}
+  void sendProgramChange(DataByte, Channel) {}
+  void sendPitchBend(int, Channel) {}
+  void sendAfterTouch(DataByte, Channel) {}
+  void sendAfterTouch(DataByte, DataByte, Channel) {}
+  void sendPolyPressure(DataByte, DataByte, Channel) {}
+  void sendSysEx(unsigned, const byte*, bool = false) {}
+  void sendRealTime(MidiType) {}
+  void sendSongPosition(unsigned) {}
+  void sendSongSelect(DataByte) {}
+  void send(MidiType, DataByte, DataByte, Channel) {}
+  void turnThruOff() {}
+};
+
+}  // namespace midi
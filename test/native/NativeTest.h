@@ -0,0 +1,27 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <iostream>
+
+// Pass/fail bookkeeping shared by the native tests: check() reports a failed condition, result()
+// prints the summary line when every check passed and gives main() its exit code
+namespace NativeTest {
+
+inline bool ok = true;
+
+inline void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << "\n";
+        ok = false;
+    }
+}
+
+inline int result(const char* summary) {
+    if (ok) std::cout << "✅ " << summary << std::endl;
+    return ok ? 0 : 1;
+}
+
+}  // namespace NativeTest
+
+using NativeTest::check;
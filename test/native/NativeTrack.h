@@ -0,0 +1,51 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "Arduino.h"
+#include "Track.h"
+
+// Track setup, playback and output counting shared by the native tests
+namespace NativeTrack {
+
+// Empty the track, whatever state it is in (clear() ignores an empty track)
+inline void reset(Track& track) {
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+}
+
+// A playing 768-tick loop of eight notes, one every 96 ticks, each held for 48 (pitches 60-67)
+inline void eightNotes(Track& track) {
+    reset(track);
+    track.setLoopLength(768);
+    for (uint8_t i = 0; i < 8; ++i) {
+        track.insertEvent(MidiEvent::NoteOn(i * 96, 1, 60 + i, 100));
+        track.insertEvent(MidiEvent::NoteOff(i * 96 + 48, 1, 60 + i));
+    }
+    track.forceSetState(TRACK_PLAYING);
+}
+
+// One playMidiEvents() call per tick in [from, to)
+inline void play(Track& track, uint32_t from, uint32_t to) {
+    for (uint32_t tick = from; tick < to; ++tick) track.playMidiEvents(tick, true);
+}
+
+// Captured USB messages of a type (and first data byte)
+inline size_t countUsb(uint8_t type) {
+    size_t n = 0;
+    for (const auto& m : NativeCapture::usb) n += m.type == type;
+    return n;
+}
+
+inline size_t countUsb(uint8_t type, uint8_t data1) {
+    size_t n = 0;
+    for (const auto& m : NativeCapture::usb) n += m.type == type && m.data1 == data1;
+    return n;
+}
+
+}  // namespace NativeTrack
+
+using NativeTrack::countUsb;
+using NativeTrack::play;
@@ -0,0 +1,44 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host stand-in for the Teensy SD library. Paths are resolved under a host directory: the
+// LOOPER_SD_ROOT environment variable, or the working directory when it is unset.
+#pragma once
+#include <Arduino.h>
+
+#define FILE_READ 0
+#define FILE_WRITE 1
+#define FILE_WRITE_BEGIN 2
+#define BUILTIN_SDCARD 254
+
+class File {
+public:
+  File() = default;
+  explicit File(FILE* handle) : handle(handle) {}
+  operator bool() const { return handle != nullptr; }
+  size_t write(const uint8_t* data, size_t len);
+  size_t write(uint8_t b);
+  int read(void* data, size_t len);
+  int read();
+  int available();
+  bool seek(uint64_t pos);
+  uint64_t position();
+  uint64_t size();
+  bool truncate(uint64_t size = 0);
+  void flush();
+  void close();
+
+private:
+  FILE* handle = nullptr;
+};
+
+class SDClass {
+public:
+  bool begin(uint8_t csPin);
+  File open(const char* path, uint8_t mode = FILE_READ);
+  bool exists(const char* path);
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  bool mkdir(const char* path);
+};
+extern SDClass SD;
@@ -0,0 +1,34 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host stand-in for the SSD1322 OLED driver: drawing calls are no-ops on a static frame buffer
+#pragma once
+#include <Arduino.h>
+
+struct GFXfont {};
+
+class SSD1322_GFX {
+public:
+  void set_buffer_size(uint16_t width, uint16_t height);
+  void select_font(const GFXfont* font);
+  void fill_buffer(uint8_t* frame, uint8_t color);
+  void draw_pixel(uint8_t* frame, int x, int y, uint8_t color);
+  void draw_hline(uint8_t* frame, int x, int y, int length, uint8_t color);
+  void draw_vline(uint8_t* frame, int x, int y, int length, uint8_t color);
+  void draw_rect(uint8_t* frame, int x0, int y0, int x1, int y1, uint8_t color);
+  void draw_rect_filled(uint8_t* frame, int x0, int y0, int x1, int y1, uint8_t color);
+  void draw_text(uint8_t* frame, const char* text, int x, int y, uint8_t color);
+};
+
+class SSD1322_API {
+public:
+  uint8_t* getFrameBuffer();
+  void display();
+};
+
+class SSD1322 {
+public:
+  void begin();
+  SSD1322_GFX gfx;
+  SSD1322_API api;
+};
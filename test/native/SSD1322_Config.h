@@ -0,0 +1,6 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+#pragma once
+#define DISPLAY_WIDTH 256
+#define DISPLAY_HEIGHT 64
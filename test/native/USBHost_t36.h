@@ -0,0 +1,34 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host stand-in for the Teensy USBHost_t36 library: a MIDI device whose input comes from
+// NativeInput::host and whose output is discarded.
+#pragma once
+#include <Arduino.h>
+
+class USBHost {
+public:
+  void begin() {}
+  void Task() {}
+};
+
+class USBHub {
+public:
+  explicit USBHub(USBHost&) {}
+};
+
+class MIDIDevice_BigBuffer {
+public:
+  explicit MIDIDevice_BigBuffer(USBHost&) {}
+  bool read(uint8_t channel = 0) { (void)channel; return input.read(); }
+  uint8_t getType() { return input.current.type; }
+  uint8_t getChannel() { return input.current.channel; }
+  uint8_t getData1() { return input.current.data1; }
+  uint8_t getData2() { return input.current.data2; }
+  uint8_t getCable() { return 0; }
+  uint8_t* getSysExArray() { return input.current.sysex.data(); }
+  uint16_t getSysExArrayLength() { return (uint16_t)input.current.sysex.size(); }
+
+private:
+  NativeInput::UsbReader input{NativeInput::host};
+};
@@ -0,0 +1,253 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Definitions behind the host shims in this directory, linked into every [env:native] build
+#include <Arduino.h>
+#include <IntervalTimer.h>
+#include <SD.h>
+#include <SSD1322.h>
+#include <Font5x7Fixed.h>
+#include <Font5x7FixedMono.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// --------------------
+// Core
+// --------------------
+volatile uint32_t native_dwt_cyccnt = 0, native_demcr = 0, native_dwt_ctrl = 0;
+uint8_t external_psram_size = 16;
+
+void* extmem_malloc(size_t bytes) { return malloc(bytes); }
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+uint32_t micros() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - bootTime).count();
+}
+uint32_t millis() { return micros() / 1000; }
+void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+
+void pinMode(int, int) {}
+void digitalWrite(int, int) {}
+int digitalRead(int) { return HIGH; }
+void attachInterrupt(int, void (*)(), int) {}
+int digitalPinToInterrupt(int pin) { return pin; }
+void noInterrupts() {}
+void interrupts() {}
+void __disable_irq() {}
+void __enable_irq() {}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// --------------------
+// Serial ports: USB serial prints to stdout, hardware serial output is discarded
+// --------------------
+static bool isStdout(const Print* p) { return p == &Serial; }
+
+size_t Print::write(const uint8_t* data, size_t len) {
+  if (NativeCapture::enabled && this == &Serial8) NativeCapture::serial8.insert(NativeCapture::serial8.end(), data, data + len);
+  return isStdout(this) ? fwrite(data, 1, len, stdout) : len;
+}
+size_t Print::write(uint8_t b) { return write(&b, 1); }
+size_t Print::print(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+size_t Print::print(char c) { return write((uint8_t)c); }
+size_t Print::print(int v) { return printf("%d", v); }
+size_t Print::print(unsigned int v) { return printf("%u", v); }
+size_t Print::print(long v) { return printf("%ld", v); }
+size_t Print::print(unsigned long v) { return printf("%lu", v); }
+size_t Print::print(double v, int digits) { return printf("%.*f", digits, v); }
+size_t Print::println() { return print("\n"); }
+size_t Print::println(const char* s) { return print(s) + println(); }
+size_t Print::println(int v) { return print(v) + println(); }
+size_t Print::println(unsigned int v) { return print(v) + println(); }
+size_t Print::println(long v) { return print(v) + println(); }
+size_t Print::println(unsigned long v) { return print(v) + println(); }
+size_t Print::println(double v, int digits) { return print(v, digits) + println(); }
+int Print::availableForWrite() { return 4096; }
+
+int Print::printf(const char* format, ...) {
+  char buffer[512];
+  va_list args;
+  va_start(args, format);
+  int len = vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  if (len < 0) return len;
+  return (int)write((const uint8_t*)buffer, std::min((size_t)len, sizeof(buffer) - 1));
+}
+
+usb_serial_class Serial;
+void usb_serial_class::begin(long) {}
+usb_serial_class::operator bool() { return true; }
+int usb_serial_class::available() { return 0; }
+int usb_serial_class::read() { return -1; }
+int usb_serial_class::peek() { return -1; }
+void usb_serial_class::flush() { fflush(stdout); }
+
+HardwareSerial Serial1, Serial8;
+void HardwareSerial::begin(long) {}
+int HardwareSerial::available() { return this == &Serial8 ? (int)NativeInput::serial8.size() : 0; }
+int HardwareSerial::read() {
+  if (this != &Serial8 || NativeInput::serial8.empty()) return -1;
+  uint8_t b = NativeInput::serial8.front();
+  NativeInput::serial8.pop_front();
+  return b;
+}
+int HardwareSerial::peek() { return this == &Serial8 && !NativeInput::serial8.empty() ? NativeInput::serial8.front() : -1; }
+void HardwareSerial::flush() {}
+void HardwareSerial::addMemoryForRead(void*, size_t) {}
+void HardwareSerial::addMemoryForWrite(void*, size_t) {}
+
+// --------------------
+// USB MIDI: input from NativeInput::usb, output captured when enabled
+// --------------------
+namespace NativeInput {
+  std::deque<UsbMessage> usb;
+  std::deque<UsbMessage> host;
+  std::deque<uint8_t> serial8;
+  void clear() { usb.clear(); host.clear(); serial8.clear(); }
+}
+static NativeInput::UsbReader usbInput{NativeInput::usb};
+
+usb_midi_class usbMIDI;
+bool usb_midi_class::read(uint8_t) { return usbInput.read(); }
+uint8_t usb_midi_class::getType() { return usbInput.current.type; }
+uint8_t usb_midi_class::getChannel() { return usbInput.current.channel; }
+uint8_t usb_midi_class::getData1() { return usbInput.current.data1; }
+uint8_t usb_midi_class::getData2() { return usbInput.current.data2; }
+uint8_t usb_midi_class::getCable() { return 0; }
+uint8_t* usb_midi_class::getSysExArray() { return usbInput.current.sysex.data(); }
+uint16_t usb_midi_class::getSysExArrayLength() { return (uint16_t)usbInput.current.sysex.size(); }
+void usb_midi_class::sendNoteOn(uint8_t, uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendNoteOff(uint8_t, uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendControlChange(uint8_t, uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendProgramChange(uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendPitchBend(int, uint8_t, uint8_t) {}
+void usb_midi_class::sendAfterTouch(uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendAfterTouchPoly(uint8_t, uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendPolyPressure(uint8_t, uint8_t, uint8_t, uint8_t) {}
+void usb_midi_class::sendSysEx(uint32_t length, const uint8_t* data, bool hasTerm, uint8_t cable) {
+  if (NativeCapture::enabled) NativeCapture::usbSysEx.push_back({data, std::vector<uint8_t>(data, data + length), hasTerm, cable});
+}
+void usb_midi_class::sendRealTime(uint8_t type, uint8_t cable) {
+  if (NativeCapture::enabled) NativeCapture::usb.push_back({type, 0, 0, 0, cable});
+}
+void usb_midi_class::sendSongPosition(uint16_t beats, uint8_t cable) {
+  if (NativeCapture::enabled) NativeCapture::usb.push_back({0xF2, (uint8_t)(beats & 0x7F), (uint8_t)(beats >> 7), 0, cable});
+}
+void usb_midi_class::sendSongSelect(uint8_t, uint8_t) {}
+void usb_midi_class::send(uint8_t type, uint8_t data1, uint8_t data2, uint8_t channel, uint8_t cable) {
+  if (NativeCapture::enabled) NativeCapture::usb.push_back({type, data1, data2, channel, cable});
+}
+
+namespace NativeCapture {
+  bool enabled = false;
+  std::vector<UsbMessage> usb;
+  std::vector<UsbSysEx> usbSysEx;
+  std::vector<uint8_t> serial8;
+  std::vector<SdAccess> sdWrites;
+  std::vector<SdAccess> sdReads;
+  void clear() { usb.clear(); usbSysEx.clear(); serial8.clear(); sdWrites.clear(); sdReads.clear(); }
+}
+void usb_midi_class::send_now() {}
+
+// --------------------
+// Timers and controls
+// --------------------
+bool IntervalTimer::begin(void (*)(), float) { return true; }
+bool IntervalTimer::begin(void (*)(), uint32_t) { return true; }
+void IntervalTimer::update(float) {}
+void IntervalTimer::update(uint32_t) {}
+void IntervalTimer::end() {}
+void IntervalTimer::priority(uint8_t) {}
+
+// --------------------
+// Display
+// --------------------
+const GFXfont Font5x7Fixed = {};
+const GFXfont Font5x7FixedMono = {};
+static uint8_t frameBuffer[256 * 64 / 2];
+
+void SSD1322_GFX::set_buffer_size(uint16_t, uint16_t) {}
+void SSD1322_GFX::select_font(const GFXfont*) {}
+void SSD1322_GFX::fill_buffer(uint8_t*, uint8_t) {}
+void SSD1322_GFX::draw_pixel(uint8_t*, int, int, uint8_t) {}
+void SSD1322_GFX::draw_hline(uint8_t*, int, int, int, uint8_t) {}
+void SSD1322_GFX::draw_vline(uint8_t*, int, int, int, uint8_t) {}
+void SSD1322_GFX::draw_rect(uint8_t*, int, int, int, int, uint8_t) {}
+void SSD1322_GFX::draw_rect_filled(uint8_t*, int, int, int, int, uint8_t) {}
+void SSD1322_GFX::draw_text(uint8_t*, const char*, int, int, uint8_t) {}
+uint8_t* SSD1322_API::getFrameBuffer() { return frameBuffer; }
+void SSD1322_API::display() {}
+void SSD1322::begin() {}
+
+// --------------------
+// SD card backed by a host directory
+// --------------------
+SDClass SD;
+
+static std::string hostPath(const char* path) {
+  const char* root = getenv("LOOPER_SD_ROOT");
+  return std::string(root ? root : ".") + path;
+}
+
+bool SDClass::begin(uint8_t) { return true; }
+
+File SDClass::open(const char* path, uint8_t mode) {
+  std::string p = hostPath(path);
+  if (mode == FILE_READ) return File(fopen(p.c_str(), "rb"));
+  // Read/write at the end (FILE_WRITE) or the start (FILE_WRITE_BEGIN), creating the file
+  FILE* f = fopen(p.c_str(), "r+b");
+  if (!f) f = fopen(p.c_str(), "w+b");
+  if (f && mode == FILE_WRITE) fseek(f, 0, SEEK_END);
+  return File(f);
+}
+
+bool SDClass::exists(const char* path) { return access(hostPath(path).c_str(), F_OK) == 0; }
+bool SDClass::remove(const char* path) { return ::remove(hostPath(path).c_str()) == 0; }
+bool SDClass::rename(const char* from, const char* to) {
+  return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
+bool SDClass::mkdir(const char*) { return true; }
+
+size_t File::write(const uint8_t* data, size_t len) {
+  if (!handle) return 0;
+  if (NativeCapture::enabled) NativeCapture::sdWrites.push_back({position(), len});
+  return fwrite(data, 1, len, handle);
+}
+size_t File::write(uint8_t b) { return write(&b, 1); }
+int File::read(void* data, size_t len) {
+  if (!handle) return -1;
+  if (NativeCapture::enabled) NativeCapture::sdReads.push_back({position(), len});
+  return (int)fread(data, 1, len, handle);
+}
+int File::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+int File::available() { return handle ? (int)(size() - position()) : 0; }
+bool File::seek(uint64_t pos) { return handle && fseek(handle, (long)pos, SEEK_SET) == 0; }
+uint64_t File::position() { return handle ? (uint64_t)ftell(handle) : 0; }
+uint64_t File::size() {
+  if (!handle) return 0;
+  long pos = ftell(handle);
+  fseek(handle, 0, SEEK_END);
+  long end = ftell(handle);
+  fseek(handle, pos, SEEK_SET);
+  return (uint64_t)end;
+}
+bool File::truncate(uint64_t size) {
+  if (!handle) return false;
+  fflush(handle);
+  return ftruncate(fileno(handle), (off_t)size) == 0;
+}
+void File::flush() { if (handle) fflush(handle); }
+void File::close() {
+  if (handle) fclose(handle);
+  handle = nullptr;
+}
@@ -0,0 +1,83 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Benchmark firmware run on the host: every case is timed and produces its expected result, the
+// same seed gives the same workload, and the tracks are left empty (pio test -e native).
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "Benchmark.h"
+#include "Globals.h"
+#include "LooperState.h"
+#include "StorageManager.h"
+#include "TrackManager.h"
+#include "NativeTest.h"
+
+static BenchConfig smallConfig() {
+    BenchConfig config;
+    config.tracks = 3;
+    config.eventsPerTrack = 200;
+    config.loopBars = 2;
+    config.undoLevels = 8;
+    config.playPasses = 1;
+    config.displayFrames = 3;
+    config.editTurns = 20;
+    config.storageRuns = 1;
+    return config;
+}
+
+static void testRun() {
+    BenchReport report = Benchmark::run(smallConfig());
+    Benchmark::print(report, Serial);
+
+    static const char* const names[] = {"record", "play_tick", "display_frame", "edit_move",
+                                        "undo_push", "undo", "save", "load"};
+    check(report.count == sizeof(names) / sizeof(names[0]), "every case reported");
+    for (uint8_t i = 0; i < report.count; ++i) {
+        const BenchCase& c = report.cases[i];
+        if (std::strcmp(c.name, names[i]) != 0 || c.samples == 0 || !c.ok) {
+            std::cerr << "FAIL: case " << c.name << " n=" << c.samples << " ok=" << c.ok << "\n";
+            NativeTest::ok = false;
+        }
+    }
+    check(report.passed(), "report passes");
+    check(report.cases[0].samples == 3 * 200 + 2 * Config::TICKS_PER_BAR / 4, "record times notes and CC sweep");
+    check(report.cases[1].samples == 2 * Config::TICKS_PER_BAR, "play times one loop pass per tick");
+    check(report.cases[5].samples == 8, "undo times each pushed level");
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        check(trackManager.getTrack(t).getMidiEventCount() == 0, "tracks left empty");
+    }
+
+    BenchReport again = Benchmark::run(smallConfig());
+    check(again.passed() && again.cases[0].samples == report.cases[0].samples, "run repeats");
+}
+
+static void testTrackLimit() {
+    BenchConfig config = smallConfig();
+    config.tracks = 255;
+    config.eventsPerTrack = 20;
+    BenchReport report = Benchmark::run(config);
+    check(report.config.tracks == Config::NUM_TRACKS, "track count capped");
+    check(report.passed(), "run on every track passes");
+}
+
+int main() {
+    char root[] = "/tmp/looper_bench_XXXXXX";
+    if (!mkdtemp(root)) {
+        std::fprintf(stderr, "FAIL: cannot create scratch directory\n");
+        return 1;
+    }
+    setenv("LOOPER_SD_ROOT", root, 1);
+    trackManager.setup();
+    StorageManager::loadState(looperState.getLooperState());
+
+    testRun();
+    testTrackLimit();
+
+    std::string cleanup = std::string("rm -rf ") + root;
+    std::system(cleanup.c_str());
+    return NativeTest::result("Benchmark firmware: all cases timed with expected results");
+}
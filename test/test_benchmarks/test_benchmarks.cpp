@@ -0,0 +1,168 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Host micro-benchmarks for the hot paths, linked against the real sources (pio test -e native).
+// Each case builds a synthetic dense loop of N events on track 0 and times one operation.
+// Results are printed as a table for tracking regressions; the run only fails if an operation
+// stops producing the expected result.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Globals.h"
+#include "Track.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NoteUtils.h"
+#include "StorageManager.h"
+#include "LooperState.h"
+#include "NativeTest.h"
+
+static const size_t EVENT_COUNTS[] = {1000, 5000, 20000, 50000};
+static const uint32_t LOOP_BARS = 8;
+static const uint32_t NOTE_LENGTH = Config::TICKS_PER_16TH_STEP / 2;
+
+// Time fn() over `reps` runs; returns the mean in microseconds
+static double timeMicros(int reps, const std::function<void()>& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < reps; ++i) fn();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / reps;
+}
+
+static void report(const char* name, size_t events, double micros) {
+    std::printf("%-28s %8zu %12.1f %10.1f\n", name, events, micros, micros * 1000.0 / events);
+}
+
+// NoteOn/NoteOff pairs spread evenly over the loop, pitches cycling so no two collide
+static std::vector<MidiEvent> makeDenseLoop(size_t eventCount, uint32_t loopLength) {
+    std::vector<MidiEvent> events;
+    size_t notes = eventCount / 2;
+    events.reserve(notes * 2);
+    for (size_t i = 0; i < notes; ++i) {
+        uint32_t tick = (uint32_t)((uint64_t)i * (loopLength - NOTE_LENGTH) / notes);
+        uint8_t pitch = 36 + (i % 60);
+        events.push_back(MidiEvent::NoteOn(tick, 1, pitch, 100));
+        events.push_back(MidiEvent::NoteOff(tick + NOTE_LENGTH, 1, pitch, 0));
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; });
+    return events;
+}
+
+static void resetTrack(Track& track) {
+    TrackUndo::clearHistory(track);
+    track.clear();
+}
+
+static void benchRecord(Track& track, const std::vector<MidiEvent>& input, uint32_t loopLength) {
+    double us = timeMicros(1, [&] {
+        track.setState(TRACK_ARMED);
+        track.startRecording(0);
+        for (const MidiEvent& e : input) {
+            track.recordMidiEvents((midi::MidiType)e.type, e.channel, e.data.noteData.note,
+                                   e.data.noteData.velocity, e.tick);
+        }
+        track.stopRecording(loopLength);
+    });
+    report("Track::recordMidiEvents", input.size(), us);
+    // A take larger than the track arena stops at "track full"; the rest runs on what was kept
+    if (track.isFull()) std::printf("  (track full after %zu events)\n", track.getMidiEventCount());
+    check(track.getMidiEventCount() == input.size() || track.isFull(), "recorded event count");
+}
+
+static void benchPlay(Track& track, uint32_t loopLength) {
+    double us = timeMicros(3, [&] {
+        for (uint32_t tick = 0; tick < loopLength; ++tick) track.playMidiEvents(tick, true);
+    });
+    report("Track::playMidiEvents/loop", track.getMidiEventCount(), us);
+}
+
+static void benchNotes(Track& track) {
+    const EventList& events = track.getMidiEvents();
+    std::vector<NoteUtils::DisplayNote> notes;
+    double us = timeMicros(5, [&] { notes = NoteUtils::reconstructNotes(events, track.getLoopLength()); });
+    report("NoteUtils::reconstructNotes", events.size(), us);
+    check(track.isFull() || notes.size() == events.size() / 2, "reconstructed note count");
+
+    NoteUtils::EventIndex index;
+    us = timeMicros(5, [&] { index = NoteUtils::buildEventIndex(events); });
+    report("NoteUtils::buildEventIndex", events.size(), us);
+    check(track.isFull() || index.first.size() == events.size() / 2, "indexed NoteOn count");
+}
+
+static void benchUndo(Track& track) {
+    size_t count = track.getMidiEventCount();
+    uint32_t kept = track.getContentHash();
+    uint32_t hash = 0;
+    double us = timeMicros(5, [&] { track.markEventsChanged(); hash = track.getContentHash(); });
+    report("Track::getContentHash (full pass)", count, us);
+    check(hash == kept, "content hash after a full pass");
+    us = timeMicros(5, [&] { hash = track.getContentHash(); });
+    report("Track::getContentHash (current)", count, us);
+    MidiEvent first = track.getMidiEvents()[0], moved = first;
+    moved.tick += 1;
+    EventEdit edit(track);
+    edit.replace(0, moved);
+    track.commitEdit(edit);
+    check(track.getContentHash() != kept, "content hash after an edit");
+    const auto& events = track.getMidiEvents();
+    size_t at = 0;
+    while (at < events.size() && memcmp(&events[at], &moved, sizeof(MidiEvent)) != 0) ++at;
+    edit.replace(at, first);
+    track.commitEdit(edit);
+    check(track.getContentHash() == kept, "content hash after reverting the edit");
+
+    us = timeMicros(5, [&] {
+        TrackUndo::pushUndoSnapshot(track);
+        track.insertEvent(MidiEvent::NoteOn(0, 2, 1, 1));
+        TrackUndo::undoOverdub(track);
+    });
+    report("TrackUndo push+undo", count, us);
+    check(track.getMidiEventCount() == count, "event count after undo");
+}
+
+static void benchStorage(size_t count) {
+    LooperState& state = looperState.getLooperState();
+    bool saved = false;
+    double us = timeMicros(1, [&] { saved = StorageManager::saveState(state); });
+    report("StorageManager::saveState", count, us);
+    check(saved, "saveState");
+
+    bool loaded = false;
+    us = timeMicros(1, [&] { loaded = StorageManager::loadState(state); });
+    report("StorageManager::loadState", count, us);
+    check(loaded, "loadState");
+}
+
+int main() {
+    // Keep the checkpoint and journal in a scratch directory
+    char sdRoot[] = "/tmp/looper_bench_XXXXXX";
+    if (!mkdtemp(sdRoot)) {
+        std::fprintf(stderr, "FAIL: cannot create scratch directory\n");
+        return 1;
+    }
+    setenv("LOOPER_SD_ROOT", sdRoot, 1);
+
+    Track& track = trackManager.getTrack(0);
+    const uint32_t loopLength = LOOP_BARS * Config::TICKS_PER_BAR;
+
+    std::printf("%-28s %8s %12s %10s\n", "benchmark", "events", "mean us", "ns/event");
+    for (size_t count : EVENT_COUNTS) {
+        std::vector<MidiEvent> input = makeDenseLoop(count, loopLength);
+        resetTrack(track);
+        benchRecord(track, input, loopLength);
+        benchPlay(track, loopLength);
+        benchNotes(track);
+        benchUndo(track);
+        benchStorage(track.getMidiEventCount());
+    }
+
+    std::string cleanup = std::string("rm -rf ") + sdRoot;
+    std::system(cleanup.c_str());
+    return NativeTest::ok ? 0 : 1;
+}
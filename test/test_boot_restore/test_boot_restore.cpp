@@ -0,0 +1,173 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Background boot restore: checkpoint and journal applied from StorageManager::update() match a
+// synchronous load, a track the user changes meanwhile keeps its content, and a corrupt
+// checkpoint falls back to loadState() (pio test -e native).
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <SD.h>
+#include "Globals.h"
+#include "LooperState.h"
+#include "StorageManager.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static std::string sdRoot;
+
+static std::vector<MidiEvent> copyOf(const EventList& events) {
+    return std::vector<MidiEvent>(events.begin(), events.end());
+}
+
+static bool sameEvents(const EventList& a, const std::vector<MidiEvent>& b) {
+    return a.size() == b.size() && (b.empty() || memcmp(a.data(), b.data(), b.size() * sizeof(MidiEvent)) == 0);
+}
+
+static void copyFile(const std::string& from, const std::string& to) {
+    std::string cmd = "cp " + sdRoot + from + " " + sdRoot + to;
+    check(std::system(cmd.c_str()) == 0, "copy file");
+}
+
+// Let update() write buffered journal records (they wait for a quiet period)
+static void flush() {
+    for (int i = 0; i < 2000 && StorageManager::isSavePending(); ++i) {
+        StorageManager::update();
+        delay(1);
+    }
+}
+
+static void runRestore() {
+    for (int i = 0; i < 100000 && StorageManager::isRestoring(); ++i) StorageManager::update();
+}
+
+struct Saved {
+    std::vector<MidiEvent> events0, events2;
+    size_t undo0 = 0;
+};
+
+// Track 1 with undo levels, track 3 with a journaled insert after the checkpoint
+static Saved makeSession() {
+    LooperState& state = looperState.getLooperState();
+    Track& t0 = trackManager.getTrack(0);
+    Track& t2 = trackManager.getTrack(2);
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) NativeTrack::reset(trackManager.getTrack(t));
+    for (uint32_t tick = 0; tick < 768; tick += 24) t0.insertEvent(MidiEvent::NoteOn(tick, 1, 60, 100));
+    t0.setLoopLength(768);
+    t0.forceSetState(TRACK_PLAYING);
+    TrackUndo::pushUndoSnapshot(t0);
+    t0.insertEvent(MidiEvent::NoteOn(12, 1, 64, 90));
+    TrackUndo::pushUndoSnapshot(t0);
+    t0.insertEvent(MidiEvent::NoteOn(36, 1, 67, 90));
+    for (uint32_t tick = 0; tick < 1536; tick += 96) t2.insertEvent(MidiEvent::NoteOn(tick, 3, 48, 80));
+    t2.setLoopLength(1536);
+    t2.forceSetState(TRACK_STOPPED);
+    check(StorageManager::saveState(state), "checkpoint written");
+    MidiEvent late = MidiEvent::NoteOn(500, 3, 50, 70);  // Journal only, as recorded
+    t2.insertEvent(late);
+    StorageManager::journalEventInserted(t2, late);
+    flush();
+
+    Saved saved;
+    saved.events0 = copyOf(t0.getMidiEvents());
+    saved.events2 = copyOf(t2.getMidiEvents());
+    saved.undo0 = TrackUndo::getUndoCount(t0);
+    copyFile("/midilooper.ckp", "/saved.ckp");
+    copyFile("/midilooper.jnl", "/saved.jnl");
+    return saved;
+}
+
+// Power-cycle: empty tracks, the saved files back on the card
+static void reboot() {
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) NativeTrack::reset(trackManager.getTrack(t));
+    copyFile("/saved.ckp", "/midilooper.ckp");
+    copyFile("/saved.jnl", "/midilooper.jnl");
+}
+
+static void testRestore() {
+    LooperState& state = looperState.getLooperState();
+    Saved saved = makeSession();
+    reboot();
+
+    check(StorageManager::beginRestore(state), "restore started");
+    check(StorageManager::isRestoring() && !StorageManager::isTrackRestored(0), "nothing applied before update()");
+    runRestore();
+    check(!StorageManager::isRestoring() && StorageManager::isTrackRestored(2), "restore completed");
+    Track& t0 = trackManager.getTrack(0);
+    Track& t2 = trackManager.getTrack(2);
+    check(sameEvents(t0.getMidiEvents(), saved.events0) && t0.getState() == TRACK_PLAYING, "track 1 restored");
+    check(sameEvents(t2.getMidiEvents(), saved.events2) && t2.getLoopLength() == 1536, "journal replayed onto track 3");
+    check(TrackUndo::getUndoCount(t0) == saved.undo0, "undo levels paged");
+    TrackUndo::undoOverdub(t0);
+    check(t0.getMidiEventCount() == saved.events0.size() - 1, "undo after a background restore");
+}
+
+static void testUserChangeWins() {
+    LooperState& state = looperState.getLooperState();
+    Saved saved = makeSession();
+    reboot();
+
+    check(StorageManager::beginRestore(state), "restore started");
+    // Played into track 3 before its saved state arrived
+    Track& t2 = trackManager.getTrack(2);
+    t2.forceSetState(TRACK_PLAYING);
+    t2.setLoopLength(768);
+    MidiEvent take = MidiEvent::NoteOn(0, 3, 72, 100);
+    t2.insertEvent(take);
+    StorageManager::journalEventInserted(t2, take);
+    runRestore();
+    check(t2.getMidiEventCount() == 1, "user's take kept over the saved track");
+    check(sameEvents(trackManager.getTrack(0).getMidiEvents(), saved.events0), "other tracks restored");
+
+    // The restore ends in a new checkpoint holding the user's take
+    check(StorageManager::isSavePending(), "fresh checkpoint pending");
+    flush();
+    check(StorageManager::loadState(state), "reload");
+    check(t2.getMidiEventCount() == 1, "user's take persisted");
+}
+
+static void testCorruptFallsBack() {
+    LooperState& state = looperState.getLooperState();
+    makeSession();
+    reboot();
+    // Flip a byte near the end of the checkpoint (after track 1's records)
+    std::string path = sdRoot + "/midilooper.ckp";
+    FILE* f = fopen(path.c_str(), "r+b");
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, size - 40, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, size - 40, SEEK_SET);
+    fputc(c ^ 0xFF, f);
+    fclose(f);
+
+    StorageManager::beginRestore(state);
+    runRestore();
+    check(!StorageManager::isRestoring(), "restore ended");
+    check(trackManager.getTrack(0).isEmpty(), "partly restored tracks reset by the fallback load");
+}
+
+int main() {
+    char root[] = "/tmp/looper_boot_XXXXXX";
+    if (!mkdtemp(root)) {
+        std::fprintf(stderr, "FAIL: cannot create scratch directory\n");
+        return 1;
+    }
+    sdRoot = root;
+    setenv("LOOPER_SD_ROOT", root, 1);
+    LooperState& state = looperState.getLooperState();
+    StorageManager::loadState(state);  // Fresh card: starts checkpoint and journal
+
+    testRestore();
+    testUserChangeWins();
+    testCorruptFallsBack();
+
+    std::string cleanup = "rm -rf " + sdRoot;
+    std::system(cleanup.c_str());
+    return NativeTest::result("Boot restore: incremental load matches, user changes win, corrupt file falls back");
+}
@@ -0,0 +1,125 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Interrupt-captured buttons and encoder: edges are debounced on their capture stamps, and taps,
+// double taps and long presses are classified from those stamps however late update() runs
+// (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "ButtonManager.h"
+#include "EditManager.h"
+#include "TrackManager.h"
+#include "NativeTest.h"
+
+static constexpr uint32_t MS = 1000;
+static uint32_t t0 = 0;   // Past the boot window
+
+// A press and release with contact bounce on both edges
+static void bouncyTap(uint8_t button, uint32_t at, uint32_t lengthMs) {
+    buttonManager.captureButton(button, true, at);
+    buttonManager.captureButton(button, false, at + 300);
+    buttonManager.captureButton(button, true, at + 900);
+    uint32_t release = at + lengthMs * MS;
+    buttonManager.captureButton(button, false, release);
+    buttonManager.captureButton(button, true, release + 400);
+    buttonManager.captureButton(button, false, release + 1500);
+}
+
+static void testTapsFromStamps() {
+    uint8_t start = trackManager.getSelectedTrackIndex();
+    uint8_t count = trackManager.getTrackCount();
+
+    // One bouncing tap: a single short press once the double-tap window has passed
+    bouncyTap(BUTTON_B, t0, 80);
+    buttonManager.update(t0 + 200 * MS);
+    check(trackManager.getSelectedTrackIndex() == start, "short press waits for the double-tap window");
+    buttonManager.update(t0 + 500 * MS);
+    check(trackManager.getSelectedTrackIndex() == (start + 1) % count, "bouncing tap is one short press");
+    check(!buttonManager.isPressed(BUTTON_B), "released after the bounce");
+
+    // Two taps 150 ms apart, seen only after a 1 s stall: a double press, no track switch
+    uint32_t t = t0 + 1000 * MS;
+    bouncyTap(BUTTON_B, t, 60);
+    bouncyTap(BUTTON_B, t + 150 * MS, 60);
+    buttonManager.update(t + 1150 * MS);
+    check(trackManager.getSelectedTrackIndex() == (start + 1) % count, "stalled double tap is a double press");
+
+    // Two taps 400 ms apart, seen in one late update: two short presses
+    t = t0 + 3000 * MS;
+    bouncyTap(BUTTON_B, t, 60);
+    bouncyTap(BUTTON_B, t + 400 * MS, 60);
+    buttonManager.update(t + 1000 * MS);
+    check(trackManager.getSelectedTrackIndex() == (start + 3) % count, "taps outside the window are two presses");
+}
+
+static void testLongPressAndSettle() {
+    Track& track = trackManager.getSelectedTrack();
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+    track.setLoopLength(768);
+    track.insertEvent(MidiEvent::NoteOn(0, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(48, 1, 60));
+    track.forceSetState(TRACK_PLAYING);
+
+    // Held 700 ms with updates in between: nothing until the release, then a long press
+    uint32_t t = t0 + 6000 * MS;
+    buttonManager.captureButton(BUTTON_A, true, t);
+    buttonManager.update(t + 300 * MS);
+    buttonManager.update(t + 650 * MS);
+    check(buttonManager.isPressed(BUTTON_A) && track.hasData(), "no action while held");
+    buttonManager.captureButton(BUTTON_A, false, t + 700 * MS);
+    buttonManager.update(t + 1500 * MS);
+    check(!track.hasData(), "long press clears the track");
+
+    // A release that bounces back and stays down inside the window is accepted when it ends
+    t = t0 + 8000 * MS;
+    buttonManager.captureButton(BUTTON_A, true, t);
+    buttonManager.captureButton(BUTTON_A, false, t + 2 * MS);
+    buttonManager.update(t + 5 * MS);
+    check(buttonManager.isPressed(BUTTON_A), "edge inside the debounce window ignored");
+    buttonManager.update(t + 12 * MS);
+    check(!buttonManager.isPressed(BUTTON_A), "level that stays is accepted at the window end");
+    buttonManager.update(t + 1000 * MS);  // Let the resulting tap expire
+}
+
+// One detent: the four quadrature states (A, B) from rest, in one direction or the other
+static void detent(uint32_t at, bool up) {
+    static const bool phase[4][2] = {{true, false}, {false, false}, {false, true}, {true, true}};
+    for (int i = 0; i < 4; ++i) {
+        int s = up ? i : (4 + 2 - i) % 4;
+        buttonManager.captureEncoder(phase[s][0], phase[s][1], at + i * 200);
+    }
+}
+
+static void testEncoder() {
+    Track& track = trackManager.getSelectedTrack();
+    track.forceSetState(TRACK_PLAYING);
+    track.setLoopLength(768);
+    editManager.enterEditMode(editManager.getNoteState(), 0);
+    uint32_t before = editManager.getBracketTick();
+    uint32_t t = t0 + 10000 * MS;
+    detent(t, true);
+    buttonManager.update(t + 10 * MS);
+    uint32_t after = editManager.getBracketTick();
+    check(after != before, "a detent moves the bracket");
+    detent(t + 200 * MS, false);
+    buttonManager.update(t + 210 * MS);
+    check(editManager.getBracketTick() == before, "the opposite detent moves it back");
+    editManager.exitEditMode(track);
+
+    // Acceleration from the time between detents, not between updates
+    check(ButtonManager::encoderAcceleration(10 * MS, true) == 24, "fast coarse turn");
+    check(ButtonManager::encoderAcceleration(60 * MS, false) == 3, "medium edit turn");
+    check(ButtonManager::encoderAcceleration(500 * MS, false) == 1, "slow turn");
+    check(buttonManager.getDroppedInputCount() == 0, "no edges dropped");
+}
+
+int main() {
+    buttonManager.setup({Buttons::RECORD, Buttons::PLAY, Buttons::ENCODER_BUTTON_PIN});
+    t0 = micros() + 2000 * MS;
+    testTapsFromStamps();
+    testLongPressAndSettle();
+    testEncoder();
+    return NativeTest::result("Button capture: stamped edges debounced, taps classified however late update() runs");
+}
@@ -0,0 +1,116 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Clock master: 24 PPQN clock sent from the tick timer ahead of the tick's notes, Start / Stop /
+// Song Position on transport changes, output jitter measured (pio test -e native).
+
+#include <iostream>
+#include <string>
+#include "Globals.h"
+#include "ClockManager.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+// Clock and transport as a string, e.g. "Stop Clock SPP3 Continue"; channel messages as "Note"
+static std::string sent() {
+    std::string s;
+    for (const auto& m : NativeCapture::usb) {
+        if (!s.empty()) s += ' ';
+        switch (m.type) {
+            case midi::Clock: s += "Clock"; break;
+            case midi::Start: s += "Start"; break;
+            case midi::Stop: s += "Stop"; break;
+            case midi::Continue: s += "Continue"; break;
+            case midi::SongPosition: s += "SPP" + std::to_string(m.data1 | (m.data2 << 7)); break;
+            case midi::NoteOn: s += "Note"; break;
+            default: s += "?"; break;
+        }
+    }
+    return s;
+}
+
+// The timer firing n times, loop() playing each tick
+static void runTicks(uint32_t n) {
+    for (uint32_t i = 0; i < n; ++i) {
+        clockManager.updateInternalClock();
+        clockManager.processPendingTicks();
+    }
+}
+
+static void testStartAndTimerClock() {
+    check(clockManager.isClockMaster() && clockManager.isSendingClock(), "master on the internal tempo by default");
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    track.setLoopLength(768);
+    track.insertEvent(MidiEvent::NoteOn(16, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(20, 1, 60));
+    track.forceSetState(TRACK_STOPPED);
+    track.startPlaying(0);
+
+    NativeCapture::clear();
+    clockManager.locate(0);
+    check(sent() == "Stop Start Clock", "locate to 0 sends Stop, Start and the first clock");
+
+    NativeCapture::clear();
+    runTicks(16);
+    check(sent() == "Clock Clock Note", "one clock per 8 ticks, before the tick's notes");
+    track.stopPlaying();
+}
+
+// Between 16ths the position waits for the next one; clock keeps running meanwhile
+static void testLocateBetweenSixteenths() {
+    NativeCapture::clear();
+    clockManager.locate(100);
+    check(sent() == "Stop", "only Stop at a tick between 16ths");
+    runTicks(44);
+    check(sent() == "Stop Clock Clock Clock Clock Clock SPP3 Continue Clock", "position and Continue on the next 16th");
+}
+
+static void testJitter() {
+    clockManager.resetClockJitter();
+    uint32_t clockMicros = 8 * 2604;  // 120 BPM
+    for (int c = 0; c < 5; ++c) {
+        runTicks(7);
+        delayMicroseconds(c == 4 ? clockMicros + 10000 : clockMicros);
+        runTicks(1);
+    }
+    check(clockManager.getClockOutputCount() == 5, "every clock counted");
+    uint32_t maxJitter = clockManager.getClockJitterMax();
+    check(maxJitter >= 10000 && maxJitter < 15000, "late clock measured");
+    check(clockManager.getClockJitterMean() < maxJitter, "mean below the worst interval");
+}
+
+// Following an external clock stops master output; losing it re-arms the position
+static void testHandover() {
+    clockManager.onMidiClockPulse(micros());
+    check(!clockManager.isSendingClock(), "external clock takes over");
+    NativeCapture::clear();
+    runTicks(16);
+    check(sent().find("Clock") == std::string::npos, "no clock sent while following");
+
+    delay(510);
+    clockManager.checkClockSource();
+    check(clockManager.isSendingClock(), "back to master when the external clock stops");
+    NativeCapture::clear();
+    uint32_t tick = clockManager.getCurrentTick();
+    runTicks(2 * Config::TICKS_PER_16TH_STEP - tick % Config::TICKS_PER_16TH_STEP);
+    check(sent().find("Continue") != std::string::npos, "position and Continue sent on the return");
+
+    NativeCapture::clear();
+    clockManager.setClockMaster(false);
+    runTicks(16);
+    check(sent() == "Stop", "switching master off sends Stop, then no clock");
+    clockManager.setClockMaster(true);
+}
+
+int main() {
+    clockManager.setup();
+    NativeCapture::enabled = true;
+    testStartAndTimerClock();
+    testLocateBetweenSixteenths();
+    testJitter();
+    testHandover();
+    return NativeTest::result("Clock master: timer clock ahead of notes, transport on locate, jitter measured");
+}
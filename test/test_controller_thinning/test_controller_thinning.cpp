@@ -0,0 +1,141 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Controller thinning: dense pitch bend / aftertouch / CC input is reduced before recording,
+// gesture end values and end points are kept, switch CCs pass untouched (pio test -e native).
+
+#include <iostream>
+#include <vector>
+#include "Globals.h"
+#include "ControllerThinner.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+struct Recorded {
+    midi::MidiType type;
+    uint8_t channel, data1, data2;
+    uint32_t tick;
+};
+static std::vector<Recorded> released;
+
+static void capture(midi::MidiType type, uint8_t channel, uint8_t data1, uint8_t data2, uint32_t tick) {
+    released.push_back({type, channel, data1, data2, tick});
+}
+
+// Feed one message; captures it when it passes (held values are captured by the thinner itself)
+static void feed(ControllerThinner& thinner, midi::MidiType type, uint8_t data1, uint8_t data2, uint32_t tick) {
+    if (thinner.accept(type, 1, data1, data2, tick, capture)) capture(type, 1, data1, data2, tick);
+}
+
+static void feedBend(ControllerThinner& thinner, uint16_t value, uint32_t tick) {
+    feed(thinner, midi::PitchBend, value & 0x7F, value >> 7, tick);
+}
+
+static uint16_t bendOf(const Recorded& r) { return (uint16_t)(r.data1 | (r.data2 << 7)); }
+
+static void testPitchBendSweep() {
+    ControllerThinner thinner;
+    released.clear();
+    // Wheel up from centre to the top over a beat, a message every tick, then back down
+    uint32_t tick = 0;
+    for (; tick <= 192; ++tick) feedBend(thinner, (uint16_t)(8192 + tick * 8191 / 192), tick);
+    for (uint32_t t = 0; t <= 96; ++t, ++tick) feedBend(thinner, (uint16_t)(16383 - t * 8191 / 96), tick);
+    size_t sent = 192 + 1 + 96 + 1;
+    check(released.size() < sent / 3, "sweep thinned to a fraction of the messages");
+    check(released.size() >= (192 + 96) / Config::CONTROLLER_MIN_INTERVAL_TICKS / 2, "sweep keeps its shape");
+    bool sawTop = false;
+    for (const auto& r : released) sawTop = sawTop || bendOf(r) == 16383;
+    check(sawTop, "top end point recorded");
+    check(!released.empty() && bendOf(released.back()) == 8192, "return to centre recorded exactly");
+    for (size_t i = 1; i < released.size(); ++i) {
+        uint32_t gap = released[i].tick - released[i - 1].tick;
+        bool endPoint = bendOf(released[i]) == 16383 || bendOf(released[i]) == 8192;
+        check(gap >= Config::CONTROLLER_MIN_INTERVAL_TICKS || endPoint, "rate limited per lane");
+    }
+}
+
+static void testGestureEnd() {
+    ControllerThinner thinner;
+    released.clear();
+    // Slow drift by one step per tick: only a few values pass, the resting value is released later
+    for (uint32_t t = 0; t <= 10; ++t) feed(thinner, midi::ControlChange, 1, (uint8_t)(40 + t), t);
+    size_t before = released.size();
+    thinner.flushIdle(11, capture);
+    check(released.size() == before, "not released before the lane went quiet");
+    thinner.flushIdle(10 + Config::CONTROLLER_MIN_INTERVAL_TICKS, capture);
+    check(!released.empty() && released.back().data2 == 50 && released.back().tick == 10,
+          "resting value released at its own tick");
+
+    // Repeats of the same value are dropped
+    released.clear();
+    for (uint32_t t = 100; t < 120; ++t) feed(thinner, midi::AfterTouchChannel, 64, 0, t);
+    check(released.size() == 1, "repeated pressure recorded once");
+
+    // Switch CCs are never thinned
+    released.clear();
+    for (uint32_t t = 200; t < 204; ++t) feed(thinner, midi::ControlChange, 64, (t & 1) ? 127 : 0, t);
+    feed(thinner, midi::ControlChange, 64, 0, 204);
+    check(released.size() == 5, "sustain pedal passes untouched");
+
+    // Poly aftertouch lanes are per note
+    released.clear();
+    feed(thinner, midi::AfterTouchPoly, 60, 30, 300);
+    feed(thinner, midi::AfterTouchPoly, 62, 30, 300);
+    check(released.size() == 2, "each note has its own lane");
+}
+
+static MidiInputStamp stampAt(uint32_t tick) { return MidiInputStamp{micros(), tick, 0}; }
+
+static void testRecording() {
+    Track& track = trackManager.getTrack(0);
+    trackManager.setSelectedTrack(0);
+    NativeTrack::reset(track);
+    track.setState(TRACK_ARMED);
+    track.startRecording(0);
+
+    size_t sent = 0;
+    for (uint32_t tick = 0; tick <= 384; ++tick, ++sent) {
+        uint16_t bend = (uint16_t)(tick <= 192 ? 8192 - tick * 8192 / 192 : (tick - 192) * 8192 / 192);
+        midiHandler.handleMidiMessage(midi::PitchBend, 2, bend & 0x7F, bend >> 7, stampAt(tick));
+    }
+    midiHandler.handleMidiMessage(midi::AfterTouchPoly, 2, 60, 90, stampAt(400));
+    midiHandler.handleMidiMessage(midi::AfterTouchChannel, 2, 70, 0, stampAt(400));
+
+    size_t bends = 0;
+    bool bottom = false, centre = false, poly = false, channelAt = false;
+    for (const auto& e : track.getMidiEvents()) {
+        if (e.type == midi::PitchBend) {
+            bends++;
+            bottom = bottom || e.data.pitchBend == -8192;
+            centre = centre || (e.data.pitchBend == 0 && e.tick == 384);
+        }
+        poly = poly || (e.type == midi::AfterTouchPoly && e.data.polyATData.note == 60 && e.data.polyATData.pressure == 90);
+        channelAt = channelAt || (e.type == midi::AfterTouchChannel && e.data.channelPressure == 70);
+    }
+    check(bends > 0 && bends < sent / 3, "recorded pitch bend thinned");
+    check(bottom && centre, "pitch bend stored signed, end points exact");
+    check(poly && channelAt, "poly and channel aftertouch recorded");
+
+    // Unthinned: every message reaches the track
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+    track.setState(TRACK_ARMED);
+    track.startRecording(0);
+    midiHandler.setControllerThinning(false);
+    for (uint32_t tick = 0; tick < 50; ++tick) {
+        midiHandler.handleMidiMessage(midi::ControlChange, 2, 1, (uint8_t)tick, stampAt(tick));
+    }
+    check(track.getMidiEventCount() == 50, "thinning can be switched off");
+    midiHandler.setControllerThinning(Config::CONTROLLER_THINNING);
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+}
+
+int main() {
+    testPitchBendSweep();
+    testGestureEnd();
+    testRecording();
+    return NativeTest::result("Controller thinning: sweeps reduced, end values kept, switches untouched");
+}
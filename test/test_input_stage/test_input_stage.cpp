@@ -0,0 +1,177 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// MIDI input stage: capture passes take a bounded share from USB device, DIN and USB host in
+// rotating order into one queue, a flooding source waits in its port instead of starving the
+// others, USB is only read while the pass holds the ports, the DIN parser handles running status,
+// real-time and SysEx, and DIN input is echoed on the DIN output (pio test -e native).
+
+#include <iostream>
+#include <vector>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "MidiParser.h"
+#include "NativeTest.h"
+
+static std::vector<InputMessage> drain() {
+    std::vector<InputMessage> out;
+    InputMessage msg;
+    while (midiHandler.takeInput(msg)) out.push_back(msg);
+    return out;
+}
+
+static size_t countFrom(const std::vector<InputMessage>& msgs, InputSource source) {
+    size_t n = 0;
+    for (const auto& m : msgs) n += m.source == source;
+    return n;
+}
+
+static void testFairPass() {
+    NativeInput::clear();
+    for (int i = 0; i < 1000; ++i) NativeInput::usb.push_back({midi::Clock, 0, 0, 0, {}});
+    for (uint8_t note = 60; note < 63; ++note) {
+        for (uint8_t b : {(uint8_t)0x91, note, (uint8_t)100}) NativeInput::serial8.push_back(b);
+    }
+    for (uint8_t cc = 0; cc < 5; ++cc) NativeInput::host.push_back({midi::ControlChange, 2, cc, 64, {}});
+
+    midiHandler.captureInput();
+    std::vector<InputMessage> pass = drain();
+    check(countFrom(pass, SOURCE_USB) == MidiConfig::INPUT_USB_BUDGET, "USB limited to its budget");
+    check(countFrom(pass, SOURCE_SERIAL) == 3, "DIN read during a USB flood");
+    check(countFrom(pass, SOURCE_USB_HOST) == 5, "USB host read");
+    bool dinNotes = true;
+    uint8_t expected = 60;
+    for (const auto& m : pass) {
+        if (m.source != SOURCE_SERIAL) continue;
+        dinNotes = dinNotes && m.type == midi::NoteOn && m.channel == 2 && m.data1 == expected++ && m.data2 == 100;
+    }
+    check(dinNotes, "DIN notes parsed with running status");
+
+    for (uint8_t b : {(uint8_t)0x91, (uint8_t)70, (uint8_t)100}) NativeInput::serial8.push_back(b);
+    NativeInput::host.push_back({midi::ControlChange, 2, 9, 64, {}});
+    midiHandler.captureInput();
+    std::vector<InputMessage> next = drain();
+    check(!pass.empty() && !next.empty() && pass.front().source != next.front().source, "first source rotates");
+    NativeInput::clear();
+    drain();
+}
+
+static void testFloodWaitsInPort() {
+    NativeInput::clear();
+    const uint32_t flood = 1000;
+    for (uint32_t i = 0; i < flood; ++i) NativeInput::usb.push_back({midi::ControlChange, 1, 1, (uint8_t)(i & 0x7F), {}});
+    InputSourceStats before = midiHandler.getInputStats(SOURCE_USB);
+    uint32_t overflowsBefore = midiHandler.getInputOverflowCount();
+
+    // loop() stalled: the USB share fills, then USB waits in the driver
+    for (int pass = 0; pass < 20; ++pass) midiHandler.captureInput();
+    InputSourceStats usb = midiHandler.getInputStats(SOURCE_USB);
+    check(usb.depth == MidiConfig::INPUT_SOURCE_SHARE, "USB holds at most its share");
+    check(usb.stalls > before.stalls, "USB stalls counted");
+    check(usb.highWater == MidiConfig::INPUT_SOURCE_SHARE, "high water per source");
+
+    // DIN still gets in while USB is over its share
+    for (uint8_t b : {(uint8_t)0x90, (uint8_t)64, (uint8_t)90}) NativeInput::serial8.push_back(b);
+    midiHandler.captureInput();
+    check(midiHandler.getInputStats(SOURCE_SERIAL).depth == 1, "DIN queued during the flood");
+
+    // Nothing lost once loop() drains again
+    uint32_t usbTaken = 0;
+    size_t dinTaken = 0;
+    for (int pass = 0; pass < 200 && (usbTaken < flood || !NativeInput::usb.empty()); ++pass) {
+        std::vector<InputMessage> msgs = drain();
+        usbTaken += countFrom(msgs, SOURCE_USB);
+        dinTaken += countFrom(msgs, SOURCE_SERIAL);
+        midiHandler.captureInput();
+    }
+    usbTaken += countFrom(drain(), SOURCE_USB);
+    check(usbTaken == flood && dinTaken == 1, "every message delivered");
+    check(midiHandler.getInputOverflowCount() == overflowsBefore, "no overflow");
+    check(midiHandler.getInputStats(SOURCE_USB).depth == 0, "queue drained");
+}
+
+// USB is read only while the capture pass holds the ports; DIN does not wait for them
+static void testUsbWaitsForPorts() {
+    NativeInput::clear();
+    NativeInput::usb.push_back({midi::NoteOn, 1, 60, 100, {}});
+    NativeInput::host.push_back({midi::NoteOn, 1, 61, 100, {}});
+    for (uint8_t b : {(uint8_t)0x90, (uint8_t)62, (uint8_t)100}) NativeInput::serial8.push_back(b);
+    check(midiHandler.claimPort(), "another writer holds the ports");
+    midiHandler.captureInput();
+    std::vector<InputMessage> held = drain();
+    check(held.size() == 1 && held[0].source == SOURCE_SERIAL, "only DIN read while the ports are held");
+    midiHandler.releasePort();
+    midiHandler.captureInput();
+    std::vector<InputMessage> next = drain();
+    check(countFrom(next, SOURCE_USB) == 1 && countFrom(next, SOURCE_USB_HOST) == 1, "USB read on the next pass");
+    NativeInput::clear();
+}
+
+static void testParser() {
+    MidiParser parser;
+    MidiParser::Message m;
+    std::vector<MidiParser::Message> out;
+    auto feed = [&](std::initializer_list<uint8_t> bytes) {
+        for (uint8_t b : bytes) {
+            if (parser.feed(b, m)) out.push_back(m);
+        }
+    };
+
+    feed({0x45, 0x90, 0x3C, 0xF8, 0x64, 0x3E, 0x00});  // Stray data, clock inside a note, running status
+    check(out.size() == 3, "stray data ignored, three messages");
+    check(out.size() == 3 && out[0].type == midi::Clock, "real-time between data bytes");
+    check(out.size() == 3 && out[1].type == midi::NoteOn && out[1].data1 == 0x3C && out[1].data2 == 0x64,
+          "note around the clock");
+    check(out.size() == 3 && out[2].type == midi::NoteOn && out[2].data1 == 0x3E && out[2].data2 == 0, "running status");
+
+    out.clear();
+    feed({0xC3, 0x05, 0x06, 0xF2, 0x10, 0x02, 0x11});  // Program change with running status, song position
+    check(out.size() == 3 && out[0].type == midi::ProgramChange && out[0].channel == 4 && out[1].data1 == 6,
+          "one-byte running status");
+    check(out.size() == 3 && out[2].type == midi::SongPosition && out[2].data1 == 0x10 && out[2].data2 == 0x02,
+          "song position");
+
+    out.clear();
+    feed({0x11, 0xF0, 0x7E, 0xF8, 0x01, 0xF7});  // System common ended running status; clock inside SysEx
+    check(out.size() == 2 && out[0].type == midi::Clock && out[1].type == midi::SystemExclusive, "SysEx reported");
+    check(parser.sysExLength() == 4 && parser.sysExData()[0] == 0xF0 && parser.sysExData()[2] == 0x01 &&
+          parser.sysExData()[3] == 0xF7, "SysEx bytes without the clock");
+
+    out.clear();
+    feed({0xF0, 0x01, 0x02, 0x90, 0x40, 0x40});  // Cut short by a status
+    check(out.size() == 1 && out[0].type == midi::NoteOn && parser.getDroppedSysEx() == 1, "cut SysEx dropped");
+    feed({0xF0});
+    for (uint32_t i = 0; i < Config::SYSEX_MAX_MESSAGE_BYTES; ++i) feed({0x01});
+    feed({0xF7});
+    check(out.size() == 1 && parser.getDroppedSysEx() == 2, "SysEx too long dropped");
+}
+
+static void testSysExAndThru() {
+    NativeInput::clear();
+    NativeCapture::clear();
+    NativeInput::usb.push_back({midi::SystemExclusive, 0, 0, 0, {0xF0, 0x7D, 0x01, 0xF7}});
+    for (uint8_t b : {(uint8_t)0x92, (uint8_t)48, (uint8_t)80, (uint8_t)49, (uint8_t)80, (uint8_t)0xF8})
+        NativeInput::serial8.push_back(b);
+    midiHandler.captureInput();
+    std::vector<InputMessage> msgs = drain();
+    bool sysex = false;
+    for (const auto& m : msgs) {
+        sysex = sysex || (m.source == SOURCE_USB && m.type == midi::SystemExclusive && m.sysexLength == 4 &&
+                          m.sysex[1] == 0x7D && m.sysex[3] == 0xF7);
+    }
+    check(sysex, "USB SysEx bytes queued with the message");
+    const std::vector<uint8_t> thru = {0x92, 48, 80, 49, 80};  // The clock goes out through the MIDI library (no-op shim)
+    check(NativeCapture::serial8 == thru, "DIN input echoed on DIN with running status");
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testFairPass();
+    testFloodWaitsInPort();
+    testUsbWaitsForPorts();
+    testParser();
+    testSysExAndThru();
+    NativeCapture::enabled = false;
+    NativeInput::clear();
+    return NativeTest::result("Input stage: fair capture passes, one arrival-ordered queue, DIN parsed and echoed");
+}
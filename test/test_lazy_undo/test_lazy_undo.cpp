@@ -0,0 +1,143 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Lazy undo at load: events are loaded, undo levels stay on the card until an undo pages them
+// in, survive a compaction, and a corrupt level drops only what depends on it (pio test -e native).
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <SD.h>
+#include "Globals.h"
+#include "LooperState.h"
+#include "StorageManager.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static std::vector<MidiEvent> copyOf(const EventList& events) {
+    return std::vector<MidiEvent>(events.begin(), events.end());
+}
+
+static bool sameEvents(const EventList& a, const std::vector<MidiEvent>& b) {
+    return a.size() == b.size() && (b.empty() || memcmp(a.data(), b.data(), b.size() * sizeof(MidiEvent)) == 0);
+}
+
+// Four states: `levels` holds the three undone to, oldest first
+static void build(Track& track, std::vector<std::vector<MidiEvent>>& levels) {
+    NativeTrack::reset(track);
+    for (uint32_t tick = 0; tick < 768; tick += 48) track.insertEvent(MidiEvent::NoteOn(tick, 1, 60, 100));
+    track.setLoopLength(768);
+    track.forceSetState(TRACK_PLAYING);
+    levels.clear();
+    for (uint8_t pass = 0; pass < 3; ++pass) {
+        levels.push_back(copyOf(track.getMidiEvents()));
+        TrackUndo::pushUndoSnapshot(track);
+        track.insertEvent(MidiEvent::NoteOn(24 + pass * 100, 1, 70 + pass, 90));
+    }
+}
+
+static void testPagedLoad() {
+    LooperState& state = looperState.getLooperState();
+    Track& track = trackManager.getTrack(0);
+    std::vector<std::vector<MidiEvent>> levels;
+    build(track, levels);
+    std::vector<MidiEvent> current = copyOf(track.getMidiEvents());
+    check(StorageManager::saveState(state), "save");
+
+    check(StorageManager::loadState(state), "load");
+    check(sameEvents(track.getMidiEvents(), current), "current events loaded");
+    check(TrackUndo::getUndoCount(track) == 3 && TrackUndo::canUndo(track), "undo levels counted");
+    check(StorageManager::pagedUndoLevels(track) == 3 && TrackUndo::getUndoBytes(track) == 0,
+          "undo levels left on the card");
+
+    // A compaction copies the paged records
+    check(StorageManager::saveState(state) && StorageManager::loadState(state), "save and load again");
+    check(StorageManager::pagedUndoLevels(track) == 3, "paged levels survive a compaction");
+
+    TrackUndo::undoOverdub(track);
+    check(sameEvents(track.getMidiEvents(), levels[2]), "first undo pages in the newest level");
+    check(TrackUndo::getUndoCount(track) == 2 && StorageManager::pagedUndoLevels(track) == 1,
+          "next level paged in as the new top");
+    TrackUndo::undoOverdub(track);
+    check(sameEvents(track.getMidiEvents(), levels[1]), "second undo");
+    TrackUndo::undoOverdub(track);
+    check(sameEvents(track.getMidiEvents(), levels[0]), "third undo reaches the oldest level");
+    check(!TrackUndo::canUndo(track), "history used up");
+}
+
+static void testPushOverPaged() {
+    LooperState& state = looperState.getLooperState();
+    Track& track = trackManager.getTrack(0);
+    std::vector<std::vector<MidiEvent>> levels;
+    build(track, levels);
+    levels.push_back(copyOf(track.getMidiEvents()));
+    check(StorageManager::saveState(state) && StorageManager::loadState(state), "save and load");
+
+    // A new level seals the paged-in top against the current events
+    TrackUndo::pushUndoSnapshot(track);
+    track.insertEvent(MidiEvent::NoteOn(600, 1, 80, 90));
+    check(TrackUndo::getUndoCount(track) == 4, "pushed on top of the paged levels");
+    check(StorageManager::saveState(state) && StorageManager::loadState(state), "save and load with mixed levels");
+    for (size_t i = levels.size(); i-- > 0;) {
+        TrackUndo::undoOverdub(track);
+        check(sameEvents(track.getMidiEvents(), levels[i]), "undo through resident and paged levels");
+    }
+    check(!TrackUndo::canUndo(track), "all levels undone");
+}
+
+static void testCorruptLevel(const char* sdRoot) {
+    LooperState& state = looperState.getLooperState();
+    Track& track = trackManager.getTrack(0);
+    std::vector<std::vector<MidiEvent>> levels;
+    build(track, levels);
+    check(StorageManager::saveState(state) && StorageManager::loadState(state), "save and load");
+    TrackUndo::undoOverdub(track);  // Pages in the newest two levels
+
+    // Flip the last byte of the event payload of the remaining level (just before the CRC)
+    std::string path = std::string(sdRoot) + "/midilooper.ckp";
+    FILE* f = fopen(path.c_str(), "r+b");
+    std::vector<uint8_t> bytes;
+    int c;
+    while ((c = fgetc(f)) != EOF) bytes.push_back((uint8_t)c);
+    // Records are header(type, track, reserved, length) + payload + CRC; find track 0's delta
+    size_t at = 0, deltaEnd = 0;
+    while (at + 8 <= bytes.size()) {
+        uint32_t length;
+        memcpy(&length, &bytes[at + 4], sizeof(length));
+        if (bytes[at] == 14 && bytes[at + 1] == 0 && !deltaEnd) deltaEnd = at + 8 + length;
+        at += 8 + length + 4;
+    }
+    check(deltaEnd > 0, "delta record found");
+    fseek(f, (long)deltaEnd - 1, SEEK_SET);
+    fputc(bytes[deltaEnd - 1] ^ 0xFF, f);
+    fclose(f);
+
+    TrackUndo::undoOverdub(track);
+    check(sameEvents(track.getMidiEvents(), levels[1]), "resident level still undoes");
+    check(!TrackUndo::canUndo(track) && StorageManager::pagedUndoLevels(track) == 0,
+          "corrupt level dropped instead of restored");
+    check(sameEvents(track.getMidiEvents(), levels[1]), "events untouched by the corrupt level");
+}
+
+int main() {
+    char sdRoot[] = "/tmp/looper_lazy_XXXXXX";
+    if (!mkdtemp(sdRoot)) {
+        std::fprintf(stderr, "FAIL: cannot create scratch directory\n");
+        return 1;
+    }
+    setenv("LOOPER_SD_ROOT", sdRoot, 1);
+    LooperState& state = looperState.getLooperState();
+    StorageManager::loadState(state);  // Fresh card: starts checkpoint and journal
+
+    testPagedLoad();
+    testPushOverPaged();
+    testCorruptLevel(sdRoot);
+
+    std::string cleanup = std::string("rm -rf ") + sdRoot;
+    std::system(cleanup.c_str());
+    return NativeTest::result("Lazy undo: levels paged in on undo, kept by compaction, corrupt level dropped");
+}
@@ -0,0 +1,126 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Locate and chase: a start mid-loop sounds the held notes and the last CC values, Song Position
+// Pointer moves the clock, and playback carries on from the new position (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "ClockManager.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static const NativeCapture::UsbMessage* findUsb(uint8_t type, uint8_t data1) {
+    for (const auto& m : NativeCapture::usb) {
+        if (m.type == type && m.data1 == data1) return &m;
+    }
+    return nullptr;
+}
+
+static MidiInputStamp stampAt(uint32_t tick) { return MidiInputStamp{micros(), tick, 0}; }
+
+// Two-bar loop: note 60 over [0, 384), note 64 over [672, 96) wrapping the loop end,
+// note 67 starting exactly at 480, and CC 7 stepping 10 -> 50 -> 90
+static Track& setupTrack() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    track.setLoopLength(Config::TICKS_PER_BAR * 2);
+    track.insertEvent(MidiEvent::ControlChange(0, 1, 7, 10));
+    track.insertEvent(MidiEvent::NoteOn(0, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(96, 1, 64));
+    track.insertEvent(MidiEvent::ControlChange(200, 1, 7, 50));
+    track.insertEvent(MidiEvent::NoteOff(384, 1, 60));
+    track.insertEvent(MidiEvent::NoteOn(480, 1, 67, 80));
+    track.insertEvent(MidiEvent::NoteOff(600, 1, 67));
+    track.insertEvent(MidiEvent::ControlChange(620, 1, 7, 90));
+    track.insertEvent(MidiEvent::NoteOn(672, 1, 64, 70));
+    track.forceSetState(TRACK_STOPPED);
+    return track;
+}
+
+// Start at tick 300: 60 is held, 64 ended at 96, CC 7 was last 50
+static void testChaseOnStart() {
+    Track& track = setupTrack();
+    NativeCapture::clear();
+    track.startPlaying(300);
+    check(countUsb(midi::NoteOn, 60) == 1, "held note 60 chased");
+    const auto* noteOn = findUsb(midi::NoteOn, 60);
+    check(noteOn && noteOn->data2 == 100, "chased with its recorded velocity");
+    check(countUsb(midi::NoteOn, 64) == 0, "ended note 64 not chased");
+    const auto* cc = findUsb(midi::ControlChange, 7);
+    check(cc && cc->data2 == 50, "CC 7 chased at its last value");
+
+    // The cursor picks up from the located tick without a jump
+    uint32_t jumps = track.getPlaybackJumpCount();
+    NativeCapture::clear();
+    for (uint32_t t = 300; t <= 384; ++t) track.playMidiEvents(t, true);
+    check(countUsb(midi::NoteOff, 60) == 1, "held note ends on schedule");
+    check(track.getPlaybackJumpCount() == jumps, "no jump counted after a locate");
+    track.stopPlaying();
+}
+
+// Start inside the wrapped note: it is carried over the loop end
+static void testChaseAcrossLoopEnd() {
+    Track& track = setupTrack();
+    NativeCapture::clear();
+    track.startPlaying(Config::TICKS_PER_BAR * 2 + 50);  // Tick 50 of the second pass
+    check(countUsb(midi::NoteOn, 64) == 1, "wrapped note chased at the loop start");
+    check(countUsb(midi::NoteOn, 60) == 1, "note 60 held at tick 50");
+    const auto* cc = findUsb(midi::ControlChange, 7);
+    check(cc && cc->data2 == 10, "CC value from before the position, not the loop end");
+    track.stopPlaying();
+}
+
+// A note starting exactly at the position is left to the cursor, not sent twice
+static void testNoteAtPosition() {
+    Track& track = setupTrack();
+    NativeCapture::clear();
+    track.startPlaying(480);
+    check(countUsb(midi::NoteOn, 67) == 0, "note at the position not chased");
+    track.playMidiEvents(480, true);
+    check(countUsb(midi::NoteOn, 67) == 1, "note at the position played once by the cursor");
+    track.stopPlaying();
+}
+
+// Stop, Song Position Pointer, Continue through the MIDI input path
+static void testSongPosition() {
+    Track& track = setupTrack();
+    track.startPlaying(0);
+    trackManager.updateAllTracks(0);
+    midiHandler.handleMidiMessage(midi::Stop, 0, 0, 0, stampAt(0));
+    check(track.getState() == TRACK_STOPPED, "Stop stops the track");
+
+    // 16th number 4 -> tick 192; 14-bit value split over two data bytes
+    uint16_t spp = 4;
+    midiHandler.handleMidiMessage(midi::SongPosition, 0, spp & 0x7F, spp >> 7, stampAt(0));
+    check(clockManager.getCurrentTick() == spp * Config::TICKS_PER_16TH_STEP, "SPP moves the clock");
+
+    NativeCapture::clear();
+    midiHandler.handleMidiMessage(midi::Continue, 0, 0, 0, stampAt(0));
+    check(track.getState() == TRACK_PLAYING, "Continue restarts the paused track");
+    check(countUsb(midi::NoteOn, 60) == 1, "Continue chases the held note");
+    const auto* cc = findUsb(midi::ControlChange, 7);
+    check(cc && cc->data2 == 10, "Continue chases CC 7 before tick 200");
+    check(clockManager.getCurrentTick() == 192, "Continue keeps the located tick");
+
+    NativeCapture::clear();
+    for (uint32_t t = 193; t <= 200; ++t) trackManager.updateAllTracks(t);
+    cc = findUsb(midi::ControlChange, 7);
+    check(cc && cc->data2 == 50, "playback continues from the located position");
+
+    midiHandler.handleMidiMessage(midi::Stop, 0, 0, 0, stampAt(0));
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testChaseOnStart();
+    testChaseAcrossLoopEnd();
+    testNoteAtPosition();
+    testSongPosition();
+    NativeCapture::enabled = false;
+    return NativeTest::result("Locate: chase on start, loop-end carry-over and Song Position Pointer");
+}
@@ -0,0 +1,121 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Memory telemetry and limits: per-track figures match what the track holds, growth evicts old
+// undo copies before the track goes full, a take is refused once nothing is left to evict, and a
+// full track keeps playing the copy it has (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "MemoryMonitor.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static void resetTrack(Track& track) {
+    NativeTrack::reset(track);
+    TrackUndo::clearHistory(track);
+}
+
+static void fill(Track& track, size_t count) {
+    for (size_t i = track.getMidiEventCount(); i < count; ++i) {
+        track.insertEvent(MidiEvent::NoteOn((uint32_t)i, 1, 60, 100));
+    }
+}
+
+static void testUsage() {
+    Track& track = trackManager.getTrack(1);
+    resetTrack(track);
+    fill(track, 1000);
+    track.setLoopLength(Config::TICKS_PER_BAR * 4);
+    TrackUndo::pushUndoSnapshot(track);
+    track.insertEvent(MidiEvent::NoteOn(5, 1, 64, 90));
+    TrackUndo::pushClearTrackSnapshot(track);
+
+    TrackMemoryUsage usage = MemoryMonitor::trackUsage(track);
+    check(usage.eventBytes == track.getMidiEvents().capacity() * sizeof(MidiEvent), "event bytes");
+    check(usage.undoBytes == TrackUndo::getUndoBytes(track) && usage.undoBytes >= 1000 * sizeof(MidiEvent),
+          "undo bytes");
+    check(usage.clearUndoBytes >= 1001 * sizeof(MidiEvent), "clear-undo bytes");
+    check(usage.undoLevels == 1 && usage.editBytes == 0, "levels and edit buffers");
+    check(usage.arenaUsed >= usage.eventBytes + usage.clearUndoBytes && usage.arenaUsed <= usage.arenaCapacity,
+          "arena fill covers the parts");
+    check(MemoryMonitor::arenaPercent(track) < Config::MEMORY_WARN_PERCENT && !MemoryMonitor::nearLimit(track),
+          "not near the limit");
+    size_t budget = TrackUndo::undoBudgetBytes(track);
+    check(budget > 0 && budget < usage.arenaCapacity - 3 * 1001 * sizeof(MidiEvent),
+          "undo budget leaves room for the events and both playback copies");
+    MemoryMonitor::dump(Serial);
+    resetTrack(track);
+}
+
+static void testGrowthEvictsUndo() {
+    Track& track = trackManager.getTrack(2);
+    resetTrack(track);
+    // An eighth of the arena in events, five clear copies and an undo copy of the same size
+    size_t eighth = track.getArena().capacity() / sizeof(MidiEvent) / 8;
+    fill(track, eighth);
+    track.setLoopLength(Config::TICKS_PER_BAR * 4);
+    for (int i = 0; i < 5; ++i) TrackUndo::pushClearTrackSnapshot(track);
+    TrackUndo::pushUndoSnapshot(track);
+    size_t clearBefore = TrackUndo::getClearUndoBytes(track);
+
+    // The take keeps growing: old clear copies go instead of the input
+    size_t target = eighth + 3 * Config::RECORD_RESERVE_EVENTS;
+    fill(track, target);
+    check(track.getMidiEventCount() == target && !track.isFull(), "growth fitted after eviction");
+    check(TrackUndo::getClearUndoBytes(track) < clearBefore, "oldest clear copies evicted");
+    check(TrackUndo::canUndoClearTrack(track) && TrackUndo::canUndo(track), "newest copies kept");
+    resetTrack(track);
+}
+
+static void testTakeRefused() {
+    Track& track = trackManager.getTrack(3);
+    resetTrack(track);
+    trackManager.setSelectedTrack(3);
+    track.setLoopLength(Config::TICKS_PER_BAR * 4);
+    size_t count = 0;
+    while (!track.isFull()) {
+        track.insertEvent(MidiEvent::NoteOn((uint32_t)count++, 1, 60, 100));
+    }
+    check(track.getMidiEventCount() > 0, "track filled");
+    check(TrackUndo::undoBudgetBytes(track) == 0, "no undo budget on a full track");
+    check(!MemoryMonitor::admitRecording(track, true), "overdub refused on a full track");
+    track.forceSetState(TRACK_PLAYING);
+    trackManager.startOverdubbingTrack(3);
+    check(track.getState() == TRACK_PLAYING, "track stays playing");
+    check(MemoryMonitor::admitRecording(track, false), "a new take reuses the event buffer");
+    resetTrack(track);
+    check(MemoryMonitor::admitRecording(track, true), "admitted again once cleared");
+    check(track.getArena().getOverflowCount() == 0, "nothing allocated past the arena");
+    trackManager.setSelectedTrack(0);
+}
+
+static void testFullKeepsPlayback() {
+    Track& track = trackManager.getTrack(4);
+    NativeTrack::eightNotes(track);
+    play(track, 0, 1);
+    uint32_t published = track.getPublishedGeneration();
+    // The events grow until the arena has no room for a playback copy of them
+    for (uint32_t i = 0; !track.isFull(); ++i) track.insertEvent(MidiEvent::NoteOn(i % 768, 2, 60, 100));
+    check(!track.preparePlayback() && track.isFull(), "a copy that does not fit is not built");
+    check(track.getPublishedGeneration() == published, "the published copy stays");
+    NativeCapture::enabled = true;
+    NativeCapture::clear();
+    play(track, 1, 768 + 1);
+    NativeCapture::enabled = false;
+    check(countUsb(midi::NoteOn) == 8, "playback carries on from the published copy");
+    check(track.getArena().getOverflowCount() == 0, "nothing allocated past the arena");
+    resetTrack(track);
+}
+
+int main() {
+    testUsage();
+    testGrowthEvictsUndo();
+    testTakeRefused();
+    testFullKeepsPlayback();
+    return NativeTest::result("Memory limits: figures per track, undo evicted before full, takes refused, "
+                              "playback kept when full");
+}
@@ -0,0 +1,121 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Standard MIDI File export/import: a two-track round trip, a hand-written type 0 file at
+// another resolution with running status, and a truncated file (pio test -e native).
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <SD.h>
+#include "Globals.h"
+#include "MidiFile.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static bool sameEvents(const EventList& a, const std::vector<MidiEvent>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (memcmp(&a[i], &b[i], sizeof(MidiEvent)) != 0) return false;
+    }
+    return true;
+}
+
+static void testRoundTrip() {
+    Track& t0 = trackManager.getTrack(0);
+    Track& t2 = trackManager.getTrack(2);
+    NativeTrack::reset(t0);
+    NativeTrack::reset(t2);
+    for (uint32_t tick = 0; tick < 3072; tick += 24) {
+        t0.insertEvent(MidiEvent::NoteOn(tick, 1, 36 + tick % 24, 100));
+        t0.insertEvent(MidiEvent::NoteOff(tick + 12, 1, 36 + tick % 24));
+    }
+    t0.insertEvent(MidiEvent::NoteOff(3100, 1, 40, 64));  // Past the loop end, with release velocity
+    t0.setLoopLength(3072);
+    t0.forceSetState(TRACK_STOPPED);
+    t2.insertEvent(MidiEvent::ProgramChange(0, 10, 5));
+    t2.insertEvent(MidiEvent::ControlChange(10, 10, 7, 99));
+    t2.insertEvent(MidiEvent::PitchBend(20, 10, -8192));
+    t2.insertEvent(MidiEvent::PitchBend(30, 10, 8191));
+    t2.insertEvent(MidiEvent::ChannelAftertouch(40, 10, 33));
+    t2.insertEvent(MidiEvent::PolyAftertouch(50, 10, 60, 44));
+    t2.setLoopLength(500);  // Not a whole bar: kept through the loop meta event
+    t2.forceSetState(TRACK_STOPPED);
+
+    std::vector<MidiEvent> want0(t0.getMidiEvents().begin(), t0.getMidiEvents().end());
+    std::vector<MidiEvent> want2(t2.getMidiEvents().begin(), t2.getMidiEvents().end());
+
+    SD.remove("/test_export.mid");
+    check(MidiFile::exportSession("/test_export.mid"), "export succeeds");
+    File f = SD.open("/test_export.mid", FILE_READ);
+    uint64_t size = f ? f.size() : 0;
+    char magic[4] = {};
+    if (f) f.read(magic, 4);
+    f.close();
+    check(memcmp(magic, "MThd", 4) == 0, "file starts with MThd");
+    size_t raw = (want0.size() + want2.size()) * sizeof(MidiEvent);
+    check(size > 0 && size < raw, "SMF smaller than the raw event layout");
+    check(!SD.exists("/test_export.mid.tmp"), "temporary file renamed away");
+
+    NativeTrack::reset(t0);
+    NativeTrack::reset(t2);
+    check(MidiFile::importSession("/test_export.mid"), "import succeeds");
+    check(sameEvents(t0.getMidiEvents(), want0), "track 1 events survive the round trip");
+    check(sameEvents(t2.getMidiEvents(), want2), "track 3 events survive the round trip");
+    check(t0.getLoopLength() == 3072 && t2.getLoopLength() == 500, "loop lengths kept");
+    check(t0.getState() == TRACK_STOPPED && trackManager.getTrack(1).isEmpty(), "states after import");
+
+    NativeTrack::reset(t0);
+    NativeTrack::reset(t2);
+    SD.remove("/test_export.mid");
+}
+
+static void writeFile(const char* path, const std::vector<uint8_t>& bytes) {
+    SD.remove(path);
+    File f = SD.open(path, FILE_WRITE);
+    f.write(bytes.data(), bytes.size());
+    f.close();
+}
+
+// Type 0, 96 PPQN, running status, tempo 100 BPM, no loop meta event
+static void testForeignFile() {
+    std::vector<uint8_t> smf = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96,
+        'M', 'T', 'r', 'k', 0, 0, 0, 25,
+        0x00, 0xFF, 0x51, 0x03, 0x09, 0x27, 0xC0,  // 600000 us per quarter
+        0x00, 0x92, 60, 100,                       // NoteOn ch 3
+        0x30, 64, 90,                              // Running status, 48 ticks later
+        0x30, 60, 0,                               // Velocity 0: NoteOff
+        0x81, 0x00, 64, 0,                         // Delta 128 as two varint bytes
+        0x00, 0xFF, 0x2F, 0x00,
+    };
+    writeFile("/test_foreign.mid", smf);
+    Track& t0 = trackManager.getTrack(0);
+    NativeTrack::reset(t0);
+    float savedBpm = bpm;
+    check(MidiFile::importSession("/test_foreign.mid"), "type 0 import succeeds");
+    const auto& events = t0.getMidiEvents();
+    check(events.size() == 4, "four events imported");
+    check(events.size() == 4 && events[1].tick == 96 && events[1].data.noteData.note == 64, "ticks rescaled to 192");
+    check(events.size() == 4 && events[2].type == midi::NoteOff && events[2].channel == 3, "velocity 0 read as NoteOff");
+    check(events.size() == 4 && events[3].tick == 192 + 256, "two-byte delta");
+    check(t0.getLoopLength() == Config::TICKS_PER_BAR, "loop rounded up to a bar");
+    check((int)bpm == 100, "tempo taken from the file");
+    clockManager.setBpm((uint16_t)savedBpm);
+    NativeTrack::reset(t0);
+
+    // Cut inside the track chunk
+    smf.resize(smf.size() - 8);
+    writeFile("/test_foreign.mid", smf);
+    check(!MidiFile::importSession("/test_foreign.mid"), "truncated file reported");
+    check(t0.getMidiEventCount() == 3 && t0.getState() == TRACK_STOPPED, "events before the cut kept");
+    NativeTrack::reset(t0);
+    SD.remove("/test_foreign.mid");
+}
+
+int main() {
+    testRoundTrip();
+    testForeignFile();
+    return NativeTest::result("MIDI file: round trip, type 0 with running status, truncated input");
+}
@@ -0,0 +1,155 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Soft thru: input is forwarded from the capture pass itself, without loop(), per source: DIN
+// echoed on DIN, the USB host port through the selected track's route, real-time only when asked,
+// SysEx never, held while another writer has the ports, and the output switches honored (pio test -e native).
+
+#include <iostream>
+#include <vector>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTest.h"
+
+static void drain() {
+    InputMessage msg;
+    while (midiHandler.takeInput(msg)) {}
+}
+
+static void testDinEchoedFromCapture() {
+    NativeInput::clear();
+    NativeCapture::clear();
+    uint32_t forwarded = midiHandler.getThruForwardedCount();
+    for (uint8_t b : {(uint8_t)0x93, (uint8_t)60, (uint8_t)100}) NativeInput::serial8.push_back(b);
+    midiHandler.captureInput();
+    const std::vector<uint8_t> note = {0x93, 60, 100};
+    check(NativeCapture::serial8 == note, "DIN note echoed by the capture pass");
+    check(NativeCapture::usb.empty(), "DIN thru stays on DIN");
+    check(midiHandler.getThruForwardedCount() == forwarded + 1 && midiHandler.getThruOverflowCount() == 0,
+          "forwarded counted");
+    InputMessage msg;
+    check(midiHandler.takeInput(msg) && msg.type == midi::NoteOn && msg.data1 == 60, "still queued for loop()");
+    drain();
+
+    // USB device input has no thru by default
+    NativeCapture::clear();
+    NativeInput::usb.push_back({midi::NoteOn, 1, 62, 90, {}});
+    midiHandler.captureInput();
+    check(NativeCapture::usb.empty() && NativeCapture::serial8.empty(), "USB device thru off by default");
+    drain();
+}
+
+// While another writer holds the ports the thru waits in its queue; only queued events are counted
+static void testHeldWhilePortClaimed() {
+    NativeInput::clear();
+    NativeCapture::clear();
+    uint32_t forwarded = midiHandler.getThruForwardedCount();
+    uint32_t overflows = midiHandler.getThruOverflowCount();
+    check(midiHandler.claimPort() && !midiHandler.claimPort(), "one writer holds the ports");
+    const uint16_t passes = MidiConfig::THRU_QUEUE_EVENTS / MidiConfig::INPUT_DIN_BUDGET + 1;
+    for (uint16_t p = 0; p < passes; ++p) {
+        for (uint8_t i = 0; i < MidiConfig::INPUT_DIN_BUDGET; ++i) {
+            for (uint8_t b : {(uint8_t)0x94, (uint8_t)(40 + i), (uint8_t)90}) NativeInput::serial8.push_back(b);
+        }
+        midiHandler.captureInput();
+        drain();
+    }
+    check(NativeCapture::serial8.empty(), "nothing written while held");
+    check(midiHandler.getThruForwardedCount() == forwarded + MidiConfig::THRU_QUEUE_EVENTS &&
+          midiHandler.getThruOverflowCount() == overflows + MidiConfig::INPUT_DIN_BUDGET,
+          "forwarded counts what was queued, the rest overflows");
+    midiHandler.releasePort();
+    check(NativeCapture::serial8.size() >= MidiConfig::THRU_QUEUE_EVENTS * 2u && NativeCapture::serial8[0] == 0x94,
+          "queue written before the port is let go");
+    check(midiHandler.claimPort(), "ports free again");
+    midiHandler.releasePort();
+}
+
+static void testHostFollowsSelectedTrack() {
+    NativeInput::clear();
+    TrackRoute route;
+    route.ports = ROUTE_USB;
+    route.usbCable = 3;
+    route.channel = 5;
+    route.filter = FILTER_CC;
+    midiHandler.setTrackRoute(2, route);
+    trackManager.setSelectedTrack(2);
+
+    NativeCapture::clear();
+    NativeInput::host.push_back({midi::NoteOn, 1, 64, 80, {}});
+    NativeInput::host.push_back({midi::ControlChange, 1, 7, 100, {}});
+    NativeInput::host.push_back({midi::Clock, 0, 0, 0, {}});
+    midiHandler.captureInput();
+    check(NativeCapture::usb.size() == 1, "CC filtered, clock not forwarded");
+    check(!NativeCapture::usb.empty() && NativeCapture::usb[0].type == midi::NoteOn &&
+          NativeCapture::usb[0].channel == 5 && NativeCapture::usb[0].cable == 3, "track's channel and cable");
+    check(NativeCapture::serial8.empty(), "track's ports");
+    drain();
+
+    // Another track selected: its route
+    trackManager.setSelectedTrack(0);
+    NativeCapture::clear();
+    NativeInput::host.push_back({midi::NoteOn, 1, 64, 80, {}});
+    midiHandler.captureInput();
+    check(NativeCapture::usb.size() == 1 && NativeCapture::usb[0].channel == 1 && NativeCapture::usb[0].cable == 0,
+          "follows the selection");
+    const std::vector<uint8_t> note = {0x90, 64, 80};
+    check(NativeCapture::serial8 == note, "default route goes to DIN too");
+    drain();
+    midiHandler.setTrackRoute(2, TrackRoute{});
+}
+
+static void testConfig() {
+    NativeInput::clear();
+    ThruConfig usb;
+    usb.enabled = true;
+    usb.ports = ROUTE_DIN;
+    midiHandler.setThru(SOURCE_USB, usb);
+
+    NativeCapture::clear();
+    NativeInput::usb.push_back({midi::Clock, 0, 0, 0, {}});
+    NativeInput::usb.push_back({midi::PitchBend, 2, 0x00, 0x50, {}});
+    NativeInput::usb.push_back({midi::SystemExclusive, 0, 0, 0, {0xF0, 0x7D, 0x01, 0xF7}});
+    midiHandler.captureInput();
+    const std::vector<uint8_t> bend = {0xE1, 0x00, 0x50};
+    check(NativeCapture::serial8 == bend, "pitch bend through, no clock without realTime, no SysEx");
+    drain();
+
+    usb.ports = ROUTE_USB;  // DIN real-time goes out through the MIDI library, a no-op in the shim
+    usb.realTime = true;
+    midiHandler.setThru(SOURCE_USB, usb);
+    NativeCapture::clear();
+    NativeInput::usb.push_back({midi::Clock, 0, 0, 0, {}});
+    midiHandler.captureInput();
+    check(NativeCapture::usb.size() == 1 && NativeCapture::usb[0].type == midi::Clock, "clock with realTime");
+    drain();
+
+    // Output switch: no USB thru while USB output is off
+    midiHandler.setOutputUSB(false);
+    NativeCapture::clear();
+    NativeInput::usb.push_back({midi::NoteOn, 1, 65, 70, {}});
+    midiHandler.captureInput();
+    check(NativeCapture::usb.empty(), "output switch honored");
+    midiHandler.setOutputUSB(true);
+    drain();
+
+    midiHandler.setThru(SOURCE_USB, ThruConfig{});
+    check(!midiHandler.getThru(SOURCE_USB).enabled, "thru off again");
+    NativeCapture::clear();
+    NativeInput::usb.push_back({midi::NoteOn, 1, 65, 70, {}});
+    midiHandler.captureInput();
+    check(NativeCapture::usb.empty() && NativeCapture::serial8.empty(), "nothing forwarded when off");
+    drain();
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testDinEchoedFromCapture();
+    testHeldWhilePortClaimed();
+    testHostFollowsSelectedTrack();
+    testConfig();
+    NativeCapture::enabled = false;
+    NativeInput::clear();
+    return NativeTest::result("MIDI thru: forwarded from the capture pass, per source, following the selected track");
+}
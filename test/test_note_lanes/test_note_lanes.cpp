@@ -0,0 +1,190 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// NoteLanes overlap queries against a brute-force scan, batched event edits (EventEdit), and
+// fast-spin moves through the real EditStartNoteState (pio test -e native).
+
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include "NoteLanes.h"
+#include "EditManager.h"
+#include "Track.h"
+#include "Globals.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+using DisplayNote = NoteUtils::DisplayNote;
+
+static bool sameSet(std::vector<DisplayNote> a, std::vector<DisplayNote> b) {
+    auto less = [](const DisplayNote& x, const DisplayNote& y) { return x.startTick < y.startTick; };
+    std::sort(a.begin(), a.end(), less);
+    std::sort(b.begin(), b.end(), less);
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].startTick != b[i].startTick || a[i].endTick != b[i].endTick) return false;
+    }
+    return true;
+}
+
+// Random lanes (ordered and overlapping), random edits, every query checked against overlaps()
+static void testQueries() {
+    const uint32_t loop = 3840;
+    std::mt19937 rng(7);
+    for (int round = 0; round < 200; ++round) {
+        bool disjoint = round % 2 == 0;
+        std::vector<DisplayNote> notes;
+        uint32_t t = rng() % 200;
+        while (t < loop) {
+            uint32_t len = 1 + rng() % 400;
+            notes.push_back(DisplayNote{60, 100, t, t + len});  // Last one may run past the loop end
+            t += disjoint ? len + rng() % 300 : 1 + rng() % 300;
+        }
+        NoteLanes lanes;
+        lanes.rebuild(notes, loop, 1);
+
+        for (int q = 0; q < 50; ++q) {
+            if (q % 10 == 9 && !notes.empty()) {
+                // Edit the lanes and the reference list alike
+                size_t i = rng() % notes.size();
+                if (rng() % 2) {
+                    lanes.remove(60, notes[i].startTick);
+                    notes.erase(notes.begin() + i);
+                } else {
+                    uint32_t end = notes[i].startTick + 1 + rng() % 200;
+                    lanes.setEnd(60, notes[i].startTick, end);
+                    notes[i].endTick = end;
+                }
+            }
+            uint32_t start = rng() % loop;
+            uint32_t end = start + 1 + rng() % 600;
+            std::vector<DisplayNote> got, want;
+            lanes.overlapping(60, start, end, got);
+            for (const auto& dn : notes) {
+                if (NoteLanes::overlaps(start, end, dn.startTick, dn.endTick, loop)) want.push_back(dn);
+            }
+            if (!sameSet(got, want)) {
+                std::cerr << "FAIL: query [" << start << ", " << end << ") round " << round << ": got "
+                          << got.size() << ", want " << want.size() << "\n";
+                NativeTest::ok = false;
+                return;
+            }
+        }
+    }
+}
+
+// Random batches of removes, moves and inserts: one commit keeps the list sorted with NoteOffs
+// ahead at their tick, and the incremental hash matches a full pass
+static void testEditBatch() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    std::mt19937 rng(11);
+    for (uint32_t t = 0; t < 3840; t += 48) {
+        track.insertEvent(MidiEvent::NoteOn(t, 1, 60 + rng() % 4, 100));
+        track.insertEvent(MidiEvent::NoteOff(t + 24 + rng() % 48, 1, 60 + rng() % 4));
+    }
+    for (int round = 0; round < 50; ++round) {
+        const auto& events = track.getMidiEvents();
+        size_t before = events.size();
+        EventEdit edit(track);
+        size_t removed = 0, added = 0;
+        for (int k = 0; k < 8; ++k) {
+            size_t i = rng() % events.size();
+            switch (rng() % 3) {
+                case 0: removed += edit.remove(i); break;
+                case 1: if (edit.move(i, rng() % 3840)) { ++removed; ++added; } break;
+                default: edit.insert(MidiEvent::NoteOff(rng() % 3840, 1, 62)); ++added; break;
+            }
+        }
+        removed += edit.remove(0);
+        check(!edit.move(0, 1), "an index stages once");
+        check(track.commitEdit(edit), "batch committed");
+        check(events.size() == before - removed + added, "event count after the batch");
+        check(std::is_sorted(events.begin(), events.end(),
+                             [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; }),
+              "batch keeps events sorted");
+        uint32_t hash = track.getContentHash();
+        track.markEventsChanged();
+        check(track.getContentHash() == hash, "batch hash matches a full pass");
+    }
+
+    // A NoteOff moved onto a NoteOn's tick goes ahead of it
+    NativeTrack::reset(track);
+    track.insertEvent(MidiEvent::NoteOn(0, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOn(96, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(120, 1, 60));
+    track.insertEvent(MidiEvent::NoteOff(192, 1, 60));
+    EventEdit edit(track);
+    edit.move(2, 96);
+    track.commitEdit(edit);
+    const auto& events = track.getMidiEvents();
+    check(events[1].tick == 96 && events[1].type == midi::NoteOff, "moved NoteOff ahead at its tick");
+    NativeTrack::reset(track);
+}
+
+// Index of the note starting at `start` on `pitch` in the track's display notes, or -1
+static int noteAt(const Track& track, uint8_t pitch, uint32_t start, uint32_t* end = nullptr) {
+    const auto& notes = track.getDisplayNotes();
+    for (size_t i = 0; i < notes.size(); ++i) {
+        if (notes[i].note == pitch && notes[i].startTick == start) {
+            if (end) *end = notes[i].endTick;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Moves of many detents at once, passing over and into another note of the same pitch
+static void testFastSpin() {
+    Track& track = trackManager.getTrack(0);
+    track.clear();
+    track.setLoopLength(Config::TICKS_PER_BAR * 2);
+    track.forceSetState(TRACK_PLAYING);
+    track.insertEvent(MidiEvent::NoteOn(0, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(96, 1, 60));
+    track.insertEvent(MidiEvent::NoteOn(384, 1, 60, 90));
+    track.insertEvent(MidiEvent::NoteOff(480, 1, 60));
+    uint32_t initialHash = track.getContentHash();
+
+    editManager.setSelectedNoteIdx(noteAt(track, 60, 0));
+    editManager.setState(editManager.getStartNoteState(), track, 0);
+
+    // Onto the second note moving right: it is deleted
+    editManager.onEncoderTurn(track, 320);
+    check(noteAt(track, 60, 320) >= 0, "moved note at 320");
+    check(noteAt(track, 60, 384) < 0, "overlapped note deleted");
+    check(track.getMidiEventCount() == 2, "two events after the delete");
+
+    // Past it in one spin: restored
+    editManager.onEncoderTurn(track, 400);
+    check(noteAt(track, 60, 720) >= 0, "moved note at 720");
+    check(noteAt(track, 60, 384) >= 0, "passed note restored");
+
+    // Back into it moving left: shortened to the new start
+    uint32_t end = 0;
+    editManager.onEncoderTurn(track, -250);
+    check(noteAt(track, 60, 470) >= 0, "moved note at 470");
+    check(noteAt(track, 60, 384, &end) >= 0 && end == 470, "overlapped note shortened");
+
+    // Back to the start: the shortened note gets its length back
+    editManager.onEncoderTurn(track, -470);
+    check(noteAt(track, 60, 0) >= 0, "moved note back at 0");
+    check(noteAt(track, 60, 384, &end) >= 0 && end == 480, "shortened note restored");
+    check(track.getContentHash() == initialHash, "events back to the original");
+
+    const auto& events = track.getMidiEvents();
+    check(std::is_sorted(events.begin(), events.end(),
+                         [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; }),
+          "events stay sorted");
+
+    editManager.exitEditMode(track);
+    track.clear();
+}
+
+int main() {
+    testQueries();
+    testEditBatch();
+    testFastSpin();
+    return NativeTest::result("Note lanes: queries, edit batches and fast-spin moves match");
+}
@@ -0,0 +1,69 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Per-track output routes: ports, USB cable, channel override and filters, checked on what the
+// USB and DIN shims receive (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "NativeTest.h"
+
+// One batch with a NoteOn, CC and pitch bend on channel 3 through the track's route
+static void sendBatch(uint8_t track) {
+    NativeCapture::clear();
+    midiHandler.beginOutputBatch();
+    midiHandler.sendTrackEvent(track, MidiEvent::NoteOn(0, 3, 60, 100));
+    midiHandler.sendTrackEvent(track, MidiEvent::ControlChange(0, 3, 7, 90));
+    midiHandler.sendTrackEvent(track, MidiEvent::PitchBend(0, 3, 0));
+    midiHandler.endOutputBatch();
+}
+
+int main() {
+    NativeCapture::enabled = true;
+
+    // Default route: both ports, recorded channel
+    sendBatch(0);
+    check(NativeCapture::usb.size() == 3, "default route: three USB messages");
+    check(!NativeCapture::usb.empty() && NativeCapture::usb[0].channel == 3 && NativeCapture::usb[0].cable == 0,
+          "default route keeps channel and cable 0");
+    check(!NativeCapture::serial8.empty() && NativeCapture::serial8[0] == 0x92, "default route on DIN, channel 3");
+
+    // USB only, cable 2, channel 10, CCs filtered
+    TrackRoute route;
+    route.ports = ROUTE_USB;
+    route.usbCable = 2;
+    route.channel = 10;
+    route.filter = FILTER_CC;
+    midiHandler.setTrackRoute(1, route);
+    sendBatch(1);
+    check(NativeCapture::serial8.empty(), "USB-only route writes nothing to DIN");
+    check(NativeCapture::usb.size() == 2, "CC filtered out");
+    bool remapped = true;
+    for (const auto& m : NativeCapture::usb) remapped &= m.channel == 10 && m.cable == 2 && m.type != midi::ControlChange;
+    check(remapped, "channel override and cable applied");
+
+    // DIN only, notes filtered: only the CC and the bend remain
+    route = TrackRoute();
+    route.ports = ROUTE_DIN;
+    route.filter = FILTER_NOTES;
+    midiHandler.setTrackRoute(2, route);
+    sendBatch(2);
+    check(NativeCapture::usb.empty(), "DIN-only route sends nothing on USB");
+    check(NativeCapture::serial8.size() == 6 && NativeCapture::serial8[0] == 0xB2 && NativeCapture::serial8[3] == 0xE2,
+          "DIN gets CC and pitch bend only");
+
+    // Global switch folds into the compiled routes
+    midiHandler.setOutputUSB(false);
+    sendBatch(0);
+    check(NativeCapture::usb.empty(), "USB disabled globally");
+    check(!NativeCapture::serial8.empty(), "DIN still enabled");
+    midiHandler.setOutputUSB(true);
+
+    // Other tracks are not affected by routes set on tracks 1 and 2
+    sendBatch(Config::NUM_TRACKS - 1);
+    check(NativeCapture::usb.size() == 3 && NativeCapture::usb[0].channel == 3, "untouched track keeps the default");
+
+    NativeCapture::enabled = false;
+    return NativeTest::result("Output routing: ports, cable, channel and filters applied");
+}
@@ -0,0 +1,168 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Layered overdubs: each take records into its own layer without republishing playback, the
+// k-way merge plays layers in the flattened order and without echoing the input, undo drops the
+// newest layer, surplus layers merge in the background as undo levels (pio test -e native).
+
+#include <iostream>
+#include <vector>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+// Position of the first NoteOn of `note` among the captured messages (SIZE_MAX if none)
+static size_t noteOnAt(uint8_t note) {
+    for (size_t i = 0; i < NativeCapture::usb.size(); ++i) {
+        if (NativeCapture::usb[i].type == midi::NoteOn && NativeCapture::usb[i].data1 == note) return i;
+    }
+    return SIZE_MAX;
+}
+
+// One overdub take: a note from `on` to `off` (absolute ticks), then back to playing
+static void take(Track& track, uint8_t note, uint32_t on, uint32_t off) {
+    track.setState(TRACK_OVERDUBBING);
+    track.noteOn(1, note, 100, on);
+    track.noteOff(1, note, 0, off);
+    track.setState(TRACK_PLAYING);
+}
+
+static uint32_t summaryNotes(const Track& track) {
+    const TrackSummary& summary = track.getSummary();
+    uint32_t n = 0;
+    for (uint16_t c = 0; c < TrackSummary::COLUMNS; ++c) n += summary.notes(c);
+    return n;
+}
+
+static bool sameNotes(const std::vector<NoteUtils::DisplayNote>& a, const std::vector<NoteUtils::DisplayNote>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].note != b[i].note || a[i].startTick != b[i].startTick || a[i].endTick != b[i].endTick) return false;
+    }
+    return true;
+}
+
+static void testRecordIntoLayer() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::eightNotes(track);
+    play(track, 0, 768);
+    uint32_t published = track.getPublishedGeneration();
+
+    // Recorded while playing: into a layer, the published buffer stays and the input is not echoed
+    track.setState(TRACK_OVERDUBBING);
+    NativeCapture::clear();
+    play(track, 768, 768 + 193);
+    track.noteOn(1, 90, 100, 768 + 192);  // Same tick as base note 62
+    play(track, 768 + 193, 768 + 250);
+    track.noteOff(1, 90, 0, 768 + 250);
+    play(track, 768 + 250, 768 * 2);
+    check(track.getLayerCount() == 1 && track.getMidiEventCount() == 18, "take recorded into one layer");
+    check(track.getPublishedGeneration() == published, "no republish while recording");
+    check(countUsb(midi::NoteOn, 90) == 0, "input not echoed in its own pass");
+
+    // Next pass: merged in, after the base event at the same tick
+    NativeCapture::clear();
+    play(track, 768 * 2, 768 * 3);
+    check(countUsb(midi::NoteOn, 90) == 1, "layer plays on the next pass");
+    check(noteOnAt(62) < noteOnAt(90) && noteOnAt(90) < noteOnAt(63), "base first at a shared tick");
+    check(track.getPlaybackJumpCount() == 0, "merging is not a jump");
+
+    // Locate into the layer's note: the chase sounds it
+    NativeCapture::clear();
+    track.locate(768 * 3 + 220, true);
+    check(countUsb(midi::NoteOn, 90) == 1, "chase sees layered notes");
+    track.setState(TRACK_PLAYING);
+}
+
+static void testViewsAndFlatten() {
+    Track& track = trackManager.getTrack(1);
+    NativeTrack::eightNotes(track);
+    take(track, 90, 100, 150);
+    take(track, 91, 700, 800);  // Held over the loop end
+    check(track.getLayerCount() == 2 && TrackUndo::getUndoCount(track) == 2, "a layer per take, each an undo level");
+    std::vector<NoteUtils::DisplayNote> layered = track.getDisplayNotes();
+    uint32_t hash = track.getContentHash();
+    uint32_t count = summaryNotes(track);
+    check(layered.size() == 10, "note view covers the layers");
+
+    // Reading merges without flattening; an edit flattens and keeps the content and the undo levels
+    check(track.getMidiEvents().size() == 20 && track.getLayerCount() == 2, "merged view leaves the layers");
+    check(TrackUndo::getUndoCount(track) == 2, "reading keeps the undo levels");
+    const EventList& events = track.editMidiEvents();
+    check(track.getLayerCount() == 0 && events.size() == 20, "flattened for an edit");
+    bool sorted = true;
+    for (size_t i = 1; i < events.size(); ++i) sorted = sorted && events[i - 1].tick <= events[i].tick;
+    check(sorted, "flattened list sorted");
+    check(sameNotes(layered, track.getDisplayNotes()), "same notes before and after flattening");
+    check(track.getContentHash() == hash && summaryNotes(track) == count, "hash and summary unchanged");
+    check(TrackUndo::getUndoCount(track) == 2, "merged layers kept as undo levels");
+    TrackUndo::undoOverdub(track);
+    TrackUndo::undoOverdub(track);
+    check(track.getMidiEventCount() == 16 && track.getDisplayNotes().size() == 8, "both takes undone");
+}
+
+static void testUndoDropsLayer() {
+    Track& track = trackManager.getTrack(2);
+    NativeTrack::eightNotes(track);
+    uint32_t baseHash = track.getContentHash();
+    take(track, 90, 100, 150);
+    uint32_t oneTakeHash = track.getContentHash();
+    take(track, 91, 300, 350);
+    uint32_t published = track.getPublishedGeneration();
+    TrackUndo::undoOverdub(track);
+    check(track.getLayerCount() == 1 && track.getMidiEventCount() == 18, "newest layer dropped");
+    check(track.getPublishedGeneration() == published, "undo without a republish");
+    check(track.getContentHash() == oneTakeHash, "hash follows the undo");
+    NativeCapture::clear();
+    play(track, 0, 768);
+    check(countUsb(midi::NoteOn, 90) == 1 && countUsb(midi::NoteOn, 91) == 0, "undone take silent");
+    TrackUndo::undoOverdub(track);
+    check(track.getLayerCount() == 0 && track.getContentHash() == baseHash && !TrackUndo::canUndo(track),
+          "back to the base take");
+
+    // Undo while the take is still recording drops it; the next input opens a new layer
+    track.setState(TRACK_OVERDUBBING);
+    track.noteOn(1, 92, 100, 400);
+    TrackUndo::undoOverdub(track);
+    track.noteOn(1, 93, 100, 500);
+    track.noteOff(1, 93, 0, 520);
+    track.setState(TRACK_PLAYING);
+    check(track.getLayerCount() == 1 && track.getMidiEventCount() == 18, "recording carries on in a new layer");
+}
+
+static void testCompaction() {
+    Track& track = trackManager.getTrack(3);
+    NativeTrack::eightNotes(track);
+    uint32_t baseHash = track.getContentHash();
+    const uint8_t takes = Config::OVERDUB_FLATTEN_LAYERS + 2;
+    for (uint8_t i = 0; i < takes; ++i) take(track, 90 + i, 10 + i * 100, 60 + i * 100);
+    check(track.getLayerCount() == takes, "sealed takes wait for the background merge");
+
+    while (trackManager.compactLayers()) {}
+    check(track.getLayerCount() == Config::OVERDUB_FLATTEN_LAYERS, "surplus layers merged");
+    check(TrackUndo::getUndoCount(track) == takes, "every take still undoable");
+    NativeCapture::clear();
+    play(track, 0, 768);
+    bool all = true;
+    for (uint8_t i = 0; i < takes; ++i) all = all && countUsb(midi::NoteOn, 90 + i) == 1;
+    check(all, "merged and layered takes play once each");
+    for (uint8_t i = 0; i < takes; ++i) TrackUndo::undoOverdub(track);
+    check(track.getContentHash() == baseHash && track.getMidiEventCount() == 16, "undone down to the base");
+
+    // More takes than layers are kept: the oldest merges in as the next one opens
+    for (uint8_t i = 0; i < Config::OVERDUB_MAX_LAYERS + 2; ++i) take(track, 90 + i, 10 + i * 60, 40 + i * 60);
+    check(track.getLayerCount() == Config::OVERDUB_MAX_LAYERS, "layer count bounded");
+    check(track.getMidiEventCount() == 16 + 2 * (Config::OVERDUB_MAX_LAYERS + 2), "no take lost");
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testRecordIntoLayer();
+    testViewsAndFlatten();
+    testUndoDropsLayer();
+    testCompaction();
+    NativeCapture::enabled = false;
+    return NativeTest::result("Overdub layers: lazy merge at playback, O(1) undo of a take, background flattening");
+}
@@ -0,0 +1,99 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Playback overruns: when ticks are stepped over, their events are sent late and in order, a
+// burst is capped, stale events are dropped and counted, and every NoteOff of a sounding note
+// still goes out (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static void setUp(Track& track) {
+    NativeTrack::eightNotes(track);
+    track.resetPlaybackStats();
+}
+
+static void testShortOverrunCatchesUp() {
+    Track& track = trackManager.getTrack(0);
+    setUp(track);
+    play(track, 0, 96);
+    NativeCapture::clear();
+    track.playMidiEvents(100, true);  // 96-99 stepped over
+    check(countUsb(midi::NoteOn, 61) == 1, "missed NoteOn sent late");
+    check(track.getOverrunCount() == 1 && track.getPlaybackJumpCount() == 0, "counted as an overrun");
+    check(track.getSkippedTickCount() == 4 && track.getDroppedEventCount() == 0, "skipped ticks, nothing dropped");
+    NativeCapture::clear();
+    play(track, 101, 768);
+    check(countUsb(midi::NoteOn, 61) == 0 && countUsb(midi::NoteOn, 67) == 1, "rest of the pass on time");
+
+    // Across the loop end: the loop start's events are caught up once
+    NativeCapture::clear();
+    track.playMidiEvents(770, true);
+    check(countUsb(midi::NoteOn, 60) == 1 && track.getOverrunCount() == 2, "overrun across the loop end");
+    NativeCapture::clear();
+    play(track, 771, 800);
+    check(countUsb(midi::NoteOn, 60) == 0, "not played again after the catch-up");
+}
+
+static void testStaleEventsDroppedNoteOffsKept() {
+    Track& track = trackManager.getTrack(1);
+    setUp(track);
+    play(track, 0, 101);  // 61 sounding until 144
+    NativeCapture::clear();
+    track.playMidiEvents(300, true);
+    check(countUsb(midi::NoteOff, 61) == 1, "NoteOff of the sounding note sent");
+    check(countUsb(midi::NoteOn, 62) == 0 && countUsb(midi::NoteOff, 62) == 0, "stale note dropped whole");
+    check(countUsb(midi::NoteOn, 63) == 1, "recent NoteOn still sent");
+    check(track.getDroppedEventCount() == 2, "dropped events counted");
+}
+
+static void testBurstCapped() {
+    Track& track = trackManager.getTrack(2);
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+    track.setLoopLength(768);
+    track.insertEvent(MidiEvent::NoteOn(5, 1, 70, 100));
+    for (uint8_t cc = 0; cc < 100; ++cc) track.insertEvent(MidiEvent::ControlChange(10, 1, cc, 64));
+    track.insertEvent(MidiEvent::NoteOff(15, 1, 70));
+    track.forceSetState(TRACK_PLAYING);
+    track.resetPlaybackStats();
+    play(track, 0, 7);
+    NativeCapture::clear();
+    track.playMidiEvents(16, true);
+    check(countUsb(midi::ControlChange) == Config::PLAYBACK_CATCHUP_BURST, "burst capped");
+    check(countUsb(midi::NoteOff, 70) == 1, "NoteOff past the cap");
+    check(track.getDroppedEventCount() == 100 - Config::PLAYBACK_CATCHUP_BURST, "rest of the burst dropped");
+}
+
+static void testSilentTicksNotCaughtUp() {
+    Track& track = trackManager.getTrack(3);
+    setUp(track);
+    play(track, 0, 90);
+    track.toggleMuteTrack();
+    play(track, 90, 120);
+    track.toggleMuteTrack();
+    NativeCapture::clear();
+    play(track, 120, 190);
+    check(countUsb(midi::NoteOn, 61) == 0, "muted ticks not caught up on unmute");
+    check(track.getOverrunCount() == 0, "unmute is not an overrun");
+
+    // A whole loop or more behind is a jump
+    NativeCapture::clear();
+    track.playMidiEvents(190 + 768, true);
+    check(track.getPlaybackJumpCount() == 1 && track.getOverrunCount() == 0, "loop-long skip is a jump");
+    check(countUsb(midi::NoteOn) == 0, "jump sends nothing missed");
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testShortOverrunCatchesUp();
+    testStaleEventsDroppedNoteOffsKept();
+    testBurstCapped();
+    testSilentTicksNotCaughtUp();
+    NativeCapture::enabled = false;
+    return NativeTest::result("Playback overruns: late ticks catch up in order, bursts capped, no hanging notes");
+}
@@ -0,0 +1,78 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Double-buffered playback: playback reads the published buffer only, an edit is prepared from
+// loop() and published between ticks, and changes to the working list that are not finished yet
+// (or reallocate it) are never heard (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static void testPublishBetweenTicks() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::eightNotes(track);
+    play(track, 0, 768);
+    check(track.getPublishedGeneration() == track.getEventsGeneration(), "published on the first tick");
+
+    // Mid-pass edit: nothing is published until the next tick
+    play(track, 768, 768 + 300);
+    EventEdit edit(track);
+    edit.insert(MidiEvent::NoteOn(400, 1, 80, 90));
+    edit.insert(MidiEvent::NoteOff(420, 1, 80));
+    edit.remove(track.getMidiEventCount() - 2);  // 67 on at 672
+    check(track.commitEdit(edit), "edit committed");
+    check(track.getPublishedGeneration() != track.getEventsGeneration(), "working list ahead of playback");
+    NativeCapture::clear();
+    play(track, 768 + 300, 768 * 2);
+    check(track.getPublishedGeneration() == track.getEventsGeneration(), "edit published at the next tick");
+    check(countUsb(midi::NoteOn, 80) == 1 && countUsb(midi::NoteOn, 67) == 0, "rest of the pass plays the edit");
+    check(track.getPlaybackJumpCount() == 0, "publishing is not a jump");
+}
+
+static void testUnfinishedEditNotHeard() {
+    Track& track = trackManager.getTrack(1);
+    NativeTrack::eightNotes(track);
+    play(track, 0, 10);
+
+    // An editor working directly on the list: half of it gone and the storage reallocated, not
+    // yet marked changed. The published copy keeps playing.
+    EventList& events = track.editMidiEvents();
+    events.erase(events.begin() + 4, events.end());
+    events.shrink_to_fit();
+    events.reserve(4096);
+    NativeCapture::clear();
+    play(track, 10, 768 + 10);
+    check(countUsb(midi::NoteOn, 67) == 1 && countUsb(midi::NoteOn, 63) == 1, "published events still play");
+
+    // Marked changed, but not built yet: the tick never builds, playback keeps its copy
+    track.markEventsChanged();
+    NativeCapture::clear();
+    play(track, 768 + 10, 768 + 20);
+    check(track.getPublishedGeneration() != track.getEventsGeneration(), "not built on the tick path");
+
+    // The loop()'s "playback" task prepares it; the next tick publishes
+    check(trackManager.preparePlayback(), "stale buffer prepared from loop()");
+    check(!trackManager.preparePlayback(), "nothing else to prepare");
+    NativeCapture::clear();
+    play(track, 768 + 20, 768 * 2 + 20);
+    check(countUsb(midi::NoteOn, 67) == 0 && countUsb(midi::NoteOn, 61) == 1, "finished edit heard from then on");
+
+    events.clear();
+    track.markEventsChanged();
+    track.preparePlayback();
+    NativeCapture::clear();
+    play(track, 768 * 2 + 20, 768 * 3 + 20);
+    check(NativeCapture::usb.empty(), "emptied list plays nothing");
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testPublishBetweenTicks();
+    testUnfinishedEditNotHeard();
+    NativeCapture::enabled = false;
+    return NativeTest::result("Playback buffers: edits published between ticks, unfinished edits never heard");
+}
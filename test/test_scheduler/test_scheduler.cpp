@@ -0,0 +1,82 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Main-loop scheduler: tasks run in priority order within their budgets, resumable tasks continue
+// on the next pass, interval tasks wait, and the service runs between every slice; the display
+// frame is drawn in resumable steps (pio test -e native).
+
+#include <iostream>
+#include <string>
+#include "Globals.h"
+#include "Scheduler.h"
+#include "DisplayManager.h"
+#include "NativeTest.h"
+
+static std::string trace;
+static int serviceCalls = 0;
+
+static void busy(uint32_t us) {
+    uint32_t start = micros();
+    while (micros() - start < us) {}
+}
+
+static void service() {
+    serviceCalls++;
+    trace += '|';
+}
+
+static bool low(uint32_t) { trace += 'L'; return false; }
+static bool high(uint32_t) { trace += 'H'; return false; }
+
+// Three slices of 300 us, each within its budget
+static int sliceWork = 0;
+static bool sliced(uint32_t budget) {
+    trace += 'S';
+    busy(budget / 2);
+    return ++sliceWork % 3 != 0;
+}
+
+static int intervalRuns = 0;
+static bool every50ms(uint32_t) { intervalRuns++; return false; }
+
+static void testPassOrder() {
+    Scheduler s;
+    s.setService(service);
+    s.addTask("low", low, TASK_PRIORITY_LOW, 100);
+    s.addTask("sliced", sliced, TASK_PRIORITY_NORMAL, 600);
+    s.addTask("high", high, TASK_PRIORITY_HIGH, 100);
+    s.addTask("interval", every50ms, TASK_PRIORITY_NORMAL, 100, 50);
+    trace.clear();
+    s.runPass();
+    check(trace == "|H|S||L|", "priority order, service between every slice");
+    check(intervalRuns == 1, "interval task runs on the first pass");
+
+    trace.clear();
+    s.runPass();
+    s.runPass();
+    check(trace == "|H|S|L||H|S|L|", "resumed slices continue each pass");
+    check(intervalRuns == 1, "interval task waits");
+    check(s.getMaxServiceGapMicros() < 600 + 2000, "service gap bounded by the longest slice");
+    delay(60);
+    s.runPass();
+    check(intervalRuns == 2, "interval task due again");
+
+    for (uint8_t i = 0; i < s.getTaskCount(); ++i) {
+        check(s.getTaskStats(i).overruns == 0, "slices within budget");
+    }
+    s.dump(Serial);
+}
+
+static void testDisplaySlices() {
+    // Zero budget: one step per call, the frame completes after the transfer step
+    int calls = 1;
+    while (!displayManager.updateSlice(0) && calls < 100) calls++;
+    check(calls == 5, "status, piano roll, info, note, transfer");
+    check(displayManager.updateSlice(UINT32_MAX), "whole frame in one slice");
+}
+
+int main() {
+    testPassOrder();
+    testDisplaySlices();
+    return NativeTest::result("Scheduler: priority order, budgeted resumable slices, service between slices");
+}
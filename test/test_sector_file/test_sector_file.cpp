@@ -0,0 +1,175 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Sector-aligned SD I/O: the block writer and reader round-trip any mix of sizes, checkpoints go
+// to the card in whole aligned blocks and load with bulk reads, and journal appends never
+// straddle a sector (pio test -e native).
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <SD.h>
+#include "Globals.h"
+#include "LooperState.h"
+#include "SectorFile.h"
+#include "StorageManager.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static constexpr uint32_t SECTOR = Config::SD_SECTOR_BYTES;
+static constexpr uint32_t BLOCK = Config::STORAGE_BLOCK_BYTES;
+
+static SectorWriter writer;
+static SectorReader reader;
+
+static bool withinSector(const NativeCapture::SdAccess& a) {
+    return a.bytes == 0 || a.offset / SECTOR == (a.offset + a.bytes - 1) / SECTOR;
+}
+
+static void testRoundTrip() {
+    std::vector<uint8_t> data(3 * BLOCK + 777);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = (uint8_t)(i * 131 + (i >> 9));
+
+    NativeCapture::clear();
+    check(writer.open("/sector_test.bin", data.size()), "writer opens");
+    const size_t pieces[] = {4, 1, 13, 600, 5000, 3};
+    size_t at = 0;
+    for (size_t i = 0; at < data.size(); ++i) {
+        size_t n = pieces[i % 6];
+        if (n > data.size() - at) n = data.size() - at;
+        check(writer.write(data.data() + at, n) == n, "staged write");
+        at += n;
+    }
+    check(writer.position() == data.size(), "position counts staged bytes");
+    check(writer.finish(), "finish writes the tail");
+    bool blocks = NativeCapture::sdWrites.size() == 4;
+    for (size_t i = 0; blocks && i < 3; ++i) {
+        blocks = NativeCapture::sdWrites[i].offset == i * BLOCK && NativeCapture::sdWrites[i].bytes == BLOCK;
+    }
+    check(blocks && NativeCapture::sdWrites[3].bytes == 777, "whole aligned blocks, then the tail");
+
+    NativeCapture::clear();
+    check(reader.open("/sector_test.bin") && reader.size() == data.size(), "reader opens");
+    std::vector<uint8_t> back(data.size());
+    at = 0;
+    for (size_t i = 0; at < back.size(); ++i) {
+        size_t n = pieces[(i + 3) % 6];
+        if (n > back.size() - at) n = back.size() - at;
+        check(reader.read(back.data() + at, n) == (int)n, "read");
+        at += n;
+    }
+    check(back == data, "bytes read back as written");
+    check(reader.read(back.data(), 1) == 0, "nothing past the end");
+    bool aligned = NativeCapture::sdReads.size() <= 6;
+    for (const auto& r : NativeCapture::sdReads) aligned = aligned && r.offset % SECTOR == 0;
+    check(aligned, "a few bulk reads from sector boundaries");
+
+    // Seeks inside the buffered block leave the card alone
+    check(reader.seek(BLOCK + 10), "seek");
+    uint8_t b[4];
+    reader.read(b, sizeof(b));
+    size_t reads = NativeCapture::sdReads.size();
+    check(reader.seek(BLOCK + 100) && reader.read(b, sizeof(b)) == 4 && memcmp(b, &data[BLOCK + 100], 4) == 0,
+          "seek and read in the block");
+    check(NativeCapture::sdReads.size() == reads, "served from the buffer");
+    check(!reader.seek(data.size() + 1), "seek past the end refused");
+    reader.close();
+    SD.remove("/sector_test.bin");
+}
+
+static void fillSession() {
+    for (uint8_t t = 0; t < Config::NUM_TRACKS; ++t) {
+        Track& track = trackManager.getTrack(t);
+        NativeTrack::reset(track);
+    }
+    for (uint8_t t = 0; t < 3; ++t) {
+        Track& track = trackManager.getTrack(t);
+        for (uint32_t tick = 0; tick < 768 * 4; tick += 6) {
+            track.insertEvent(MidiEvent::NoteOn(tick, 1 + t, 40 + tick % 40, 100));
+            track.insertEvent(MidiEvent::NoteOff(tick + 3, 1 + t, 40 + tick % 40));
+        }
+        track.setLoopLength(768 * 4);
+        track.forceSetState(TRACK_PLAYING);
+        TrackUndo::pushUndoSnapshot(track);
+        track.insertEvent(MidiEvent::NoteOn(1, 1, 90, 90));
+    }
+}
+
+static void testCheckpoint() {
+    LooperState& state = looperState.getLooperState();
+    fillSession();
+    std::vector<MidiEvent> saved(trackManager.getTrack(1).getMidiEvents().begin(),
+                                 trackManager.getTrack(1).getMidiEvents().end());
+
+    NativeCapture::clear();
+    check(StorageManager::saveState(state), "checkpoint saved");
+    File f = SD.open("/midilooper.ckp", FILE_READ);
+    uint64_t bytes = f.size();
+    f.close();
+    bool aligned = true;
+    for (const auto& w : NativeCapture::sdWrites) aligned = aligned && w.offset % SECTOR == 0;
+    check(aligned, "every write starts on a sector");
+    check(NativeCapture::sdWrites.size() <= bytes / BLOCK + 3, "one write per block (plus tail and journal header)");
+
+    NativeCapture::clear();
+    check(StorageManager::loadState(state), "checkpoint loaded");
+    const EventList& loaded = trackManager.getTrack(1).getMidiEvents();
+    check(loaded.size() == saved.size() && memcmp(loaded.data(), saved.data(), saved.size() * sizeof(MidiEvent)) == 0,
+          "events round-trip");
+    check(TrackUndo::getUndoCount(trackManager.getTrack(1)) == 1, "undo level kept");
+    check(NativeCapture::sdReads.size() <= bytes / BLOCK + 6, "bulk reads");
+}
+
+// Let update() write buffered journal records (they wait for a quiet period)
+static void flush() {
+    for (int i = 0; i < 2000 && StorageManager::isSavePending(); ++i) {
+        StorageManager::update();
+        delay(1);
+    }
+}
+
+static void testJournalAppends() {
+    Track& track = trackManager.getTrack(0);
+    track.forceSetState(TRACK_OVERDUBBING);
+    NativeCapture::clear();
+    for (uint32_t i = 0; i < 150; ++i) {
+        track.noteOn(1, 100, 90, i * 5 + 1);
+        track.noteOff(1, 100, 0, i * 5 + 3);
+    }
+    track.forceSetState(TRACK_PLAYING);
+    size_t recorded = track.getMidiEventCount();
+    flush();
+    bool within = !NativeCapture::sdWrites.empty();
+    for (const auto& w : NativeCapture::sdWrites) within = within && withinSector(w);
+    check(within, "journal writes stay inside one sector each");
+
+    LooperState& state = looperState.getLooperState();
+    track.clear();
+    check(StorageManager::loadState(state) && track.getMidiEventCount() == recorded, "journal replays");
+}
+
+int main() {
+    char root[] = "/tmp/looper_sector_XXXXXX";
+    if (!mkdtemp(root)) {
+        std::fprintf(stderr, "FAIL: cannot create scratch directory\n");
+        return 1;
+    }
+    setenv("LOOPER_SD_ROOT", root, 1);
+    LooperState& state = looperState.getLooperState();
+    StorageManager::loadState(state);  // Fresh card: starts checkpoint and journal
+
+    NativeCapture::enabled = true;
+    testRoundTrip();
+    testCheckpoint();
+    testJournalAppends();
+    NativeCapture::enabled = false;
+
+    std::string cleanup = std::string("rm -rf ") + root;
+    std::system(cleanup.c_str());
+    return NativeTest::result("Sector file: aligned block writes, bulk reads, journal appends inside a sector");
+}
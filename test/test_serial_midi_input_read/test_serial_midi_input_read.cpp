@@ -5,35 +5,8 @@
 #include <vector>
 #include <cstdint>
 
-// Stubbed MIDI types and MidiEvent for host-side test
-namespace midi {
-    enum MidiType { NoteOn, NoteOff };
-}
-
-struct MidiEvent {
-    uint32_t tick;
-    midi::MidiType type;
-    uint8_t channel;
-    union {
-        struct { uint8_t note, velocity; } noteData;
-    } data;
-    static MidiEvent NoteOn(uint32_t tick, uint8_t channel, uint8_t note, uint8_t velocity) {
-        MidiEvent e;
-        e.tick = tick;
-        e.type = midi::NoteOn;
-        e.channel = channel;
-        e.data.noteData = {note, velocity};
-        return e;
-    }
-    static MidiEvent NoteOff(uint32_t tick, uint8_t channel, uint8_t note, uint8_t velocity = 0) {
-        MidiEvent e;
-        e.tick = tick;
-        e.type = midi::NoteOff;
-        e.channel = channel;
-        e.data.noteData = {note, velocity};
-        return e;
-    }
-};
+// Real MidiEvent from include/ (the native env links the firmware sources)
+#include "MidiEvent.h"
 
 int main() {
     bool success = true;
@@ -0,0 +1,56 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Replays generated MIDI streams through MidiHandler with a simulated clock (pio test -e native).
+// The same StressTest harness runs on the device in the teensy41_stress env.
+
+#include <iostream>
+#include "StressTest.h"
+
+struct Case {
+    const char* name;
+    StressConfig config;
+    uint32_t maxLatenessTicks;  // Playback may trail by at most this much
+};
+
+static StressConfig makeConfig(uint8_t notesPerBeat, uint8_t chordSize, uint8_t ccPerBeat,
+                               uint32_t stallEvery, uint32_t stallTicks) {
+    StressConfig c;
+    c.notesPerBeat = notesPerBeat;
+    c.chordSize = chordSize;
+    c.ccPerBeat = ccPerBeat;
+    c.stallEveryTicks = stallEvery;
+    c.stallTicks = stallTicks;
+    return c;
+}
+
+int main() {
+    const Case cases[] = {
+        {"steady 16ths",             makeConfig(4, 1, 0, 0, 0),     0},
+        {"dense chords + CC",        makeConfig(16, 4, 24, 0, 0),   0},
+        {"dense with loop() stalls", makeConfig(16, 4, 24, 96, 12), 12},
+    };
+
+    bool ok = true;
+    for (const Case& c : cases) {
+        std::cout << "--- " << c.name << std::endl;
+        StressReport report = StressTest::run(c.config);
+        StressTest::print(report, Serial);
+        if (!report.passed()) {
+            std::cerr << "FAIL: " << c.name << ": events missed or dropped\n";
+            ok = false;
+        }
+        if (report.recordShifted != 0) {
+            std::cerr << "FAIL: " << c.name << ": recorded off the arrival tick\n";
+            ok = false;
+        }
+        if (report.early != 0 || report.maxLatenessTicks > c.maxLatenessTicks) {
+            std::cerr << "FAIL: " << c.name << ": playback lateness " << report.maxLatenessTicks
+                      << " ticks (limit " << c.maxLatenessTicks << ")\n";
+            ok = false;
+        }
+    }
+
+    if (ok) std::cout << "✅ Stress replay: no missed or late events" << std::endl;
+    return ok ? 0 : 1;
+}
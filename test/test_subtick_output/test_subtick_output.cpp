@@ -0,0 +1,131 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Sub-tick output: swing and partial quantize fractions are kept by the transform, queued by the
+// OutputScheduler and sent at their microsecond deadline, in deadline order (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "ClockManager.h"
+#include "MidiHandler.h"
+#include "OutputScheduler.h"
+#include "TrackManager.h"
+#include "TrackTransform.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+// Swing 57 on a 16th grid puts the odd step at 54.72 ticks
+static void testFractions() {
+    TrackTransform t;
+    t.quantizeStrength = 100;
+    t.swing = 57;
+    uint16_t frac = 0;
+    check(t.moveStart(48, &frac) == 54 && frac > 0xB800 && frac < 0xB900, "swung step keeps its fraction");
+    check(t.moveStart(96, &frac) == 96 && frac == 0, "even step lands on the tick");
+
+    EventList events;
+    events.push_back(MidiEvent::NoteOn(48, 1, 60, 100));
+    events.push_back(MidiEvent::NoteOff(60, 1, 60));
+    events.push_back(MidiEvent::NoteOn(96, 1, 62, 100));
+    events.push_back(MidiEvent::NoteOff(100, 1, 62));
+    EventList out;
+    OffsetList offsets;
+    t.render(events, 768, out, &offsets);
+    check(offsets.size() == out.size(), "one offset per rendered event");
+    check(out.size() == 4 && out[0].tick == 54 && offsets[0] != 0, "swung NoteOn carries its fraction");
+    check(out[1].tick == 66 && offsets[1] == offsets[0], "NoteOff shares its NoteOn's fraction");
+    check(out[2].tick == 96 && offsets[2] == 0, "straight note has no fraction");
+
+    TrackTransform straight;
+    straight.quantizeStrength = 100;
+    straight.render(events, 768, out, &offsets);
+    check(offsets.empty(), "no offsets when every event is on a tick");
+}
+
+// Deadlines out of order go out in order, each when it is due
+static void testDeadlineOrder() {
+    NativeCapture::clear();
+    outputScheduler.resetStats();
+    uint32_t now = micros();
+    outputScheduler.schedule(0, MidiEvent::NoteOn(0, 1, 70, 100), now + 50000);
+    outputScheduler.schedule(0, MidiEvent::NoteOn(0, 1, 71, 100), now + 10000);
+    outputScheduler.schedule(0, MidiEvent::NoteOn(0, 1, 72, 100), now + 30000);
+    check(outputScheduler.getPendingCount() == 3, "three events pending");
+    check(outputScheduler.service(now) > 0 && NativeCapture::usb.empty(), "nothing sent before its deadline");
+
+    check(midiHandler.claimPort(), "claim the ports");
+    check(outputScheduler.service(now + 15000) == Config::OUTPUT_RETRY_US && NativeCapture::usb.empty(),
+          "retries while another writer holds the ports");
+    midiHandler.releasePort();
+
+    uint32_t wait = outputScheduler.service(now + 15000);
+    check(NativeCapture::usb.size() == 1 && NativeCapture::usb[0].data1 == 71, "earliest deadline sent first");
+    check(wait == 15000, "next wait is to the next deadline");
+    check(outputScheduler.service(now + 60000) == 0, "queue empty after the last deadline");
+    check(NativeCapture::usb.size() == 3 && NativeCapture::usb[1].data1 == 72 && NativeCapture::usb[2].data1 == 70,
+          "remaining events in deadline order");
+    check(outputScheduler.getSentOnTime() == 3 && outputScheduler.getMaxLateMicros() == 30000, "late time measured");
+
+    // A deadline already passed is sent at once
+    outputScheduler.schedule(0, MidiEvent::NoteOn(0, 1, 73, 100), micros() - 100);
+    check(countUsb(midi::NoteOn, 73) == 1 && outputScheduler.getSentImmediately() == 1, "past deadline sent at once");
+}
+
+// Cancelling a track drops its NoteOns and sends its NoteOffs now; other tracks keep theirs
+static void testCancel() {
+    NativeCapture::clear();
+    uint32_t now = micros();
+    outputScheduler.schedule(0, MidiEvent::NoteOn(0, 1, 80, 100), now + 40000);
+    outputScheduler.schedule(0, MidiEvent::NoteOff(0, 1, 81), now + 40000);
+    outputScheduler.schedule(1, MidiEvent::NoteOn(0, 1, 82, 100), now + 40000);
+    outputScheduler.cancelTrack(0);
+    check(countUsb(midi::NoteOff, 81) == 1, "pending NoteOff sent on cancel");
+    check(countUsb(midi::NoteOn, 80) == 0, "pending NoteOn dropped on cancel");
+    check(outputScheduler.getPendingCount() == 1, "other track's event still pending");
+    outputScheduler.service(now + 50000);
+    check(countUsb(midi::NoteOn, 82) == 1 && countUsb(midi::NoteOn, 80) == 0, "only the other track's note sounds");
+}
+
+// Playback: the swung NoteOn is queued when its tick plays and sent inside that tick
+static void testSwungPlayback() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    track.setLoopLength(768);
+    track.insertEvent(MidiEvent::NoteOn(48, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(60, 1, 60));
+    TrackTransform t;
+    t.quantizeStrength = 100;
+    t.swing = 57;
+    track.setTransform(t);
+    track.forceSetState(TRACK_STOPPED);
+    track.startPlaying(0);
+
+    NativeCapture::clear();
+    clockManager.locate(53);
+    clockManager.updateInternalClock();  // Tick 54, stamped now
+    uint32_t played = micros();
+    clockManager.processPendingTicks();
+    check(countUsb(midi::NoteOn, 60) == 0, "swung note not sent on the whole tick");
+    check(outputScheduler.getPendingCount() == 1, "swung note queued");
+    outputScheduler.service(played + 5000);
+    check(countUsb(midi::NoteOn, 60) == 1, "swung note sent at its deadline");
+
+    // Stopping with the NoteOff still queued sends it now
+    clockManager.locate(65);
+    clockManager.updateInternalClock();
+    clockManager.processPendingTicks();
+    check(outputScheduler.getPendingCount() == 1, "swung NoteOff queued");
+    track.stopPlaying();
+    check(countUsb(midi::NoteOff, 60) >= 1 && outputScheduler.getPendingCount() == 0, "stop flushes the NoteOff");
+}
+
+int main() {
+    clockManager.setup();
+    outputScheduler.setup();
+    NativeCapture::enabled = true;
+    testFractions();
+    testDeadlineOrder();
+    testCancel();
+    testSwungPlayback();
+    return NativeTest::result("Sub-tick output: swing fractions sent at their microsecond, in deadline order");
+}
@@ -0,0 +1,176 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// SysEx looping: whole messages recorded into the track's SysEx store, played back from the
+// store without a copy, kept through checkpoint, journal and boot restore (pio test -e native).
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <SD.h>
+#include "Globals.h"
+#include "LooperState.h"
+#include "MidiHandler.h"
+#include "StorageManager.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static std::string sdRoot;
+
+// A patch-dump-sized message: F0, manufacturer, a ramp of data bytes, F7
+static std::vector<uint8_t> makeSysEx(uint16_t length, uint8_t seed) {
+    std::vector<uint8_t> msg(length);
+    msg[0] = 0xF0;
+    for (uint16_t i = 1; i + 1 < length; ++i) msg[i] = (uint8_t)((seed + i) & 0x7F);
+    msg[length - 1] = 0xF7;
+    return msg;
+}
+
+static void setupTrack(Track& track) {
+    NativeTrack::reset(track);
+    track.setLoopLength(768);
+    track.forceSetState(TRACK_OVERDUBBING);
+}
+
+static void record(const std::vector<uint8_t>& msg, uint32_t tick) {
+    midiHandler.handleSysEx(msg.data(), (uint16_t)msg.size(), MidiInputStamp{micros(), tick, 0});
+}
+
+// One pass of the loop; returns the SysEx messages sent
+static size_t playPass(Track& track) {
+    NativeCapture::clear();
+    track.forceSetState(TRACK_PLAYING);
+    for (uint32_t t = 0; t < 768; ++t) track.playMidiEvents(t, true);
+    return NativeCapture::usbSysEx.size();
+}
+
+static const MidiEvent* findSysEx(const Track& track, size_t nth) {
+    for (const auto& evt : track.getMidiEvents()) {
+        if (evt.type == midi::SystemExclusive && nth-- == 0) return &evt;
+    }
+    return nullptr;
+}
+
+static void testRecordAndPlay() {
+    Track& track = trackManager.getTrack(0);
+    trackManager.setSelectedTrack(0);
+    setupTrack(track);
+    std::vector<uint8_t> dump = makeSysEx(300, 5);
+    record(dump, 100);
+    const MidiEvent* evt = findSysEx(track, 0);
+    check(evt && evt->tick == 100, "SysEx recorded at its arrival tick");
+    const SysExStore& store = track.getSysExStore();
+    check(store.size() == SysExStore::HEADER + dump.size(), "bytes pooled in the track's store");
+
+    // Truncated and split messages are not recorded
+    uint32_t overflows = midiHandler.getInputOverflowCount();
+    std::vector<uint8_t> torn(dump.begin(), dump.begin() + 64);
+    record(torn, 200);
+    check(findSysEx(track, 1) == nullptr && midiHandler.getInputOverflowCount() == overflows + 1,
+          "message without F7 dropped and counted");
+
+    check(playPass(track) == 1, "SysEx played once per pass");
+    const auto& sent = NativeCapture::usbSysEx[0];
+    check(sent.bytes == dump && sent.hasTerm, "played bytes match the recording");
+    check(sent.data == store.data() + evt->data.sysexOffset + SysExStore::HEADER, "sent straight from the store");
+
+    // A damaged offset is skipped, not sent
+    uint16_t length;
+    check(store.message((uint16_t)(store.size() - 1), length) == nullptr && length == 0, "offset past the store rejected");
+}
+
+static void testClearAndUndoClear() {
+    Track& track = trackManager.getTrack(0);
+    size_t bytes = track.getSysExStore().size();
+    TrackUndo::pushClearTrackSnapshot(track);
+    track.clear();
+    check(track.getSysExStore().size() == bytes, "bytes kept while a clear copy refers to them");
+    TrackUndo::undoClearTrack(track);
+    check(playPass(track) == 1 && NativeCapture::usbSysEx[0].bytes.size() == 300, "undone clear plays the SysEx");
+    track.clear();
+    check(track.getSysExStore().size() == 0, "store emptied with the last reference");
+    track.setLoopLength(768);  // Leave the track as the next test expects
+    track.forceSetState(TRACK_OVERDUBBING);
+}
+
+// Let update() write buffered journal records (they wait for a quiet period)
+static void flush() {
+    for (int i = 0; i < 2000 && StorageManager::isSavePending(); ++i) {
+        StorageManager::update();
+        delay(1);
+    }
+}
+
+static void copyFile(const std::string& from, const std::string& to) {
+    std::string cmd = "cp " + sdRoot + from + " " + sdRoot + to;
+    check(std::system(cmd.c_str()) == 0, "copy file");
+}
+
+static bool holds(const Track& track, const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    const MidiEvent* first = findSysEx(track, 0);
+    const MidiEvent* second = findSysEx(track, 1);
+    uint16_t la = 0, lb = 0;
+    const uint8_t* pa = first ? track.getSysExStore().message(first->data.sysexOffset, la) : nullptr;
+    const uint8_t* pb = second ? track.getSysExStore().message(second->data.sysexOffset, lb) : nullptr;
+    return pa && pb && la == a.size() && lb == b.size() && memcmp(pa, a.data(), la) == 0 &&
+           memcmp(pb, b.data(), lb) == 0;
+}
+
+// One message in the checkpoint, one only in the journal
+static void testPersistence() {
+    LooperState& state = looperState.getLooperState();
+    Track& track = trackManager.getTrack(0);
+    setupTrack(track);
+    std::vector<uint8_t> patch = makeSysEx(1000, 1);
+    std::vector<uint8_t> param = makeSysEx(12, 9);
+    record(patch, 0);
+    track.forceSetState(TRACK_PLAYING);
+    check(StorageManager::saveState(state), "checkpoint written");
+    track.forceSetState(TRACK_OVERDUBBING);
+    record(param, 384);
+    track.forceSetState(TRACK_PLAYING);
+    flush();
+    copyFile("/midilooper.ckp", "/saved.ckp");
+    copyFile("/midilooper.jnl", "/saved.jnl");
+
+    track.clear();
+    check(track.getSysExStore().size() == 0, "store empty before the load");
+    check(StorageManager::loadState(state), "state loaded");
+    check(holds(track, patch, param), "checkpoint and journal SysEx loaded");
+
+    // The same through the background restore
+    track.clear();
+    copyFile("/saved.ckp", "/midilooper.ckp");
+    copyFile("/saved.jnl", "/midilooper.jnl");
+    check(StorageManager::beginRestore(state), "restore started");
+    for (int i = 0; i < 100000 && StorageManager::isRestoring(); ++i) StorageManager::update();
+    check(!StorageManager::isRestoring() && holds(track, patch, param), "SysEx restored in the background");
+    check(playPass(track) == 2 && NativeCapture::usbSysEx[1].bytes == param, "restored SysEx plays");
+}
+
+int main() {
+    char root[] = "/tmp/looper_sysex_XXXXXX";
+    if (!mkdtemp(root)) {
+        std::fprintf(stderr, "FAIL: cannot create scratch directory\n");
+        return 1;
+    }
+    sdRoot = root;
+    setenv("LOOPER_SD_ROOT", root, 1);
+    LooperState& state = looperState.getLooperState();
+    StorageManager::loadState(state);  // Fresh card: starts checkpoint and journal
+
+    NativeCapture::enabled = true;
+    testRecordAndPlay();
+    testClearAndUndoClear();
+    testPersistence();
+    NativeCapture::enabled = false;
+
+    std::string cleanup = "rm -rf " + sdRoot;
+    std::system(cleanup.c_str());
+    return NativeTest::result("SysEx: recorded into the track's store, played from it, saved and restored");
+}
@@ -0,0 +1,155 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Timing profiles: reciprocal dividers exact against '/', meter changes on the next bar line,
+// bar / beat positions and loop rounding in odd meters, time signature from a MIDI file
+// (pio test -e native).
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <SD.h>
+#include "Globals.h"
+#include "ClockManager.h"
+#include "DisplayManager.h"
+#include "MidiFile.h"
+#include "TimeSignature.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static_assert(Config::TICKS_PER_CLOCK == 8 && Config::TICKS_PER_BAR == 768, "default profile: 192 PPQN, 4/4");
+static_assert(Config::TIMING.ticksPerBar({7, 8}) == 672 && Config::TIMING.ticksPerBeat({3, 16}) == 48,
+              "bar and beat lengths from the meter");
+static_assert(!Timing::Meter{4, 3}.valid() && !Timing::Meter{0, 4}.valid(), "meters this PPQN cannot count");
+
+static void testDividers() {
+    const uint32_t divisors[] = {1, 3, 7, 8, 48, 96, 192, 576, 672, 768, 1344, 65535, 0x7FFFFFFF};
+    uint32_t x = 12345;
+    bool exact = true;
+    for (uint32_t d : divisors) {
+        Timing::TickDivider div(d);
+        const uint32_t edges[] = {0, 1, d - 1, d, d + 1, 2 * d - 1, 0xFFFFFFFE, 0xFFFFFFFF};
+        for (uint32_t e : edges) exact = exact && div.div(e) == e / d && div.mod(e) == e % d;
+        for (int i = 0; i < 20000; ++i) {
+            x = x * 1664525u + 1013904223u;
+            exact = exact && div.div(x) == x / d && div.mod(x) == x % d;
+        }
+    }
+    check(exact, "reciprocal divide matches '/' and '%'");
+}
+
+static bool at(const TimeSignature::Position& p, uint32_t bar, uint8_t beat, uint8_t sixteenth, uint16_t tick) {
+    return p.bar == bar && p.beat == beat && p.sixteenth == sixteenth && p.tick == tick;
+}
+
+static void testMeterChange() {
+    TimeSignature sig;
+    check(sig.ticksPerBar() == 768 && at(sig.position(700), 1, 4, 3, 28), "4/4 from boot");
+    check(!sig.setMeter({5, 3}, 0), "invalid meter refused");
+
+    // Asked for mid-bar: 7/8 starts at the next 4/4 bar line
+    check(sig.setMeter({7, 8}, 100), "7/8 set");
+    check(sig.meterAt(767) == Timing::Meter{4, 4} && sig.meterAt(768) == Timing::Meter{7, 8}, "change on the bar line");
+    check(sig.isBarStart(768) && sig.isBarStart(768 + 672) && !sig.isBarStart(768 + 768), "7/8 bars of 672 ticks");
+    check(at(sig.position(768 + 3 * 96 + 58), 2, 4, 2, 10), "position in 7/8");
+    check(at(sig.position(768 + 672), 3, 1, 1, 0) && sig.barStartAtOrBefore(768 + 1000) == 768 + 672, "bars counted on");
+    check(at(sig.loopPosition(700), 2, 1, 1, 28), "loop positions in the newest meter");
+    check(sig.barsIn(3 * 672) == 3, "loop bars in the newest meter");
+
+    // Set again after a locate backwards: the later change is replaced
+    check(sig.setMeter({3, 4}, 10) && sig.meterAt(2000) == Timing::Meter{3, 4} && sig.isBarStart(768 + 576),
+          "earlier change replaces a later one");
+
+    // More changes than the table holds: bar numbers of the newest still count from tick 0
+    sig.reset();
+    uint32_t tick = 0, bar = 1;
+    for (uint8_t n = 2; n < 2 + 3 * Config::METER_CHANGES; ++n) {
+        Timing::Meter meter{n, 8};
+        check(sig.setMeter(meter, tick), "change accepted");
+        tick += Config::TIMING.ticksPerBar(sig.meterAt(tick));
+        bar++;
+    }
+    check(sig.position(tick).bar == bar, "bar numbers kept when old changes are dropped");
+}
+
+// Takes round to and wait for bars of the running meter
+static void testRecordingIn34() {
+    timeSignature.reset({3, 4});
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    track.setState(TRACK_ARMED);
+    track.startRecording(576);
+    track.stopRecording(576 + 576 + 400);  // 1.7 bars of 3/4; in 4/4 this would round down to one bar
+    check(track.getLoopLength() == 1152, "take rounded to whole 3/4 bars");
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+
+    check(clockManager.isClockRunning(), "clock running");
+    trackManager.queueRecordingTrack(1);
+    trackManager.updateAllTracks(768);
+    check(!trackManager.getTrack(1).isRecording(), "no start on a 4/4 bar line");
+    trackManager.updateAllTracks(1152);
+    check(trackManager.getTrack(1).isRecording(), "queued take starts on the 3/4 bar line");
+    trackManager.getTrack(1).forceSetState(TRACK_PLAYING);
+    trackManager.getTrack(1).clear();
+
+    // The piano roll draws its grid in the running meter
+    trackManager.setSelectedTrack(0);
+    track.insertEvent(MidiEvent::NoteOn(0, 1, 60, 100));
+    track.insertEvent(MidiEvent::NoteOff(96, 1, 60));
+    track.setLoopLength(1152);
+    track.forceSetState(TRACK_STOPPED);
+    displayManager.update();
+    timeSignature.reset({7, 8});
+    displayManager.update();
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+    timeSignature.reset();
+}
+
+// Type 0, 96 PPQN, 7/8: the meter follows the file, the loop rounds to its bars
+static void testFileMeter() {
+    std::vector<uint8_t> smf = {
+        'M', 'T', 'h', 'd', 0, 0, 0, 6, 0, 0, 0, 1, 0, 96,
+        'M', 'T', 'r', 'k', 0, 0, 0, 19,
+        0x00, 0xFF, 0x58, 0x04, 7, 3, 12, 8,  // 7/8, a click per eighth
+        0x00, 0x90, 60, 100,
+        0x60, 60, 0,                          // 96 ticks at 96 PPQN
+        0x00, 0xFF, 0x2F, 0x00,
+    };
+    SD.remove("/test_meter.mid");
+    File f = SD.open("/test_meter.mid", FILE_WRITE);
+    f.write(smf.data(), smf.size());
+    f.close();
+    Track& track = trackManager.getTrack(0);
+    check(MidiFile::importSession("/test_meter.mid"), "import succeeds");
+    check(timeSignature.getMeter() == Timing::Meter{7, 8}, "meter taken from the file");
+    check(track.getLoopLength() == 672, "loop rounded up to a 7/8 bar");
+
+    // Export writes the running meter back
+    check(MidiFile::exportSession("/test_meter.mid"), "export succeeds");
+    f = SD.open("/test_meter.mid", FILE_READ);
+    std::vector<uint8_t> bytes((size_t)f.size());
+    f.read(bytes.data(), bytes.size());
+    f.close();
+    const uint8_t sig[] = {0xFF, 0x58, 0x04, 7, 3, 12, 8};
+    bool found = false;
+    for (size_t i = 0; i + sizeof(sig) <= bytes.size() && !found; ++i) {
+        found = memcmp(&bytes[i], sig, sizeof(sig)) == 0;
+    }
+    check(found, "7/8 time signature exported");
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+    SD.remove("/test_meter.mid");
+    timeSignature.reset();
+}
+
+int main() {
+    clockManager.setup();
+    testDividers();
+    testMeterChange();
+    testRecordingIn34();
+    testFileMeter();
+    return NativeTest::result("Timing profile: exact reciprocal divides, meter changes on the bar, odd meters");
+}
@@ -0,0 +1,114 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Track summaries for the all-tracks overview: updated per recorded or edited event, rebuilt once
+// after other changes, equal to a full rebuild throughout (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "DisplayManager.h"
+#include "TrackManager.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+// The summary matches one built from scratch
+static bool matchesRebuild(const Track& track) {
+    static TrackSummary fresh;
+    fresh.rebuild(track.getMidiEvents(), track.getLoopLength());
+    const TrackSummary& summary = track.getSummary();
+    for (uint16_t c = 0; c < TrackSummary::COLUMNS; ++c) {
+        if (summary.notes(c) != fresh.notes(c) || summary.others(c) != fresh.others(c)) return false;
+    }
+    return true;
+}
+
+static size_t indexOf(const Track& track, uint32_t tick, midi::MidiType type) {
+    const auto& events = track.getMidiEvents();
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (events[i].tick == tick && events[i].type == type) return i;
+    }
+    return events.size();
+}
+
+static Track& setupTrack() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    track.setLoopLength(768);
+    for (uint32_t t = 0; t < 768; t += 48) {
+        track.insertEvent(MidiEvent::NoteOn(t, 1, 60, 100));
+        track.insertEvent(MidiEvent::NoteOff(t + 24, 1, 60));
+    }
+    track.insertEvent(MidiEvent::ControlChange(400, 1, 7, 64));
+    track.forceSetState(TRACK_PLAYING);
+    return track;
+}
+
+static void testIncremental() {
+    Track& track = setupTrack();
+    check(matchesRebuild(track), "built summary matches");
+    const TrackSummary& summary = track.getSummary();
+    uint16_t column = (uint16_t)(400u * TrackSummary::COLUMNS / 768);
+    check(summary.others(column) == 1 && summary.notes(column) == 0, "CC counted apart from notes");
+    check(summary.notes(0) == 1, "note start counted, NoteOff not");
+
+    // One recorded event moves the summary by one step, no rebuild
+    uint32_t version = summary.getVersion();
+    track.insertEvent(MidiEvent::NoteOn(1, 1, 64, 90));
+    check(track.getSummary().getVersion() == version + 1 && summary.notes(0) == 2, "insert updates the column");
+
+    auto& events = track.editMidiEvents();
+    track.eraseEvent(events.begin() + indexOf(track, 1, midi::NoteOn));
+    check(track.getSummary().getVersion() == version + 2 && summary.notes(0) == 1, "erase updates the column");
+
+    // An editor move: remove + add in one commit
+    EventEdit edit(track);
+    size_t on = indexOf(track, 96, midi::NoteOn);
+    size_t off = indexOf(track, 120, midi::NoteOff);
+    check(edit.move(on, 500) && edit.move(off, 524), "stage move");
+    track.commitEdit(edit);
+    check(track.getSummary().getVersion() == version + 4, "commit updates per event");
+    check(matchesRebuild(track), "summary after edits matches a rebuild");
+}
+
+// Edits outside the hashed paths and a new loop length rebuild once
+static void testRebuilds() {
+    Track& track = setupTrack();
+    track.getSummary();
+    track.editMidiEvents()[0].tick = 700;
+    track.markEventsChanged();
+    uint32_t version = track.getSummary().getVersion();
+    check(matchesRebuild(track) && track.getSummary().getVersion() == version, "direct edit rebuilt once");
+
+    track.setLoopLength(1536);
+    check(track.getSummary().getLoopLength() == 1536 && matchesRebuild(track), "new loop length respreads the columns");
+}
+
+// A column over 255 saturates; removing from it rebuilds instead of guessing
+static void testSaturation() {
+    Track& track = setupTrack();
+    for (int i = 0; i < 300; ++i) track.insertEvent(MidiEvent::ControlChange(401, 1, 1, (uint8_t)(i & 0x7F)));
+    uint16_t column = (uint16_t)(401u * TrackSummary::COLUMNS / 768);
+    check(track.getSummary().others(column) == 255, "count saturates");
+    auto& events = track.editMidiEvents();
+    track.eraseEvent(events.begin() + indexOf(track, 401, midi::ControlChange));
+    check(track.getSummary().others(column) == 255 && matchesRebuild(track), "removal from a saturated column rebuilds");
+}
+
+static void testOverviewFrame() {
+    setupTrack();
+    displayManager.setOverview(true);
+    displayManager.update();
+    check(displayManager.isOverview(), "overview drawn");
+    displayManager.toggleOverview();
+    displayManager.update();
+    check(!displayManager.isOverview(), "back to the piano roll");
+}
+
+int main() {
+    trackManager.setSelectedTrack(0);
+    testIncremental();
+    testRebuilds();
+    testSaturation();
+    testOverviewFrame();
+    return NativeTest::result("Track summary: per-event updates match rebuilds; overview drawn from summaries");
+}
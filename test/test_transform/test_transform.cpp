@@ -0,0 +1,126 @@
+//  Copyright (c)  2025 Lytrix (Eelke Jager)
+//  Licensed under the PolyForm Noncommercial 1.0.0
+
+// Playback transforms: quantize, swing, transpose, velocity and length rendered from untouched
+// events, applied at the loop start, and baked in by commitTransform() (pio test -e native).
+
+#include <iostream>
+#include "Globals.h"
+#include "MidiHandler.h"
+#include "TrackManager.h"
+#include "TrackUndo.h"
+#include "NativeTrack.h"
+#include "NativeTest.h"
+
+static const MidiEvent* find(const EventList& events, midi::MidiType type, uint8_t note) {
+    for (const auto& e : events) {
+        if (e.type == type && e.data.noteData.note == note) return &e;
+    }
+    return nullptr;
+}
+
+// 60 over [10, 100), 62 over [90, 130), 64 over [700, 40) wrapping a 768 tick loop
+static void fill(EventList& events) {
+    events.push_back(MidiEvent::NoteOff(40, 1, 64));
+    events.push_back(MidiEvent::NoteOn(10, 1, 60, 100));
+    events.push_back(MidiEvent::NoteOn(90, 1, 62, 80));
+    events.push_back(MidiEvent::NoteOff(100, 1, 60));
+    events.push_back(MidiEvent::NoteOff(130, 1, 62));
+    events.push_back(MidiEvent::NoteOn(700, 1, 64, 120));
+    std::stable_sort(events.begin(), events.end(),
+                     [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; });
+}
+
+static void testRender() {
+    EventList events;
+    fill(events);
+    EventList out;
+
+    TrackTransform t;
+    t.quantizeStrength = 100;
+    t.transpose = 2;
+    t.velocityScale = 50;
+    t.lengthScale = 200;
+    t.render(events, 768, out);
+    const MidiEvent* on = find(out, midi::NoteOn, 62);
+    const MidiEvent* off = find(out, midi::NoteOff, 62);
+    check(on && on->tick == 0 && on->data.noteData.velocity == 50, "60 -> 62 quantized to 0, half velocity");
+    check(off && off->tick == 180, "length 90 doubled from the new start");
+    on = find(out, midi::NoteOn, 64);
+    check(on && on->tick == 96, "62 -> 64 quantized to 96");
+    on = find(out, midi::NoteOn, 66);
+    off = find(out, midi::NoteOff, 66);
+    check(on && on->tick == 720 && on->data.noteData.velocity == 60, "wrapping note moved to 720");
+    check(off && off->tick == 720 + 2 * 108, "wrapped length measured over the loop end");
+    check(std::is_sorted(out.begin(), out.end(),
+                         [](const MidiEvent& a, const MidiEvent& b) { return a.tick < b.tick; }),
+          "render is sorted");
+
+    // Half strength, heavy swing: odd step 1 (48) moves towards 48 + 0.4 * 48
+    TrackTransform s;
+    s.quantizeStrength = 50;
+    s.swing = 70;
+    check(s.moveStart(40) == 40 + (67 - 40) / 2, "swung, half-strength quantize");
+    check(s.moveStart(100) == 98, "even steps are not swung");
+
+    // Out of range: the note and its NoteOff are dropped
+    TrackTransform up;
+    up.transpose = 70;
+    up.render(events, 768, out);
+    check(!find(out, midi::NoteOn, 134 - 128) && out.size() == 0, "notes past 127 dropped with their NoteOffs");
+}
+
+static void testPlayback() {
+    Track& track = trackManager.getTrack(0);
+    NativeTrack::reset(track);
+    track.setLoopLength(768);
+    EventList& events = track.editMidiEvents();
+    fill(events);
+    track.markEventsChanged();
+    track.forceSetState(TRACK_PLAYING);
+    uint32_t hash = track.getContentHash();
+    size_t undoLevels = TrackUndo::getUndoCount(track);
+
+    for (uint32_t t = 0; t < 768; ++t) track.playMidiEvents(t, true);
+    TrackTransform t;
+    t.transpose = 12;
+    track.setTransform(t);
+    NativeCapture::clear();
+    for (uint32_t tick = 768; tick < 768 + 200; ++tick) track.playMidiEvents(tick, true);
+    check(countUsb(midi::NoteOn, 72) == 1 && countUsb(midi::NoteOn, 60) == 0, "transpose applied from the next pass");
+    check(countUsb(midi::NoteOff, 64) == 1, "note started before the change still gets its NoteOff");
+
+    // Changed mid-pass: the rest of the pass keeps the old render
+    t.transpose = 0;
+    track.setTransform(t);
+    NativeCapture::clear();
+    for (uint32_t tick = 768 + 200; tick < 768 * 2 + 200; ++tick) track.playMidiEvents(tick, true);
+    check(countUsb(midi::NoteOn, 76) == 1, "rest of the pass played with the old transform");
+    check(countUsb(midi::NoteOn, 60) == 1, "new pass played with the new transform");
+    check(track.getContentHash() == hash && TrackUndo::getUndoCount(track) == undoLevels,
+          "stored events and undo untouched by transforms");
+
+    // Commit: one undo level, events now hold the transform
+    t.velocityScale = 50;
+    track.setTransform(t);
+    check(track.commitTransform(), "transform committed");
+    check(TrackUndo::getUndoCount(track) == undoLevels + 1, "commit is one undo level");
+    check(track.getTransform().isIdentity(), "transform reset after the commit");
+    EventList stored(events.begin(), events.end());
+    const MidiEvent* on = find(stored, midi::NoteOn, 60);
+    check(on && on->data.noteData.velocity == 50, "velocity baked into the events");
+    check(!track.commitTransform(), "nothing to commit without a transform");
+
+    track.stopPlaying();
+    TrackUndo::clearHistory(track);
+    track.forceSetState(TRACK_PLAYING);
+    track.clear();
+}
+
+int main() {
+    NativeCapture::enabled = true;
+    testRender();
+    testPlayback();
+    NativeCapture::enabled = false;
+    return NativeTest::result("Transforms: rendered at playback, applied per pass, committed as one undo");
+}